@@ -45,16 +45,30 @@ PROJECTM_EXPORT unsigned int projectm_pcm_get_max_samples();
  * @brief Adds 32-bit floating-point audio samples.
  *
  * This function is used to add new audio data to projectM's internal audio buffer. It is internally converted
- * to 2-channel float data, duplicating the channel.
+ * to 2-channel float data. Mono data is copied into both channels, stereo data is used as is and data
+ * with 3 to 8 channels is downmixed to stereo.
  *
- * If stereo, the channel order in samples is LRLRLR.
+ * Samples are interleaved, one sample per channel for each point in time, e.g. LRLRLR for stereo.
+ * The default downmix matrices expect the WAVE (WAVEFORMATEXTENSIBLE) channel order:
+ * - 3 channels: L, R, C
+ * - 4 channels (quad): L, R, Ls, Rs
+ * - 5 channels (5.0): L, R, C, Ls, Rs
+ * - 6 channels (5.1): L, R, C, LFE, Ls, Rs
+ * - 7 channels (6.1): L, R, C, LFE, Cs, Ls, Rs
+ * - 8 channels (7.1): L, R, C, LFE, Lb, Rb, Ls, Rs
+ *
+ * C is the center, LFE the low-frequency effects, Ls/Rs the side or surround, Lb/Rb the back and Cs
+ * the back center channel.
+ *
+ * For other channel orders, set a matching matrix with projectm_pcm_set_downmix_matrix(). With more
+ * than 8 channels, only the first two are used as left and right.
  *
  * @param instance The projectM instance handle.
  * @param samples An array of PCM samples.
  * Each sample is expected to be within the range -1 to 1.
  * @param count The number of audio samples in a channel.
- * @param channels If the buffer is mono or stereo.
- * Can be PROJECTM_MONO or PROJECTM_STEREO.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
  */
 PROJECTM_EXPORT void projectm_pcm_add_float(projectm_handle instance, const float* samples,
                                             unsigned int count, projectm_channels channels);
@@ -63,15 +77,17 @@ PROJECTM_EXPORT void projectm_pcm_add_float(projectm_handle instance, const floa
  * @brief Adds 16-bit integer audio samples.
  *
  * This function is used to add new audio data to projectM's internal audio buffer. It is internally converted
- * to 2-channel float data, duplicating the channel.
+ * to 2-channel float data. Mono data is copied into both channels, stereo data is used as is and data
+ * with 3 to 8 channels is downmixed to stereo.
  *
- * If stereo, the channel order in samples is LRLRLR.
+ * Samples are interleaved, e.g. LRLRLR for stereo. See projectm_pcm_add_float() for the channel order
+ * of data with more than two channels.
  *
  * @param instance The projectM instance handle.
  * @param samples An array of PCM samples.
  * @param count The number of audio samples in a channel.
- * @param channels If the buffer is mono or stereo.
- * Can be PROJECTM_MONO or PROJECTM_STEREO.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
  */
 PROJECTM_EXPORT void projectm_pcm_add_int16(projectm_handle instance, const int16_t* samples,
                                             unsigned int count, projectm_channels channels);
@@ -80,19 +96,224 @@ PROJECTM_EXPORT void projectm_pcm_add_int16(projectm_handle instance, const int1
  * @brief Adds 8-bit unsigned integer audio samples.
  *
  * This function is used to add new audio data to projectM's internal audio buffer. It is internally converted
- * to 2-channel float data, duplicating the channel.
+ * to 2-channel float data. Mono data is copied into both channels, stereo data is used as is and data
+ * with 3 to 8 channels is downmixed to stereo.
  *
- * If stereo, the channel order in samples is LRLRLR.
+ * Samples are interleaved, e.g. LRLRLR for stereo. See projectm_pcm_add_float() for the channel order
+ * of data with more than two channels.
  *
  * @param instance The projectM instance handle.
  * @param samples An array of PCM samples.
  * @param count The number of audio samples in a channel.
- * @param channels If the buffer is mono or stereo.
- * Can be PROJECTM_MONO or PROJECTM_STEREO.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
  */
 PROJECTM_EXPORT void projectm_pcm_add_uint8(projectm_handle instance, const uint8_t* samples,
                                             unsigned int count, projectm_channels channels);
 
+/**
+ * @brief Callback function that writes new audio samples directly into projectM's audio buffer.
+ *
+ * The callback receives contiguous, non-interleaved spans of projectM's internal left and right
+ * channel buffers. For mono audio, write the same samples into both spans.
+ *
+ * @param left Receives the left channel samples, each within the range -1 to 1.
+ * @param right Receives the right channel samples, each within the range -1 to 1.
+ * @param max_samples The maximum number of samples to write into each span.
+ * @param user_data A user-defined data pointer that was provided when registering the callback,
+ *                  e.g. context information.
+ * @return The number of samples written per channel. Must not exceed max_samples.
+ */
+typedef unsigned int (*projectm_pcm_pull_callback)(float* left, float* right, unsigned int max_samples,
+                                                   void* user_data);
+
+/**
+ * @brief Sets a callback function that provides audio samples when projectM needs them.
+ *
+ * This is an alternative to the projectm_pcm_add_* functions which avoids copying the audio
+ * data into a separate buffer first. The callback is called before each audio analysis pass,
+ * while rendering a frame or, if enabled, in the background analysis thread. If the callback
+ * returns max_samples and the buffer wraps around, it is called a second time for the rest.
+ *
+ * Don't call any of the projectm_pcm_add_* functions while a callback is set.
+ *
+ * Must be called from the rendering thread. Only one callback can be registered per projectM
+ * instance. To remove the callback, use NULL.
+ *
+ * @param instance The projectM instance handle.
+ * @param callback A pointer to the callback function.
+ * @param user_data A pointer to any data that will be sent back in the callback, e.g. context
+ *                  information.
+ */
+PROJECTM_EXPORT void projectm_pcm_set_pull_callback(projectm_handle instance, projectm_pcm_pull_callback callback,
+                                                    void* user_data);
+
+/**
+ * @brief Returns the current time of the clock used for audio sample timestamps.
+ *
+ * This is a monotonic clock, e.g. CLOCK_MONOTONIC on Linux and QueryPerformanceCounter() on Windows.
+ *
+ * @return The current time in seconds.
+ */
+PROJECTM_EXPORT double projectm_pcm_get_current_time();
+
+/**
+ * @brief Adds 32-bit floating-point audio samples with a playback timestamp.
+ *
+ * Same as projectm_pcm_add_float(), but also records when the first sample will be audible. With
+ * timestamps, projectM analyzes the audio played back at the time the frame is displayed instead
+ * of the newest samples. See projectm_pcm_set_presentation_latency().
+ *
+ * @param instance The projectM instance handle.
+ * @param samples An array of PCM samples.
+ * Each sample is expected to be within the range -1 to 1.
+ * @param count The number of audio samples in a channel.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
+ * @param timestamp The playback time of the first sample, in seconds, on the clock returned by
+ *                  projectm_pcm_get_current_time().
+ */
+PROJECTM_EXPORT void projectm_pcm_add_float_timestamped(projectm_handle instance, const float* samples,
+                                                        unsigned int count, projectm_channels channels,
+                                                        double timestamp);
+
+/**
+ * @brief Adds 16-bit integer audio samples with a playback timestamp.
+ *
+ * Same as projectm_pcm_add_int16(), but also records when the first sample will be audible.
+ *
+ * @param instance The projectM instance handle.
+ * @param samples An array of PCM samples.
+ * @param count The number of audio samples in a channel.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
+ * @param timestamp The playback time of the first sample, in seconds, on the clock returned by
+ *                  projectm_pcm_get_current_time().
+ */
+PROJECTM_EXPORT void projectm_pcm_add_int16_timestamped(projectm_handle instance, const int16_t* samples,
+                                                        unsigned int count, projectm_channels channels,
+                                                        double timestamp);
+
+/**
+ * @brief Adds 8-bit unsigned integer audio samples with a playback timestamp.
+ *
+ * Same as projectm_pcm_add_uint8(), but also records when the first sample will be audible.
+ *
+ * @param instance The projectM instance handle.
+ * @param samples An array of PCM samples.
+ * @param count The number of audio samples in a channel.
+ * @param channels The number of interleaved channels in samples, 1 to 8, e.g. PROJECTM_MONO,
+ * PROJECTM_STEREO or PROJECTM_SURROUND_5_1.
+ * @param timestamp The playback time of the first sample, in seconds, on the clock returned by
+ *                  projectm_pcm_get_current_time().
+ */
+PROJECTM_EXPORT void projectm_pcm_add_uint8_timestamped(projectm_handle instance, const uint8_t* samples,
+                                                        unsigned int count, projectm_channels channels,
+                                                        double timestamp);
+
+/**
+ * @brief Sets the time between rendering a frame and the frame being displayed.
+ *
+ * If audio samples are added with timestamps, each frame is rendered with the audio played back
+ * at the time the frame will be displayed, i.e. the current time plus this latency. The latency
+ * that can be compensated for is limited by the amount of audio kept in projectM's buffer,
+ * about 150 ms at 48 kHz. Without timestamps, the newest samples are always used.
+ *
+ * @param instance The projectM instance handle.
+ * @param seconds The presentation latency in seconds, e.g. the video output pipeline delay. Default is 0.
+ */
+PROJECTM_EXPORT void projectm_pcm_set_presentation_latency(projectm_handle instance, double seconds);
+
+/**
+ * @brief Returns the time between rendering a frame and the frame being displayed.
+ * @param instance The projectM instance handle.
+ * @return The presentation latency in seconds.
+ */
+PROJECTM_EXPORT double projectm_pcm_get_presentation_latency(projectm_handle instance);
+
+/**
+ * @brief Sets the matrix used to downmix audio data with more than two channels to stereo.
+ *
+ * By default, data with 3 to 8 channels is downmixed using the ITU-R BS.775 coefficients for the
+ * standard WAVE channel layout of that channel count, e.g. PROJECTM_SURROUND_5_1. Center and surround
+ * channels are attenuated by 3 dB, LFE is dropped.
+ *
+ * Must be called from the thread adding audio samples, or while no samples are added.
+ *
+ * @param instance The projectM instance handle.
+ * @param channels The number of input channels the matrix is used for, 3 to 8.
+ * @param coefficients 2 * channels values: for each input channel, its weight in the left output
+ *                     followed by its weight in the right output. NULL restores the default matrix.
+ * @return True if the matrix was set, false if the channel count is not supported.
+ */
+PROJECTM_EXPORT bool projectm_pcm_set_downmix_matrix(projectm_handle instance, unsigned int channels,
+                                                     const float* coefficients);
+
+/**
+ * @brief Enables or disables audio analysis in a separate thread.
+ *
+ * By default, the spectrum, waveform alignment and beat detection values are calculated while
+ * rendering each frame. If enabled, this analysis runs in a background thread at a fixed rate
+ * instead, independent of the rendering frame rate. Each rendered frame then uses the most recent
+ * analysis result.
+ *
+ * Must be called from the rendering thread. If the analysis thread cannot be started, audio
+ * analysis continues to run while rendering the frame.
+ *
+ * @param instance The projectM instance handle.
+ * @param enabled True to run the audio analysis in a background thread, false to run it while rendering.
+ * @param analyses_per_second The number of analysis passes per second. Only used if enabled is true.
+ *                            A sensible default is 60.
+ * @return True if the background analysis is now running, false otherwise.
+ */
+PROJECTM_EXPORT bool projectm_pcm_set_background_analysis(projectm_handle instance, bool enabled,
+                                                          unsigned int analyses_per_second);
+
+/**
+ * @brief Returns whether audio analysis is running in a separate thread.
+ * @param instance The projectM instance handle.
+ * @return True if the background analysis is running, false if audio is analyzed while rendering.
+ */
+PROJECTM_EXPORT bool projectm_pcm_get_background_analysis(projectm_handle instance);
+
+/**
+ * @brief Analyzes a WAVE file and writes the per-frame audio data into an audio feature file.
+ *
+ * Runs the same audio analysis as while rendering, for each frame of a video with the given frame
+ * rate. The results are deterministic and can be replayed with projectm_pcm_replay_feature_file(),
+ * e.g. to render the same track multiple times without analyzing it again.
+ *
+ * Supports uncompressed 8, 16, 24 and 32 bit integer and 32 and 64 bit float WAVE files.
+ *
+ * @param wav_filename The WAVE file to analyze.
+ * @param feature_filename The audio feature file to write. Overwritten if it already exists.
+ * @param fps The video frame rate to analyze the audio at.
+ * @return True if the file was successfully written, false if an error occurred.
+ */
+PROJECTM_EXPORT bool projectm_pcm_analyze_wav_file(const char* wav_filename, const char* feature_filename,
+                                                   double fps);
+
+/**
+ * @brief Replays an audio feature file instead of analyzing audio data.
+ *
+ * The file is memory-mapped, and each rendered frame uses the next frame from the file. After the
+ * last frame, the last frame's data is used. Audio samples added while replaying are ignored.
+ * Disables background analysis.
+ *
+ * @param instance The projectM instance handle.
+ * @param feature_filename The audio feature file, as written by projectm_pcm_analyze_wav_file().
+ *                         If NULL, replay is stopped and live audio analysis resumes.
+ * @return True if the file is being replayed, false if it couldn't be loaded or replay was stopped.
+ */
+PROJECTM_EXPORT bool projectm_pcm_replay_feature_file(projectm_handle instance, const char* feature_filename);
+
+/**
+ * @brief Selects the frame of the audio feature file used for the next rendered frame.
+ * @param instance The projectM instance handle.
+ * @param frame The frame index in the audio feature file.
+ */
+PROJECTM_EXPORT void projectm_pcm_seek_feature_file(projectm_handle instance, unsigned int frame);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
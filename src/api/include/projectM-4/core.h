@@ -130,6 +130,51 @@ PROJECTM_EXPORT char* projectm_get_version_string();
  */
 PROJECTM_EXPORT char* projectm_get_vcs_version_string();
 
+/**
+ * @brief Returns the usage counters of the process-wide compiled preset code cache.
+ *
+ * Presets loaded again reuse the machine code of the expression JIT compiled on the first load,
+ * skipping the interpreter compilation of that code. The cache only exists if libprojectM was
+ * built with the expression JIT enabled on a supported platform. Otherwise, this function returns
+ * false and sets all values to zero.
+ *
+ * Values which aren't required can be set to NULL.
+ *
+ * @param hits A pointer to a variable that will be set to the number of code blocks found in the cache.
+ * @param misses A pointer to a variable that will be set to the number of code blocks compiled.
+ * @param entries A pointer to a variable that will be set to the number of currently cached code blocks.
+ * @return True if the cache is available, false if libprojectM was built without the expression JIT.
+ */
+PROJECTM_EXPORT bool projectm_get_code_cache_statistics(uint64_t* hits, uint64_t* misses, size_t* entries);
+
+/**
+ * @brief Sets the maximum number of code blocks kept in the compiled preset code cache.
+ *
+ * If the cache is full, the least recently used code is evicted. The cache is shared between all
+ * projectM instances in the process. The default size is 1024.
+ *
+ * @param max_entries The maximum number of cached code blocks. 0 disables the cache.
+ */
+PROJECTM_EXPORT void projectm_set_code_cache_size(size_t max_entries);
+
+/**
+ * @brief Enables or disables single precision evaluation of per-pixel and per-point preset code.
+ *
+ * In single precision, JIT-compiled per-pixel and per-point code stores its variables as floats,
+ * which the renderer uses anyway, and calculates with scalar float instructions. This saves
+ * conversions in the innermost loops, which mostly speeds up arithmetic-heavy code. Code calling
+ * functions like sin() runs at about the same speed. Results may change for presets relying on
+ * the precision of large values, e.g. time or frame. Per-frame code always runs in double precision.
+ *
+ * The setting is shared between all projectM instances in the process and applies to presets
+ * loaded afterwards. The expression JIT is disabled by default, so the setting has no effect
+ * unless libprojectM was built with ENABLE_EXPRESSION_JIT on a supported platform.
+ *
+ * @param enabled True to use single precision, false to use double precision. Default is false.
+ * @return True if the setting is used, false if libprojectM was built without the expression JIT.
+ */
+PROJECTM_EXPORT bool projectm_set_single_precision_vertex_code(bool enabled);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
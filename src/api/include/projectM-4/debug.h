@@ -50,6 +50,36 @@ extern "C" {
  */
 PROJECTM_EXPORT void projectm_write_debug_image_on_next_frame(projectm_handle instance, const char* output_file);
 
+/**
+ * @brief Returns where the per-pixel equations of the current preset are evaluated.
+ *
+ * Per-pixel code using only arithmetic and math functions is translated into the warp vertex
+ * shader and runs on the GPU. Code using memory buffers, loops, rand(), time, frame or other
+ * unsupported constructs falls back to the CPU, as does all code if GPU evaluation was disabled
+ * with projectm_set_per_pixel_code_on_gpu(). Enable the Milkdrop preset debug output to see the reason.
+ *
+ * During a smooth transition, the mode of the preset being transitioned to is returned.
+ *
+ * @param instance The projectM instance handle.
+ * @return The per-pixel code evaluation mode of the current preset.
+ */
+PROJECTM_EXPORT projectm_per_pixel_evaluation projectm_get_per_pixel_evaluation(projectm_handle instance);
+
+/**
+ * @brief Returns the CPU time spent in each render stage of the current preset.
+ *
+ * The timings are only recorded if libprojectM was built with ENABLE_STAGE_PROFILER. Each preset
+ * keeps its own timings, so the rolling average starts over when a new preset is loaded. During a
+ * smooth transition, the timings of the preset being transitioned to are returned.
+ *
+ * Call this function from the thread rendering the frames.
+ *
+ * @param instance The projectM instance handle.
+ * @param stats The stats structure to fill. Zeroed if no timings are available.
+ * @return True if timings were returned, false if the profiler is disabled or no frame was rendered yet.
+ */
+PROJECTM_EXPORT bool projectm_get_frame_stats(projectm_handle instance, projectm_frame_stats* stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -175,6 +175,27 @@ PROJECTM_EXPORT void projectm_set_mesh_size(projectm_handle instance, size_t wid
  */
 PROJECTM_EXPORT void projectm_get_mesh_size(projectm_handle instance, size_t* width, size_t* height);
 
+/**
+ * @brief Enables or disables evaluating per-pixel equations in the warp vertex shader.
+ *
+ * If enabled, per-pixel code using only arithmetic and math functions runs on the GPU. Code using
+ * time or frame always runs on the CPU, as float shader uniforms lose too much precision for them
+ * after long runtimes. Disable this if a GPU driver miscompiles the generated shaders.
+ *
+ * The setting applies to presets loaded afterwards.
+ *
+ * @param instance The projectM instance handle.
+ * @param enabled True to evaluate translatable per-pixel code on the GPU, false to always use the CPU. Default is true.
+ */
+PROJECTM_EXPORT void projectm_set_per_pixel_code_on_gpu(projectm_handle instance, bool enabled);
+
+/**
+ * @brief Returns whether per-pixel equations may be evaluated in the warp vertex shader.
+ * @param instance The projectM instance handle.
+ * @return True if translatable per-pixel code is evaluated on the GPU, false if it always runs on the CPU.
+ */
+PROJECTM_EXPORT bool projectm_get_per_pixel_code_on_gpu(projectm_handle instance);
+
 /**
  * @brief Sets the current/average frames per second.
  *
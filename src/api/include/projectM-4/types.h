@@ -44,7 +44,9 @@ typedef struct projectm* projectm_handle; //!< A pointer to the opaque projectM
 typedef enum
 {
     PROJECTM_MONO = 1,
-    PROJECTM_STEREO = 2
+    PROJECTM_STEREO = 2,
+    PROJECTM_SURROUND_5_1 = 6, //!< 5.1 surround in WAVE channel order: L, R, C, LFE, Ls, Rs.
+    PROJECTM_SURROUND_7_1 = 8  //!< 7.1 surround in WAVE channel order: L, R, C, LFE, Lb, Rb, Ls, Rs.
 } projectm_channels;
 
 /**
@@ -74,6 +76,43 @@ typedef enum
     PROJECTM_TOUCH_TYPE_DOUBLE_LINE      //!< Draws a double-line waveform.
 } projectm_touch_type;
 
+/**
+ * Where the per-pixel equations of a preset are evaluated.
+ */
+typedef enum
+{
+    PROJECTM_PER_PIXEL_EVALUATION_NONE = 0, //!< No preset loaded or the preset has no per-pixel code.
+    PROJECTM_PER_PIXEL_EVALUATION_CPU = 1,  //!< The per-pixel code is evaluated on the CPU for each mesh vertex.
+    PROJECTM_PER_PIXEL_EVALUATION_GPU = 2   //!< The per-pixel code was translated into the warp vertex shader.
+} projectm_per_pixel_evaluation;
+
+/**
+ * Render stages timed by the stage profiler. All stages are part of PROJECTM_FRAME_STAGE_RENDER_FRAME.
+ */
+typedef enum
+{
+    PROJECTM_FRAME_STAGE_RENDER_FRAME = 0,             //!< Rendering the whole preset frame.
+    PROJECTM_FRAME_STAGE_PER_FRAME_UPDATE = 1,         //!< Running the preset per-frame code.
+    PROJECTM_FRAME_STAGE_CALCULATE_MESH = 2,           //!< Running the per-pixel code on the CPU.
+    PROJECTM_FRAME_STAGE_CUSTOM_WAVEFORM_EVALUATE = 3, //!< Running the custom waveform per-frame and per-point code.
+    PROJECTM_FRAME_STAGE_CUSTOM_WAVEFORM_DRAW = 4,     //!< Drawing the custom waveforms.
+    PROJECTM_FRAME_STAGE_CUSTOM_SHAPE_DRAW = 5,        //!< Running the custom shape per-frame code and drawing the shapes.
+    PROJECTM_FRAME_STAGE_BLUR_UPDATE = 6,              //!< Rendering the blur textures.
+    PROJECTM_FRAME_STAGE_SHADER_LOAD_VARIABLES = 7,    //!< Uploading the warp and composite shader uniforms.
+    PROJECTM_FRAME_STAGE_COUNT = 8                     //!< Number of stages, not a stage itself.
+} projectm_frame_stage;
+
+/**
+ * CPU time spent in each render stage of the current preset, in milliseconds.
+ * The arrays are indexed with projectm_frame_stage values.
+ */
+typedef struct
+{
+    double last_frame_ms[PROJECTM_FRAME_STAGE_COUNT]; //!< Time spent in each stage in the last rendered frame.
+    double average_ms[PROJECTM_FRAME_STAGE_COUNT];    //!< Time spent in each stage, averaged over the last average_frames frames.
+    uint32_t average_frames;                          //!< Number of frames in the rolling average, up to 60.
+} projectm_frame_stats;
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
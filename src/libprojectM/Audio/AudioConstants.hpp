@@ -1,16 +1,67 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 namespace libprojectM {
 namespace Audio {
 
-static constexpr int AudioBufferSamples = 576; //!< Number of waveform data samples stored in the buffer for analysis.
-static constexpr int WaveformSamples = 480;    //!< Number of waveform data samples available for rendering a frame.
-static constexpr int SpectrumSamples = 512;    //!< Number of spectrum analyzer samples.
+/**
+ * @brief Compile-time sizes of the audio analysis chain.
+ *
+ * All analysis classes are templates specialized for these sizes, so the compiler can fully
+ * unroll and vectorize their loops. Implementations are explicitly instantiated in the source
+ * files for the configurations declared below. To add a new configuration, declare it here and
+ * add it to the explicit instantiations at the end of each analysis class source file.
+ *
+ * @tparam audioBufferSamples Number of waveform samples used for analysis each frame.
+ * @tparam waveformSamples Number of waveform samples available for rendering a frame.
+ * @tparam spectrumSamples Number of spectrum analyzer samples. Must be a power of two.
+ * @tparam inputBufferSamples Number of samples stored in the input ring buffer. Must be a power of two.
+ *                            Half of it is kept as history, limiting how far back the analysis window
+ *                            can be placed to compensate for presentation latency.
+ */
+template<size_t audioBufferSamples, size_t waveformSamples, size_t spectrumSamples, size_t inputBufferSamples>
+struct AudioConfig
+{
+    static constexpr size_t AudioBufferSamples = audioBufferSamples; //!< Number of waveform data samples stored in the buffer for analysis.
+    static constexpr size_t WaveformSamples = waveformSamples;       //!< Number of waveform data samples available for rendering a frame.
+    static constexpr size_t SpectrumSamples = spectrumSamples;       //!< Number of spectrum analyzer samples.
+    static constexpr size_t InputBufferSamples = inputBufferSamples; //!< Number of samples stored in the input ring buffer.
 
-using WaveformBuffer = std::array<float, AudioBufferSamples>; //!< Buffer with waveform data. Only the first WaveformSamples number of samples are valid.
-using SpectrumBuffer = std::array<float, SpectrumSamples>;    //!< Buffer with spectrum data.
+    using WaveformBuffer = std::array<float, audioBufferSamples>; //!< Buffer with waveform data. Only the first WaveformSamples number of samples are valid.
+    using SpectrumBuffer = std::array<float, spectrumSamples>;    //!< Buffer with spectrum data.
+
+    static_assert(waveformSamples < audioBufferSamples, "The analysis buffer must be larger than the rendered waveform.");
+    static_assert(audioBufferSamples - waveformSamples >= 16, "Waveform alignment needs at least 16 samples of margin.");
+    static_assert((spectrumSamples & (spectrumSamples - 1)) == 0, "The number of spectrum samples must be a power of two.");
+    static_assert(spectrumSamples * 2 >= waveformSamples, "The FFT size must be larger than the number of waveform samples.");
+    static_assert((inputBufferSamples & (inputBufferSamples - 1)) == 0, "The input buffer size must be a power of two.");
+    static_assert(audioBufferSamples <= inputBufferSamples / 2, "The input buffer must be at least twice the size of the analysis buffer.");
+};
+
+template<size_t audioBufferSamples, size_t waveformSamples, size_t spectrumSamples, size_t inputBufferSamples>
+constexpr size_t AudioConfig<audioBufferSamples, waveformSamples, spectrumSamples, inputBufferSamples>::AudioBufferSamples;
+
+template<size_t audioBufferSamples, size_t waveformSamples, size_t spectrumSamples, size_t inputBufferSamples>
+constexpr size_t AudioConfig<audioBufferSamples, waveformSamples, spectrumSamples, inputBufferSamples>::WaveformSamples;
+
+template<size_t audioBufferSamples, size_t waveformSamples, size_t spectrumSamples, size_t inputBufferSamples>
+constexpr size_t AudioConfig<audioBufferSamples, waveformSamples, spectrumSamples, inputBufferSamples>::SpectrumSamples;
+
+template<size_t audioBufferSamples, size_t waveformSamples, size_t spectrumSamples, size_t inputBufferSamples>
+constexpr size_t AudioConfig<audioBufferSamples, waveformSamples, spectrumSamples, inputBufferSamples>::InputBufferSamples;
+
+using DefaultAudioConfig = AudioConfig<576, 480, 512, 16384>;          //!< The Milkdrop-compatible sizes used for rendering.
+using LowLatencyAudioConfig = AudioConfig<288, 240, 256, 8192>;         //!< Half-size analysis window, e.g. for LED controllers.
+using HighResolutionAudioConfig = AudioConfig<1152, 960, 1024, 32768>;  //!< Double-size analysis window with twice the frequency resolution.
+
+static constexpr int AudioBufferSamples = DefaultAudioConfig::AudioBufferSamples; //!< Number of waveform data samples stored in the buffer for analysis.
+static constexpr int WaveformSamples = DefaultAudioConfig::WaveformSamples;       //!< Number of waveform data samples available for rendering a frame.
+static constexpr int SpectrumSamples = DefaultAudioConfig::SpectrumSamples;       //!< Number of spectrum analyzer samples.
+
+using WaveformBuffer = DefaultAudioConfig::WaveformBuffer; //!< Buffer with waveform data. Only the first WaveformSamples number of samples are valid.
+using SpectrumBuffer = DefaultAudioConfig::SpectrumBuffer; //!< Buffer with spectrum data.
 
 } // namespace Audio
 } // namespace libprojectM
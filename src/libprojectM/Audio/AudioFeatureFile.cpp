@@ -0,0 +1,236 @@
+#include "AudioFeatureFile.hpp"
+
+#include "AudioFileException.hpp"
+#include "LittleEndian.hpp"
+
+#include <array>
+#include <cstring>
+#include <initializer_list>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace libprojectM {
+namespace Audio {
+
+namespace {
+
+constexpr char Magic[4]{'P', 'M', 'A', 'F'}; //!< File magic.
+constexpr uint32_t Version{1};               //!< Current file format version.
+
+} // namespace
+
+constexpr size_t AudioFeatureFileReader::HeaderSize;
+constexpr size_t AudioFeatureFileReader::FrameSize;
+
+AudioFeatureFileWriter::AudioFeatureFileWriter(std::ostream& stream, double framesPerSecond, uint32_t frameCount)
+    : m_stream(stream)
+    , m_frameCount(frameCount)
+{
+    std::array<uint8_t, AudioFeatureFileReader::HeaderSize> header{};
+
+    std::memcpy(header.data(), Magic, sizeof(Magic));
+    LittleEndian::StoreUInt32(Version, header.data() + 4);
+    LittleEndian::StoreUInt32(frameCount, header.data() + 8);
+    LittleEndian::StoreUInt32(static_cast<uint32_t>(WaveformSamples), header.data() + 12);
+    LittleEndian::StoreUInt32(static_cast<uint32_t>(SpectrumSamples), header.data() + 16);
+    LittleEndian::StoreDouble(framesPerSecond, header.data() + 24);
+
+    if (!m_stream.write(reinterpret_cast<const char*>(header.data()), header.size()))
+    {
+        throw AudioFileException("Could not write audio feature file header");
+    }
+}
+
+void AudioFeatureFileWriter::WriteFrame(const FrameAudioData& data)
+{
+    if (m_framesWritten >= m_frameCount)
+    {
+        throw AudioFileException("More frames written than announced in the audio feature file header");
+    }
+
+    std::array<uint8_t, AudioFeatureFileReader::FrameSize> record;
+    uint8_t* bytes = record.data();
+
+    auto store = [&bytes](float value) {
+        LittleEndian::StoreFloat(value, bytes);
+        bytes += 4;
+    };
+
+    store(data.bass);
+    store(data.bassAtt);
+    store(data.mid);
+    store(data.midAtt);
+    store(data.treb);
+    store(data.trebAtt);
+    store(data.vol);
+    store(data.volAtt);
+
+    for (auto const* values : {data.waveformLeft.data(), data.waveformRight.data()})
+    {
+        for (size_t sample = 0; sample < WaveformSamples; sample++)
+        {
+            store(values[sample]);
+        }
+    }
+
+    for (auto const* values : {data.spectrumLeft.data(), data.spectrumRight.data()})
+    {
+        for (size_t sample = 0; sample < SpectrumSamples; sample++)
+        {
+            store(values[sample]);
+        }
+    }
+
+    if (!m_stream.write(reinterpret_cast<const char*>(record.data()), record.size()))
+    {
+        throw AudioFileException("Could not write audio feature file frame");
+    }
+
+    m_framesWritten++;
+}
+
+AudioFeatureFileReader::AudioFeatureFileReader(const std::string& filename)
+{
+#ifdef _WIN32
+    m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+    {
+        m_fileHandle = nullptr;
+        throw AudioFileException("Could not open audio feature file \"" + filename + "\"");
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (GetFileSizeEx(m_fileHandle, &fileSize) && fileSize.QuadPart >= static_cast<LONGLONG>(HeaderSize))
+    {
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle != nullptr)
+        {
+            m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            m_size = static_cast<size_t>(fileSize.QuadPart);
+        }
+    }
+#else
+    int const fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        throw AudioFileException("Could not open audio feature file \"" + filename + "\"");
+    }
+
+    struct stat fileStat{};
+    if (fstat(fileDescriptor, &fileStat) == 0 && fileStat.st_size >= static_cast<off_t>(HeaderSize))
+    {
+        void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_data = static_cast<const uint8_t*>(mapping);
+            m_size = static_cast<size_t>(fileStat.st_size);
+        }
+    }
+
+    // The mapping stays valid after closing the file.
+    close(fileDescriptor);
+#endif
+
+    if (m_data == nullptr)
+    {
+        Close();
+        throw AudioFileException("Could not map audio feature file \"" + filename + "\"");
+    }
+
+    if (std::memcmp(m_data, Magic, sizeof(Magic)) != 0 ||
+        LittleEndian::LoadUInt32(m_data + 4) != Version ||
+        LittleEndian::LoadUInt32(m_data + 12) != WaveformSamples ||
+        LittleEndian::LoadUInt32(m_data + 16) != SpectrumSamples)
+    {
+        Close();
+        throw AudioFileException("\"" + filename + "\" is not a compatible audio feature file");
+    }
+
+    m_frameCount = LittleEndian::LoadUInt32(m_data + 8);
+    m_framesPerSecond = LittleEndian::LoadDouble(m_data + 24);
+
+    if ((m_size - HeaderSize) / FrameSize < m_frameCount)
+    {
+        Close();
+        throw AudioFileException("Audio feature file \"" + filename + "\" is truncated");
+    }
+}
+
+AudioFeatureFileReader::~AudioFeatureFileReader()
+{
+    Close();
+}
+
+void AudioFeatureFileReader::ReadFrame(uint32_t frame, FrameAudioData& data) const
+{
+    const uint8_t* bytes = m_data + HeaderSize + static_cast<size_t>(frame) * FrameSize;
+
+    auto load = [&bytes]() {
+        float const value = LittleEndian::LoadFloat(bytes);
+        bytes += 4;
+        return value;
+    };
+
+    data.bass = load();
+    data.bassAtt = load();
+    data.mid = load();
+    data.midAtt = load();
+    data.treb = load();
+    data.trebAtt = load();
+    data.vol = load();
+    data.volAtt = load();
+
+    for (auto* values : {data.waveformLeft.data(), data.waveformRight.data()})
+    {
+        for (size_t sample = 0; sample < WaveformSamples; sample++)
+        {
+            values[sample] = load();
+        }
+    }
+
+    for (auto* values : {data.spectrumLeft.data(), data.spectrumRight.data()})
+    {
+        for (size_t sample = 0; sample < SpectrumSamples; sample++)
+        {
+            values[sample] = load();
+        }
+    }
+}
+
+void AudioFeatureFileReader::Close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != nullptr)
+    {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+    if (m_fileHandle != nullptr)
+    {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = nullptr;
+    }
+#else
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,128 @@
+/**
+ * @file AudioFeatureFile.hpp
+ * @brief Reads and writes files containing pre-analyzed per-frame audio data.
+ *
+ * File layout, all values stored in little-endian byte order:
+ *
+ * | Offset | Type      | Contents                                          |
+ * |--------|-----------|---------------------------------------------------|
+ * | 0      | char[4]   | Magic "PMAF"                                      |
+ * | 4      | uint32    | Format version, currently 1                       |
+ * | 8      | uint32    | Number of frames                                  |
+ * | 12     | uint32    | Waveform samples per channel and frame            |
+ * | 16     | uint32    | Spectrum samples per channel and frame            |
+ * | 20     | uint32    | Reserved, zero                                    |
+ * | 24     | float64   | Frames per second                                 |
+ * | 32     | frames... | One record per frame, see below                   |
+ *
+ * Each frame record consists of 32-bit floats: bass, bassAtt, mid, midAtt, treb, trebAtt, vol,
+ * volAtt, followed by the left and right waveforms and the left and right spectra.
+ */
+#pragma once
+
+#include "FrameAudioData.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class AudioFeatureFileWriter
+ * @brief Writes per-frame audio data into an audio feature stream.
+ */
+class AudioFeatureFileWriter
+{
+public:
+    /**
+     * @brief Writes the file header.
+     * @throws AudioFileException if the header can't be written.
+     * @param stream The binary output stream to write to.
+     * @param framesPerSecond The frame rate the audio data was analyzed at.
+     * @param frameCount The number of frames which will be written.
+     */
+    AudioFeatureFileWriter(std::ostream& stream, double framesPerSecond, uint32_t frameCount);
+
+    /**
+     * @brief Appends a single frame to the file.
+     * @throws AudioFileException if the frame can't be written or all frames were already written.
+     * @param data The frame audio data to write.
+     */
+    void WriteFrame(const FrameAudioData& data);
+
+private:
+    std::ostream& m_stream;    //!< The output stream.
+    uint32_t m_frameCount{};   //!< Number of frames announced in the header.
+    uint32_t m_framesWritten{}; //!< Number of frames written so far.
+};
+
+/**
+ * @class AudioFeatureFileReader
+ * @brief Memory-maps an audio feature file for random access to its frames.
+ */
+class AudioFeatureFileReader
+{
+public:
+    /**
+     * @brief Opens and maps the given file.
+     * @throws AudioFileException if the file can't be mapped or is not a valid feature file.
+     * @param filename The file to open.
+     */
+    explicit AudioFeatureFileReader(const std::string& filename);
+
+    ~AudioFeatureFileReader();
+
+    AudioFeatureFileReader(const AudioFeatureFileReader&) = delete;
+    auto operator=(const AudioFeatureFileReader&) -> AudioFeatureFileReader& = delete;
+
+    /**
+     * @brief Returns the frame rate the file was analyzed at.
+     * @return The number of frames per second.
+     */
+    auto FramesPerSecond() const -> double
+    {
+        return m_framesPerSecond;
+    }
+
+    /**
+     * @brief Returns the number of frames in the file.
+     * @return The number of frames.
+     */
+    auto FrameCount() const -> uint32_t
+    {
+        return m_frameCount;
+    }
+
+    /**
+     * @brief Copies a single frame from the file.
+     * @param frame The frame index. Must be less than FrameCount().
+     * @param data Receives the frame audio data.
+     */
+    void ReadFrame(uint32_t frame, FrameAudioData& data) const;
+
+    static constexpr size_t HeaderSize{32};                                                //!< Size of the file header in bytes.
+    static constexpr size_t FrameSize{(8 + 2 * WaveformSamples + 2 * SpectrumSamples) * 4}; //!< Size of a single frame record in bytes.
+
+private:
+    /**
+     * Unmaps the file, if mapped.
+     */
+    void Close();
+
+    const uint8_t* m_data{}; //!< Start of the mapped file.
+    size_t m_size{};         //!< Size of the mapped file in bytes.
+
+#ifdef _WIN32
+    void* m_fileHandle{};    //!< Windows file handle.
+    void* m_mappingHandle{}; //!< Windows file mapping handle.
+#endif
+
+    double m_framesPerSecond{}; //!< Frame rate of the analysis.
+    uint32_t m_frameCount{};    //!< Number of frames in the file.
+};
+
+} // namespace Audio
+} // namespace libprojectM
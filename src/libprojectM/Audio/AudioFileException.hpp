@@ -0,0 +1,37 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @brief Exception for errors reading or writing audio and audio feature files.
+ */
+class AudioFileException : public std::exception
+{
+public:
+    inline AudioFileException(std::string message)
+        : m_message(std::move(message))
+    {
+    }
+
+    virtual ~AudioFileException() = default;
+
+    const char* what() const noexcept override
+    {
+        return m_message.c_str();
+    }
+
+    const std::string& message() const
+    {
+        return m_message;
+    }
+
+private:
+    std::string m_message;
+};
+
+} // namespace Audio
+} // namespace libprojectM
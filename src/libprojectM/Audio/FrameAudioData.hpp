@@ -6,7 +6,6 @@
  */
 #pragma once
 
-#include "projectM-4/projectM_export.h"
 #include "AudioConstants.hpp"
 
 #include <array>
@@ -14,7 +13,12 @@
 namespace libprojectM {
 namespace Audio {
 
-class PROJECTM_EXPORT FrameAudioData
+/**
+ * @brief Per-frame audio analysis results.
+ * @tparam Config The AudioConfig specialization determining the waveform and spectrum sizes.
+ */
+template<typename Config>
+class BasicFrameAudioData
 {
 public:
     float bass{0.f};
@@ -27,12 +31,14 @@ public:
     float vol{0.f};
     float volAtt{0.f};
 
-    std::array<float, WaveformSamples> waveformLeft;
-    std::array<float, WaveformSamples> waveformRight;
+    std::array<float, Config::WaveformSamples> waveformLeft{};
+    std::array<float, Config::WaveformSamples> waveformRight{};
 
-    std::array<float, SpectrumSamples> spectrumLeft;
-    std::array<float, SpectrumSamples> spectrumRight;
+    std::array<float, Config::SpectrumSamples> spectrumLeft{};
+    std::array<float, Config::SpectrumSamples> spectrumRight{};
 };
 
+using FrameAudioData = BasicFrameAudioData<DefaultAudioConfig>; //!< Audio data passed to presets for rendering.
+
 } // namespace Audio
 } // namespace libprojectM
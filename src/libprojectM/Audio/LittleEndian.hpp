@@ -0,0 +1,80 @@
+/**
+ * @file LittleEndian.hpp
+ * @brief Helpers to read and write little-endian values from and to byte buffers.
+ *
+ * Used for file formats with a fixed byte order, independent of the host byte order.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace libprojectM {
+namespace Audio {
+namespace LittleEndian {
+
+inline auto LoadUInt16(const uint8_t* bytes) -> uint16_t
+{
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+inline auto LoadUInt32(const uint8_t* bytes) -> uint32_t
+{
+    return static_cast<uint32_t>(bytes[0]) |
+           (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) |
+           (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+inline auto LoadUInt64(const uint8_t* bytes) -> uint64_t
+{
+    return static_cast<uint64_t>(LoadUInt32(bytes)) | (static_cast<uint64_t>(LoadUInt32(bytes + 4)) << 32);
+}
+
+inline auto LoadFloat(const uint8_t* bytes) -> float
+{
+    uint32_t const bits = LoadUInt32(bytes);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline auto LoadDouble(const uint8_t* bytes) -> double
+{
+    uint64_t const bits = LoadUInt64(bytes);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline void StoreUInt32(uint32_t value, uint8_t* bytes)
+{
+    bytes[0] = static_cast<uint8_t>(value);
+    bytes[1] = static_cast<uint8_t>(value >> 8);
+    bytes[2] = static_cast<uint8_t>(value >> 16);
+    bytes[3] = static_cast<uint8_t>(value >> 24);
+}
+
+inline void StoreUInt64(uint64_t value, uint8_t* bytes)
+{
+    StoreUInt32(static_cast<uint32_t>(value), bytes);
+    StoreUInt32(static_cast<uint32_t>(value >> 32), bytes + 4);
+}
+
+inline void StoreFloat(float value, uint8_t* bytes)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    StoreUInt32(bits, bytes);
+}
+
+inline void StoreDouble(double value, uint8_t* bytes)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    StoreUInt64(bits, bytes);
+}
+
+} // namespace LittleEndian
+} // namespace Audio
+} // namespace libprojectM
@@ -5,40 +5,49 @@
 namespace libprojectM {
 namespace Audio {
 
-Loudness::Loudness(Loudness::Band band)
+template<size_t spectrumSize>
+constexpr size_t BasicLoudness<spectrumSize>::SpectrumSamples;
+
+template<size_t spectrumSize>
+BasicLoudness<spectrumSize>::BasicLoudness(Band band)
     : m_band(band)
 {
 }
 
-void Loudness::Update(const std::array<float, SpectrumSamples>& spectrumSamples, double secondsSinceLastFrame, uint32_t frame)
+template<size_t spectrumSize>
+void BasicLoudness<spectrumSize>::Update(const std::array<float, SpectrumSamples>& spectrumSamples, double secondsSinceLastFrame, uint32_t frame)
 {
     SumBand(spectrumSamples);
     UpdateBandAverage(secondsSinceLastFrame, frame);
 }
 
-auto Loudness::CurrentRelative() const -> float
+template<size_t spectrumSize>
+auto BasicLoudness<spectrumSize>::CurrentRelative() const -> float
 {
     return m_currentRelative;
 }
 
-auto Loudness::AverageRelative() const -> float
+template<size_t spectrumSize>
+auto BasicLoudness<spectrumSize>::AverageRelative() const -> float
 {
     return m_averageRelative;
 }
 
-void Loudness::SumBand(const std::array<float, SpectrumSamples>& spectrumSamples)
+template<size_t spectrumSize>
+void BasicLoudness<spectrumSize>::SumBand(const std::array<float, SpectrumSamples>& spectrumSamples)
 {
-    int start = SpectrumSamples * static_cast<int>(m_band) / 6;
-    int end = SpectrumSamples * (static_cast<int>(m_band) + 1) / 6;
+    size_t const start = SpectrumSamples * static_cast<size_t>(m_band) / 6;
+    size_t const end = SpectrumSamples * (static_cast<size_t>(m_band) + 1) / 6;
 
     m_current = 0.0f;
-    for (int sample = start; sample < end; sample++)
+    for (size_t sample = start; sample < end; sample++)
     {
         m_current += spectrumSamples[sample];
     }
 }
 
-void Loudness::UpdateBandAverage(double secondsSinceLastFrame, uint32_t frame)
+template<size_t spectrumSize>
+void BasicLoudness<spectrumSize>::UpdateBandAverage(double secondsSinceLastFrame, uint32_t frame)
 {
     float rate = AdjustRateToFps(m_current > m_average ? 0.2f : 0.5f, secondsSinceLastFrame);
     m_average = m_average * rate + m_current * (1.0f - rate);
@@ -50,7 +59,8 @@ void Loudness::UpdateBandAverage(double secondsSinceLastFrame, uint32_t frame)
     m_averageRelative = std::fabs(m_longAverage) < 0.001f ? 1.0f : m_average / m_longAverage;
 }
 
-auto Loudness::AdjustRateToFps(float rate, double secondsSinceLastFrame) -> float
+template<size_t spectrumSize>
+auto BasicLoudness<spectrumSize>::AdjustRateToFps(float rate, double secondsSinceLastFrame) -> float
 {
     float const perSecondDecayRateAtFps1 = std::pow(rate, 30.0f);
     float const perFrameDecayRateAtFps2 = std::pow(perSecondDecayRateAtFps1, static_cast<float>(secondsSinceLastFrame));
@@ -58,5 +68,9 @@ auto Loudness::AdjustRateToFps(float rate, double secondsSinceLastFrame) -> floa
     return perFrameDecayRateAtFps2;
 }
 
+template class BasicLoudness<DefaultAudioConfig::SpectrumSamples>;
+template class BasicLoudness<LowLatencyAudioConfig::SpectrumSamples>;
+template class BasicLoudness<HighResolutionAudioConfig::SpectrumSamples>;
+
 } // namespace Audio
 } // namespace libprojectM
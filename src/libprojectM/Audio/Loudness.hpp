@@ -8,6 +8,7 @@
 #include "AudioConstants.hpp"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 namespace libprojectM {
@@ -15,10 +16,14 @@ namespace Audio {
 
 /**
  * @brief Calculates beat-detection loudness relative to the previous frame(s).
+ * @tparam spectrumSize Number of spectrum analyzer samples passed to Update().
  */
-class Loudness
+template<size_t spectrumSize>
+class BasicLoudness
 {
 public:
+    static constexpr size_t SpectrumSamples = spectrumSize; //!< Number of spectrum analyzer samples.
+
     /**
      * @brief Frequency bands.
      * Only the first half of the spectrum is used for these bands, each using one third of this half.
@@ -34,7 +39,7 @@ public:
      * @brief Constructor.
      * @param band The band to use for this loudness instance.
      */
-    explicit Loudness(Band band);
+    explicit BasicLoudness(Band band);
 
     /**
      * @brief Updates the beat detection values and averages.
@@ -93,5 +98,7 @@ private:
     float m_averageRelative{1.0f}; //!< The attenuated relative loudness value.
 };
 
+using Loudness = BasicLoudness<SpectrumSamples>; //!< Loudness used by the default audio configuration.
+
 } // namespace Audio
 } // namespace libprojectM
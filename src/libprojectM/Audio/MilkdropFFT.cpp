@@ -29,80 +29,88 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "MilkdropFFT.hpp"
 
+#include <cmath>
+
 namespace libprojectM {
 namespace Audio {
 
 constexpr auto PI = 3.141592653589793238462643383279502884197169399f;
+constexpr auto PI_DOUBLE = 3.141592653589793238462643383279502884197169399;
+
+template<size_t samplesIn, size_t samplesOut>
+constexpr size_t BasicMilkdropFFT<samplesIn, samplesOut>::SamplesIn;
+
+template<size_t samplesIn, size_t samplesOut>
+constexpr size_t BasicMilkdropFFT<samplesIn, samplesOut>::SamplesOut;
 
-MilkdropFFT::MilkdropFFT(size_t samplesIn, size_t samplesOut, bool equalize, float envelopePower)
-    : m_samplesIn(samplesIn)
-    , m_numFrequencies(samplesOut * 2)
+template<size_t samplesIn, size_t samplesOut>
+constexpr size_t BasicMilkdropFFT<samplesIn, samplesOut>::NumFrequencies;
+
+template<size_t samplesIn, size_t samplesOut>
+BasicMilkdropFFT<samplesIn, samplesOut>::BasicMilkdropFFT(bool equalize, float envelopePower)
 {
     InitBitRevTable();
-    InitCosSinTable();
+    InitTwiddleTable();
     InitEnvelopeTable(envelopePower);
     InitEqualizeTable(equalize);
 }
 
-void MilkdropFFT::InitEnvelopeTable(float power)
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::InitEnvelopeTable(float power)
 {
     if (power < 0.0f)
     {
         // Keep all values as-is.
-        m_envelope = std::vector<float>(m_samplesIn, 1.0f);
+        m_envelope.fill(1.0f);
         return;
     }
 
-    float const multiplier = 1.0f / static_cast<float>(m_samplesIn) * 2.0f * PI;
-
-    m_envelope.resize(m_samplesIn);
+    float const multiplier = 1.0f / static_cast<float>(samplesIn) * 2.0f * PI;
 
     if (power == 1.0f)
     {
-        for (size_t i = 0; i < m_samplesIn; i++)
+        for (size_t i = 0; i < samplesIn; i++)
         {
             m_envelope[i] = 0.5f + 0.5f * std::sin(static_cast<float>(i) * multiplier - PI * 0.5f);
         }
     }
     else
     {
-        for (size_t i = 0; i < m_samplesIn; i++)
+        for (size_t i = 0; i < samplesIn; i++)
         {
             m_envelope[i] = std::pow(0.5f + 0.5f * std::sin(static_cast<float>(i) * multiplier - PI * 0.5f), power);
         }
     }
 }
 
-void MilkdropFFT::InitEqualizeTable(bool equalize)
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::InitEqualizeTable(bool equalize)
 {
     if (!equalize)
     {
-        m_equalize = std::vector<float>(m_numFrequencies / 2, 1.0f);
+        m_equalize.fill(1.0f);
         return;
     }
 
     float const scaling = -0.02f;
-    float const inverseHalfNumFrequencies = 1.0f / static_cast<float>(m_numFrequencies / 2);
+    float const inverseHalfNumFrequencies = 1.0f / static_cast<float>(samplesOut);
 
-    m_equalize.resize(m_numFrequencies / 2);
-
-    for (size_t i = 0; i < m_numFrequencies / 2; i++)
+    for (size_t i = 0; i < samplesOut; i++)
     {
-        m_equalize[i] = scaling * std::log(static_cast<float>(m_numFrequencies / 2 - i) * inverseHalfNumFrequencies);
+        m_equalize[i] = scaling * std::log(static_cast<float>(samplesOut - i) * inverseHalfNumFrequencies);
     }
 }
 
-void MilkdropFFT::InitBitRevTable()
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::InitBitRevTable()
 {
-    m_bitRevTable.resize(m_numFrequencies);
-
-    for (size_t i = 0; i < m_numFrequencies; i++)
+    for (size_t i = 0; i < NumFrequencies; i++)
     {
         m_bitRevTable[i] = i;
     }
 
     size_t j{};
-    for (size_t i = 0; i < m_numFrequencies; i++)
+    for (size_t i = 0; i < NumFrequencies; i++)
     {
         if (j > i)
         {
@@ -111,7 +119,7 @@ void MilkdropFFT::InitBitRevTable()
             m_bitRevTable[j] = temp;
         }
 
-        size_t m = m_numFrequencies >> 1;
+        size_t m = NumFrequencies >> 1;
 
         while (m >= 1 && j >= m)
         {
@@ -123,84 +131,108 @@ void MilkdropFFT::InitBitRevTable()
     }
 }
 
-void MilkdropFFT::InitCosSinTable()
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::InitTwiddleTable()
 {
-    size_t tabsize{};
-    size_t dftsize{2};
-
-    while (dftsize <= m_numFrequencies)
+    for (size_t halfDftSize = 1; halfDftSize < NumFrequencies; halfDftSize <<= 1)
     {
-        tabsize++;
-        dftsize <<= 1;
+        double const theta = -PI_DOUBLE / static_cast<double>(halfDftSize);
+        for (size_t m = 0; m < halfDftSize; m++)
+        {
+            auto const twiddle = std::polar(1.0, theta * static_cast<double>(m));
+            m_twiddles[halfDftSize - 1 + m] = {static_cast<float>(twiddle.real()), static_cast<float>(twiddle.imag())};
+        }
     }
+}
 
-    m_cosSinTable.resize(tabsize);
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::Transform()
+{
+    std::complex<float>* const data = m_workBuffer.data();
 
-    dftsize = 2;
-    size_t index{0};
-    while (dftsize <= m_numFrequencies)
+    for (size_t halfDftSize = 1; halfDftSize < NumFrequencies; halfDftSize <<= 1)
     {
-        auto const theta{-2.0f * PI / static_cast<float>(dftsize)};
-        m_cosSinTable[index] = std::polar(1.0f, theta); // Radius 1 is the unity circle.
-        index++;
-        dftsize <<= 1;
+        std::complex<float> const* const twiddles = m_twiddles.data() + halfDftSize - 1;
+        size_t const dftSize = halfDftSize << 1;
+
+        for (size_t i = 0; i < NumFrequencies; i += dftSize)
+        {
+            std::complex<float>* const even = data + i;
+            std::complex<float>* const odd = even + halfDftSize;
+
+            for (size_t m = 0; m < halfDftSize; m++)
+            {
+                // Written out to avoid the NaN/Inf handling of std::complex multiplication.
+                float const tempReal = odd[m].real() * twiddles[m].real() - odd[m].imag() * twiddles[m].imag();
+                float const tempImag = odd[m].real() * twiddles[m].imag() + odd[m].imag() * twiddles[m].real();
+                std::complex<float> const temp{tempReal, tempImag};
+
+                odd[m] = even[m] - temp;
+                even[m] += temp;
+            }
+        }
     }
 }
 
-void MilkdropFFT::TimeToFrequencyDomain(const std::vector<float>& waveformData, std::vector<float>& spectralData)
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::TimeToFrequencyDomain(const std::vector<float>& waveformData, std::vector<float>& spectralData)
 {
-    if (m_bitRevTable.empty() || m_cosSinTable.empty() || waveformData.size() < m_samplesIn)
+    if (waveformData.size() < samplesIn)
     {
         spectralData.clear();
         return;
     }
 
     // 1. Set up input to the FFT
-    std::vector<std::complex<float>> spectrumData(m_numFrequencies, std::complex<float>());
-    for (size_t i = 0; i < m_numFrequencies; i++)
+    for (size_t i = 0; i < NumFrequencies; i++)
     {
         size_t const idx{m_bitRevTable[i]};
-        if (idx < m_samplesIn)
-        {
-            spectrumData[i].real(waveformData[idx] * m_envelope[idx]);
-        }
+        m_workBuffer[i] = idx < samplesIn ? std::complex<float>(waveformData[idx] * m_envelope[idx], 0.0f) : std::complex<float>();
     }
 
     // 2. Perform FFT
-    size_t dftSize{2};
-    size_t octave{0};
+    Transform();
 
-    while (dftSize <= m_numFrequencies)
+    // 3. Take the magnitude & eventually equalize it (on a log10 scale) for output. The magnitudes
+    //    can't overflow, so use a plain square root instead of the much slower std::abs(), which
+    //    calls hypot().
+    spectralData.resize(samplesOut);
+    for (size_t i = 0; i < samplesOut; i++)
     {
-        std::complex<float> w{1.0f, 0.0f};
-        std::complex<float> const wp{m_cosSinTable[octave]};
-
-        size_t const hdftsize{dftSize >> 1};
-
-        for (size_t m = 0; m < hdftsize; m += 1)
-        {
-            for (size_t i = m; i < m_numFrequencies; i += dftSize)
-            {
-                size_t const j{i + hdftsize};
-                std::complex<float> const tempNum{spectrumData[j] * w};
-                spectrumData[j] = spectrumData[i] - tempNum;
-                spectrumData[i] = spectrumData[i] + tempNum;
-            }
-
-            w *= wp;
-        }
+        spectralData[i] = m_equalize[i] * std::sqrt(std::norm(m_workBuffer[i]));
+    }
+}
 
-        dftSize <<= 1;
-        octave++;
+template<size_t samplesIn, size_t samplesOut>
+void BasicMilkdropFFT<samplesIn, samplesOut>::TimeToFrequencyDomain(const float* waveformLeft, const float* waveformRight,
+                                        float* spectrumLeft, float* spectrumRight)
+{
+    // 1. Set up input to the FFT, left channel as real and right channel as imaginary part.
+    for (size_t i = 0; i < NumFrequencies; i++)
+    {
+        size_t const idx{m_bitRevTable[i]};
+        m_workBuffer[i] = idx < samplesIn ? std::complex<float>(waveformLeft[idx] * m_envelope[idx], waveformRight[idx] * m_envelope[idx]) : std::complex<float>();
     }
 
-    // 3. Take the magnitude & eventually equalize it (on a log10 scale) for output
-    spectralData.resize(m_numFrequencies / 2);
-    for (size_t i = 0; i < m_numFrequencies / 2; i++)
+    // 2. Perform FFT
+    Transform();
+
+    // 3. Separate the channels. As both inputs are real, their spectra are conjugate-symmetric:
+    //    Left[k] = (Z[k] + conj(Z[N-k])) / 2 and Right[k] = (Z[k] - conj(Z[N-k])) / 2i.
+    //    Then take the magnitude & equalize as in the single-channel variant.
+    for (size_t i = 0; i < samplesOut; i++)
     {
-        spectralData[i] = m_equalize[i] * std::abs(spectrumData[i]);
+        auto const& current = m_workBuffer[i];
+        auto const mirrored = std::conj(m_workBuffer[(NumFrequencies - i) & (NumFrequencies - 1)]);
+
+        spectrumLeft[i] = m_equalize[i] * 0.5f * std::sqrt(std::norm(current + mirrored));
+        spectrumRight[i] = m_equalize[i] * 0.5f * std::sqrt(std::norm(current - mirrored));
     }
 }
 
+template class BasicMilkdropFFT<DefaultAudioConfig::WaveformSamples, DefaultAudioConfig::SpectrumSamples>;
+template class BasicMilkdropFFT<LowLatencyAudioConfig::WaveformSamples, LowLatencyAudioConfig::SpectrumSamples>;
+template class BasicMilkdropFFT<HighResolutionAudioConfig::WaveformSamples, HighResolutionAudioConfig::SpectrumSamples>;
+
 } // namespace Audio
 } // namespace libprojectM
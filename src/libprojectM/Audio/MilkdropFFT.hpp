@@ -29,6 +29,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "AudioConstants.hpp"
+
+#include <array>
 #include <complex>
 #include <vector>
 
@@ -39,24 +42,37 @@ namespace Audio {
  * @brief Performs a Fast Fourier Transform on audio sample data.
  * Also applies an equalizer pattern with an envelope curve to the resulting data to smooth out
  * certain artifacts.
+ *
+ * All work buffers and twiddle factors are allocated and precomputed on construction, so
+ * transforming data does not allocate any memory. As the input data is real-valued, the
+ * stereo variant packs the left and right channel into a single complex transform.
+ *
+ * The transform sizes are template parameters, so all tables are fixed-size arrays and the
+ * compiler knows every loop count.
+ *
+ * @tparam samplesIn Number of waveform samples which will be fed into the FFT.
+ * @tparam samplesOut Number of frequency samples generated. Must be a power of two.
  */
-class MilkdropFFT
+template<size_t samplesIn, size_t samplesOut>
+class BasicMilkdropFFT
 {
 public:
+    static constexpr size_t SamplesIn = samplesIn;             //!< Number of waveform samples used for the FFT calculation.
+    static constexpr size_t SamplesOut = samplesOut;           //!< Number of frequency samples returned.
+    static constexpr size_t NumFrequencies = samplesOut * 2;   //!< Number of frequency samples calculated by the FFT.
+
     /**
      * Initializes the Fast Fourier Transform.
-     * @param samplesIn Number of waveform samples which will be fed into the FFT
-     * @param samplesOut Number of frequency samples generated; MUST BE A POWER OF 2.
      * @param equalize true to roughly equalize the magnitude of the basses and trebles,
      *                 false to leave them untouched.
      * @param envelopePower Specifies the envelope power. Set to any negative value to disable the envelope.
      *                      See InitEnvelopeTable for more info.
      */
-    MilkdropFFT(size_t samplesIn, size_t samplesOut, bool equalize = true, float envelopePower = 1.0f);
+    explicit BasicMilkdropFFT(bool equalize = true, float envelopePower = 1.0f);
 
     /**
      * @brief Converts time-domain samples into frequency-domain samples.
-     * The array lengths are the two parameters to Init().
+     * The array lengths are the two template parameters.
      *
      * The last sample of the output data will represent the frequency
      * that is 1/4th of the input sampling rate.  For example,
@@ -94,21 +110,26 @@ public:
      * You might want to slightly damp (blur) the input if your signal isn't
      * of a very high quality, to reduce high-frequency noise that would
      * otherwise show up in the output.
-     * @param waveformData The waveform data to convert. Must contain at least the number of elements passed as samplesIn in Init().
-     * @param spectralData The resulting frequency data. Vector will be resized to samplesOut elements as passed to Init().
-     *                     If the conversion failed, e.g. not initialized or too few input samples, the result vector will be empty.
+     * @param waveformData The waveform data to convert. Must contain at least samplesIn elements.
+     * @param spectralData The resulting frequency data. Vector will be resized to samplesOut elements.
+     *                     If the conversion failed due to too few input samples, the result vector will be empty.
      */
     void TimeToFrequencyDomain(const std::vector<float>& waveformData, std::vector<float>& spectralData);
 
     /**
-     * @brief Returns the number of frequency samples calculated.
-     * This is twice the value of samplesOut passed to Init().
-     * @return The number of frequency samples calculated.
+     * @brief Converts time-domain samples of two channels into frequency-domain samples.
+     *
+     * Produces the same results as calling the single-channel variant for each channel, but
+     * only performs a single complex transform with the left channel as the real and the right
+     * channel as the imaginary part.
+     *
+     * @param waveformLeft The left channel waveform data. Must contain at least samplesIn elements.
+     * @param waveformRight The right channel waveform data. Must contain at least samplesIn elements.
+     * @param spectrumLeft Receives the left channel frequency data. Must have room for samplesOut elements.
+     * @param spectrumRight Receives the right channel frequency data. Must have room for samplesOut elements.
      */
-    auto NumFrequencies() const -> size_t
-    {
-        return m_numFrequencies;
-    };
+    void TimeToFrequencyDomain(const float* waveformLeft, const float* waveformRight,
+                               float* spectrumLeft, float* spectrumRight);
 
 private:
     /**
@@ -142,18 +163,29 @@ private:
     void InitBitRevTable();
 
     /**
-     * @brief Builds a table with the Nth roots of unity inputs for the transform.
+     * @brief Builds the twiddle factor tables for all butterfly stages.
+     *
+     * The factors of each stage are stored contiguously, the stage with a butterfly span of
+     * h (1, 2, 4, ..., N/2) starts at index h - 1. All values are calculated in double precision,
+     * so there is no accumulated rounding error.
      */
-    void InitCosSinTable();
+    void InitTwiddleTable();
 
-    size_t m_samplesIn{}; //!< Number of waveform samples to use for the FFT calculation.
-    size_t m_numFrequencies{}; //!< Number of frequency samples calculated by the FFT.
+    /**
+     * @brief Runs the in-place radix-2 butterfly stages on the bit-reversed work buffer.
+     */
+    void Transform();
 
-    std::vector<size_t> m_bitRevTable; //!< Index table for frequency-specific waveform data lookups.
-    std::vector<float> m_envelope; //!< Equalizer envelope table.
-    std::vector<float> m_equalize; //!< Equalization values.
-    std::vector<std::complex<float>> m_cosSinTable; //!< Table with complex polar coordinates for the different frequency domains used in the FFT.
+    static_assert((samplesOut & (samplesOut - 1)) == 0, "The number of FFT output samples must be a power of two.");
+
+    std::array<size_t, NumFrequencies> m_bitRevTable{}; //!< Index table for frequency-specific waveform data lookups.
+    std::array<float, samplesIn> m_envelope{}; //!< Equalizer envelope table.
+    std::array<float, samplesOut> m_equalize{}; //!< Equalization values.
+    std::array<std::complex<float>, NumFrequencies - 1> m_twiddles{}; //!< Per-stage twiddle factors (Nth roots of unity) used in the butterflies.
+    std::array<std::complex<float>, NumFrequencies> m_workBuffer{}; //!< FFT work buffer.
 };
 
+using MilkdropFFT = BasicMilkdropFFT<WaveformSamples, SpectrumSamples>; //!< FFT used by the default audio configuration.
+
 } // namespace Audio
 } // namespace libprojectM
@@ -0,0 +1,82 @@
+#include "OfflineAnalyzer.hpp"
+
+#include "AudioFeatureFile.hpp"
+#include "AudioFileException.hpp"
+#include "PCM.hpp"
+#include "WavFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+
+namespace libprojectM {
+namespace Audio {
+
+namespace {
+
+/**
+ * Returns the index of the first sample after the given frame. Rounds down, so each sample
+ * belongs to exactly one frame.
+ */
+auto FrameEndSample(uint32_t frame, size_t sampleCount, uint32_t sampleRate, double framesPerSecond) -> size_t
+{
+    auto const endSample = static_cast<size_t>(std::floor(static_cast<double>(frame + 1) * static_cast<double>(sampleRate) / framesPerSecond));
+    return std::min(endSample, sampleCount);
+}
+
+} // namespace
+
+auto OfflineAnalyzer::FrameCount(size_t sampleCount, uint32_t sampleRate, double framesPerSecond) -> uint32_t
+{
+    return static_cast<uint32_t>(std::ceil(static_cast<double>(sampleCount) * framesPerSecond / static_cast<double>(sampleRate)));
+}
+
+void OfflineAnalyzer::Analyze(const float* samples, uint32_t channels, size_t sampleCount, uint32_t sampleRate,
+                              double framesPerSecond, std::ostream& output)
+{
+    if (channels == 0 || sampleRate == 0 || !(framesPerSecond > 0.0))
+    {
+        throw AudioFileException("Invalid offline audio analysis parameters");
+    }
+
+    uint32_t const frameCount = FrameCount(sampleCount, sampleRate, framesPerSecond);
+    double const secondsPerFrame = 1.0 / framesPerSecond;
+
+    AudioFeatureFileWriter writer(output, framesPerSecond, frameCount);
+    auto pcm = std::make_unique<PCM>();
+
+    size_t startSample{};
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        size_t const endSample = FrameEndSample(frame, sampleCount, sampleRate, framesPerSecond);
+
+        pcm->Add(samples + startSample * channels, channels, endSample - startSample);
+        pcm->UpdateFrameAudioData(secondsPerFrame, frame);
+        writer.WriteFrame(pcm->GetFrameAudioData());
+
+        startSample = endSample;
+    }
+}
+
+void OfflineAnalyzer::AnalyzeWavFile(const std::string& wavFilename, const std::string& featureFilename, double framesPerSecond)
+{
+    auto const wavFile = WavFile::Load(wavFilename);
+
+    std::ofstream output(featureFilename, std::ios::binary | std::ios::trunc);
+    if (!output.is_open())
+    {
+        throw AudioFileException("Could not create audio feature file \"" + featureFilename + "\"");
+    }
+
+    Analyze(wavFile.Samples().data(), wavFile.Channels(), wavFile.SampleCount(), wavFile.SampleRate(), framesPerSecond, output);
+
+    output.close();
+    if (output.fail())
+    {
+        throw AudioFileException("Could not write audio feature file \"" + featureFilename + "\"");
+    }
+}
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,59 @@
+/**
+ * @file OfflineAnalyzer.hpp
+ * @brief Analyzes complete audio tracks into audio feature files.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class OfflineAnalyzer
+ * @brief Runs the per-frame audio analysis over a whole track at a fixed frame rate.
+ *
+ * For each frame, the samples belonging to this frame are added to a fresh PCM instance, which then
+ * runs the same analysis as during live rendering, with a fixed time between frames. The results are
+ * therefore deterministic and can be replayed later using an AudioFeatureFileReader.
+ */
+class OfflineAnalyzer
+{
+public:
+    /**
+     * @brief Returns the number of frames needed to cover the given number of samples.
+     * @param sampleCount The number of samples per channel.
+     * @param sampleRate The sample rate in Hz.
+     * @param framesPerSecond The video frame rate.
+     * @return The number of frames. The last frame may cover less samples than the others.
+     */
+    static auto FrameCount(size_t sampleCount, uint32_t sampleRate, double framesPerSecond) -> uint32_t;
+
+    /**
+     * @brief Analyzes interleaved floating-point samples and writes the results as an audio feature file.
+     * @throws AudioFileException if the output can't be written or the parameters are invalid.
+     * @param samples The interleaved samples in the range [-1, 1].
+     * @param channels The number of channels in the sample data.
+     * @param sampleCount The number of samples per channel.
+     * @param sampleRate The sample rate in Hz.
+     * @param framesPerSecond The video frame rate to analyze the audio at.
+     * @param output The binary stream to write the audio feature file to.
+     */
+    static void Analyze(const float* samples, uint32_t channels, size_t sampleCount, uint32_t sampleRate,
+                        double framesPerSecond, std::ostream& output);
+
+    /**
+     * @brief Analyzes a WAVE file and writes the results to an audio feature file.
+     * @throws AudioFileException if a file can't be read or written.
+     * @param wavFilename The WAVE file to analyze.
+     * @param featureFilename The audio feature file to write.
+     * @param framesPerSecond The video frame rate to analyze the audio at.
+     */
+    static void AnalyzeWavFile(const std::string& wavFilename, const std::string& featureFilename, double framesPerSecond);
+};
+
+} // namespace Audio
+} // namespace libprojectM
@@ -1,13 +1,54 @@
 #include "PCM.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <system_error>
+
 namespace libprojectM {
 namespace Audio {
 
-template<
-    int signalAmplitude,
-    int signalOffset,
-    typename SampleType>
-void PCM::AddToBuffer(
+namespace {
+
+/**
+ * Feature files only store data in the default configuration's layout.
+ */
+template<typename Data>
+void ReadFeatureFrame(const AudioFeatureFileReader&, uint32_t, Data&)
+{
+}
+
+void ReadFeatureFrame(const AudioFeatureFileReader& reader, uint32_t frame, FrameAudioData& data)
+{
+    reader.ReadFrame(frame, data);
+}
+
+} // namespace
+
+template<typename Config>
+constexpr uint32_t BasicPCM<Config>::DefaultAnalysisRate;
+
+template<typename Config>
+constexpr size_t BasicPCM<Config>::AudioBufferSamples;
+
+template<typename Config>
+constexpr size_t BasicPCM<Config>::WaveformSamples;
+
+template<typename Config>
+constexpr size_t BasicPCM<Config>::SpectrumSamples;
+
+template<typename Config>
+constexpr bool BasicPCM<Config>::SupportsFeatureReplay;
+
+template<typename Config>
+BasicPCM<Config>::~BasicPCM()
+{
+    StopAnalysisThread();
+}
+
+template<typename Config>
+template<typename SampleType>
+void BasicPCM<Config>::AddToBuffer(
     SampleType const* const samples,
     uint32_t channels,
     size_t const sampleCount)
@@ -17,44 +58,212 @@ void PCM::AddToBuffer(
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; i++)
+    float* const bufferL = m_inputBuffer.Left();
+    float* const bufferR = m_inputBuffer.Right();
+
+    // Large inputs are published in chunks, so the render thread never reads a range
+    // that is being overwritten.
+    for (size_t chunkStart = 0; chunkStart < sampleCount; chunkStart += InputBuffer::MaxWriteSamples)
     {
-        size_t const bufferOffset = (m_start + i) % AudioBufferSamples;
-        m_inputBufferL[bufferOffset] = 128.0f * (static_cast<float>(samples[0 + i * channels]) - float(signalOffset)) / float(signalAmplitude);
-        if (channels > 1)
-        {
-            m_inputBufferR[bufferOffset] = 128.0f * (static_cast<float>(samples[1 + i * channels]) - float(signalOffset)) / float(signalAmplitude);
-        }
-        else
+        size_t const chunkCount = std::min(sampleCount - chunkStart, InputBuffer::MaxWriteSamples);
+        size_t const startIndex = InputBuffer::Index(m_inputBuffer.BeginWrite(chunkCount));
+
+        // Write the chunk in at most two contiguous segments, split at the end of the ring buffer.
+        size_t const firstSegment = std::min(chunkCount, InputBuffer::Capacity - startIndex);
+        SampleType const* const chunkSamples = samples + chunkStart * channels;
+
+        m_sampleConverter.Convert(chunkSamples, channels, firstSegment, bufferL + startIndex, bufferR + startIndex);
+        m_sampleConverter.Convert(chunkSamples + firstSegment * channels, channels, chunkCount - firstSegment, bufferL, bufferR);
+
+        m_inputBuffer.CommitWrite(chunkCount);
+    }
+}
+
+template<typename Config>
+void BasicPCM<Config>::Add(float const* const samples, uint32_t channels, size_t const count)
+{
+    AddToBuffer(samples, channels, count);
+}
+template<typename Config>
+void BasicPCM<Config>::Add(uint8_t const* const samples, uint32_t channels, size_t const count)
+{
+    AddToBuffer(samples, channels, count);
+}
+template<typename Config>
+void BasicPCM<Config>::Add(int16_t const* const samples, uint32_t channels, size_t const count)
+{
+    AddToBuffer(samples, channels, count);
+}
+
+template<typename Config>
+void BasicPCM<Config>::Add(float const* const samples, uint32_t channels, size_t const count, double timestamp)
+{
+    AddTimestamp(channels, count, timestamp);
+    AddToBuffer(samples, channels, count);
+}
+
+template<typename Config>
+void BasicPCM<Config>::Add(uint8_t const* const samples, uint32_t channels, size_t const count, double timestamp)
+{
+    AddTimestamp(channels, count, timestamp);
+    AddToBuffer(samples, channels, count);
+}
+
+template<typename Config>
+void BasicPCM<Config>::Add(int16_t const* const samples, uint32_t channels, size_t const count, double timestamp)
+{
+    AddTimestamp(channels, count, timestamp);
+    AddToBuffer(samples, channels, count);
+}
+
+template<typename Config>
+void BasicPCM<Config>::AddTimestamp(uint32_t channels, size_t count, double timestamp)
+{
+    if (channels == 0 || count == 0)
+    {
+        return;
+    }
+
+    // The next sample written is the first one of the new data.
+    m_inputBuffer.AddTimestamp(m_inputBuffer.WriteSequence(), timestamp);
+}
+
+template<typename Config>
+auto BasicPCM<Config>::SetDownmixMatrix(uint32_t channels, const float* coefficients) -> bool
+{
+    return m_sampleConverter.SetDownmixMatrix(channels, coefficients);
+}
+
+template<typename Config>
+void BasicPCM<Config>::SetAudioSource(AudioSourceCallback callback, void* userData)
+{
+    // Waits for a running background analysis pass to finish.
+    std::lock_guard<std::mutex> lock(m_analysisMutex);
+
+    m_audioSource = callback;
+    m_audioSourceData = userData;
+}
+
+template<typename Config>
+auto BasicPCM<Config>::CurrentTime() -> double
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Config>
+void BasicPCM<Config>::SetPresentationLatency(double seconds)
+{
+    m_presentationLatency.store(seconds, std::memory_order_relaxed);
+}
+
+template<typename Config>
+auto BasicPCM<Config>::PresentationLatency() const -> double
+{
+    return m_presentationLatency.load(std::memory_order_relaxed);
+}
+
+template<typename Config>
+void BasicPCM<Config>::UpdateFrameAudioData(double secondsSinceLastFrame, uint32_t frame)
+{
+    if (m_replayFeatures)
+    {
+        if (m_replayFeatures->FrameCount() > 0)
         {
-            m_inputBufferR[bufferOffset] = m_inputBufferL[bufferOffset];
+            ReadFeatureFrame(*m_replayFeatures, std::min(m_replayFrame, m_replayFeatures->FrameCount() - 1), m_frameAudioData);
+            m_replayFrame++;
         }
+        m_currentFrameAudioData = &m_frameAudioData;
+        return;
+    }
+
+    if (m_analysisThread.joinable())
+    {
+        m_analysisResults.Update();
+        m_currentFrameAudioData = &m_analysisResults.ReadBuffer();
+        return;
     }
-    m_start = (m_start + sampleCount) % AudioBufferSamples;
+
+    Analyze(secondsSinceLastFrame, frame, m_frameAudioData);
+    m_currentFrameAudioData = &m_frameAudioData;
 }
 
-void PCM::Add(float const* const samples, uint32_t channels, size_t const count)
+template<typename Config>
+auto BasicPCM<Config>::GetFrameAudioData() const -> const FrameData&
 {
-    AddToBuffer<1, 0>(samples, channels, count);
+    return *m_currentFrameAudioData;
 }
-void PCM::Add(uint8_t const* const samples, uint32_t channels, size_t const count)
+
+template<typename Config>
+auto BasicPCM<Config>::SetBackgroundAnalysis(bool enabled, uint32_t analysesPerSecond) -> bool
 {
-    AddToBuffer<128, 128>(samples, channels, count);
+    if (m_analysisThread.joinable())
+    {
+        StopAnalysisThread();
+
+        // Continue with the last results of the analysis thread.
+        m_frameAudioData = m_analysisResults.ReadBuffer();
+        m_currentFrameAudioData = &m_frameAudioData;
+    }
+
+    if (!enabled || m_replayFeatures)
+    {
+        return false;
+    }
+
+    // Start with the current results, so the next frames don't see empty audio data.
+    m_analysisResults.Reset(m_frameAudioData);
+    m_stopAnalysis = false;
+
+    try
+    {
+        m_analysisThread = std::thread(&BasicPCM::AnalysisThread, this, std::max(analysesPerSecond, uint32_t{1}));
+    }
+    catch (const std::system_error&)
+    {
+        // Not fatal, just keep analyzing the audio data in the render thread.
+        return false;
+    }
+
+    return true;
 }
-void PCM::Add(int16_t const* const samples, uint32_t channels, size_t const count)
+
+template<typename Config>
+auto BasicPCM<Config>::BackgroundAnalysis() const -> bool
 {
-    AddToBuffer<32768, 0>(samples, channels, count);
+    return m_analysisThread.joinable();
 }
 
-void PCM::UpdateFrameAudioData(double secondsSinceLastFrame, uint32_t frame)
+template<typename Config>
+void BasicPCM<Config>::SetFeatureReplay(std::unique_ptr<AudioFeatureFileReader> features)
+{
+    if (!SupportsFeatureReplay)
+    {
+        features.reset();
+    }
+
+    if (features)
+    {
+        SetBackgroundAnalysis(false);
+    }
+
+    m_replayFeatures = std::move(features);
+    m_replayFrame = 0;
+}
+
+template<typename Config>
+void BasicPCM<Config>::SeekFeatureReplay(uint32_t frame)
+{
+    m_replayFrame = frame;
+}
+
+template<typename Config>
+void BasicPCM<Config>::Analyze(double secondsSinceLastFrame, uint32_t frame, FrameData& data)
 {
     // 1. Copy audio data from input buffer
-    CopyNewWaveformData(m_inputBufferL, m_waveformL);
-    CopyNewWaveformData(m_inputBufferR, m_waveformR);
+    CopyNewWaveformData();
 
     // 2. Update spectrum analyzer data for both channels
-    UpdateSpectrum(m_waveformL, m_spectrumL);
-    UpdateSpectrum(m_waveformR, m_spectrumR);
+    UpdateSpectrum();
 
     // 3. Align waveforms
     m_alignL.Align(m_waveformL);
@@ -65,12 +274,9 @@ void PCM::UpdateFrameAudioData(double secondsSinceLastFrame, uint32_t frame)
     m_middles.Update(m_spectrumL, secondsSinceLastFrame, frame);
     m_treble.Update(m_spectrumL, secondsSinceLastFrame, frame);
 
-}
-
-auto PCM::GetFrameAudioData() const -> FrameAudioData
-{
-    FrameAudioData data{};
+    m_analysisFrame = frame + 1;
 
+    // 5. Store the results
     std::copy(m_waveformL.begin(), m_waveformL.begin() + WaveformSamples, data.waveformLeft.begin());
     std::copy(m_waveformR.begin(), m_waveformR.begin() + WaveformSamples, data.waveformRight.begin());
     std::copy(m_spectrumL.begin(), m_spectrumL.begin() + SpectrumSamples, data.spectrumLeft.begin());
@@ -86,38 +292,129 @@ auto PCM::GetFrameAudioData() const -> FrameAudioData
 
     data.vol = (data.bass + data.mid + data.treb) * 0.333f;
     data.volAtt = (data.bassAtt + data.midAtt + data.trebAtt) * 0.333f;
+}
 
-    return data;
+template<typename Config>
+void BasicPCM<Config>::AnalysisThread(uint32_t analysesPerSecond)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto const hopInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / analysesPerSecond));
+    auto lastAnalysis = Clock::now();
+    auto nextAnalysis = lastAnalysis + hopInterval;
+    uint32_t frame = m_analysisFrame;
+
+    // The lock is only released while waiting, so the audio source can't change during a pass.
+    std::unique_lock<std::mutex> lock(m_analysisMutex);
+    while (!m_analysisCondition.wait_until(lock, nextAnalysis, [this]() { return m_stopAnalysis; }))
+    {
+        // Pass the actual time between analysis passes, so the loudness smoothing stays
+        // independent of any scheduling delays.
+        auto const now = Clock::now();
+        double const secondsSinceLastAnalysis = std::chrono::duration<double>(now - lastAnalysis).count();
+        lastAnalysis = now;
+
+        Analyze(secondsSinceLastAnalysis, frame++, m_analysisResults.WriteBuffer());
+        m_analysisResults.Publish();
+
+        // Don't try to catch up if the analysis fell behind, just continue at the normal rate.
+        nextAnalysis = std::max(nextAnalysis + hopInterval, now);
+    }
 }
 
-void PCM::UpdateSpectrum(const WaveformBuffer& waveformData, SpectrumBuffer& spectrumData)
+template<typename Config>
+void BasicPCM<Config>::StopAnalysisThread()
 {
-    std::vector<float> waveformSamples(AudioBufferSamples);
-    std::vector<float> spectrumValues;
+    if (!m_analysisThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_analysisMutex);
+        m_stopAnalysis = true;
+    }
+    m_analysisCondition.notify_one();
 
+    m_analysisThread.join();
+}
+
+template<typename Config>
+void BasicPCM<Config>::UpdateSpectrum()
+{
     size_t oldI{0};
     for (size_t i = 0; i < AudioBufferSamples; i++)
     {
         // Damp the input into the FFT a bit, to reduce high-frequency noise:
-        waveformSamples[i] = 0.5f * (waveformData[i] + waveformData[oldI]);
+        m_spectrumInputL[i] = 0.5f * (m_waveformL[i] + m_waveformL[oldI]);
+        m_spectrumInputR[i] = 0.5f * (m_waveformR[i] + m_waveformR[oldI]);
         oldI = i;
     }
 
-    m_fft.TimeToFrequencyDomain(waveformSamples, spectrumValues);
+    m_fft.TimeToFrequencyDomain(m_spectrumInputL.data(), m_spectrumInputR.data(), m_spectrumL.data(), m_spectrumR.data());
+}
+
+template<typename Config>
+void BasicPCM<Config>::PullSamples()
+{
+    if (m_audioSource == nullptr)
+    {
+        return;
+    }
+
+    // Offer as much space as can be written at once, in at most two contiguous spans.
+    size_t const maxCount = InputBuffer::MaxWriteSamples;
+    size_t const startIndex = InputBuffer::Index(m_inputBuffer.BeginWrite(maxCount));
+    size_t const firstSegment = std::min(maxCount, InputBuffer::Capacity - startIndex);
+    float* const bufferL = m_inputBuffer.Left();
+    float* const bufferR = m_inputBuffer.Right();
+
+    size_t count = std::min<size_t>(m_audioSource(bufferL + startIndex, bufferR + startIndex, static_cast<uint32_t>(firstSegment), m_audioSourceData), firstSegment);
+    size_t secondSegment{};
+    if (count == firstSegment && firstSegment < maxCount)
+    {
+        secondSegment = std::min<size_t>(m_audioSource(bufferL, bufferR, static_cast<uint32_t>(maxCount - firstSegment), m_audioSourceData), maxCount - firstSegment);
+    }
 
-    std::copy(spectrumValues.begin(), spectrumValues.end(), spectrumData.begin());
+    // Scale to the internal sample range in place.
+    for (size_t i = startIndex; i < startIndex + count; i++)
+    {
+        bufferL[i] *= 128.0f;
+        bufferR[i] *= 128.0f;
+    }
+    for (size_t i = 0; i < secondSegment; i++)
+    {
+        bufferL[i] *= 128.0f;
+        bufferR[i] *= 128.0f;
+    }
+
+    m_inputBuffer.CommitWrite(count + secondSegment);
 }
 
-void PCM::CopyNewWaveformData(const WaveformBuffer& source, WaveformBuffer& destination)
+template<typename Config>
+void BasicPCM<Config>::CopyNewWaveformData()
 {
-    auto const bufferStartIndex = m_start.load();
+    static_assert(AudioBufferSamples <= InputBuffer::MaxReadSamples, "Input ring buffer too small for analysis window.");
 
-    for (size_t i = 0; i < AudioBufferSamples; i++)
+    PullSamples();
+
+    // Place the end of the analysis window at the sample audible when the frame is displayed.
+    size_t delay{};
+    size_t sequence{};
+    if (m_inputBuffer.SequenceAt(CurrentTime() + m_presentationLatency.load(std::memory_order_relaxed), sequence))
     {
-        destination[i] = source[(bufferStartIndex + i) % AudioBufferSamples];
+        auto const samplesAhead = static_cast<std::ptrdiff_t>(m_inputBuffer.WriteSequence() - sequence - 1);
+        delay = samplesAhead > 0 ? static_cast<size_t>(samplesAhead) : 0;
     }
+
+    // If the samples kept being overwritten while copying, the previous frame's waveform is kept.
+    size_t newSamples{};
+    m_inputBuffer.ReadLatest(m_waveformL.data(), m_waveformR.data(), AudioBufferSamples, delay, newSamples);
 }
 
+template class BasicPCM<DefaultAudioConfig>;
+template class BasicPCM<LowLatencyAudioConfig>;
+template class BasicPCM<HighResolutionAudioConfig>;
 
 } // namespace Audio
 } // namespace libprojectM
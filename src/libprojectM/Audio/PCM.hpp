@@ -8,27 +8,91 @@
 #pragma once
 
 #include "AudioConstants.hpp"
+#include "AudioFeatureFile.hpp"
 #include "FrameAudioData.hpp"
 #include "Loudness.hpp"
 #include "MilkdropFFT.hpp"
+#include "SampleConverter.hpp"
+#include "SampleRingBuffer.hpp"
+#include "TripleBuffer.hpp"
 #include "WaveformAligner.hpp"
 
 #include <projectM-4/projectM_export.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 
 namespace libprojectM {
 namespace Audio {
 
-class PCM
+/**
+ * @brief Audio sample storage and analyzer.
+ *
+ * The Add() methods may be called from a different thread (e.g. the application's audio thread)
+ * than UpdateFrameAudioData() and GetFrameAudioData(), which must both be called from the render
+ * thread. Only a single thread may add samples at a time.
+ *
+ * All buffers used for the analysis are allocated on construction. Neither adding samples nor
+ * updating the per-frame audio data allocates any memory.
+ *
+ * Optionally, the analysis can run in a background thread at a fixed rate. UpdateFrameAudioData()
+ * then only picks up the most recently finished analysis result.
+ *
+ * All buffer and transform sizes are taken from the Config template parameter. projectM itself
+ * renders with the PCM alias using DefaultAudioConfig, other configurations are meant for
+ * applications which only need the analysis results.
+ *
+ * @tparam Config The AudioConfig specialization determining all analysis sizes.
+ */
+template<typename Config>
+class BasicPCM
 {
 public:
+    static constexpr uint32_t DefaultAnalysisRate{60}; //!< Default number of background analysis passes per second.
+
+    static constexpr size_t AudioBufferSamples = Config::AudioBufferSamples; //!< Number of waveform samples used for analysis.
+    static constexpr size_t WaveformSamples = Config::WaveformSamples;       //!< Number of waveform samples returned per frame.
+    static constexpr size_t SpectrumSamples = Config::SpectrumSamples;       //!< Number of spectrum samples returned per frame.
+
+    /**
+     * Audio feature files always store data in the layout of the default configuration.
+     */
+    static constexpr bool SupportsFeatureReplay = std::is_same<Config, DefaultAudioConfig>::value;
+
+    using FrameData = BasicFrameAudioData<Config>; //!< Per-frame analysis results of this configuration.
+
+    /**
+     * @brief Callback writing new audio samples directly into the input buffer.
+     *
+     * Receives contiguous spans of the left and right channel buffers and the maximum number of
+     * samples to write. Samples are expected in the range -1 to 1. Returns the number of samples
+     * written per channel. The last parameter is the user data pointer passed to SetAudioSource().
+     */
+    using AudioSourceCallback = uint32_t (*)(float* left, float* right, uint32_t maxSamples, void* userData);
+
+    BasicPCM() = default;
+
+    /**
+     * @brief Destructor. Stops the background analysis thread if it is running.
+     */
+    PROJECTM_EXPORT ~BasicPCM();
+
+    BasicPCM(const BasicPCM&) = delete;
+    BasicPCM(BasicPCM&&) = delete;
+    auto operator=(const BasicPCM&) -> BasicPCM& = delete;
+    auto operator=(BasicPCM&&) -> BasicPCM& = delete;
+
     /**
      * @brief Adds new interleaved floating-point PCM data to the buffer.
-     * Left channel is expected at offset 0, right channel at offset 1. Other channels are ignored.
+     * Left channel is expected at offset 0, right channel at offset 1. Data with more than two
+     * channels is downmixed, see SetDownmixMatrix().
      * @param samples The buffer to be added
      * @param channels The number of channels in the input data.
      * @param count The amount of samples in the buffer
@@ -37,7 +101,8 @@ public:
 
     /**
      * @brief Adds new mono unsigned 8-bit PCM data to the storage
-     * Left channel is expected at offset 0, right channel at offset 1. Other channels are ignored.
+     * Left channel is expected at offset 0, right channel at offset 1. Data with more than two
+     * channels is downmixed, see SetDownmixMatrix().
      * @param samples The buffer to be added
      * @param channels The number of channels in the input data.
      * @param count The amount of samples in the buffer
@@ -46,13 +111,96 @@ public:
 
     /**
      * @brief Adds new mono signed 16-bit PCM data to the storage
-     * Left channel is expected at offset 0, right channel at offset 1. Other channels are ignored.
+     * Left channel is expected at offset 0, right channel at offset 1. Data with more than two
+     * channels is downmixed, see SetDownmixMatrix().
      * @param samples The buffer to be added
      * @param channels The number of channels in the input data.
      * @param count The amount of samples in the buffer
      */
     PROJECTM_EXPORT void Add(const int16_t* samples, uint32_t channels, size_t count);
 
+    /**
+     * @brief Adds new interleaved floating-point PCM data with a playback timestamp.
+     * @param samples The buffer to be added
+     * @param channels The number of channels in the input data.
+     * @param count The amount of samples in the buffer
+     * @param timestamp The time the first sample is played back, in seconds, as returned by CurrentTime().
+     */
+    PROJECTM_EXPORT void Add(const float* samples, uint32_t channels, size_t count, double timestamp);
+
+    /**
+     * @brief Adds new unsigned 8-bit PCM data with a playback timestamp.
+     * @param samples The buffer to be added
+     * @param channels The number of channels in the input data.
+     * @param count The amount of samples in the buffer
+     * @param timestamp The time the first sample is played back, in seconds, as returned by CurrentTime().
+     */
+    PROJECTM_EXPORT void Add(const uint8_t* samples, uint32_t channels, size_t count, double timestamp);
+
+    /**
+     * @brief Adds new signed 16-bit PCM data with a playback timestamp.
+     * @param samples The buffer to be added
+     * @param channels The number of channels in the input data.
+     * @param count The amount of samples in the buffer
+     * @param timestamp The time the first sample is played back, in seconds, as returned by CurrentTime().
+     */
+    PROJECTM_EXPORT void Add(const int16_t* samples, uint32_t channels, size_t count, double timestamp);
+
+    /**
+     * @brief Sets the matrix used to downmix input data with more than two channels.
+     *
+     * Must be called from the thread calling Add(), or while no samples are added.
+     *
+     * @param channels The number of input channels, 3 to SampleConverter::MaxDownmixChannels.
+     * @param coefficients 2 * channels coefficients: for each input channel, its weight in the left
+     *                     output followed by its weight in the right output. If nullptr, the
+     *                     ITU-R BS.775 default matrix is restored.
+     * @return True if the matrix was set, false if the channel count is not supported.
+     */
+    PROJECTM_EXPORT auto SetDownmixMatrix(uint32_t channels, const float* coefficients) -> bool;
+
+    /**
+     * @brief Sets a callback which provides new audio samples for each analysis pass.
+     *
+     * Instead of copying samples into the input buffer with Add(), the callback writes them
+     * directly into the buffer right before the analysis, i.e. in UpdateFrameAudioData() or in the
+     * background analysis thread. Add() must not be called while a callback is set.
+     *
+     * Must be called from the same thread as UpdateFrameAudioData().
+     *
+     * @param callback The callback function, or nullptr to remove the callback.
+     * @param userData A pointer passed to each callback invocation.
+     */
+    PROJECTM_EXPORT void SetAudioSource(AudioSourceCallback callback, void* userData);
+
+    /**
+     * @brief Returns the current time of the clock used for sample timestamps.
+     *
+     * This is a monotonic clock, the same as std::chrono::steady_clock.
+     *
+     * @return The current time in seconds.
+     */
+    PROJECTM_EXPORT static auto CurrentTime() -> double;
+
+    /**
+     * @brief Sets the time between analyzing the audio data and the frame being displayed.
+     *
+     * If samples were added with timestamps, the analysis uses the samples played back at the
+     * time the frame is displayed instead of the newest samples. The time is limited by the
+     * history kept in the input buffer. Without timestamps, the newest samples are always used.
+     *
+     * May be called from any thread.
+     *
+     * @param seconds The presentation latency in seconds.
+     */
+    PROJECTM_EXPORT void SetPresentationLatency(double seconds);
+
+    /**
+     * @brief Returns the time between analyzing the audio data and the frame being displayed.
+     * @return The presentation latency in seconds.
+     */
+    PROJECTM_EXPORT auto PresentationLatency() const -> double;
+
     /**
      * @brief Updates the internal audio data values for rendering the next frame.
      * This method must only be called once per frame, as it does some temporal blending
@@ -61,58 +209,166 @@ public:
      * - Aligning waveforms to a best-fit match to the previous frame to produce a calmer waveform shape.
      * - Calculating the bass/mid/treb values and their attenuated (time-smoothed) versions.
      *
+     * If background analysis is enabled, this only picks up the latest result from the analysis
+     * thread and the parameters are ignored.
+     *
      * @param secondsSinceLastFrame Time passed since rendering the last frame. Basically 1.0/FPS.
      * @param frame Frames rendered since projectM was started.
      */
     PROJECTM_EXPORT void UpdateFrameAudioData(double secondsSinceLastFrame, uint32_t frame);
 
     /**
-     * @brief Returns a class holding a copy of the current frame audio data.
+     * @brief Enables or disables running the audio analysis in a separate thread.
+     *
+     * Must be called from the same thread as UpdateFrameAudioData(). If the analysis thread
+     * cannot be created, the analysis continues to run synchronously. Background analysis is
+     * not available while replaying an audio feature file.
+     *
+     * @param enabled True to analyze audio in a background thread, false to analyze audio in
+     *                UpdateFrameAudioData().
+     * @param analysesPerSecond The number of analysis passes per second. Independent of the
+     *                          rendering frame rate. Values of zero are changed to one.
+     * @return True if background analysis is now running, false if not.
+     */
+    PROJECTM_EXPORT auto SetBackgroundAnalysis(bool enabled, uint32_t analysesPerSecond = DefaultAnalysisRate) -> bool;
+
+    /**
+     * @brief Returns whether the audio analysis is running in a background thread.
+     * @return True if background analysis is running, false if the analysis runs in UpdateFrameAudioData().
+     */
+    PROJECTM_EXPORT auto BackgroundAnalysis() const -> bool;
+
+    /**
+     * @brief Replays pre-analyzed audio data instead of analyzing the added samples.
+     *
+     * Each call to UpdateFrameAudioData() advances the replay by one frame. After the last frame,
+     * the last frame's data is kept. Stops the background analysis thread, if running.
+     * Ignored if SupportsFeatureReplay is false for this configuration.
+     *
+     * @param features The audio feature file to replay, or nullptr to continue with live analysis.
+     */
+    PROJECTM_EXPORT void SetFeatureReplay(std::unique_ptr<AudioFeatureFileReader> features);
+
+    /**
+     * @brief Sets the frame which is used on the next call to UpdateFrameAudioData().
+     * Does nothing if no audio feature file is being replayed.
+     * @param frame The frame index in the audio feature file.
+     */
+    PROJECTM_EXPORT void SeekFeatureReplay(uint32_t frame);
+
+    /**
+     * @brief Returns the current frame audio data.
+     *
+     * The returned data is owned by this class and not copied. It remains valid and unchanged until the
+     * next call to UpdateFrameAudioData() or SetBackgroundAnalysis(), so all consumers in a frame can share it.
+     *
      * @return A FrameAudioData class with waveform, spectrum and other derived values.
      */
-    PROJECTM_EXPORT auto GetFrameAudioData() const -> FrameAudioData;
+    PROJECTM_EXPORT auto GetFrameAudioData() const -> const FrameData&;
 
 private:
-    template<
-        int signalAmplitude,
-        int signalOffset,
-        typename SampleType>
-    void AddToBuffer(const SampleType* samples, uint32_t channel, size_t sampleCount);
+    using WaveformBuffer = typename Config::WaveformBuffer;
+    using SpectrumBuffer = typename Config::SpectrumBuffer;
+    using InputBuffer = BasicSampleRingBuffer<Config::InputBufferSamples>;
+    using FFT = BasicMilkdropFFT<Config::WaveformSamples, Config::SpectrumSamples>;
+    using Aligner = BasicWaveformAligner<Config::AudioBufferSamples, Config::WaveformSamples>;
+    using LoudnessBand = BasicLoudness<Config::SpectrumSamples>;
+
+    template<typename SampleType>
+    void AddToBuffer(const SampleType* samples, uint32_t channels, size_t sampleCount);
+
+    /**
+     * Records the playback time of the first sample of the data about to be added.
+     * @param channels The number of channels in the input data.
+     * @param count The amount of samples in the input data.
+     * @param timestamp The playback time of the first sample in seconds.
+     */
+    void AddTimestamp(uint32_t channels, size_t count, double timestamp);
+
+    /**
+     * Updates FFT data for both channels.
+     */
+    void UpdateSpectrum();
+
+    /**
+     * Invokes the audio source callback, if set, to write new samples into the input buffer.
+     */
+    void PullSamples();
 
     /**
-     * Updates FFT data
+     * Copies the samples played back when the frame is displayed out of the input ring buffer
+     * into the per-frame waveform buffers. Uses the newest samples if there are no timestamps.
      */
-    void UpdateSpectrum(const WaveformBuffer& waveformData, SpectrumBuffer& spectrumData);
+    void CopyNewWaveformData();
 
     /**
-     * Copies data out of the circular input buffer into the per-frame waveform buffer.
+     * Runs a full analysis pass over the newest samples and stores the results.
+     * @param secondsSinceLastFrame Time passed since the last analysis pass.
+     * @param frame The number of analysis passes done so far.
+     * @param data Receives the analysis results.
      */
-    void CopyNewWaveformData(const WaveformBuffer& source, WaveformBuffer& destination);
+    void Analyze(double secondsSinceLastFrame, uint32_t frame, FrameData& data);
+
+    /**
+     * Background analysis thread function.
+     * @param analysesPerSecond The number of analysis passes per second.
+     */
+    void AnalysisThread(uint32_t analysesPerSecond);
+
+    /**
+     * Stops the background analysis thread, if running.
+     */
+    void StopAnalysisThread();
 
     // External input buffer
-    WaveformBuffer m_inputBufferL{0.f}; //!< Circular buffer for left-channel PCM data.
-    WaveformBuffer m_inputBufferR{0.f}; //!< Circular buffer for right-channel PCM data.
-    std::atomic<size_t> m_start{0};     //!< Circular buffer start index.
+    SampleConverter m_sampleConverter; //!< Deinterleaves and converts incoming samples into the input buffer.
+    InputBuffer m_inputBuffer;         //!< Lock-free ring buffer receiving PCM data from the audio thread.
+
+    std::atomic<double> m_presentationLatency{0.0}; //!< Time between analysis and display in seconds.
+
+    AudioSourceCallback m_audioSource{nullptr}; //!< Callback providing new samples, if set. Protected by m_analysisMutex.
+    void* m_audioSourceData{nullptr};           //!< User data pointer passed to the audio source callback.
 
     // Frame waveform data
     WaveformBuffer m_waveformL{0.f}; //!< Left-channel waveform data, aligned. Only the first WaveformSamples number of samples are valid.
     WaveformBuffer m_waveformR{0.f}; //!< Right-channel waveform data, aligned. Only the first WaveformSamples number of samples are valid.
 
     // Frame spectrum data
-    SpectrumBuffer m_spectrumL{0.f}; //!< Left-channel spectrum data.
-    SpectrumBuffer m_spectrumR{0.f}; //!< Right-channel spectrum data.
+    WaveformBuffer m_spectrumInputL{0.f}; //!< Damped left-channel waveform data used as FFT input.
+    WaveformBuffer m_spectrumInputR{0.f}; //!< Damped right-channel waveform data used as FFT input.
+    SpectrumBuffer m_spectrumL{0.f};      //!< Left-channel spectrum data.
+    SpectrumBuffer m_spectrumR{0.f};      //!< Right-channel spectrum data.
 
-    MilkdropFFT m_fft{WaveformSamples, SpectrumSamples, true}; //!< Spectrum analyzer instance.
+    FFT m_fft{true}; //!< Spectrum analyzer instance.
 
     // Alignment data
-    WaveformAligner m_alignL; //!< Left-channel waveform alignment.
-    WaveformAligner m_alignR; //!< Left-channel waveform alignment.
+    Aligner m_alignL; //!< Left-channel waveform alignment.
+    Aligner m_alignR; //!< Left-channel waveform alignment.
 
     // Frame beat detection values
-    Loudness m_bass{Loudness::Band::Bass};       //!< Beat detection/volume for the "bass" band.
-    Loudness m_middles{Loudness::Band::Middles}; //!< Beat detection/volume for the "middles" band.
-    Loudness m_treble{Loudness::Band::Treble};   //!< Beat detection/volume for the "treble" band.
+    LoudnessBand m_bass{LoudnessBand::Band::Bass};       //!< Beat detection/volume for the "bass" band.
+    LoudnessBand m_middles{LoudnessBand::Band::Middles}; //!< Beat detection/volume for the "middles" band.
+    LoudnessBand m_treble{LoudnessBand::Band::Treble};   //!< Beat detection/volume for the "treble" band.
+
+    uint32_t m_analysisFrame{}; //!< Number of analysis passes done so far.
+
+    // Analysis results
+    FrameData m_frameAudioData;                                  //!< Results of the synchronous analysis or replayed data.
+    TripleBuffer<FrameData> m_analysisResults;                   //!< Results of the background analysis thread.
+    const FrameData* m_currentFrameAudioData{&m_frameAudioData}; //!< The data returned by GetFrameAudioData().
+
+    // Feature replay
+    std::unique_ptr<AudioFeatureFileReader> m_replayFeatures; //!< Audio feature file being replayed, if any.
+    uint32_t m_replayFrame{};                                //!< Next frame to replay.
+
+    // Background analysis thread
+    std::thread m_analysisThread;                  //!< The background analysis thread, if running.
+    std::mutex m_analysisMutex;                    //!< Held by the analysis thread while not waiting.
+    std::condition_variable m_analysisCondition;   //!< Wakes up the analysis thread if it should stop.
+    bool m_stopAnalysis{false};                    //!< Set to true to stop the analysis thread.
 };
 
+using PCM = BasicPCM<DefaultAudioConfig>; //!< Audio storage and analyzer used for rendering.
+
 } // namespace Audio
 } // namespace libprojectM
@@ -0,0 +1,717 @@
+#include "SampleConverter.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROJECTM_AUDIO_SSE2 1
+#include <emmintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PROJECTM_AUDIO_AVX2 1
+#define PROJECTM_AUDIO_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#define PROJECTM_AUDIO_AVX2 1
+#define PROJECTM_AUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PROJECTM_AUDIO_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace libprojectM {
+namespace Audio {
+
+namespace {
+
+/**
+ * @brief Offset and scale to convert a sample type into the internal [-128, 128] range.
+ *
+ * The scale factors are powers of two, so (sample - Offset) * Scale is exact and identical
+ * for all kernel implementations.
+ */
+template<typename SampleType>
+struct SampleFormat;
+
+template<>
+struct SampleFormat<float>
+{
+    static constexpr auto Offset() -> float
+    {
+        return 0.0f;
+    }
+    static constexpr auto Scale() -> float
+    {
+        return 128.0f;
+    }
+};
+
+template<>
+struct SampleFormat<int16_t>
+{
+    static constexpr auto Offset() -> float
+    {
+        return 0.0f;
+    }
+    static constexpr auto Scale() -> float
+    {
+        return 128.0f / 32768.0f;
+    }
+};
+
+template<>
+struct SampleFormat<uint8_t>
+{
+    static constexpr auto Offset() -> float
+    {
+        return 128.0f;
+    }
+    static constexpr auto Scale() -> float
+    {
+        return 1.0f;
+    }
+};
+
+template<typename SampleType>
+inline auto ConvertSample(SampleType sample) -> float
+{
+    return (static_cast<float>(sample) - SampleFormat<SampleType>::Offset()) * SampleFormat<SampleType>::Scale();
+}
+
+template<typename SampleType>
+void ConvertScalar(const SampleType* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    if (channels == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            left[i] = ConvertSample(samples[i]);
+            right[i] = left[i];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        left[i] = ConvertSample(samples[i * channels]);
+        right[i] = ConvertSample(samples[i * channels + 1]);
+    }
+}
+
+/**
+ * @brief Folds all channels into left and right using the given downmix matrix.
+ *
+ * The vectorized kernels accumulate the channels in the same order, so results are identical.
+ */
+template<typename SampleType>
+void DownmixScalar(const SampleType* samples, uint32_t channels, size_t count, const float* matrix, float* left, float* right)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float sumLeft{};
+        float sumRight{};
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            float const value = ConvertSample(samples[i * channels + channel]);
+            sumLeft += matrix[channel * 2] * value;
+            sumRight += matrix[channel * 2 + 1] * value;
+        }
+        left[i] = sumLeft;
+        right[i] = sumRight;
+    }
+}
+
+#ifdef PROJECTM_AUDIO_SSE2
+
+template<typename SampleType>
+inline auto ScaleSSE2(__m128 values) -> __m128
+{
+    return _mm_mul_ps(_mm_sub_ps(values, _mm_set1_ps(SampleFormat<SampleType>::Offset())),
+                      _mm_set1_ps(SampleFormat<SampleType>::Scale()));
+}
+
+void ConvertFloatSSE2(const float* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const values = ScaleSSE2<float>(_mm_loadu_ps(samples + i));
+            _mm_storeu_ps(left + i, values);
+            _mm_storeu_ps(right + i, values);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const first = _mm_loadu_ps(samples + i * 2);      // L0 R0 L1 R1
+            auto const second = _mm_loadu_ps(samples + i * 2 + 4); // L2 R2 L3 R3
+            _mm_storeu_ps(left + i, ScaleSSE2<float>(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0))));
+            _mm_storeu_ps(right + i, ScaleSSE2<float>(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+void ConvertInt16SSE2(const int16_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+            // Sign-extend by moving the 16-bit values into the upper half and shifting back.
+            auto const low = ScaleSSE2<int16_t>(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16)));
+            auto const high = ScaleSSE2<int16_t>(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16)));
+            _mm_storeu_ps(left + i, low);
+            _mm_storeu_ps(left + i + 4, high);
+            _mm_storeu_ps(right + i, low);
+            _mm_storeu_ps(right + i + 4, high);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            // Each 32-bit lane holds one L/R pair, with the left sample in the lower half.
+            auto const frames = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i * 2));
+            auto const leftValues = _mm_srai_epi32(_mm_slli_epi32(frames, 16), 16);
+            auto const rightValues = _mm_srai_epi32(frames, 16);
+            _mm_storeu_ps(left + i, ScaleSSE2<int16_t>(_mm_cvtepi32_ps(leftValues)));
+            _mm_storeu_ps(right + i, ScaleSSE2<int16_t>(_mm_cvtepi32_ps(rightValues)));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+void ConvertUInt8SSE2(const uint8_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    auto const zero = _mm_setzero_si128();
+
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i)), zero);
+            auto const low = ScaleSSE2<uint8_t>(_mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)));
+            auto const high = ScaleSSE2<uint8_t>(_mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)));
+            _mm_storeu_ps(left + i, low);
+            _mm_storeu_ps(left + i + 4, high);
+            _mm_storeu_ps(right + i, low);
+            _mm_storeu_ps(right + i + 4, high);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            // Widen to 16 bits, then each 32-bit lane holds one L/R pair.
+            auto const frames = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i * 2)), zero);
+            auto const leftValues = _mm_and_si128(frames, _mm_set1_epi32(0xFFFF));
+            auto const rightValues = _mm_srli_epi32(frames, 16);
+            _mm_storeu_ps(left + i, ScaleSSE2<uint8_t>(_mm_cvtepi32_ps(leftValues)));
+            _mm_storeu_ps(right + i, ScaleSSE2<uint8_t>(_mm_cvtepi32_ps(rightValues)));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+/**
+ * @brief Loads one channel of four consecutive frames.
+ */
+template<typename SampleType>
+inline auto GatherSSE2(const SampleType* samples, uint32_t channels) -> __m128
+{
+    return ScaleSSE2<SampleType>(_mm_setr_ps(static_cast<float>(samples[0]), static_cast<float>(samples[channels]),
+                                             static_cast<float>(samples[channels * 2]), static_cast<float>(samples[channels * 3])));
+}
+
+template<typename SampleType>
+void DownmixSSE2(const SampleType* samples, uint32_t channels, size_t count, const float* matrix, float* left, float* right)
+{
+    size_t i{};
+    for (; i + 4 <= count; i += 4)
+    {
+        auto sumLeft = _mm_setzero_ps();
+        auto sumRight = _mm_setzero_ps();
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            auto const values = GatherSSE2(samples + i * channels + channel, channels);
+            sumLeft = _mm_add_ps(sumLeft, _mm_mul_ps(_mm_set1_ps(matrix[channel * 2]), values));
+            sumRight = _mm_add_ps(sumRight, _mm_mul_ps(_mm_set1_ps(matrix[channel * 2 + 1]), values));
+        }
+        _mm_storeu_ps(left + i, sumLeft);
+        _mm_storeu_ps(right + i, sumRight);
+    }
+
+    DownmixScalar(samples + i * channels, channels, count - i, matrix, left + i, right + i);
+}
+
+#endif
+
+#ifdef PROJECTM_AUDIO_AVX2
+
+template<typename SampleType>
+PROJECTM_AUDIO_TARGET_AVX2 inline auto ScaleAVX2(__m256 values) -> __m256
+{
+    return _mm256_mul_ps(_mm256_sub_ps(values, _mm256_set1_ps(SampleFormat<SampleType>::Offset())),
+                         _mm256_set1_ps(SampleFormat<SampleType>::Scale()));
+}
+
+PROJECTM_AUDIO_TARGET_AVX2 void ConvertFloatAVX2(const float* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = ScaleAVX2<float>(_mm256_loadu_ps(samples + i));
+            _mm256_storeu_ps(left + i, values);
+            _mm256_storeu_ps(right + i, values);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const first = _mm256_loadu_ps(samples + i * 2);      // L0 R0 L1 R1 | L2 R2 L3 R3
+            auto const second = _mm256_loadu_ps(samples + i * 2 + 8); // L4 R4 L5 R5 | L6 R6 L7 R7
+
+            // In-lane shuffles yield L0 L1 L4 L5 | L2 L3 L6 L7, so swap the middle 64-bit blocks.
+            auto const leftValues = _mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+            auto const rightValues = _mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm256_storeu_ps(left + i, ScaleAVX2<float>(_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(leftValues), _MM_SHUFFLE(3, 1, 2, 0)))));
+            _mm256_storeu_ps(right + i, ScaleAVX2<float>(_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(rightValues), _MM_SHUFFLE(3, 1, 2, 0)))));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+PROJECTM_AUDIO_TARGET_AVX2 void ConvertInt16AVX2(const int16_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i)));
+            auto const scaled = ScaleAVX2<int16_t>(_mm256_cvtepi32_ps(values));
+            _mm256_storeu_ps(left + i, scaled);
+            _mm256_storeu_ps(right + i, scaled);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const frames = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i * 2));
+            auto const leftValues = _mm256_srai_epi32(_mm256_slli_epi32(frames, 16), 16);
+            auto const rightValues = _mm256_srai_epi32(frames, 16);
+            _mm256_storeu_ps(left + i, ScaleAVX2<int16_t>(_mm256_cvtepi32_ps(leftValues)));
+            _mm256_storeu_ps(right + i, ScaleAVX2<int16_t>(_mm256_cvtepi32_ps(rightValues)));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+PROJECTM_AUDIO_TARGET_AVX2 void ConvertUInt8AVX2(const uint8_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i)));
+            auto const scaled = ScaleAVX2<uint8_t>(_mm256_cvtepi32_ps(values));
+            _mm256_storeu_ps(left + i, scaled);
+            _mm256_storeu_ps(right + i, scaled);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const frames = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i * 2)));
+            auto const leftValues = _mm256_and_si256(frames, _mm256_set1_epi32(0xFFFF));
+            auto const rightValues = _mm256_srli_epi32(frames, 16);
+            _mm256_storeu_ps(left + i, ScaleAVX2<uint8_t>(_mm256_cvtepi32_ps(leftValues)));
+            _mm256_storeu_ps(right + i, ScaleAVX2<uint8_t>(_mm256_cvtepi32_ps(rightValues)));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+/**
+ * @brief Loads one channel of eight consecutive frames.
+ *
+ * Built from scalar loads, as hardware gathers are slower than this on many CPUs.
+ */
+template<typename SampleType>
+PROJECTM_AUDIO_TARGET_AVX2 inline auto GatherAVX2(const SampleType* samples, uint32_t channels) -> __m256
+{
+    return ScaleAVX2<SampleType>(_mm256_setr_ps(static_cast<float>(samples[0]), static_cast<float>(samples[channels]),
+                                                static_cast<float>(samples[channels * 2]), static_cast<float>(samples[channels * 3]),
+                                                static_cast<float>(samples[channels * 4]), static_cast<float>(samples[channels * 5]),
+                                                static_cast<float>(samples[channels * 6]), static_cast<float>(samples[channels * 7])));
+}
+
+template<typename SampleType>
+PROJECTM_AUDIO_TARGET_AVX2 void DownmixAVX2(const SampleType* samples, uint32_t channels, size_t count, const float* matrix, float* left, float* right)
+{
+    size_t i{};
+    for (; i + 8 <= count; i += 8)
+    {
+        auto sumLeft = _mm256_setzero_ps();
+        auto sumRight = _mm256_setzero_ps();
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            auto const values = GatherAVX2(samples + i * channels + channel, channels);
+            sumLeft = _mm256_add_ps(sumLeft, _mm256_mul_ps(_mm256_set1_ps(matrix[channel * 2]), values));
+            sumRight = _mm256_add_ps(sumRight, _mm256_mul_ps(_mm256_set1_ps(matrix[channel * 2 + 1]), values));
+        }
+        _mm256_storeu_ps(left + i, sumLeft);
+        _mm256_storeu_ps(right + i, sumRight);
+    }
+
+    DownmixScalar(samples + i * channels, channels, count - i, matrix, left + i, right + i);
+}
+
+auto CpuSupportsAVX2() -> bool
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int registers[4]{};
+    __cpuid(registers, 0);
+    if (registers[0] < 7)
+    {
+        return false;
+    }
+
+    // Check that the OS saves the AVX registers (OSXSAVE + AVX, then XCR0 bits 1 and 2).
+    __cpuid(registers, 1);
+    bool const osxsave = (registers[2] & (1 << 27)) != 0;
+    bool const avx = (registers[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(registers, 7, 0);
+    return (registers[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+#ifdef PROJECTM_AUDIO_NEON
+
+template<typename SampleType>
+inline auto ScaleNEON(float32x4_t values) -> float32x4_t
+{
+    return vmulq_f32(vsubq_f32(values, vdupq_n_f32(SampleFormat<SampleType>::Offset())),
+                     vdupq_n_f32(SampleFormat<SampleType>::Scale()));
+}
+
+void ConvertFloatNEON(const float* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const values = ScaleNEON<float>(vld1q_f32(samples + i));
+            vst1q_f32(left + i, values);
+            vst1q_f32(right + i, values);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const frames = vld2q_f32(samples + i * 2);
+            vst1q_f32(left + i, ScaleNEON<float>(frames.val[0]));
+            vst1q_f32(right + i, ScaleNEON<float>(frames.val[1]));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+void ConvertInt16NEON(const int16_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const values = ScaleNEON<int16_t>(vcvtq_f32_s32(vmovl_s16(vld1_s16(samples + i))));
+            vst1q_f32(left + i, values);
+            vst1q_f32(right + i, values);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const frames = vld2_s16(samples + i * 2);
+            vst1q_f32(left + i, ScaleNEON<int16_t>(vcvtq_f32_s32(vmovl_s16(frames.val[0]))));
+            vst1q_f32(right + i, ScaleNEON<int16_t>(vcvtq_f32_s32(vmovl_s16(frames.val[1]))));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+void ConvertUInt8NEON(const uint8_t* samples, uint32_t channels, size_t count, float* left, float* right)
+{
+    size_t i{};
+    if (channels == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const values = vmovl_u8(vld1_u8(samples + i));
+            auto const low = ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_low_u16(values))));
+            auto const high = ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_high_u16(values))));
+            vst1q_f32(left + i, low);
+            vst1q_f32(left + i + 4, high);
+            vst1q_f32(right + i, low);
+            vst1q_f32(right + i + 4, high);
+        }
+    }
+    else if (channels == 2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const frames = vld2_u8(samples + i * 2);
+            auto const leftValues = vmovl_u8(frames.val[0]);
+            auto const rightValues = vmovl_u8(frames.val[1]);
+            vst1q_f32(left + i, ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_low_u16(leftValues)))));
+            vst1q_f32(left + i + 4, ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_high_u16(leftValues)))));
+            vst1q_f32(right + i, ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_low_u16(rightValues)))));
+            vst1q_f32(right + i + 4, ScaleNEON<uint8_t>(vcvtq_f32_u32(vmovl_u16(vget_high_u16(rightValues)))));
+        }
+    }
+
+    ConvertScalar(samples + i * channels, channels, count - i, left + i, right + i);
+}
+
+/**
+ * @brief Loads one channel of four consecutive frames.
+ */
+template<typename SampleType>
+inline auto GatherNEON(const SampleType* samples, uint32_t channels) -> float32x4_t
+{
+    float const values[4]{static_cast<float>(samples[0]), static_cast<float>(samples[channels]),
+                          static_cast<float>(samples[channels * 2]), static_cast<float>(samples[channels * 3])};
+    return ScaleNEON<SampleType>(vld1q_f32(values));
+}
+
+template<typename SampleType>
+void DownmixNEON(const SampleType* samples, uint32_t channels, size_t count, const float* matrix, float* left, float* right)
+{
+    size_t i{};
+    for (; i + 4 <= count; i += 4)
+    {
+        auto sumLeft = vdupq_n_f32(0.0f);
+        auto sumRight = vdupq_n_f32(0.0f);
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            auto const values = GatherNEON(samples + i * channels + channel, channels);
+            sumLeft = vaddq_f32(sumLeft, vmulq_f32(vdupq_n_f32(matrix[channel * 2]), values));
+            sumRight = vaddq_f32(sumRight, vmulq_f32(vdupq_n_f32(matrix[channel * 2 + 1]), values));
+        }
+        vst1q_f32(left + i, sumLeft);
+        vst1q_f32(right + i, sumRight);
+    }
+
+    DownmixScalar(samples + i * channels, channels, count - i, matrix, left + i, right + i);
+}
+
+#endif
+
+} // namespace
+
+constexpr uint32_t SampleConverter::MaxDownmixChannels;
+
+SampleConverter::SampleConverter()
+    : SampleConverter(BestInstructionSet())
+{
+}
+
+SampleConverter::SampleConverter(InstructionSet instructionSet)
+{
+    if (!IsSupported(instructionSet))
+    {
+        instructionSet = InstructionSet::Scalar;
+    }
+
+    m_instructionSet = instructionSet;
+
+    switch (instructionSet)
+    {
+#ifdef PROJECTM_AUDIO_SSE2
+        case InstructionSet::SSE2:
+            m_convertFloat = ConvertFloatSSE2;
+            m_convertInt16 = ConvertInt16SSE2;
+            m_convertUInt8 = ConvertUInt8SSE2;
+            m_downmixFloat = DownmixSSE2<float>;
+            m_downmixInt16 = DownmixSSE2<int16_t>;
+            m_downmixUInt8 = DownmixSSE2<uint8_t>;
+            break;
+#endif
+
+#ifdef PROJECTM_AUDIO_AVX2
+        case InstructionSet::AVX2:
+            m_convertFloat = ConvertFloatAVX2;
+            m_convertInt16 = ConvertInt16AVX2;
+            m_convertUInt8 = ConvertUInt8AVX2;
+            m_downmixFloat = DownmixAVX2<float>;
+            m_downmixInt16 = DownmixAVX2<int16_t>;
+            m_downmixUInt8 = DownmixAVX2<uint8_t>;
+            break;
+#endif
+
+#ifdef PROJECTM_AUDIO_NEON
+        case InstructionSet::NEON:
+            m_convertFloat = ConvertFloatNEON;
+            m_convertInt16 = ConvertInt16NEON;
+            m_convertUInt8 = ConvertUInt8NEON;
+            m_downmixFloat = DownmixNEON<float>;
+            m_downmixInt16 = DownmixNEON<int16_t>;
+            m_downmixUInt8 = DownmixNEON<uint8_t>;
+            break;
+#endif
+
+        default:
+            m_convertFloat = ConvertScalar<float>;
+            m_convertInt16 = ConvertScalar<int16_t>;
+            m_convertUInt8 = ConvertScalar<uint8_t>;
+            m_downmixFloat = DownmixScalar<float>;
+            m_downmixInt16 = DownmixScalar<int16_t>;
+            m_downmixUInt8 = DownmixScalar<uint8_t>;
+            break;
+    }
+
+    for (uint32_t channels = 3; channels <= MaxDownmixChannels; channels++)
+    {
+        m_downmixMatrices[channels] = DefaultDownmixMatrix(channels);
+    }
+}
+
+auto SampleConverter::IsSupported(InstructionSet instructionSet) -> bool
+{
+    switch (instructionSet)
+    {
+        case InstructionSet::Scalar:
+            return true;
+
+#ifdef PROJECTM_AUDIO_SSE2
+        case InstructionSet::SSE2:
+            return true;
+#endif
+
+#ifdef PROJECTM_AUDIO_AVX2
+        case InstructionSet::AVX2: {
+            static bool const supported = CpuSupportsAVX2();
+            return supported;
+        }
+#endif
+
+#ifdef PROJECTM_AUDIO_NEON
+        case InstructionSet::NEON:
+            return true;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+auto SampleConverter::DefaultDownmixMatrix(uint32_t channels) -> DownmixMatrix
+{
+    // Weights of the speaker positions in the left and right output (ITU-R BS.775, -3 dB for
+    // center and surround channels). LFE is not part of the downmix.
+    static constexpr float Attenuation = 0.70710678f;
+    static constexpr float FrontLeft[2]{1.0f, 0.0f};
+    static constexpr float FrontRight[2]{0.0f, 1.0f};
+    static constexpr float Center[2]{Attenuation, Attenuation};
+    static constexpr float LowFrequency[2]{0.0f, 0.0f};
+    static constexpr float SurroundLeft[2]{Attenuation, 0.0f};
+    static constexpr float SurroundRight[2]{0.0f, Attenuation};
+    static constexpr float BackCenter[2]{0.5f, 0.5f};
+
+    // Default channel layouts for 3 to 8 channels, in WAVE (WAVEFORMATEXTENSIBLE) order.
+    static const float* const layouts[][MaxDownmixChannels]{
+        {FrontLeft, FrontRight, Center},                                                                    // 3.0: L R C
+        {FrontLeft, FrontRight, SurroundLeft, SurroundRight},                                               // Quad: L R Ls Rs
+        {FrontLeft, FrontRight, Center, SurroundLeft, SurroundRight},                                       // 5.0: L R C Ls Rs
+        {FrontLeft, FrontRight, Center, LowFrequency, SurroundLeft, SurroundRight},                         // 5.1: L R C LFE Ls Rs
+        {FrontLeft, FrontRight, Center, LowFrequency, BackCenter, SurroundLeft, SurroundRight},             // 6.1: L R C LFE Cs Ls Rs
+        {FrontLeft, FrontRight, Center, LowFrequency, SurroundLeft, SurroundRight, SurroundLeft, SurroundRight} // 7.1: L R C LFE Lb Rb Ls Rs
+    };
+
+    DownmixMatrix matrix{};
+    if (channels < 3 || channels > MaxDownmixChannels)
+    {
+        return matrix;
+    }
+
+    for (uint32_t channel = 0; channel < channels; channel++)
+    {
+        matrix[channel * 2] = layouts[channels - 3][channel][0];
+        matrix[channel * 2 + 1] = layouts[channels - 3][channel][1];
+    }
+
+    return matrix;
+}
+
+auto SampleConverter::SetDownmixMatrix(uint32_t channels, const float* coefficients) -> bool
+{
+    if (channels < 3 || channels > MaxDownmixChannels)
+    {
+        return false;
+    }
+
+    if (coefficients == nullptr)
+    {
+        m_downmixMatrices[channels] = DefaultDownmixMatrix(channels);
+        return true;
+    }
+
+    m_downmixMatrices[channels] = {};
+    std::copy(coefficients, coefficients + 2 * channels, m_downmixMatrices[channels].begin());
+    return true;
+}
+
+auto SampleConverter::BestInstructionSet() -> InstructionSet
+{
+    for (auto instructionSet : {InstructionSet::AVX2, InstructionSet::SSE2, InstructionSet::NEON})
+    {
+        if (IsSupported(instructionSet))
+        {
+            return instructionSet;
+        }
+    }
+
+    return InstructionSet::Scalar;
+}
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,180 @@
+/**
+ * @file SampleConverter.hpp
+ * @brief Deinterleaves and converts incoming PCM data into planar float samples.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class SampleConverter
+ * @brief Vectorized deinterleave, scale and convert kernels for incoming PCM data.
+ *
+ * Converts interleaved float, signed 16-bit and unsigned 8-bit samples into two planar float
+ * channels, scaled to the internal sample range of [-128, 128]. Left channel is expected at
+ * offset 0, right channel at offset 1. Mono data is copied into both channels.
+ *
+ * Data with 3 to MaxDownmixChannels channels is folded into left and right in the same pass,
+ * using a downmix matrix per channel count. By default, these are the ITU-R BS.775 coefficients
+ * for the WAVE channel order (e.g. L, R, C, LFE, Ls, Rs for 5.1), with center and surround
+ * channels attenuated by 3 dB and LFE dropped. Any channels beyond MaxDownmixChannels are ignored.
+ *
+ * The best implementation for the current CPU is selected at runtime. All implementations
+ * produce bit-identical results.
+ */
+class SampleConverter
+{
+public:
+    /**
+     * @brief Available kernel implementations.
+     */
+    enum class InstructionSet : int
+    {
+        Scalar, //!< Portable C++ implementation.
+        SSE2,   //!< x86 SSE2 implementation.
+        AVX2,   //!< x86 AVX2 implementation.
+        NEON    //!< ARM NEON implementation.
+    };
+
+    static constexpr uint32_t MaxDownmixChannels = 8; //!< Maximum number of channels that are downmixed, enough for 7.1.
+
+    /**
+     * @brief Downmix coefficients for one channel count.
+     *
+     * For each input channel, holds its weight in the left output followed by its weight in the
+     * right output. Only the first 2 * channels values are used.
+     */
+    using DownmixMatrix = std::array<float, 2 * MaxDownmixChannels>;
+
+    /**
+     * @brief Creates a converter using the fastest instruction set supported by the current CPU.
+     */
+    SampleConverter();
+
+    /**
+     * @brief Creates a converter using the given instruction set.
+     * @param instructionSet The instruction set to use. If not supported by the build or CPU,
+     *                       the scalar implementation is used.
+     */
+    explicit SampleConverter(InstructionSet instructionSet);
+
+    /**
+     * @brief Checks whether the given instruction set can be used on this CPU.
+     * @param instructionSet The instruction set to check.
+     * @return True if the kernels for this instruction set were compiled in and the CPU supports them.
+     */
+    static auto IsSupported(InstructionSet instructionSet) -> bool;
+
+    /**
+     * @brief Returns the fastest instruction set supported by this CPU.
+     * @return The fastest supported instruction set.
+     */
+    static auto BestInstructionSet() -> InstructionSet;
+
+    /**
+     * @brief Returns the instruction set used by this converter.
+     * @return The active instruction set.
+     */
+    auto ActiveInstructionSet() const -> InstructionSet
+    {
+        return m_instructionSet;
+    }
+
+    /**
+     * @brief Returns the ITU-R BS.775 downmix matrix for the given channel count.
+     * @param channels The number of input channels, 3 to MaxDownmixChannels.
+     * @return The default downmix coefficients. All zero for unsupported channel counts.
+     */
+    static auto DefaultDownmixMatrix(uint32_t channels) -> DownmixMatrix;
+
+    /**
+     * @brief Sets the downmix matrix used for input data with the given number of channels.
+     * @param channels The number of input channels, 3 to MaxDownmixChannels.
+     * @param coefficients 2 * channels coefficients: for each input channel, its weight in the left
+     *                     output followed by its weight in the right output. If nullptr, the
+     *                     default matrix is restored.
+     * @return True if the matrix was set, false if the channel count is not supported.
+     */
+    auto SetDownmixMatrix(uint32_t channels, const float* coefficients) -> bool;
+
+    /**
+     * @brief Converts floating-point samples in the range [-1, 1].
+     * @param samples The interleaved input samples.
+     * @param channels The number of channels in the input data.
+     * @param count The number of samples per channel to convert.
+     * @param left Destination for the left channel, at least count elements large.
+     * @param right Destination for the right channel, at least count elements large.
+     */
+    void Convert(const float* samples, uint32_t channels, size_t count, float* left, float* right) const
+    {
+        if (channels > 2 && channels <= MaxDownmixChannels)
+        {
+            m_downmixFloat(samples, channels, count, m_downmixMatrices[channels].data(), left, right);
+            return;
+        }
+        m_convertFloat(samples, channels, count, left, right);
+    }
+
+    /**
+     * @brief Converts signed 16-bit integer samples.
+     * @param samples The interleaved input samples.
+     * @param channels The number of channels in the input data.
+     * @param count The number of samples per channel to convert.
+     * @param left Destination for the left channel, at least count elements large.
+     * @param right Destination for the right channel, at least count elements large.
+     */
+    void Convert(const int16_t* samples, uint32_t channels, size_t count, float* left, float* right) const
+    {
+        if (channels > 2 && channels <= MaxDownmixChannels)
+        {
+            m_downmixInt16(samples, channels, count, m_downmixMatrices[channels].data(), left, right);
+            return;
+        }
+        m_convertInt16(samples, channels, count, left, right);
+    }
+
+    /**
+     * @brief Converts unsigned 8-bit integer samples.
+     * @param samples The interleaved input samples.
+     * @param channels The number of channels in the input data.
+     * @param count The number of samples per channel to convert.
+     * @param left Destination for the left channel, at least count elements large.
+     * @param right Destination for the right channel, at least count elements large.
+     */
+    void Convert(const uint8_t* samples, uint32_t channels, size_t count, float* left, float* right) const
+    {
+        if (channels > 2 && channels <= MaxDownmixChannels)
+        {
+            m_downmixUInt8(samples, channels, count, m_downmixMatrices[channels].data(), left, right);
+            return;
+        }
+        m_convertUInt8(samples, channels, count, left, right);
+    }
+
+private:
+    template<typename SampleType>
+    using Kernel = void (*)(const SampleType*, uint32_t, size_t, float*, float*);
+
+    template<typename SampleType>
+    using DownmixKernel = void (*)(const SampleType*, uint32_t, size_t, const float*, float*, float*);
+
+    InstructionSet m_instructionSet{InstructionSet::Scalar}; //!< The instruction set used by the kernels below.
+
+    Kernel<float> m_convertFloat{};   //!< Float conversion kernel.
+    Kernel<int16_t> m_convertInt16{}; //!< Signed 16-bit conversion kernel.
+    Kernel<uint8_t> m_convertUInt8{}; //!< Unsigned 8-bit conversion kernel.
+
+    DownmixKernel<float> m_downmixFloat{};   //!< Float downmix kernel.
+    DownmixKernel<int16_t> m_downmixInt16{}; //!< Signed 16-bit downmix kernel.
+    DownmixKernel<uint8_t> m_downmixUInt8{}; //!< Unsigned 8-bit downmix kernel.
+
+    std::array<DownmixMatrix, MaxDownmixChannels + 1> m_downmixMatrices{}; //!< Downmix matrices, indexed by channel count.
+};
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,187 @@
+#include "SampleRingBuffer.hpp"
+
+#include <algorithm>
+
+namespace libprojectM {
+namespace Audio {
+
+template<size_t capacity>
+constexpr size_t BasicSampleRingBuffer<capacity>::Capacity;
+
+template<size_t capacity>
+constexpr size_t BasicSampleRingBuffer<capacity>::MaxReadSamples;
+
+template<size_t capacity>
+constexpr size_t BasicSampleRingBuffer<capacity>::MaxWriteSamples;
+
+template<size_t capacity>
+constexpr size_t BasicSampleRingBuffer<capacity>::TimestampCount;
+
+template<size_t capacity>
+auto BasicSampleRingBuffer<capacity>::BeginWrite(size_t count) -> size_t
+{
+    // Only the producer modifies the write sequence, so a relaxed load is sufficient.
+    auto const sequence = m_writeSequence.load(std::memory_order_relaxed);
+
+    // Announce the range about to be overwritten before touching the sample data.
+    m_reserveSequence.store(sequence + count, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    return sequence;
+}
+
+template<size_t capacity>
+void BasicSampleRingBuffer<capacity>::CommitWrite(size_t count)
+{
+    auto const sequence = m_writeSequence.load(std::memory_order_relaxed);
+    m_writeSequence.store(sequence + count, std::memory_order_release);
+}
+
+template<size_t capacity>
+void BasicSampleRingBuffer<capacity>::AddTimestamp(size_t sequence, double seconds)
+{
+    auto const count = m_timestampCount.load(std::memory_order_relaxed);
+    auto& timestamp = m_timestamps[count % TimestampCount];
+
+    // Seqlock-style update, so the consumer never sees a sequence number with the wrong time.
+    auto const version = timestamp.version.load(std::memory_order_relaxed);
+    timestamp.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    timestamp.sequence.store(sequence, std::memory_order_relaxed);
+    timestamp.seconds.store(seconds, std::memory_order_relaxed);
+
+    timestamp.version.store(version + 2, std::memory_order_release);
+    m_timestampCount.store(count + 1, std::memory_order_release);
+}
+
+template<size_t capacity>
+auto BasicSampleRingBuffer<capacity>::LoadTimestamp(size_t index, size_t& sequence, double& seconds) const -> bool
+{
+    auto const& timestamp = m_timestamps[index % TimestampCount];
+
+    auto const version = timestamp.version.load(std::memory_order_acquire);
+    sequence = timestamp.sequence.load(std::memory_order_relaxed);
+    seconds = timestamp.seconds.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return (version & 1) == 0 && timestamp.version.load(std::memory_order_relaxed) == version;
+}
+
+template<size_t capacity>
+auto BasicSampleRingBuffer<capacity>::SequenceAt(double seconds, size_t& sequence) const -> bool
+{
+    auto const count = m_timestampCount.load(std::memory_order_acquire);
+    auto const available = std::min(count, TimestampCount);
+
+    // Walk from the newest to the oldest timestamp until the requested time is passed.
+    bool hasNewer{false};
+    size_t newerSequence{};
+    double newerSeconds{};
+    for (size_t age = 0; age < available; age++)
+    {
+        size_t olderSequence{};
+        double olderSeconds{};
+        if (!LoadTimestamp(count - 1 - age, olderSequence, olderSeconds))
+        {
+            // Overwritten by the producer, so all remaining timestamps are too old anyway.
+            break;
+        }
+
+        if (olderSeconds > seconds)
+        {
+            hasNewer = true;
+            newerSequence = olderSequence;
+            newerSeconds = olderSeconds;
+            continue;
+        }
+
+        if (age == 0)
+        {
+            // Past the newest timestamp, extrapolate using the rate between the two newest ones.
+            size_t previousSequence{};
+            double previousSeconds{};
+            if (available < 2 || !LoadTimestamp(count - 2, previousSequence, previousSeconds) || previousSeconds >= olderSeconds)
+            {
+                return false;
+            }
+
+            // Never extrapolate further than the buffer reaches, e.g. if timestamps are outdated.
+            double const samplesPerSecond = static_cast<double>(olderSequence - previousSequence) / (olderSeconds - previousSeconds);
+            sequence = olderSequence + static_cast<size_t>(std::min((seconds - olderSeconds) * samplesPerSecond, static_cast<double>(Capacity)));
+            return true;
+        }
+
+        if (newerSeconds <= olderSeconds)
+        {
+            // Timestamps are not monotonic, e.g. after the application restarted playback.
+            sequence = olderSequence;
+            return true;
+        }
+
+        double const fraction = (seconds - olderSeconds) / (newerSeconds - olderSeconds);
+        sequence = olderSequence + static_cast<size_t>(fraction * static_cast<double>(newerSequence - olderSequence));
+        return true;
+    }
+
+    if (hasNewer)
+    {
+        // Older than all known timestamps, use the oldest one.
+        sequence = newerSequence;
+        return true;
+    }
+
+    return false;
+}
+
+template<size_t capacity>
+auto BasicSampleRingBuffer<capacity>::ReadLatest(float* left, float* right, size_t count, size_t delay, size_t& newSamples) -> bool
+{
+    // If the producer writes more than the free buffer space while we're copying, retry with
+    // the newer data. Give up after a few attempts to never stall the render thread, keeping
+    // the previous contents of the destination buffers.
+    static constexpr int maxAttempts = 4;
+
+    // Only the samples within MaxReadSamples of the newest one are safe from being overwritten.
+    delay = std::min(delay, MaxReadSamples - count);
+
+    for (int attempt = 0; attempt < maxAttempts; attempt++)
+    {
+        auto const writeSequence = m_writeSequence.load(std::memory_order_acquire);
+        size_t const startSequence = writeSequence - delay - count;
+
+        // Copy in at most two contiguous segments.
+        size_t const startIndex = Index(startSequence);
+        size_t const firstSegment = std::min(count, Capacity - startIndex);
+
+        std::copy_n(m_left.begin() + startIndex, firstSegment, m_readLeft.begin());
+        std::copy_n(m_right.begin() + startIndex, firstSegment, m_readRight.begin());
+        std::copy_n(m_left.begin(), count - firstSegment, m_readLeft.begin() + firstSegment);
+        std::copy_n(m_right.begin(), count - firstSegment, m_readRight.begin() + firstSegment);
+
+        // Check if the producer has reserved any of the samples we've just copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto const reserveSequence = m_reserveSequence.load(std::memory_order_relaxed);
+        if (reserveSequence - startSequence <= Capacity)
+        {
+            std::copy_n(m_readLeft.begin(), count, left);
+            std::copy_n(m_readRight.begin(), count, right);
+
+            auto const previousReadSequence = m_readSequence.load(std::memory_order_relaxed);
+            m_readSequence.store(writeSequence, std::memory_order_release);
+
+            newSamples = std::min(writeSequence - previousReadSequence, Capacity);
+            return true;
+        }
+    }
+
+    newSamples = 0;
+    return false;
+}
+
+template class BasicSampleRingBuffer<DefaultAudioConfig::InputBufferSamples>;
+template class BasicSampleRingBuffer<LowLatencyAudioConfig::InputBufferSamples>;
+template class BasicSampleRingBuffer<HighResolutionAudioConfig::InputBufferSamples>;
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,207 @@
+/**
+ * @file SampleRingBuffer.hpp
+ * @brief Lock-free single-producer/single-consumer ring buffer for stereo PCM data.
+ *
+ * Decouples the application's audio thread, which adds new samples, from the render thread
+ * which reads the latest samples for analysis.
+ */
+#pragma once
+
+#include "AudioConstants.hpp"
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class BasicSampleRingBuffer
+ * @brief Lock-free SPSC ring buffer holding planar left/right channel samples.
+ *
+ * The producer (the thread calling PCM::Add()) reserves space, writes the samples and then
+ * publishes them by advancing the write sequence. The consumer (the render thread) always
+ * copies the newest samples. The producer never waits for the consumer: if the consumer
+ * doesn't keep up, old samples are simply overwritten.
+ *
+ * To detect samples being overwritten while the consumer copies them, the producer announces
+ * each write via a reservation sequence before touching the buffer (seqlock-style). If the
+ * reserved range overlaps the range the consumer has just copied, the copy is repeated with
+ * the newer data.
+ *
+ * Sequence numbers are monotonically increasing sample counters. They are allowed to wrap,
+ * as the capacity is a power of two and only differences between sequences are used.
+ *
+ * Optionally, the producer can record the playback time of individual samples. The consumer
+ * uses these timestamps to look up which sample is audible at a given time, e.g. to read the
+ * samples matching the time a frame will actually be displayed instead of the newest samples.
+ *
+ * @tparam capacity Number of samples stored per channel. Must be a power of two.
+ */
+template<size_t capacity>
+class BasicSampleRingBuffer
+{
+public:
+    static constexpr size_t Capacity = capacity;                //!< Number of samples stored per channel.
+    static constexpr size_t MaxReadSamples = Capacity / 2;      //!< Maximum number of samples the consumer can read at once.
+    static constexpr size_t MaxWriteSamples = Capacity - MaxReadSamples; //!< Maximum number of samples that can be written in a single reservation.
+
+    /**
+     * @brief Reserves space for writing new samples.
+     *
+     * Must only be called from the producer thread. After writing all samples to the buffer
+     * positions returned by Index(), the write must be published by calling CommitWrite().
+     *
+     * @param count The number of samples to write. Must not exceed MaxWriteSamples.
+     * @return The sequence number of the first sample to be written.
+     */
+    auto BeginWrite(size_t count) -> size_t;
+
+    /**
+     * @brief Publishes the samples written after the last call to BeginWrite().
+     * @param count The number of samples written. Must be the same value passed to BeginWrite().
+     */
+    void CommitWrite(size_t count);
+
+    /**
+     * @brief Records the playback time of a sample.
+     *
+     * Must only be called from the producer thread. Only the most recent TimestampCount
+     * timestamps are kept.
+     *
+     * @param sequence The sequence number of the sample.
+     * @param seconds The time the sample is played back, in seconds.
+     */
+    void AddTimestamp(size_t sequence, double seconds);
+
+    /**
+     * @brief Looks up the sample played back at the given time.
+     *
+     * Interpolates between the recorded timestamps. Times after the newest timestamp are
+     * extrapolated using the sample rate between the two newest timestamps, times before the
+     * oldest timestamp return the oldest timestamp's sample. The result may lie outside of the
+     * samples currently stored in the buffer.
+     *
+     * Must only be called from the consumer thread.
+     *
+     * @param seconds The playback time to look up, in seconds.
+     * @param[out] sequence Receives the sequence number of the sample played at the given time.
+     * @return True if a sequence number was found, false if there are not enough timestamps.
+     */
+    auto SequenceAt(double seconds, size_t& sequence) const -> bool;
+
+    /**
+     * @brief Copies the newest samples of both channels into the given buffers.
+     *
+     * Must only be called from the consumer thread. Never blocks the producer. The samples are
+     * first copied into a consumer-owned scratch buffer and only passed on if the producer didn't
+     * overwrite them while copying. If the producer keeps overwriting them, the destination
+     * buffers are left unchanged, so they always hold the last consistent snapshot.
+     *
+     * @param left Destination for the left channel samples. Must hold at least count elements.
+     * @param right Destination for the right channel samples. Must hold at least count elements.
+     * @param count The number of samples to copy. Must not exceed MaxReadSamples.
+     * @param delay The number of newest samples to skip. Limited to the history kept in the
+     *              buffer, which is MaxReadSamples - count samples.
+     * @param[out] newSamples Receives the number of samples published since the previous
+     *                        successful read, capped at Capacity.
+     * @return True if the buffers were updated, false if they still contain the previous snapshot.
+     */
+    auto ReadLatest(float* left, float* right, size_t count, size_t delay, size_t& newSamples) -> bool;
+
+    /**
+     * @brief Returns the sequence number of the most recently published sample plus one.
+     * @return The current write sequence.
+     */
+    auto WriteSequence() const -> size_t
+    {
+        return m_writeSequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the write sequence the consumer has seen on its last read.
+     * @return The current read sequence.
+     */
+    auto ReadSequence() const -> size_t
+    {
+        return m_readSequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Maps a sample sequence number to the buffer index.
+     * @param sequence The sample sequence number.
+     * @return The index into the left/right channel buffers.
+     */
+    static auto Index(size_t sequence) -> size_t
+    {
+        return sequence & (Capacity - 1);
+    }
+
+    /**
+     * @brief Returns the left channel buffer for the producer to write into.
+     * @return A pointer to the left channel buffer, Capacity samples large.
+     */
+    auto Left() -> float*
+    {
+        return m_left.data();
+    }
+
+    /**
+     * @brief Returns the right channel buffer for the producer to write into.
+     * @return A pointer to the right channel buffer, Capacity samples large.
+     */
+    auto Right() -> float*
+    {
+        return m_right.data();
+    }
+
+    static constexpr size_t TimestampCount = 64; //!< Number of sample timestamps kept.
+
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "SampleRingBuffer capacity must be a power of two.");
+
+    static constexpr size_t CacheLineSize = 64; //!< Conservative cache line size used to separate producer and consumer data.
+
+    /**
+     * @brief A sample timestamp, protected by its own sequence lock.
+     */
+    struct Timestamp
+    {
+        std::atomic<uint32_t> version{0}; //!< Odd while the producer updates the timestamp.
+        std::atomic<size_t> sequence{0};  //!< The sample sequence number.
+        std::atomic<double> seconds{0.0}; //!< The playback time of the sample.
+    };
+
+    /**
+     * @brief Reads a consistent copy of a timestamp.
+     * @param index The number of the timestamp, counted since the first one was added.
+     * @param[out] sequence Receives the sample sequence number.
+     * @param[out] seconds Receives the playback time.
+     * @return True if the timestamp was read, false if it was overwritten while reading.
+     */
+    auto LoadTimestamp(size_t index, size_t& sequence, double& seconds) const -> bool;
+
+    // Producer-owned indices.
+    std::atomic<size_t> m_writeSequence{0};   //!< Sequence past the last published sample.
+    std::atomic<size_t> m_reserveSequence{0}; //!< Sequence past the last sample reserved for writing.
+    char m_producerPadding[CacheLineSize]{};  //!< Keeps the consumer index out of the producer's cache line.
+
+    // Consumer-owned data.
+    std::atomic<size_t> m_readSequence{0};           //!< Write sequence observed by the consumer on its last successful read.
+    std::array<float, MaxReadSamples> m_readLeft{};  //!< Scratch copy of the left channel samples being read.
+    std::array<float, MaxReadSamples> m_readRight{}; //!< Scratch copy of the right channel samples being read.
+    char m_consumerPadding[CacheLineSize]{};         //!< Keeps the sample data out of the consumer's cache line.
+
+    std::array<float, Capacity> m_left{};  //!< Left channel samples.
+    std::array<float, Capacity> m_right{}; //!< Right channel samples.
+
+    std::array<Timestamp, TimestampCount> m_timestamps; //!< The most recent sample timestamps.
+    std::atomic<size_t> m_timestampCount{0};            //!< Number of timestamps added so far.
+};
+
+using SampleRingBuffer = BasicSampleRingBuffer<DefaultAudioConfig::InputBufferSamples>; //!< Ring buffer used by the default audio configuration.
+
+} // namespace Audio
+} // namespace libprojectM
@@ -0,0 +1,100 @@
+/**
+ * @file TripleBuffer.hpp
+ * @brief Lock-free triple buffer to pass data from one thread to another.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class TripleBuffer
+ * @brief Lock-free single-producer, single-consumer triple buffer.
+ *
+ * The producer fills the write buffer and publishes it, the consumer picks up the most recently
+ * published buffer. Neither side ever waits for the other: the producer always has a buffer to
+ * write to, and the consumer keeps the previous data until a new buffer was published. Buffers
+ * published in between two updates on the consumer side are dropped.
+ *
+ * @tparam T The buffer data type. Must be default-constructible.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+    /**
+     * @brief Returns the buffer the producer is allowed to write to.
+     * Must only be called from the producer thread.
+     * @return A reference to the current write buffer.
+     */
+    auto WriteBuffer() -> T&
+    {
+        return m_buffers[m_writeIndex];
+    }
+
+    /**
+     * @brief Publishes the write buffer to the consumer and switches to a new write buffer.
+     * Must only be called from the producer thread.
+     */
+    void Publish()
+    {
+        auto const previous = m_middle.exchange(static_cast<uint8_t>(m_writeIndex | FreshBit), std::memory_order_acq_rel);
+        m_writeIndex = static_cast<uint8_t>(previous & IndexMask);
+    }
+
+    /**
+     * @brief Switches the read buffer to the most recently published buffer, if there is one.
+     * Must only be called from the consumer thread.
+     * @return True if new data was published since the last update, false if not.
+     */
+    auto Update() -> bool
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FreshBit) == 0)
+        {
+            return false;
+        }
+
+        auto const previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = static_cast<uint8_t>(previous & IndexMask);
+
+        return true;
+    }
+
+    /**
+     * @brief Returns the buffer the consumer is allowed to read from.
+     * Must only be called from the consumer thread.
+     * @return A reference to the current read buffer.
+     */
+    auto ReadBuffer() const -> const T&
+    {
+        return m_buffers[m_readIndex];
+    }
+
+    /**
+     * @brief Sets all three buffers to the given value.
+     * Must not be called while the producer or consumer threads are using the buffer.
+     * @param value The value to copy into all buffers.
+     */
+    void Reset(const T& value)
+    {
+        m_buffers.fill(value);
+        m_middle.store(m_middle.load(std::memory_order_relaxed) & IndexMask, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint8_t IndexMask{0x03}; //!< Bits containing the buffer index.
+    static constexpr uint8_t FreshBit{0x04};  //!< Set if the middle buffer was published, but not yet picked up.
+
+    std::array<T, 3> m_buffers{}; //!< The three buffers.
+
+    uint8_t m_writeIndex{0};          //!< Index of the buffer owned by the producer.
+    std::atomic<uint8_t> m_middle{1}; //!< Index of the buffer being exchanged, plus the fresh flag.
+    uint8_t m_readIndex{2};           //!< Index of the buffer owned by the consumer.
+};
+
+} // namespace Audio
+} // namespace libprojectM
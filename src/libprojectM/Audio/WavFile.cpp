@@ -0,0 +1,190 @@
+#include "WavFile.hpp"
+
+#include "AudioFileException.hpp"
+#include "LittleEndian.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace libprojectM {
+namespace Audio {
+
+namespace {
+
+constexpr uint16_t FormatPcm{0x0001};        //!< WAVE_FORMAT_PCM
+constexpr uint16_t FormatFloat{0x0003};      //!< WAVE_FORMAT_IEEE_FLOAT
+constexpr uint16_t FormatExtensible{0xFFFE}; //!< WAVE_FORMAT_EXTENSIBLE
+
+constexpr uint32_t MaxFormatChunkSize{1024}; //!< Largest accepted format chunk. WAVE_FORMAT_EXTENSIBLE needs 40 bytes.
+constexpr size_t DataReadSize{65536};        //!< Number of bytes read from the data chunk at once.
+
+auto ReadBytes(std::istream& stream, uint8_t* bytes, size_t count) -> bool
+{
+    stream.read(reinterpret_cast<char*>(bytes), static_cast<std::streamsize>(count));
+    return static_cast<size_t>(stream.gcount()) == count;
+}
+
+auto ConvertSample(const uint8_t* bytes, uint16_t format, uint16_t bitsPerSample) -> float
+{
+    if (format == FormatFloat)
+    {
+        return bitsPerSample == 32 ? LittleEndian::LoadFloat(bytes) : static_cast<float>(LittleEndian::LoadDouble(bytes));
+    }
+
+    switch (bitsPerSample)
+    {
+        case 8:
+            // 8 bit data is unsigned, all others are signed.
+            return static_cast<float>(static_cast<int>(bytes[0]) - 128) / 128.0f;
+
+        case 16:
+            return static_cast<float>(static_cast<int16_t>(LittleEndian::LoadUInt16(bytes))) / 32768.0f;
+
+        case 24: {
+            // Shift into the upper bytes to get the sign right.
+            auto const value = static_cast<int32_t>((static_cast<uint32_t>(bytes[0]) << 8) |
+                                                    (static_cast<uint32_t>(bytes[1]) << 16) |
+                                                    (static_cast<uint32_t>(bytes[2]) << 24));
+            return static_cast<float>(value / 256) / 8388608.0f;
+        }
+
+        default:
+            return static_cast<float>(static_cast<double>(static_cast<int32_t>(LittleEndian::LoadUInt32(bytes))) / 2147483648.0);
+    }
+}
+
+} // namespace
+
+auto WavFile::Load(const std::string& filename) -> WavFile
+{
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream.is_open())
+    {
+        throw AudioFileException("Could not open WAVE file \"" + filename + "\"");
+    }
+
+    return Load(stream);
+}
+
+auto WavFile::Load(std::istream& stream) -> WavFile
+{
+    uint8_t riffHeader[12];
+    if (!ReadBytes(stream, riffHeader, sizeof(riffHeader)) ||
+        std::memcmp(riffHeader, "RIFF", 4) != 0 ||
+        std::memcmp(riffHeader + 8, "WAVE", 4) != 0)
+    {
+        throw AudioFileException("Not a RIFF WAVE file");
+    }
+
+    WavFile wavFile;
+    uint16_t format{};
+    uint16_t bitsPerSample{};
+    uint16_t blockAlign{};
+    bool hasFormat{false};
+
+    // Walk the chunk list until the data chunk is found. Unknown chunks are skipped.
+    uint8_t chunkHeader[8];
+    while (ReadBytes(stream, chunkHeader, sizeof(chunkHeader)))
+    {
+        uint32_t const chunkSize = LittleEndian::LoadUInt32(chunkHeader + 4);
+
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0)
+        {
+            if (chunkSize < 16)
+            {
+                throw AudioFileException("WAVE format chunk is too small");
+            }
+
+            if (chunkSize > MaxFormatChunkSize)
+            {
+                throw AudioFileException("WAVE format chunk is too large");
+            }
+
+            std::vector<uint8_t> formatChunk(chunkSize);
+            if (!ReadBytes(stream, formatChunk.data(), chunkSize))
+            {
+                throw AudioFileException("WAVE format chunk is truncated");
+            }
+
+            // Chunks are padded to an even size.
+            stream.ignore(chunkSize & 1);
+
+            format = LittleEndian::LoadUInt16(formatChunk.data());
+            wavFile.m_channels = LittleEndian::LoadUInt16(formatChunk.data() + 2);
+            wavFile.m_sampleRate = LittleEndian::LoadUInt32(formatChunk.data() + 4);
+            blockAlign = LittleEndian::LoadUInt16(formatChunk.data() + 12);
+            bitsPerSample = LittleEndian::LoadUInt16(formatChunk.data() + 14);
+
+            // The extensible format stores the actual format tag in the first bytes of the sub-format GUID.
+            if (format == FormatExtensible && chunkSize >= 26)
+            {
+                format = LittleEndian::LoadUInt16(formatChunk.data() + 24);
+            }
+
+            bool const supportedPcm = format == FormatPcm && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+            bool const supportedFloat = format == FormatFloat && (bitsPerSample == 32 || bitsPerSample == 64);
+            if (!supportedPcm && !supportedFloat)
+            {
+                throw AudioFileException("Unsupported WAVE sample format " + std::to_string(format) + " with " + std::to_string(bitsPerSample) + " bits per sample");
+            }
+
+            if (wavFile.m_channels == 0 || wavFile.m_sampleRate == 0 || blockAlign < wavFile.m_channels * (bitsPerSample / 8))
+            {
+                throw AudioFileException("Invalid WAVE format chunk");
+            }
+
+            hasFormat = true;
+        }
+        else if (std::memcmp(chunkHeader, "data", 4) == 0)
+        {
+            if (!hasFormat)
+            {
+                throw AudioFileException("WAVE data chunk before format chunk");
+            }
+
+            // Tolerate files with a wrong data chunk size, as written by some streaming encoders, by reading
+            // whole sample blocks in bounded pieces until either the chunk size or the end of the stream is reached.
+            // The claimed size is never allocated up front, as it can be up to 4 GiB.
+            size_t const bytesPerSample = bitsPerSample / 8;
+            std::vector<uint8_t> data(std::max<size_t>(DataReadSize / blockAlign, 1) * blockAlign);
+            size_t remaining = chunkSize;
+            while (remaining >= blockAlign)
+            {
+                size_t const requested = std::min(data.size(), remaining - remaining % blockAlign);
+                stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(requested));
+                auto const bytesRead = static_cast<size_t>(stream.gcount());
+
+                size_t const sampleCount = bytesRead / blockAlign;
+                size_t const firstValue = wavFile.m_samples.size();
+                wavFile.m_samples.resize(firstValue + sampleCount * wavFile.m_channels);
+                for (size_t sample = 0; sample < sampleCount; sample++)
+                {
+                    const uint8_t* const block = data.data() + sample * blockAlign;
+                    for (uint32_t channel = 0; channel < wavFile.m_channels; channel++)
+                    {
+                        wavFile.m_samples[firstValue + sample * wavFile.m_channels + channel] = ConvertSample(block + channel * bytesPerSample, format, bitsPerSample);
+                    }
+                }
+
+                if (bytesRead < requested)
+                {
+                    break;
+                }
+                remaining -= requested;
+            }
+
+            return wavFile;
+        }
+        else
+        {
+            // Chunks are padded to an even size.
+            stream.ignore(static_cast<std::streamsize>(chunkSize) + (chunkSize & 1));
+        }
+    }
+
+    throw AudioFileException("WAVE file has no data chunk");
+}
+
+} // namespace Audio
+} // namespace libprojectM
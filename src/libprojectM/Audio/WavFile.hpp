@@ -0,0 +1,87 @@
+/**
+ * @file WavFile.hpp
+ * @brief Minimal reader for RIFF WAVE audio files.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace libprojectM {
+namespace Audio {
+
+/**
+ * @class WavFile
+ * @brief Reads uncompressed RIFF WAVE files into interleaved floating-point samples.
+ *
+ * Supports 8, 16, 24 and 32 bit integer PCM as well as 32 and 64 bit floating-point data,
+ * both in the plain and the extensible format variant. All samples are converted to floats
+ * in the range [-1, 1]. Compressed formats are not supported.
+ */
+class WavFile
+{
+public:
+    /**
+     * @brief Loads a WAVE file from disk.
+     * @throws AudioFileException if the file can't be read or is not a supported WAVE file.
+     * @param filename The file to load.
+     * @return The decoded file contents.
+     */
+    static auto Load(const std::string& filename) -> WavFile;
+
+    /**
+     * @brief Loads WAVE data from a stream.
+     * @throws AudioFileException if the stream data is not a supported WAVE file.
+     * @param stream The stream to read from.
+     * @return The decoded file contents.
+     */
+    static auto Load(std::istream& stream) -> WavFile;
+
+    /**
+     * @brief Returns the sample rate of the audio data.
+     * @return The sample rate in Hz.
+     */
+    auto SampleRate() const -> uint32_t
+    {
+        return m_sampleRate;
+    }
+
+    /**
+     * @brief Returns the number of interleaved channels.
+     * @return The number of channels.
+     */
+    auto Channels() const -> uint32_t
+    {
+        return m_channels;
+    }
+
+    /**
+     * @brief Returns the number of samples per channel.
+     * @return The number of samples per channel.
+     */
+    auto SampleCount() const -> size_t
+    {
+        return m_channels > 0 ? m_samples.size() / m_channels : 0;
+    }
+
+    /**
+     * @brief Returns the interleaved sample data.
+     * @return The samples of all channels, in the range [-1, 1].
+     */
+    auto Samples() const -> const std::vector<float>&
+    {
+        return m_samples;
+    }
+
+private:
+    uint32_t m_sampleRate{}; //!< Sample rate in Hz.
+    uint32_t m_channels{};   //!< Number of interleaved channels.
+
+    std::vector<float> m_samples; //!< Interleaved samples, converted to float.
+};
+
+} // namespace Audio
+} // namespace libprojectM
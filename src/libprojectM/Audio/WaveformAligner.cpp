@@ -4,41 +4,47 @@
 #include <cmath>
 #include <iterator>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROJECTM_ALIGN_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PROJECTM_ALIGN_NEON 1
+#include <arm_neon.h>
+#endif
+
 namespace libprojectM {
 namespace Audio {
 
-WaveformAligner::WaveformAligner()
-{
-    static const uint32_t maxOctaves{10};
-    // For AudioBufferSamples = 576 and WaveformSamples = 480:
-    // floor(log2(96)) = 6
-    static const uint32_t numOctaves{static_cast<uint32_t>(std::floor(std::log(AudioBufferSamples - WaveformSamples) / std::log(2.0f)))};
-    m_octaves = numOctaves > maxOctaves ? maxOctaves : numOctaves;
-
-    m_aligmentWeights.resize(m_octaves);
-    m_firstNonzeroWeights.resize(m_octaves);
-    m_lastNonzeroWeights.resize(m_octaves);
-    m_octaveSamples.resize(m_octaves);
-    m_octaveSampleSpacing.resize(m_octaves);
-    m_oldWaveformMips.resize(m_octaves);
+template<size_t audioBufferSamples, size_t waveformSamples>
+constexpr size_t BasicWaveformAligner<audioBufferSamples, waveformSamples>::AudioBufferSamples;
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+constexpr size_t BasicWaveformAligner<audioBufferSamples, waveformSamples>::WaveformSamples;
 
+template<size_t audioBufferSamples, size_t waveformSamples>
+constexpr uint32_t BasicWaveformAligner<audioBufferSamples, waveformSamples>::Octaves;
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+BasicWaveformAligner<audioBufferSamples, waveformSamples>::BasicWaveformAligner()
+{
     m_octaveSamples[0] = AudioBufferSamples;
     m_octaveSampleSpacing[0] = AudioBufferSamples - WaveformSamples;
-    for (uint32_t octave = 1; octave < m_octaves; octave++)
+    for (uint32_t octave = 1; octave < Octaves; octave++)
     {
         m_octaveSamples[octave] = m_octaveSamples[octave - 1] / 2;
         m_octaveSampleSpacing[octave] = m_octaveSampleSpacing[octave - 1] / 2;
     }
 }
 
-void WaveformAligner::ResampleOctaves(std::vector<WaveformBuffer>& dstWaveformMips, WaveformBuffer& newWaveform)
+template<size_t audioBufferSamples, size_t waveformSamples>
+void BasicWaveformAligner<audioBufferSamples, waveformSamples>::ResampleOctaves(WaveformMips& dstWaveformMips, WaveformBuffer& newWaveform)
 {
     // Octave 0 is a direct copy of the new waveform
     std::copy(newWaveform.begin(), newWaveform.end(), dstWaveformMips[0].begin());
 
     // Calculate mip levels
     // This downsamples the previous octave's waveform by a factor of 2
-    for (uint32_t octave = 1; octave < m_octaves; octave++)
+    for (uint32_t octave = 1; octave < Octaves; octave++)
     {
         for (uint32_t sample = 0; sample < m_octaveSamples[octave]; sample++)
         {
@@ -47,10 +53,11 @@ void WaveformAligner::ResampleOctaves(std::vector<WaveformBuffer>& dstWaveformMi
     }
 }
 
-void WaveformAligner::GenerateWeights()
+template<size_t audioBufferSamples, size_t waveformSamples>
+void BasicWaveformAligner<audioBufferSamples, waveformSamples>::GenerateWeights()
 {
     // The below is performed only on the first fill.
-    for (uint32_t octave = 0; octave < m_octaves; octave++)
+    for (uint32_t octave = 0; octave < Octaves; octave++)
     {
         // For example:
         //  m_octaveSampleSpacing[octave] == 4
@@ -119,7 +126,36 @@ void WaveformAligner::GenerateWeights()
     }
 }
 
-int WaveformAligner::CalculateOffset(std::vector<WaveformBuffer>& newWaveformMips)
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::CalculateOffset(WaveformMips& newWaveformMips)
+{
+    return CalculateOffsetVectorized(newWaveformMips);
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::CalculateOffsetScalar(WaveformMips& newWaveformMips)
+{
+    return SearchOffsets(newWaveformMips, &BasicWaveformAligner::LowestErrorOffsetScalar);
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::CalculateOffsetVectorized(WaveformMips& newWaveformMips)
+{
+    return SearchOffsets(newWaveformMips, &BasicWaveformAligner::LowestErrorOffsetVectorized);
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+auto BasicWaveformAligner<audioBufferSamples, waveformSamples>::HasVectorizedOffsetSearch() -> bool
+{
+#if defined(PROJECTM_ALIGN_SSE2) || defined(PROJECTM_ALIGN_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::SearchOffsets(WaveformMips& newWaveformMips, LowestErrorFunction findLowestErrorOffset)
 {
     /*
      * Note that we use signed variables here because we need to check for negatives even
@@ -127,33 +163,14 @@ int WaveformAligner::CalculateOffset(std::vector<WaveformBuffer>& newWaveformMip
      */
     int alignOffset{};
     int offsetStart{};
-    int offsetEnd{static_cast<int>(m_octaveSampleSpacing[m_octaves - 1])};
+    int offsetEnd{static_cast<int>(m_octaveSampleSpacing[Octaves - 1])};
 
     // Find best match for alignment
     // Note that we need a signed iterator here because the termination condition is octave < 0
-    for (int octave = static_cast<int>(m_octaves) - 1; octave >= 0; octave--)
+    for (int octave = static_cast<int>(Octaves) - 1; octave >= 0; octave--)
     {
-        int lowestErrorOffset{-1};
-        float lowestErrorAmount{};
-
         // For each octave, find the offset that maximizes the correlation between waveforms.
-        for (int sample = offsetStart; sample < offsetEnd; sample++)
-        {
-            float errorSum{};
-
-            // Perform the cross-correlation. Note that we shift the new waveform but not the old
-            // one because we're looking for the offset between them that produces the lowest error.
-            for (uint32_t i = m_firstNonzeroWeights[octave]; i <= m_lastNonzeroWeights[octave]; i++)
-            {
-                errorSum += std::abs((newWaveformMips[octave][i + sample] - m_oldWaveformMips[octave][i]) * m_aligmentWeights[octave][i]);
-            }
-
-            if (lowestErrorOffset == -1 || errorSum < lowestErrorAmount)
-            {
-                lowestErrorOffset = static_cast<int>(sample);
-                lowestErrorAmount = errorSum;
-            }
-        }
+        int const lowestErrorOffset = (this->*findLowestErrorOffset)(newWaveformMips[octave], static_cast<uint32_t>(octave), offsetStart, offsetEnd);
 
         // Now use 'lowestErrorOffset' to guide bounds of search in next octave:
         //  m_octaveSampleSpacing[octave] == 8
@@ -190,18 +207,121 @@ int WaveformAligner::CalculateOffset(std::vector<WaveformBuffer>& newWaveformMip
     return alignOffset;
 }
 
-void WaveformAligner::Align(WaveformBuffer& newWaveform)
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::LowestErrorOffsetScalar(const WaveformBuffer& newWaveformMip, uint32_t octave, int offsetStart, int offsetEnd) const
 {
-    if (m_octaves < 4)
+    int lowestErrorOffset{-1};
+    float lowestErrorAmount{};
+
+    for (int sample = offsetStart; sample < offsetEnd; sample++)
+    {
+        float errorSum{};
+
+        // Perform the cross-correlation. Note that we shift the new waveform but not the old
+        // one because we're looking for the offset between them that produces the lowest error.
+        for (uint32_t i = m_firstNonzeroWeights[octave]; i <= m_lastNonzeroWeights[octave]; i++)
+        {
+            errorSum += std::abs((newWaveformMip[i + sample] - m_oldWaveformMips[octave][i]) * m_aligmentWeights[octave][i]);
+        }
+
+        if (lowestErrorOffset == -1 || errorSum < lowestErrorAmount)
+        {
+            lowestErrorOffset = static_cast<int>(sample);
+            lowestErrorAmount = errorSum;
+        }
+    }
+
+    return lowestErrorOffset;
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+int BasicWaveformAligner<audioBufferSamples, waveformSamples>::LowestErrorOffsetVectorized(const WaveformBuffer& newWaveformMip, uint32_t octave, int offsetStart, int offsetEnd) const
+{
+#if defined(PROJECTM_ALIGN_SSE2) || defined(PROJECTM_ALIGN_NEON)
+    static constexpr int lanes{4};
+
+    uint32_t const firstSample = m_firstNonzeroWeights[octave];
+    uint32_t const lastSample = m_lastNonzeroWeights[octave];
+    const float* const oldWaveform = m_oldWaveformMips[octave].data();
+    const float* const weights = m_aligmentWeights[octave].data();
+
+    int lowestErrorOffset{-1};
+    float lowestErrorAmount{};
+
+    int sample = offsetStart;
+    // Each pass calculates the error for four consecutive offsets at once, one per lane. The
+    // window of new samples slides along with i, while the old sample and weight are broadcast.
+    // Every lane sums up its terms in the same order as the scalar code, so the results are
+    // bit-identical. Lanes past offsetEnd are calculated, but ignored. As this reads up to
+    // three samples past the last candidate offset, the loads must stay inside the buffer.
+    for (; sample < offsetEnd && lastSample + static_cast<uint32_t>(sample + lanes) <= newWaveformMip.size(); sample += lanes)
+    {
+        const float* const newWaveform = newWaveformMip.data() + sample;
+        alignas(16) float errorSums[lanes];
+
+#ifdef PROJECTM_ALIGN_SSE2
+        __m128 const absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 errorSum = _mm_setzero_ps();
+        for (uint32_t i = firstSample; i <= lastSample; i++)
+        {
+            __m128 const difference = _mm_sub_ps(_mm_loadu_ps(newWaveform + i), _mm_set1_ps(oldWaveform[i]));
+            errorSum = _mm_add_ps(errorSum, _mm_and_ps(_mm_mul_ps(difference, _mm_set1_ps(weights[i])), absMask));
+        }
+        _mm_store_ps(errorSums, errorSum);
+#else
+        float32x4_t errorSum = vdupq_n_f32(0.0f);
+        for (uint32_t i = firstSample; i <= lastSample; i++)
+        {
+            float32x4_t const difference = vsubq_f32(vld1q_f32(newWaveform + i), vdupq_n_f32(oldWaveform[i]));
+            errorSum = vaddq_f32(errorSum, vabsq_f32(vmulq_f32(difference, vdupq_n_f32(weights[i]))));
+        }
+        vst1q_f32(errorSums, errorSum);
+#endif
+
+        int const validLanes = std::min(lanes, offsetEnd - sample);
+        for (int lane = 0; lane < validLanes; lane++)
+        {
+            if (lowestErrorOffset == -1 || errorSums[lane] < lowestErrorAmount)
+            {
+                lowestErrorOffset = sample + lane;
+                lowestErrorAmount = errorSums[lane];
+            }
+        }
+    }
+
+    // Remaining offsets, one at a time.
+    for (; sample < offsetEnd; sample++)
+    {
+        float errorSum{};
+        for (uint32_t i = firstSample; i <= lastSample; i++)
+        {
+            errorSum += std::abs((newWaveformMip[i + sample] - oldWaveform[i]) * weights[i]);
+        }
+
+        if (lowestErrorOffset == -1 || errorSum < lowestErrorAmount)
+        {
+            lowestErrorOffset = sample;
+            lowestErrorAmount = errorSum;
+        }
+    }
+
+    return lowestErrorOffset;
+#else
+    return LowestErrorOffsetScalar(newWaveformMip, octave, offsetStart, offsetEnd);
+#endif
+}
+
+template<size_t audioBufferSamples, size_t waveformSamples>
+void BasicWaveformAligner<audioBufferSamples, waveformSamples>::Align(WaveformBuffer& newWaveform)
+{
+    if (Octaves < 4)
     {
         // The original code does not align if there isn't enough margin for
         // alignment but has no explanation for why the limit is 2**4 samples.
         return;
     }
 
-
-    std::vector<WaveformBuffer> newWaveformMips(m_octaves, WaveformBuffer());
-    ResampleOctaves(newWaveformMips, newWaveform);
+    ResampleOctaves(m_newWaveformMips, newWaveform);
 
     if (!m_alignWaveReady)
     {
@@ -210,7 +330,7 @@ void WaveformAligner::Align(WaveformBuffer& newWaveform)
         m_alignWaveReady = true;
     }
 
-    int alignOffset = CalculateOffset(newWaveformMips);
+    int alignOffset = CalculateOffset(m_newWaveformMips);
 
     // Finally, apply the results by scooting the aligned samples so that they start at index 0.
     // This is the second place where we limit negative offsets.
@@ -227,6 +347,9 @@ void WaveformAligner::Align(WaveformBuffer& newWaveform)
     ResampleOctaves(m_oldWaveformMips, newWaveform);
 }
 
+template class BasicWaveformAligner<DefaultAudioConfig::AudioBufferSamples, DefaultAudioConfig::WaveformSamples>;
+template class BasicWaveformAligner<LowLatencyAudioConfig::AudioBufferSamples, LowLatencyAudioConfig::WaveformSamples>;
+template class BasicWaveformAligner<HighResolutionAudioConfig::AudioBufferSamples, HighResolutionAudioConfig::WaveformSamples>;
 
 } // namespace Audio
 } // namespace libprojectM
@@ -7,26 +7,57 @@
 
 #include "AudioConstants.hpp"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <vector>
 
 namespace libprojectM {
 namespace Audio {
 
 /**
- * @class WaveformAligner
+ * @brief Returns the number of octaves searched for a given alignment margin.
+ * @param margin The number of samples available for shifting the waveform.
+ * @return floor(log2(margin)), limited to 10 octaves.
+ */
+constexpr auto WaveformAlignerOctaves(size_t margin) -> uint32_t
+{
+    uint32_t octaves{};
+    while (margin > 1 && octaves < 10)
+    {
+        margin >>= 1;
+        octaves++;
+    }
+    return octaves;
+}
+
+/**
+ * @class BasicWaveformAligner
  * @brief Mip-based waveform alignment algorithm
  *
  * Calculates the absolute error between the previous and current waveforms over several octaves
  * and sample offsets, then shifts the new waveform forward to best align with the previous frame.
  * This will keep similar features in-place instead of randomly jumping around on each frame and creates
  * for a smoother-looking waveform visualization.
+ *
+ * @tparam audioBufferSamples Number of samples in the waveform buffer.
+ * @tparam waveformSamples Number of samples kept after alignment.
  */
-class WaveformAligner
+template<size_t audioBufferSamples, size_t waveformSamples>
+class BasicWaveformAligner
 {
 public:
-    WaveformAligner();
+    static constexpr size_t AudioBufferSamples = audioBufferSamples; //!< Number of samples in the waveform buffer.
+    static constexpr size_t WaveformSamples = waveformSamples;       //!< Number of samples kept after alignment.
+
+    /**
+     * Number of mip-levels/octaves. For 576 buffer and 480 waveform samples, this is floor(log2(96)) = 6.
+     */
+    static constexpr uint32_t Octaves = WaveformAlignerOctaves(audioBufferSamples - waveformSamples);
+
+    using WaveformBuffer = std::array<float, audioBufferSamples>; //!< Buffer with waveform data.
+    using WaveformMips = std::array<WaveformBuffer, Octaves>;     //!< One waveform buffer per octave.
+
+    BasicWaveformAligner();
 
     /**
      * @brief Aligns waveforms to a best-fit match to the previous frame.
@@ -36,21 +67,64 @@ public:
 
 protected:
     void GenerateWeights();
-    int CalculateOffset(std::vector<WaveformBuffer>& newWaveformMips);
-    void ResampleOctaves(std::vector<WaveformBuffer>& dstWaveformMips, WaveformBuffer& newWaveform);
+
+    /**
+     * @brief Finds the best offset using the fastest implementation available in this build.
+     * @param newWaveformMips Mip levels of the new waveform.
+     * @return The offset of the new waveform with the lowest error.
+     */
+    int CalculateOffset(WaveformMips& newWaveformMips);
+
+    /**
+     * @brief Finds the best offset, calculating the error for each candidate offset separately.
+     * @param newWaveformMips Mip levels of the new waveform.
+     * @return The offset of the new waveform with the lowest error.
+     */
+    int CalculateOffsetScalar(WaveformMips& newWaveformMips);
+
+    /**
+     * @brief Finds the best offset, calculating the error for four candidate offsets per pass.
+     *
+     * Returns exactly the same offset as CalculateOffsetScalar(). If no SIMD instruction set is
+     * available in this build, the scalar implementation is used.
+     *
+     * @param newWaveformMips Mip levels of the new waveform.
+     * @return The offset of the new waveform with the lowest error.
+     */
+    int CalculateOffsetVectorized(WaveformMips& newWaveformMips);
+
+    /**
+     * @brief Returns whether CalculateOffsetVectorized() uses SIMD instructions in this build.
+     * @return True if a vectorized implementation is available, false if it falls back to scalar code.
+     */
+    static auto HasVectorizedOffsetSearch() -> bool;
+
+    void ResampleOctaves(WaveformMips& dstWaveformMips, WaveformBuffer& newWaveform);
+
+    /**
+     * Calculates the error for the candidate offsets [offsetStart, offsetEnd) in the given octave
+     * and returns the offset with the lowest error. The first offset wins if errors are equal.
+     */
+    using LowestErrorFunction = int (BasicWaveformAligner::*)(const WaveformBuffer& newWaveformMip, uint32_t octave, int offsetStart, int offsetEnd) const;
+
+    int SearchOffsets(WaveformMips& newWaveformMips, LowestErrorFunction lowestErrorOffset);
+    int LowestErrorOffsetScalar(const WaveformBuffer& newWaveformMip, uint32_t octave, int offsetStart, int offsetEnd) const;
+    int LowestErrorOffsetVectorized(const WaveformBuffer& newWaveformMip, uint32_t octave, int offsetStart, int offsetEnd) const;
 
     bool m_alignWaveReady{false}; //!< Alignment needs special treatment for the first buffer fill.
 
-    std::vector<std::array<float, AudioBufferSamples>> m_aligmentWeights; //!< Sample weights per octave.
+    WaveformMips m_aligmentWeights{}; //!< Sample weights per octave.
 
-    uint32_t m_octaves{};                        //!< Number of mip-levels/octaves.
-    std::vector<uint32_t> m_octaveSamples;       //!< Samples per octave.
-    std::vector<uint32_t> m_octaveSampleSpacing; //!< Space between samples per octave.
+    std::array<uint32_t, Octaves> m_octaveSamples{};       //!< Samples per octave.
+    std::array<uint32_t, Octaves> m_octaveSampleSpacing{}; //!< Space between samples per octave.
 
-    std::vector<WaveformBuffer> m_oldWaveformMips; //!< Mip levels of the previous frame's waveform.
-    std::vector<uint32_t> m_firstNonzeroWeights;   //!< First non-zero weight sample index for each octave.
-    std::vector<uint32_t> m_lastNonzeroWeights;    //!< Last non-zero weight sample index for each octave.
+    WaveformMips m_newWaveformMips{};                      //!< Mip levels of the current frame's waveform.
+    WaveformMips m_oldWaveformMips{};                      //!< Mip levels of the previous frame's waveform.
+    std::array<uint32_t, Octaves> m_firstNonzeroWeights{}; //!< First non-zero weight sample index for each octave.
+    std::array<uint32_t, Octaves> m_lastNonzeroWeights{};  //!< Last non-zero weight sample index for each octave.
 };
 
+using WaveformAligner = BasicWaveformAligner<AudioBufferSamples, WaveformSamples>; //!< Aligner used by the default audio configuration.
+
 } // namespace Audio
 } // namespace libprojectM
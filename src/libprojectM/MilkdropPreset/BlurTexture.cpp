@@ -1,6 +1,7 @@
 #include "BlurTexture.hpp"
 
 #include "PerFrameContext.hpp"
+#include "StageProfiler.hpp"
 
 #include "MilkdropStaticShaders.hpp"
 
@@ -95,6 +96,8 @@ auto BlurTexture::GetDescriptorsForBlurLevel(BlurTexture::BlurLevel blurLevel) c
 
 void BlurTexture::Update(const Renderer::Texture& sourceTexture, const PerFrameContext& perFrameContext)
 {
+    PROJECTM_PROFILE_STAGE(BlurUpdate);
+
     if (m_blurLevel == BlurLevel::None)
     {
         return;
@@ -0,0 +1,265 @@
+#include "CodeAnalysis.hpp"
+
+#include <cctype>
+#include <vector>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+/**
+ * @brief A single lexical token relevant for the analysis.
+ */
+struct Token
+{
+    enum class Type
+    {
+        Variable,      //!< A variable name.
+        Function,      //!< A function name, i.e. an identifier followed by an opening parenthesis.
+        OpenBracket,   //!< ( or [
+        CloseBracket,  //!< ) or ]
+        StatementEnd,  //!< ;
+        Other          //!< Any other operator, number or constant.
+    };
+
+    enum class Assignment
+    {
+        None,    //!< Variable is only read.
+        Plain,   //!< Variable is assigned with "=".
+        Compound //!< Variable is read and assigned, e.g. "+=".
+    };
+
+    Type type{Type::Other};
+    std::string name;                       //!< Lower-case identifier for variables and functions.
+    Assignment assignment{Assignment::None}; //!< Assignment type for variables.
+};
+
+auto IsIdentifierStart(char character) -> bool
+{
+    return std::isalpha(static_cast<unsigned char>(character)) != 0 || character == '_';
+}
+
+auto IsIdentifierChar(char character) -> bool
+{
+    return std::isalnum(static_cast<unsigned char>(character)) != 0 || character == '_' || character == '.';
+}
+
+auto SkipWhitespace(const std::string& code, size_t pos) -> size_t
+{
+    while (pos < code.size() && std::isspace(static_cast<unsigned char>(code[pos])) != 0)
+    {
+        pos++;
+    }
+    return pos;
+}
+
+auto Tokenize(const std::string& code) -> std::vector<Token>
+{
+    std::vector<Token> tokens;
+
+    size_t pos{};
+    while (pos < code.size())
+    {
+        char const character = code[pos];
+
+        if (std::isspace(static_cast<unsigned char>(character)) != 0)
+        {
+            pos++;
+        }
+        else if (code.compare(pos, 2, "//") == 0)
+        {
+            pos = code.find('\n', pos);
+        }
+        else if (code.compare(pos, 2, "/*") == 0)
+        {
+            pos = code.find("*/", pos + 2);
+            if (pos != std::string::npos)
+            {
+                pos += 2;
+            }
+        }
+        else if (character == '$' || std::isdigit(static_cast<unsigned char>(character)) != 0 || (character == '.' && pos + 1 < code.size() && std::isdigit(static_cast<unsigned char>(code[pos + 1])) != 0))
+        {
+            // Numbers and named constants like $pi.
+            pos++;
+            while (pos < code.size() && IsIdentifierChar(code[pos]))
+            {
+                pos++;
+            }
+            tokens.push_back({});
+        }
+        else if (IsIdentifierStart(character))
+        {
+            Token token;
+            while (pos < code.size() && IsIdentifierChar(code[pos]))
+            {
+                token.name.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(code[pos]))));
+                pos++;
+            }
+
+            size_t const next = SkipWhitespace(code, pos);
+            if (next < code.size() && code[next] == '(')
+            {
+                token.type = Token::Type::Function;
+            }
+            else
+            {
+                token.type = Token::Type::Variable;
+                if (next < code.size() && code[next] == '=' && (next + 1 >= code.size() || code[next + 1] != '='))
+                {
+                    token.assignment = Token::Assignment::Plain;
+                }
+                else if (next + 1 < code.size() && code[next + 1] == '=' && std::string("+-*/%|&^").find(code[next]) != std::string::npos)
+                {
+                    token.assignment = Token::Assignment::Compound;
+                }
+                else if (tokens.size() >= 2 && tokens.back().type == Token::Type::OpenBracket &&
+                         tokens[tokens.size() - 2].type == Token::Type::Function && tokens[tokens.size() - 2].name == "assign")
+                {
+                    // assign(var, value) stores the value in the variable.
+                    token.assignment = Token::Assignment::Compound;
+                }
+            }
+            tokens.push_back(std::move(token));
+        }
+        else
+        {
+            Token token;
+            if (character == '(' || character == '[')
+            {
+                token.type = Token::Type::OpenBracket;
+            }
+            else if (character == ')' || character == ']')
+            {
+                token.type = Token::Type::CloseBracket;
+            }
+            else if (character == ';')
+            {
+                token.type = Token::Type::StatementEnd;
+            }
+            tokens.push_back(token);
+            pos++;
+        }
+    }
+
+    return tokens;
+}
+
+/**
+ * @brief Checks whether an identifier refers to memory buffers, global registers or the random generator.
+ */
+auto IsSharedState(const std::string& name) -> bool
+{
+    // Matches megabuf, gmegabuf, gmem, freembuf, memcpy and memset.
+    if (name.find("mem") != std::string::npos || name.find("megabuf") != std::string::npos || name == "rand")
+    {
+        return true;
+    }
+
+    // Global registers reg00 to reg99.
+    return name.size() == 5 && name.compare(0, 3, "reg") == 0 &&
+           std::isdigit(static_cast<unsigned char>(name[3])) != 0 &&
+           std::isdigit(static_cast<unsigned char>(name[4])) != 0;
+}
+
+} // namespace
+
+auto AnalyzeCode(const std::string& code) -> CodeAnalysis
+{
+    CodeAnalysis analysis;
+
+    auto const tokens = Tokenize(code);
+
+    // Variables whose first occurrence was already seen, either as a clean definition or not.
+    std::set<std::string> seen;
+    std::set<std::string> readBeforeDefinition;
+
+    size_t statementStart{};
+    while (statementStart < tokens.size())
+    {
+        // A top-level statement starting with "var = ..." defines var before anything else reads it,
+        // unless the right-hand side reads var itself.
+        std::string definition;
+        auto const& first = tokens[statementStart];
+        if (first.type == Token::Type::Variable && first.assignment == Token::Assignment::Plain &&
+            seen.find(first.name) == seen.end())
+        {
+            definition = first.name;
+        }
+
+        int depth{};
+        size_t pos = statementStart;
+        for (; pos < tokens.size(); pos++)
+        {
+            auto const& token = tokens[pos];
+            if (token.type == Token::Type::StatementEnd && depth == 0)
+            {
+                break;
+            }
+
+            switch (token.type)
+            {
+                case Token::Type::OpenBracket:
+                    depth++;
+                    break;
+
+                case Token::Type::CloseBracket:
+                    depth = depth > 0 ? depth - 1 : 0;
+                    break;
+
+                case Token::Type::Function:
+                    if (IsSharedState(token.name))
+                    {
+                        analysis.usesSharedState = true;
+                    }
+                    break;
+
+                case Token::Type::Variable:
+                    if (IsSharedState(token.name))
+                    {
+                        analysis.usesSharedState = true;
+                    }
+
+                    analysis.variables.insert(token.name);
+                    if (token.assignment != Token::Assignment::None)
+                    {
+                        analysis.assignedVariables.insert(token.name);
+                    }
+
+                    if (pos != statementStart || definition.empty())
+                    {
+                        if (seen.insert(token.name).second || token.name == definition)
+                        {
+                            readBeforeDefinition.insert(token.name);
+                        }
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        if (!definition.empty())
+        {
+            seen.insert(definition);
+        }
+
+        statementStart = pos + 1;
+    }
+
+    // Variables never assigned always keep their value, so only assigned ones can carry state.
+    for (const auto& name : readBeforeDefinition)
+    {
+        if (analysis.assignedVariables.find(name) != analysis.assignedVariables.end())
+        {
+            analysis.carriedVariables.insert(name);
+        }
+    }
+
+    return analysis;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
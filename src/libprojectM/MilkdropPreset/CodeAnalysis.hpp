@@ -0,0 +1,48 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Result of a lexical analysis of Milkdrop expression code.
+ *
+ * The analysis doesn't parse the code, it only looks at identifiers, assignments and statement
+ * boundaries. All results are conservative: if in doubt, a variable is considered carried over
+ * and any unknown memory access is considered shared state.
+ */
+struct CodeAnalysis
+{
+    std::set<std::string> variables;        //!< All variables referenced by the code, in lower case.
+    std::set<std::string> assignedVariables; //!< Variables assigned anywhere in the code.
+
+    /**
+     * Assigned variables which may be read before being assigned in the same code run, e.g.
+     * counters like "n = n + 1". Their values carry over from one execution to the next.
+     */
+    std::set<std::string> carriedVariables;
+
+    bool usesSharedState{}; //!< True if the code uses memory buffers, global registers or rand().
+
+    /**
+     * @brief Checks whether the code references the given variable.
+     * @param name The lower-case variable name.
+     * @return True if the variable is read or written by the code.
+     */
+    auto References(const std::string& name) const -> bool
+    {
+        return variables.find(name) != variables.end();
+    }
+};
+
+/**
+ * @brief Analyzes which variables the given expression code uses and how.
+ * @param code The expression code, as stored in the preset.
+ * @return The analysis result.
+ */
+auto AnalyzeCode(const std::string& code) -> CodeAnalysis;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
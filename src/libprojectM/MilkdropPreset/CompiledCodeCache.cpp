@@ -0,0 +1,119 @@
+#include "CompiledCodeCache.hpp"
+
+#include "ExpressionJit.hpp"
+
+#include <functional>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+constexpr size_t CompiledCodeCache::DefaultCapacity;
+
+auto CompiledCodeCache::Instance() -> CompiledCodeCache&
+{
+    static CompiledCodeCache instance;
+    return instance;
+}
+
+auto CompiledCodeCache::Compile(const std::string& code, JitPrecision precision) -> std::shared_ptr<const JitProgram>
+{
+    auto const hash = std::hash<std::string>{}(code) + static_cast<size_t>(precision);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto const entry = m_entryIndex.find(hash);
+        if (entry != m_entryIndex.end() && entry->second->code == code && entry->second->precision == precision)
+        {
+            m_hits++;
+            m_entries.splice(m_entries.begin(), m_entries, entry->second);
+            return entry->second->program;
+        }
+
+        m_misses++;
+    }
+
+    // Compile without holding the lock, so other threads can still use the cache.
+    auto program = JitProgram::Compile(code, precision);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_capacity == 0)
+    {
+        return program;
+    }
+
+    // Another thread may have added the same code in the meantime, or a colliding one.
+    auto const entry = m_entryIndex.find(hash);
+    if (entry != m_entryIndex.end())
+    {
+        m_entries.erase(entry->second);
+        m_entryIndex.erase(entry);
+    }
+
+    m_entries.push_front({hash, code, precision, program});
+    m_entryIndex[hash] = m_entries.begin();
+    EvictExcessEntries();
+
+    return program;
+}
+
+auto CompiledCodeCache::Find(const std::string& code, JitPrecision precision) -> std::shared_ptr<const JitProgram>
+{
+    auto const hash = std::hash<std::string>{}(code) + static_cast<size_t>(precision);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto const entry = m_entryIndex.find(hash);
+    if (entry == m_entryIndex.end() || entry->second->code != code || entry->second->precision != precision ||
+        !entry->second->program)
+    {
+        return {};
+    }
+
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, entry->second);
+    return entry->second->program;
+}
+
+void CompiledCodeCache::SetCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_capacity = capacity;
+    EvictExcessEntries();
+}
+
+auto CompiledCodeCache::GetStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Statistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.entries = m_entries.size();
+    statistics.capacity = m_capacity;
+    return statistics;
+}
+
+void CompiledCodeCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_entryIndex.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void CompiledCodeCache::EvictExcessEntries()
+{
+    while (m_entries.size() > m_capacity)
+    {
+        m_entryIndex.erase(m_entries.back().hash);
+        m_entries.pop_back();
+    }
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
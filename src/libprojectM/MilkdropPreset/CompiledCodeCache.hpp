@@ -0,0 +1,112 @@
+#pragma once
+
+#include "JitPrecision.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+class JitProgram;
+
+/**
+ * @brief Process-wide LRU cache of compiled expression programs.
+ *
+ * Playlists keep coming back to the same presets, each load compiling the same code again.
+ * Programs are keyed by a hash of the code and shared between all contexts running the same code,
+ * each binding its own variables. Code the JIT can't compile is cached too, so it isn't parsed again.
+ *
+ * Only JIT-compiled programs are cached. projectm-eval code handles are bound to the variables of the
+ * context they were compiled in and can't be shared. Contexts look up their code with Find() first and
+ * skip the projectm-eval compilation if a cached program is found, as all cached code compiled with
+ * projectm-eval before.
+ */
+class CompiledCodeCache
+{
+public:
+    static constexpr size_t DefaultCapacity = 1024; //!< Default maximum number of cached programs.
+
+    /**
+     * @brief Cache usage counters.
+     */
+    struct Statistics
+    {
+        uint64_t hits{};   //!< Number of lookups which returned a cached program.
+        uint64_t misses{}; //!< Number of lookups which compiled the code.
+        size_t entries{};  //!< Number of currently cached programs.
+        size_t capacity{}; //!< Maximum number of cached programs.
+    };
+
+    /**
+     * @brief Returns the process-wide cache.
+     * @return The cache instance.
+     */
+    static auto Instance() -> CompiledCodeCache&;
+
+    /**
+     * @brief Returns the compiled program for the given code, compiling it on a cache miss.
+     * @param code The expression code, as stored in the preset.
+     * @param precision The storage type of the variables. Programs for each precision are cached separately.
+     * @return The compiled program, or nullptr if the code can't be JIT-compiled.
+     */
+    auto Compile(const std::string& code, JitPrecision precision = JitPrecision::Double) -> std::shared_ptr<const JitProgram>;
+
+    /**
+     * @brief Returns the cached program for the given code without compiling it.
+     *
+     * Only a returned program counts as a hit. Lookups which find nothing aren't counted, as the
+     * caller compiles the code with Compile() next.
+     *
+     * @param code The expression code, as stored in the preset.
+     * @param precision The storage type of the variables.
+     * @return The cached program, or nullptr if the code isn't cached or can't be JIT-compiled.
+     */
+    auto Find(const std::string& code, JitPrecision precision = JitPrecision::Double) -> std::shared_ptr<const JitProgram>;
+
+    /**
+     * @brief Sets the maximum number of cached programs, evicting the least recently used ones.
+     * @param capacity The new capacity. 0 disables the cache.
+     */
+    void SetCapacity(size_t capacity);
+
+    /**
+     * @brief Returns the current usage counters.
+     * @return The cache statistics.
+     */
+    auto GetStatistics() const -> Statistics;
+
+    /**
+     * @brief Removes all cached programs and resets the counters.
+     */
+    void Clear();
+
+private:
+    /**
+     * @brief A cached program with the code it was compiled from, to detect hash collisions.
+     */
+    struct Entry
+    {
+        size_t hash{};
+        std::string code;
+        JitPrecision precision{};
+        std::shared_ptr<const JitProgram> program;
+    };
+
+    void EvictExcessEntries();
+
+    mutable std::mutex m_mutex;                                          //!< Guards all members.
+    std::list<Entry> m_entries;                                          //!< Cached programs, most recently used first.
+    std::unordered_map<size_t, std::list<Entry>::iterator> m_entryIndex; //!< Entries by code and precision hash.
+    size_t m_capacity{DefaultCapacity};                                  //!< Maximum number of entries.
+    uint64_t m_hits{};                                                   //!< Lookups served from the cache.
+    uint64_t m_misses{};                                                 //!< Lookups which compiled the code.
+};
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -12,6 +12,7 @@ static constexpr int TVarCount = 8; //!< Number of T variables available.
 
 static constexpr int CustomWaveformCount = 4; //!< Number of custom waveforms (expression-driven) which can be used in a preset.
 static constexpr int CustomShapeCount = 4; //!< Number of custom shapes (expression-driven) which can be used in a preset.
+static constexpr int CustomShapeMaxInstances = 1024; //!< Maximum number of instances drawn for a single custom shape.
 
 static constexpr int WaveformMaxPoints = 512; //!< Maximum number of waveform points.
 
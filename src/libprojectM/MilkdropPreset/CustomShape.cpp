@@ -1,75 +1,140 @@
 #include "CustomShape.hpp"
 
 #include "PresetFileParser.hpp"
+#include "StageProfiler.hpp"
 
 #include <Renderer/TextureManager.hpp>
 #include <Renderer/RenderItem.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <vector>
 
 namespace libprojectM {
 namespace MilkdropPreset {
 
-CustomShape::CustomShape(PresetState& presetState)
-    : m_presetState(presetState)
-    , m_perFrameContext(presetState.globalMemory, &presetState.globalRegisters)
+namespace {
+
+constexpr int MinSides = 3;   //!< Minimum number of shape sides.
+constexpr int MaxSides = 100; //!< Maximum number of shape sides.
+
+/**
+ * @brief Vertex attributes of a single shape corner.
+ */
+struct ShapeCorner {
+    float x{};    //!< Unrotated unit circle X coordinate.
+    float y{};    //!< Unrotated unit circle Y coordinate.
+    float edge{}; //!< 0.0 for the center vertex, 1.0 for the corners. Used to blend between the two shape colors.
+};
+
+/**
+ * @brief The triangle fan vertices of all possible side counts, stored back to back.
+ *
+ * The fan for a side count starts with the center, followed by all corners and a copy of the first corner
+ * to close the fan. The corners alone are used to draw the border as a line loop.
+ */
+struct ShapeCornerTable {
+    std::vector<ShapeCorner> corners;        //!< The vertices of all side counts.
+    std::array<GLint, MaxSides + 1> first{}; //!< Index of the center vertex for each side count.
+};
+
+auto CornerTable() -> const ShapeCornerTable&
 {
-    std::vector<TexturedPoint> vertexData;
-    vertexData.resize(102);
+    static const ShapeCornerTable table = []() {
+        static constexpr double pi = 3.141592653589793;
 
-    glGenVertexArrays(1, &m_vaoIdTextured);
-    glGenBuffers(1, &m_vboIdTextured);
+        ShapeCornerTable newTable;
+        for (int sides = MinSides; sides <= MaxSides; sides++)
+        {
+            newTable.first[sides] = static_cast<GLint>(newTable.corners.size());
+            newTable.corners.push_back({0.0f, 0.0f, 0.0f});
 
-    glGenVertexArrays(1, &m_vaoIdUntextured);
-    glGenBuffers(1, &m_vboIdUntextured);
+            for (int corner = 0; corner < sides; corner++)
+            {
+                const double angle = static_cast<double>(corner) / static_cast<double>(sides) * pi * 2.0 + pi * 0.25;
+                newTable.corners.push_back({static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)), 1.0f});
+            }
 
-    glBindVertexArray(m_vaoIdTextured);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIdTextured);
+            const auto firstCorner = newTable.corners[newTable.first[sides] + 1];
+            newTable.corners.push_back(firstCorner);
+        }
+        return newTable;
+    }();
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+    return table;
+}
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedPoint), reinterpret_cast<void*>(offsetof(TexturedPoint, x))); // Position
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TexturedPoint), reinterpret_cast<void*>(offsetof(TexturedPoint, r))); // Color
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedPoint), reinterpret_cast<void*>(offsetof(TexturedPoint, u))); // Texture coordinate
+} // namespace
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(TexturedPoint) * vertexData.size(), vertexData.data(), GL_STREAM_DRAW);
+CustomShape::CustomShape(PresetState& presetState)
+    : m_presetState(presetState)
+    , m_perFrameContext(presetState.globalMemory, &presetState.globalRegisters)
+{
+    const auto& cornerTable = CornerTable();
 
-    glBindVertexArray(m_vaoIdUntextured);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIdUntextured);
+    glGenBuffers(1, &m_cornerVboId);
+    glBindBuffer(GL_ARRAY_BUFFER, m_cornerVboId);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(ShapeCorner) * cornerTable.corners.size(), cornerTable.corners.data(), GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
+    // The base class VAO and VBO are used to draw the shape fill.
+    RenderItem::Init();
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedPoint), reinterpret_cast<void*>(offsetof(TexturedPoint, x))); // Position
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TexturedPoint), reinterpret_cast<void*>(offsetof(TexturedPoint, r))); // Color
+    glGenVertexArrays(1, &m_borderVaoId);
+    glGenBuffers(1, &m_borderInstanceVboId);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(TexturedPoint) * vertexData.size(), vertexData.data(), GL_STREAM_DRAW);
+    glBindVertexArray(m_borderVaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, m_borderInstanceVboId);
 
-    RenderItem::Init();
+    InitVertexAttrib();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instanceData.reserve(CustomShapeMaxInstances);
+    m_instanceStates.reserve(CustomShapeMaxInstances);
+    m_borderInstanceData.reserve(CustomShapeMaxInstances);
+    m_instanceRuns.reserve(CustomShapeMaxInstances);
 
     m_perFrameContext.RegisterBuiltinVariables();
 }
 
 CustomShape::~CustomShape()
 {
-    glDeleteBuffers(1, &m_vboIdTextured);
-    glDeleteVertexArrays(1, &m_vaoIdTextured);
+    glDeleteBuffers(1, &m_borderInstanceVboId);
+    glDeleteVertexArrays(1, &m_borderVaoId);
 
-    glDeleteBuffers(1, &m_vboIdUntextured);
-    glDeleteVertexArrays(1, &m_vaoIdUntextured);
+    glDeleteBuffers(1, &m_cornerVboId);
 }
 
 void CustomShape::InitVertexAttrib()
 {
+    // Expects the instance buffer to be bound.
+    glBufferData(GL_ARRAY_BUFFER, sizeof(ShapeInstance) * CustomShapeMaxInstances, nullptr, GL_STREAM_DRAW);
+
+    InitInstanceAttrib(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_cornerVboId);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr); // points
-    glDisableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ShapeCorner), reinterpret_cast<void*>(offsetof(ShapeCorner, x))); // Corner
 
-    std::vector<Point> vertexData;
-    vertexData.resize(100);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Point) * vertexData.size(), vertexData.data(), GL_STREAM_DRAW);
+    // Instanced attributes
+    for (GLuint attribute = 1; attribute <= 5; attribute++)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+}
+
+void CustomShape::InitInstanceAttrib(size_t firstInstance)
+{
+    const auto base = sizeof(ShapeInstance) * firstInstance;
+
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), reinterpret_cast<void*>(base + offsetof(ShapeInstance, x)));        // Transform
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), reinterpret_cast<void*>(base + offsetof(ShapeInstance, angleCos))); // Rotation
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), reinterpret_cast<void*>(base + offsetof(ShapeInstance, r)));        // Center color
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), reinterpret_cast<void*>(base + offsetof(ShapeInstance, r2)));       // Edge color
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), reinterpret_cast<void*>(base + offsetof(ShapeInstance, borderR)));  // Border color
 }
 
 void CustomShape::Initialize(PresetFileParser& parsedFile, int index)
@@ -82,7 +147,7 @@ void CustomShape::Initialize(PresetFileParser& parsedFile, int index)
     m_additive = parsedFile.GetBool(shapecodePrefix + "additive", m_additive);
     m_thickOutline = parsedFile.GetBool(shapecodePrefix + "thickOutline", m_thickOutline);
     m_textured = parsedFile.GetBool(shapecodePrefix + "textured", m_textured);
-    m_instances = parsedFile.GetInt(shapecodePrefix + "num_inst", m_instances);
+    m_instances = std::min(std::max(parsedFile.GetInt(shapecodePrefix + "num_inst", m_instances), 1), CustomShapeMaxInstances);
     m_x = parsedFile.GetFloat(shapecodePrefix + "x", m_x);
     m_y = parsedFile.GetFloat(shapecodePrefix + "y", m_y);
     m_radius = parsedFile.GetFloat(shapecodePrefix + "rad", m_radius);
@@ -108,53 +173,51 @@ void CustomShape::Initialize(PresetFileParser& parsedFile, int index)
 
 void CustomShape::CompileCodeAndRunInitExpressions()
 {
-    m_perFrameContext.LoadStateVariables(m_presetState, *this, 0);
+    m_perFrameContext.LoadStateVariables(m_presetState, *this);
     m_perFrameContext.EvaluateInitCode(m_presetState.customShapeInitCode[m_index], *this);
 
-    for (int t = 0; t < TVarCount; t++)
-    {
-        m_tValuesAfterInitCode[t] = *m_perFrameContext.t_vars[t];
-    }
+    m_perFrameContext.t_vars.Store(m_tValuesAfterInitCode);
 
     m_perFrameContext.CompilePerFrameCode(m_presetState.customShapePerFrameCode[m_index], *this);
 }
 
 void CustomShape::Draw()
 {
-    static constexpr float pi = 3.141592653589793f;
+    PROJECTM_PROFILE_STAGE(CustomShapeDraw);
 
     if (!m_enabled)
     {
         return;
     }
 
-    glEnable(GL_BLEND);
+    m_instanceData.clear();
+    m_instanceStates.clear();
+
+    m_perFrameContext.LoadStateVariables(m_presetState, *this);
 
     for (int instance = 0; instance < m_instances; instance++)
     {
-        m_perFrameContext.LoadStateVariables(m_presetState, *this, instance);
+        m_perFrameContext.LoadInstanceVariables(instance);
         m_perFrameContext.ExecutePerFrameCode();
 
-        int sides = static_cast<int>(*m_perFrameContext.sides);
-        if (sides < 3)
-        {
-            sides = 3;
-        }
-        if (sides > 100)
-        {
-            sides = 100;
-        }
-
-        // Additive Drawing or Overwrite
-        glBlendFunc(GL_SRC_ALPHA, static_cast<int>(*m_perFrameContext.additive) != 0 ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+        InstanceState state;
+        state.sides = std::min(std::max(static_cast<int>(*m_perFrameContext.sides), MinSides), MaxSides);
+        state.additive = static_cast<int>(*m_perFrameContext.additive) != 0;
+        state.textured = static_cast<int>(*m_perFrameContext.textured) != 0;
 
-        std::vector<TexturedPoint> vertexData(sides + 2);
+        ShapeInstance data;
+        data.x = static_cast<float>(*m_perFrameContext.x * 2.0 - 1.0);
+        data.y = static_cast<float>(*m_perFrameContext.y * -2.0 + 1.0);
+        data.radius = static_cast<float>(*m_perFrameContext.rad);
+        data.textureScale = static_cast<float>(1.0 / *m_perFrameContext.tex_zoom);
 
-        vertexData[0].x = static_cast<float>(*m_perFrameContext.x * 2.0 - 1.0);
-        vertexData[0].y = static_cast<float>(*m_perFrameContext.y * -2.0 + 1.0);
+        const auto angle = static_cast<float>(*m_perFrameContext.ang);
+        data.angleCos = cosf(angle);
+        data.angleSin = sinf(angle);
 
-        vertexData[0].u = 0.5f;
-        vertexData[0].v = 0.5f;
+        const auto textureAngle = static_cast<float>(*m_perFrameContext.tex_ang);
+        data.textureAngleCos = cosf(textureAngle);
+        data.textureAngleSin = sinf(textureAngle);
 
         // x = f*255.0 & 0xFF = (f*255.0) % 256
         // f' = x/255.0 = f % (256/255)
@@ -162,181 +225,188 @@ void CustomShape::Draw()
         // 2.0 -> 254 (0xFE)
         // -1.0 -> 0x01
 
-        vertexData[0].r = Renderer::color_modulo(*m_perFrameContext.r);
-        vertexData[0].g = Renderer::color_modulo(*m_perFrameContext.g);
-        vertexData[0].b = Renderer::color_modulo(*m_perFrameContext.b);
-        vertexData[0].a = Renderer::color_modulo(*m_perFrameContext.a);
+        data.r = Renderer::color_modulo(*m_perFrameContext.r);
+        data.g = Renderer::color_modulo(*m_perFrameContext.g);
+        data.b = Renderer::color_modulo(*m_perFrameContext.b);
+        data.a = Renderer::color_modulo(*m_perFrameContext.a);
 
-        vertexData[1].r = Renderer::color_modulo(*m_perFrameContext.r2);
-        vertexData[1].g = Renderer::color_modulo(*m_perFrameContext.g2);
-        vertexData[1].b = Renderer::color_modulo(*m_perFrameContext.b2);
-        vertexData[1].a = Renderer::color_modulo(*m_perFrameContext.a2);
+        data.r2 = Renderer::color_modulo(*m_perFrameContext.r2);
+        data.g2 = Renderer::color_modulo(*m_perFrameContext.g2);
+        data.b2 = Renderer::color_modulo(*m_perFrameContext.b2);
+        data.a2 = Renderer::color_modulo(*m_perFrameContext.a2);
 
-        for (int i = 1; i < sides + 1; i++)
-        {
-            const float cornerProgress = static_cast<float>(i - 1) / static_cast<float>(sides);
-            const float angle = cornerProgress * pi * 2.0f + static_cast<float>(*m_perFrameContext.ang) + pi * 0.25f;
+        data.borderR = static_cast<float>(*m_perFrameContext.border_r);
+        data.borderG = static_cast<float>(*m_perFrameContext.border_g);
+        data.borderB = static_cast<float>(*m_perFrameContext.border_b);
+        data.borderA = static_cast<float>(*m_perFrameContext.border_a);
+
+        m_instanceData.push_back(data);
+        m_instanceStates.push_back(state);
+    }
 
-            // Todo: There's still some issue with aspect ratio here, as everything gets squashed horizontally if Y > x.
-            vertexData[i].x = vertexData[0].x + static_cast<float>(*m_perFrameContext.rad) * cosf(angle) * m_presetState.renderContext.aspectY;
-            vertexData[i].y = vertexData[0].y + static_cast<float>(*m_perFrameContext.rad) * sinf(angle);
+    if (m_instanceData.empty())
+    {
+        return;
+    }
 
-            vertexData[i].r = vertexData[1].r;
-            vertexData[i].g = vertexData[1].g;
-            vertexData[i].b = vertexData[1].b;
-            vertexData[i].a = vertexData[1].a;
+    // Split the instances into runs with the same render state and collect the visible borders.
+    m_instanceRuns.clear();
+    m_borderInstanceData.clear();
+    for (size_t instance = 0; instance < m_instanceData.size(); instance++)
+    {
+        if (m_instanceRuns.empty() || !(m_instanceRuns.back().state == m_instanceStates[instance]))
+        {
+            InstanceRun run;
+            run.state = m_instanceStates[instance];
+            run.first = instance;
+            run.borderFirst = m_borderInstanceData.size();
+            m_instanceRuns.push_back(run);
         }
 
-        // Duplicate last vertex.
-        vertexData[sides + 1] = vertexData[1];
+        m_instanceRuns.back().count++;
 
-        if (static_cast<int>(*m_perFrameContext.textured) != 0)
+        if (m_instanceData[instance].borderA > 0.0001f)
         {
-            m_presetState.texturedShader.Bind();
-            m_presetState.texturedShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
-            m_presetState.texturedShader.SetUniformInt("texture_sampler", 0);
+            m_borderInstanceData.push_back(m_instanceData[instance]);
+            m_instanceRuns.back().borderCount++;
+        }
+    }
 
-            // Textured shape, either main texture or texture from "image" key
-            auto textureAspectY = m_presetState.renderContext.aspectY;
-            if (m_image.empty())
-            {
-                assert(!m_presetState.mainTexture.expired());
-                m_presetState.mainTexture.lock()->Bind(0);
-            }
-            else
-            {
-                auto desc = m_presetState.renderContext.textureManager->GetTexture(m_image);
-                if (!desc.Empty())
-                {
-                    desc.Bind(0, m_presetState.texturedShader);
-                    textureAspectY = 1.0f;
-                }
-                else
-                {
-                    // No texture found, fall back to main texture.
-                    assert(!m_presetState.mainTexture.expired());
-                    m_presetState.mainTexture.lock()->Bind(0);
-                }
-            }
+    glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(sizeof(ShapeInstance) * m_instanceData.size()), m_instanceData.data());
+
+    if (!m_borderInstanceData.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_borderInstanceVboId);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(sizeof(ShapeInstance) * m_borderInstanceData.size()), m_borderInstanceData.data());
+    }
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    const bool textured = std::any_of(m_instanceRuns.begin(), m_instanceRuns.end(), [](const InstanceRun& run) {
+        return run.state.textured;
+    });
 
-            for (int i = 1; i < sides + 1; i++)
-            {
-                const float cornerProgress = static_cast<float>(i - 1) / static_cast<float>(sides);
-                const float angle = cornerProgress * pi * 2.0f + static_cast<float>(*m_perFrameContext.tex_ang) + pi * 0.25f;
+    float textureAspectY = m_presetState.renderContext.aspectY;
+    if (textured)
+    {
+        textureAspectY = BindTexture();
+    }
 
-                vertexData[i].u = 0.5f + 0.5f * cosf(angle) / static_cast<float>(*m_perFrameContext.tex_zoom) * textureAspectY;
-                vertexData[i].v = 1.0f - (0.5f - 0.5f * sinf(angle) / static_cast<float>(*m_perFrameContext.tex_zoom)); // Vertical flip required!
-            }
+    glEnable(GL_BLEND);
 
-            vertexData[sides + 1] = vertexData[1];
+    for (const auto& run : m_instanceRuns)
+    {
+        DrawInstances(run, textureAspectY);
+    }
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboIdTextured);
+    if (textured)
+    {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Renderer::Sampler::Unbind(0);
+    }
 
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TexturedPoint) * (sides + 2), vertexData.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 
-            glBindVertexArray(m_vaoIdTextured);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, sides + 2);
-            glBindVertexArray(0);
+#ifndef USE_GLES
+    glDisable(GL_LINE_SMOOTH);
+#endif
+    glDisable(GL_BLEND);
 
-            glBindTexture(GL_TEXTURE_2D, 0);
-            Renderer::Sampler::Unbind(0);
+    Renderer::Shader::Unbind();
+}
+
+auto CustomShape::BindTexture() -> float
+{
+    // Textured shape, either main texture or texture from "image" key
+    auto textureAspectY = m_presetState.renderContext.aspectY;
+    if (m_image.empty())
+    {
+        assert(!m_presetState.mainTexture.expired());
+        m_presetState.mainTexture.lock()->Bind(0);
+    }
+    else
+    {
+        auto desc = m_presetState.renderContext.textureManager->GetTexture(m_image);
+        if (!desc.Empty())
+        {
+            desc.Bind(0, m_presetState.texturedShapeShader);
+            textureAspectY = 1.0f;
         }
         else
         {
-            // Untextured (creates a color gradient: center=r/g/b/a to border=r2/b2/g2/a2)
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboIdUntextured);
+            // No texture found, fall back to main texture.
+            assert(!m_presetState.mainTexture.expired());
+            m_presetState.mainTexture.lock()->Bind(0);
+        }
+    }
 
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TexturedPoint) * (sides + 2), vertexData.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-            m_presetState.untexturedShader.Bind();
-            m_presetState.untexturedShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
+    return textureAspectY;
+}
 
-            glBindVertexArray(m_vaoIdUntextured);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, sides + 2);
-            glBindVertexArray(0);
-        }
+void CustomShape::DrawInstances(const InstanceRun& run, float textureAspectY)
+{
+    const auto& cornerTable = CornerTable();
+    const auto sides = run.state.sides;
+
+    // Additive Drawing or Overwrite
+    glBlendFunc(GL_SRC_ALPHA, run.state.additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+
+    // Untextured shapes create a color gradient: center=r/g/b/a to border=r2/b2/g2/a2
+    const auto& fillShader = run.state.textured ? m_presetState.texturedShapeShader : m_presetState.untexturedShapeShader;
+    fillShader.Bind();
+    fillShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
+    fillShader.SetUniformFloat("aspect_y", m_presetState.renderContext.aspectY);
+    if (run.state.textured)
+    {
+        fillShader.SetUniformInt("texture_sampler", 0);
+        fillShader.SetUniformFloat("texture_aspect_y", textureAspectY);
+    }
 
-        if (*m_perFrameContext.border_a > 0.0001f)
-        {
-            std::vector<ShapeVertex> points(sides);
+    glBindVertexArray(m_vaoID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
+    InitInstanceAttrib(run.first);
 
-            for (int i = 0; i < sides; i++)
-            {
-                points[i].x = vertexData[i + 1].x;
-                points[i].y = vertexData[i + 1].y;
-            }
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, cornerTable.first[sides], sides + 2, static_cast<GLsizei>(run.count));
 
-            m_presetState.untexturedShader.Bind();
-            m_presetState.untexturedShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
+    if (run.borderCount == 0)
+    {
+        return;
+    }
 
-            glVertexAttrib4f(1,
-                             static_cast<float>(*m_perFrameContext.border_r),
-                             static_cast<float>(*m_perFrameContext.border_g),
-                             static_cast<float>(*m_perFrameContext.border_b),
-                             static_cast<float>(*m_perFrameContext.border_a));
-            glLineWidth(1);
+    m_presetState.shapeBorderShader.Bind();
+    m_presetState.shapeBorderShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
+    m_presetState.shapeBorderShader.SetUniformFloat("aspect_y", m_presetState.renderContext.aspectY);
+
+    glLineWidth(1);
 #ifndef USE_GLES
-            glEnable(GL_LINE_SMOOTH);
+    glEnable(GL_LINE_SMOOTH);
 #endif
 
-            glBindVertexArray(m_vaoID);
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
-
-            const auto iterations = m_thickOutline ? 4 : 1;
-
-            // Need to use +/- 1.0 here instead of 2.0 used in Milkdrop to achieve the same rendering result.
-            const auto incrementX = 1.0f / static_cast<float>(m_presetState.renderContext.viewportSizeX);
-            const auto incrementY = 1.0f / static_cast<float>(m_presetState.renderContext.viewportSizeY);
+    glBindVertexArray(m_borderVaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, m_borderInstanceVboId);
+    InitInstanceAttrib(run.borderFirst);
 
-            // If thick outline is used, draw the shape four times with slight offsets
-            // (top left, top right, bottom right, bottom left).
-            for (auto iteration = 0; iteration < iterations; iteration++)
-            {
-                switch (iteration)
-                {
-                    case 0:
-                        break;
-
-                    case 1:
-                        for (auto j = 0; j < sides; j++)
-                        {
-                            points[j].x += incrementX;
-                        }
-                        break;
-
-                    case 2:
-                        for (auto j = 0; j < sides; j++)
-                        {
-                            points[j].y += incrementY;
-                        }
-                        break;
-
-                    case 3:
-                        for (auto j = 0; j < sides; j++)
-                        {
-                            points[j].x -= incrementX;
-                        }
-                        break;
-                }
-
-                glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizei>(sizeof(Point) * sides), points.data());
-                glDrawArrays(GL_LINE_LOOP, 0, sides);
-            }
-        }
-    }
+    const auto iterations = m_thickOutline ? 4 : 1;
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // Need to use +/- 1.0 here instead of 2.0 used in Milkdrop to achieve the same rendering result.
+    const auto incrementX = 1.0f / static_cast<float>(m_presetState.renderContext.viewportSizeX);
+    const auto incrementY = 1.0f / static_cast<float>(m_presetState.renderContext.viewportSizeY);
 
-#ifndef USE_GLES
-    glDisable(GL_LINE_SMOOTH);
-#endif
-    glDisable(GL_BLEND);
+    // If thick outline is used, draw the shape four times with slight offsets
+    // (top left, top right, bottom right, bottom left).
+    const std::array<glm::vec2, 4> offsets{{{0.0f, 0.0f},
+                                            {incrementX, 0.0f},
+                                            {incrementX, incrementY},
+                                            {0.0f, incrementY}}};
 
-    Renderer::Shader::Unbind();
+    for (auto iteration = 0; iteration < iterations; iteration++)
+    {
+        m_presetState.shapeBorderShader.SetUniformFloat2("vertex_offset", offsets[iteration]);
+        glDrawArraysInstanced(GL_LINE_LOOP, cornerTable.first[sides] + 1, sides, static_cast<GLsizei>(run.borderCount));
+    }
 }
 
 } // namespace MilkdropPreset
@@ -8,6 +8,8 @@
 
 #include <projectm-eval.h>
 
+#include <vector>
+
 namespace libprojectM {
 namespace MilkdropPreset {
 
@@ -16,8 +18,10 @@ class PresetFileParser;
 /**
  * @brief Renders a custom shape with or without a texture.
  *
- * The class creates two sets of VBO/VAO as it's only known later (in the Draw() call) whether the shape is textured
- * or not.
+ * All instances of a shape are drawn with instanced rendering. The per-frame code is run for every instance first,
+ * collecting the resulting parameters in an instance buffer. Consecutive instances with the same number of sides,
+ * blend mode and texturing are then drawn with a single instanced draw call for the fill and one for the border.
+ * The corner vertices of all possible side counts are stored once in a static vertex buffer.
  */
 class CustomShape : public Renderer::RenderItem
 {
@@ -47,11 +51,76 @@ public:
     void Draw();
 
 private:
-    struct ShapeVertex {
-        float x{.0f}; //!< The vertex X coordinate.
-        float y{.0f}; //!< The vertex Y coordinate.
+    /**
+     * @brief Per-instance vertex attributes, as passed to the shape shaders.
+     */
+    struct ShapeInstance {
+        float x{};               //!< The shape center X coordinate.
+        float y{};               //!< The shape center Y coordinate.
+        float radius{};          //!< The shape radius.
+        float textureScale{};    //!< The inverse texture zoom.
+        float angleCos{};        //!< Cosine of the shape rotation angle.
+        float angleSin{};        //!< Sine of the shape rotation angle.
+        float textureAngleCos{}; //!< Cosine of the texture rotation angle.
+        float textureAngleSin{}; //!< Sine of the texture rotation angle.
+        float r{};               //!< Center red color value.
+        float g{};               //!< Center green color value.
+        float b{};               //!< Center blue color value.
+        float a{};               //!< Center alpha value.
+        float r2{};              //!< Edge red color value.
+        float g2{};              //!< Edge green color value.
+        float b2{};              //!< Edge blue color value.
+        float a2{};              //!< Edge alpha value.
+        float borderR{};         //!< Border red color value.
+        float borderG{};         //!< Border green color value.
+        float borderB{};         //!< Border blue color value.
+        float borderA{};         //!< Border alpha value.
+    };
+
+    /**
+     * @brief Per-instance render state which can't be changed within a single draw call.
+     */
+    struct InstanceState {
+        int sides{};          //!< Number of sides, clamped to 3 to 100.
+        bool additive{false}; //!< If true, the instance is drawn with additive blending.
+        bool textured{false}; //!< If true, the instance is drawn with a texture.
+
+        auto operator==(const InstanceState& other) const -> bool
+        {
+            return sides == other.sides && additive == other.additive && textured == other.textured;
+        }
+    };
+
+    /**
+     * @brief A range of consecutive instances sharing the same render state.
+     */
+    struct InstanceRun {
+        InstanceState state;  //!< The render state of all instances in the run.
+        size_t first{};       //!< Index of the first instance in the fill instance buffer.
+        size_t count{};       //!< Number of instances in the run.
+        size_t borderFirst{}; //!< Index of the first instance in the border instance buffer.
+        size_t borderCount{}; //!< Number of instances in the run with a visible border.
     };
 
+    /**
+     * @brief Sets up the per-instance attribute pointers for the currently bound VAO and instance buffer.
+     * @param firstInstance Index of the instance in the buffer used for the first drawn instance.
+     */
+    static void InitInstanceAttrib(size_t firstInstance);
+
+    /**
+     * @brief Binds the texture used by textured instances.
+     * @return The Y aspect ratio to apply to texture coordinates.
+     */
+    auto BindTexture() -> float;
+
+    /**
+     * @brief Draws the fill and border of a run of instances with one instanced draw call each.
+     * @param run The instances to draw.
+     * @param textureAspectY The Y aspect ratio of the bound texture.
+     */
+    void DrawInstances(const InstanceRun& run, float textureAspectY);
+
     std::string m_image; //!< Texture filename to be rendered on this shape
 
     int m_index{0};        //!< The custom shape index in the preset.
@@ -88,16 +157,19 @@ private:
     std::string m_initCode;     //!< Init expression code, run once on preset load.
     std::string m_perFrameCode; //!< Per-frame expression code, run once per frame and instance.
 
-    PRJM_EVAL_F m_tValuesAfterInitCode[TVarCount]{};
+    TVariableBlock m_tValuesAfterInitCode; //!< t1 to t8 after running the init code, loaded before each per-frame code run.
 
     PresetState& m_presetState; //!< The global preset state.
     ShapePerFrameContext m_perFrameContext;
 
-    GLuint m_vboIdTextured{0}; //!< Vertex buffer object ID for a textured shape.
-    GLuint m_vaoIdTextured{0}; //!< Vertex array object ID for a textured shape.
+    std::vector<ShapeInstance> m_instanceData;       //!< Parameters of all instances drawn in the current frame.
+    std::vector<InstanceState> m_instanceStates;     //!< Render state of all instances drawn in the current frame.
+    std::vector<ShapeInstance> m_borderInstanceData; //!< Instances of the current run with a visible border.
+    std::vector<InstanceRun> m_instanceRuns;         //!< Runs of instances with the same render state in the current frame.
 
-    GLuint m_vboIdUntextured{0}; //!< Vertex buffer object ID for an untextured shape.
-    GLuint m_vaoIdUntextured{0}; //!< Vertex array object ID for an untextured shape.
+    GLuint m_cornerVboId{0};         //!< Vertex buffer object ID for the unit circle corners of all side counts.
+    GLuint m_borderVaoId{0};         //!< Vertex array object ID for drawing the shape borders.
+    GLuint m_borderInstanceVboId{0}; //!< Instance buffer object ID for the shape borders.
 
     friend class ShapePerFrameContext;
 };
@@ -1,7 +1,9 @@
 #include "CustomWaveform.hpp"
 
+#include "CodeAnalysis.hpp"
 #include "PerFrameContext.hpp"
 #include "PresetFileParser.hpp"
+#include "StageProfiler.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -9,13 +11,13 @@
 namespace libprojectM {
 namespace MilkdropPreset {
 
-static constexpr int CustomWaveformMaxSamples = std::max(libprojectM::Audio::WaveformSamples, libprojectM::Audio::SpectrumSamples);
-
 CustomWaveform::CustomWaveform(PresetState& presetState)
     : RenderItem()
     , m_presetState(presetState)
     , m_perFrameContext(presetState.globalMemory, &presetState.globalRegisters)
     , m_perPointContext(presetState.globalMemory, &presetState.globalRegisters)
+    , m_points(WaveformMaxPoints)
+    , m_vertices(WaveformMaxPoints * 2)
 {
     RenderItem::Init();
 
@@ -63,20 +65,22 @@ void CustomWaveform::CompileCodeAndRunInitExpressions(const PerFrameContext& pre
     m_perFrameContext.LoadStateVariables(m_presetState, presetPerFrameContext, *this);
     m_perFrameContext.EvaluateInitCode(m_presetState.customWaveInitCode[m_index], *this);
 
-    for (int t = 0; t < TVarCount; t++)
-    {
-        m_tValuesAfterInitCode[t] = *m_perFrameContext.t_vars[t];
-    }
+    m_perFrameContext.t_vars.Store(m_tValuesAfterInitCode);
 
     m_perFrameContext.CompilePerFrameCode(m_presetState.customWavePerFrameCode[m_index], *this);
     m_perPointContext.CompilePerPointCode(m_presetState.customWavePerPointCode[m_index], *this);
+
+    m_supportsMultithreading = !AnalyzeCode(m_presetState.customWavePerFrameCode[m_index]).usesSharedState &&
+                               !AnalyzeCode(m_presetState.customWavePerPointCode[m_index]).usesSharedState;
 }
 
-void CustomWaveform::Draw(const PerFrameContext& presetPerFrameContext)
+void CustomWaveform::Evaluate(const PerFrameContext& presetPerFrameContext)
 {
     static_assert(libprojectM::Audio::WaveformSamples <= WaveformMaxPoints, "WaveformMaxPoints is larger than WaveformSamples");
     static_assert(libprojectM::Audio::SpectrumSamples <= WaveformMaxPoints, "WaveformMaxPoints is larger than SpectrumSamples");
 
+    m_vertexCount = 0;
+
     if (!m_enabled)
     {
         return;
@@ -101,11 +105,11 @@ void CustomWaveform::Draw(const PerFrameContext& presetPerFrameContext)
     }
 
     const auto* pcmL = m_spectrum
-                           ? m_presetState.audioData.spectrumLeft.data()
-                           : m_presetState.audioData.waveformLeft.data();
+                           ? m_presetState.audioData->spectrumLeft.data()
+                           : m_presetState.audioData->waveformLeft.data();
     const auto* pcmR = m_spectrum
-                           ? m_presetState.audioData.spectrumRight.data()
-                           : m_presetState.audioData.waveformRight.data();
+                           ? m_presetState.audioData->spectrumRight.data()
+                           : m_presetState.audioData->waveformRight.data();
 
     const float mult = m_scaling * m_presetState.waveScale * (m_spectrum ? 0.15f : 0.004f);
     //const float mult = m_scaling * m_presetState.waveScale * (m_spectrum ? 0.05f : 1.0f);
@@ -117,8 +121,10 @@ void CustomWaveform::Draw(const PerFrameContext& presetPerFrameContext)
     const float mix1 = std::pow(m_smoothing * 0.98f, 0.5f);
     const float mix2 = 1.0f - mix1;
 
-    std::array<float, CustomWaveformMaxSamples> sampleDataL{};
-    std::array<float, CustomWaveformMaxSamples> sampleDataR{};
+    // The smoothed samples are the value1 and value2 inputs of the per-point code.
+    m_pointBlock.count = static_cast<size_t>(sampleCount);
+    auto& sampleDataL = m_pointBlock.value1;
+    auto& sampleDataR = m_pointBlock.value2;
 
     sampleDataL[0] = pcmL[offset1];
     sampleDataR[0] = pcmR[offset2];
@@ -144,27 +150,36 @@ void CustomWaveform::Draw(const PerFrameContext& presetPerFrameContext)
         sampleDataR[sample] *= mult;
     }
 
-    std::vector<ColoredPoint> pointsTransformed(sampleCount);
+    LoadPerPointEvaluationVariables();
+
+    m_perPointContext.ExecutePerPointCode(m_pointBlock);
 
-    float const sampleMultiplicator = sampleCount > 1 ? 1.0f / static_cast<float>(sampleCount - 1) : 0.0f;
+    float const invAspectX = m_presetState.renderContext.invAspectX;
+    float const invAspectY = m_presetState.renderContext.invAspectY;
     for (int sample = 0; sample < sampleCount; sample++)
     {
-        float const sampleIndex = static_cast<float>(sample) * sampleMultiplicator;
-        LoadPerPointEvaluationVariables(sampleIndex, sampleDataL[sample], sampleDataR[sample]);
+        auto& point = m_points[sample];
 
-        m_perPointContext.ExecutePerPointCode();
+        point.x = (m_pointBlock.x[sample] * 2.0f - 1.0f) * invAspectX;
+        point.y = (m_pointBlock.y[sample] * -2.0f + 1.0f) * invAspectY;
 
-        pointsTransformed[sample].x = static_cast<float>((*m_perPointContext.x * 2.0 - 1.0) * m_presetState.renderContext.invAspectX);
-        pointsTransformed[sample].y = static_cast<float>((*m_perPointContext.y * -2.0 + 1.0) * m_presetState.renderContext.invAspectY);
-
-        pointsTransformed[sample].r = Renderer::color_modulo(*m_perPointContext.r);
-        pointsTransformed[sample].g = Renderer::color_modulo(*m_perPointContext.g);
-        pointsTransformed[sample].b = Renderer::color_modulo(*m_perPointContext.b);
-        pointsTransformed[sample].a = Renderer::color_modulo(*m_perPointContext.a);
+        point.r = Renderer::color_modulo(m_pointBlock.r[sample]);
+        point.g = Renderer::color_modulo(m_pointBlock.g[sample]);
+        point.b = Renderer::color_modulo(m_pointBlock.b[sample]);
+        point.a = Renderer::color_modulo(m_pointBlock.a[sample]);
     }
 
-    std::vector<ColoredPoint> pointsSmoothed(sampleCount * 2);
-    auto smoothedVertexCount = SmoothWave(pointsTransformed.data(), sampleCount, pointsSmoothed.data());
+    m_vertexCount = SmoothWave(m_points.data(), sampleCount, m_vertices.data());
+}
+
+void CustomWaveform::Draw()
+{
+    PROJECTM_PROFILE_STAGE(CustomWaveformDraw);
+
+    if (m_vertexCount == 0)
+    {
+        return;
+    }
 
 #ifndef USE_GLES
     glDisable(GL_LINE_SMOOTH);
@@ -207,29 +222,29 @@ void CustomWaveform::Draw(const PerFrameContext& presetPerFrameContext)
                 break;
 
             case 1:
-                for (auto j = 0; j < smoothedVertexCount; j++)
+                for (auto j = 0; j < m_vertexCount; j++)
                 {
-                    pointsSmoothed[j].x += incrementX;
+                    m_vertices[j].x += incrementX;
                 }
                 break;
 
             case 2:
-                for (auto j = 0; j < smoothedVertexCount; j++)
+                for (auto j = 0; j < m_vertexCount; j++)
                 {
-                    pointsSmoothed[j].y += incrementY;
+                    m_vertices[j].y += incrementY;
                 }
                 break;
 
             case 3:
-                for (auto j = 0; j < smoothedVertexCount; j++)
+                for (auto j = 0; j < m_vertexCount; j++)
                 {
-                    pointsSmoothed[j].x -= incrementX;
+                    m_vertices[j].x -= incrementX;
                 }
                 break;
         }
 
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ColoredPoint) * smoothedVertexCount, pointsSmoothed.data());
-        glDrawArrays(drawType, 0, smoothedVertexCount);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ColoredPoint) * m_vertexCount, m_vertices.data());
+        glDrawArrays(drawType, 0, m_vertexCount);
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -248,27 +263,30 @@ void CustomWaveform::LoadPerFrameEvaluationVariables(const PerFrameContext& pres
 
 void CustomWaveform::InitPerPointEvaluationVariables()
 {
-    for (int q = 0; q < QVarCount; q++)
-    {
-        *m_perPointContext.q_vars[q] = *m_perFrameContext.q_vars[q];
-    }
-    for (int t = 0; t < TVarCount; t++)
-    {
-        *m_perPointContext.t_vars[t] = *m_perFrameContext.t_vars[t];
-    }
+    m_perPointContext.q_vars.Load(m_perFrameContext.q_vars);
+    m_perPointContext.t_vars.Load(m_perFrameContext.t_vars);
 }
 
-void CustomWaveform::LoadPerPointEvaluationVariables(float sample, float value1, float value2)
+void CustomWaveform::LoadPerPointEvaluationVariables()
 {
-    *m_perPointContext.sample = static_cast<double>(sample);
-    *m_perPointContext.value1 = static_cast<double>(value1);
-    *m_perPointContext.value2 = static_cast<double>(value2);
-    *m_perPointContext.x = static_cast<double>(0.5f + value1);
-    *m_perPointContext.y = static_cast<double>(0.5f + value2);
-    *m_perPointContext.r = *m_perFrameContext.r;
-    *m_perPointContext.g = *m_perFrameContext.g;
-    *m_perPointContext.b = *m_perFrameContext.b;
-    *m_perPointContext.a = *m_perFrameContext.a;
+    auto const r = static_cast<float>(*m_perFrameContext.r);
+    auto const g = static_cast<float>(*m_perFrameContext.g);
+    auto const b = static_cast<float>(*m_perFrameContext.b);
+    auto const a = static_cast<float>(*m_perFrameContext.a);
+
+    auto& points = m_pointBlock;
+    float const sampleMultiplicator = points.count > 1 ? 1.0f / static_cast<float>(points.count - 1) : 0.0f;
+    for (size_t sample = 0; sample < points.count; sample++)
+    {
+        points.sample[sample] = static_cast<float>(sample) * sampleMultiplicator;
+        points.x[sample] = 0.5f + points.value1[sample];
+        points.y[sample] = 0.5f + points.value2[sample];
+    }
+
+    std::fill_n(points.r.begin(), points.count, r);
+    std::fill_n(points.g.begin(), points.count, g);
+    std::fill_n(points.b.begin(), points.count, b);
+    std::fill_n(points.a.begin(), points.count, a);
 }
 
 int CustomWaveform::SmoothWave(const CustomWaveform::ColoredPoint* inputVertices,
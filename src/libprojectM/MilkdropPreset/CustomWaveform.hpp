@@ -42,10 +42,37 @@ public:
     void CompileCodeAndRunInitExpressions(const PerFrameContext& presetPerFrameContext);
 
     /**
-     * @brief Renders the waveform.
-     * @param presetPerFrameContext The per-frame context to retrieve the init Q vars from.
+     * @brief Runs the per-frame and per-point code and calculates the vertices of the waveform.
+     *
+     * Doesn't call any OpenGL functions. Waveforms which support multithreading can be evaluated
+     * on different threads at the same time.
+     *
+     * @param presetPerFrameContext The per-frame context to retrieve the Q vars from.
+     */
+    void Evaluate(const PerFrameContext& presetPerFrameContext);
+
+    /**
+     * @brief Renders the vertices calculated by the last call to Evaluate().
+     */
+    void Draw();
+
+    /**
+     * @brief Returns whether the waveform is drawn.
+     * @return True if the waveform is enabled in the preset.
      */
-    void Draw(const PerFrameContext& presetPerFrameContext);
+    auto Enabled() const -> bool
+    {
+        return m_enabled != 0;
+    }
+
+    /**
+     * @brief Returns whether the waveform can be evaluated in parallel with other waveforms.
+     * @return True if neither the per-frame nor the per-point code uses gmegabuf, regXX vars or other shared state.
+     */
+    auto SupportsMultithreading() const -> bool
+    {
+        return m_supportsMultithreading;
+    }
 
 private:
     /**
@@ -60,12 +87,11 @@ private:
     void InitPerPointEvaluationVariables();
 
     /**
-     * @brief Loads the variables for each point into the per-point evaluation context.
-     * @param sample The sample index being rendered.
-     * @param value1 The left channel value.
-     * @param value2 The right channel value.
+     * @brief Fills in the remaining per-point code inputs of all points from the channel values.
+     *
+     * The count, value1 and value2 arrays of m_pointBlock must already be set.
      */
-    void LoadPerPointEvaluationVariables(float sample, float value1, float value2);
+    void LoadPerPointEvaluationVariables();
 
     /**
      * @brief Does a better-than-linear smooth on a wave.
@@ -96,13 +122,18 @@ private:
     bool m_drawThick{false}; //!< Draw thicker lines.
     bool m_additive{false}; //!< Add color values together.
 
-    PRJM_EVAL_F m_tValuesAfterInitCode[TVarCount]{};
+    TVariableBlock m_tValuesAfterInitCode; //!< t1 to t8 after running the init code, loaded before each per-frame code run.
 
     PresetState& m_presetState; //!< The global preset state.
     WaveformPerFrameContext m_perFrameContext; //!< Holds the code execution context for per-frame expressions
     WaveformPerPointContext m_perPointContext; //!< Holds the code execution context for per-point expressions
 
-    std::vector<ColoredPoint> m_points; //!< Points in this waveform.
+    bool m_supportsMultithreading{true}; //!< True if the code doesn't reference shared state.
+
+    WaveformPerPointContext::PointBlock m_pointBlock; //!< Per-point code inputs and results, reused on each frame.
+    std::vector<ColoredPoint> m_points;               //!< Points in this waveform, transformed into screen coordinates.
+    std::vector<ColoredPoint> m_vertices;             //!< Smoothed vertices uploaded to the vertex buffer.
+    int m_vertexCount{};                              //!< Number of vertices calculated by Evaluate(), 0 if there's nothing to draw.
 
     friend class WaveformPerFrameContext;
     friend class WaveformPerPointContext;
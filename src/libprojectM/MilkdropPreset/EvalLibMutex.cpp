@@ -1,4 +1,29 @@
 #include <projectm-eval.h>
 
-void projectm_eval_memory_host_lock_mutex() {}
-void projectm_eval_memory_host_unlock_mutex() {}
+#include <mutex>
+
+namespace {
+
+/**
+ * @brief Protects the expression library's global memory buffers.
+ *
+ * Per-pixel code can be evaluated on multiple threads, each in its own context, so accesses to
+ * gmegabuf must be synchronized. Recursive, as the library may nest lock calls.
+ */
+auto EvalLibMutex() -> std::recursive_mutex&
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+} // namespace
+
+void projectm_eval_memory_host_lock_mutex()
+{
+    EvalLibMutex().lock();
+}
+
+void projectm_eval_memory_host_unlock_mutex()
+{
+    EvalLibMutex().unlock();
+}
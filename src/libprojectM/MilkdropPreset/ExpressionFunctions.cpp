@@ -0,0 +1,256 @@
+#include "ExpressionFunctions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+namespace ExpressionFunctions {
+
+namespace {
+
+auto Add(double a, double b) -> double
+{
+    return a + b;
+}
+
+auto Subtract(double a, double b) -> double
+{
+    return a - b;
+}
+
+auto Multiply(double a, double b) -> double
+{
+    return a * b;
+}
+
+auto Divide(double a, double b) -> double
+{
+    return b == 0.0 ? 0.0 : a / b;
+}
+
+auto Power(double base, double exponent) -> double
+{
+    return std::pow(base, exponent);
+}
+
+auto Above(double a, double b) -> double
+{
+    return a > b ? 1.0 : 0.0;
+}
+
+auto Below(double a, double b) -> double
+{
+    return a < b ? 1.0 : 0.0;
+}
+
+auto AboveOrEqual(double a, double b) -> double
+{
+    return a >= b ? 1.0 : 0.0;
+}
+
+auto BelowOrEqual(double a, double b) -> double
+{
+    return a <= b ? 1.0 : 0.0;
+}
+
+auto Equal(double a, double b) -> double
+{
+    return std::fabs(a - b) < CloseFactor ? 1.0 : 0.0;
+}
+
+auto NotEqual(double a, double b) -> double
+{
+    return std::fabs(a - b) < CloseFactor ? 0.0 : 1.0;
+}
+
+auto ExactlyEqual(double a, double b) -> double
+{
+    return a == b ? 1.0 : 0.0;
+}
+
+auto NotExactlyEqual(double a, double b) -> double
+{
+    return a != b ? 1.0 : 0.0;
+}
+
+auto Minimum(double a, double b) -> double
+{
+    return a < b ? a : b;
+}
+
+auto Maximum(double a, double b) -> double
+{
+    return a > b ? a : b;
+}
+
+auto ArcTangent2(double y, double x) -> double
+{
+    return std::atan2(y, x);
+}
+
+auto Sigmoid(double value, double constraint) -> double
+{
+    double const t = 1.0 + std::exp(-value * constraint);
+    return std::fabs(t) > CloseFactor ? 1.0 / t : 0.0;
+}
+
+auto Sine(double value) -> double
+{
+    return std::sin(value);
+}
+
+auto Cosine(double value) -> double
+{
+    return std::cos(value);
+}
+
+auto Tangent(double value) -> double
+{
+    return std::tan(value);
+}
+
+auto ArcSine(double value) -> double
+{
+    return std::asin(value);
+}
+
+auto ArcCosine(double value) -> double
+{
+    return std::acos(value);
+}
+
+auto ArcTangent(double value) -> double
+{
+    return std::atan(value);
+}
+
+auto SquareRoot(double value) -> double
+{
+    return std::sqrt(std::fabs(value));
+}
+
+auto Square(double value) -> double
+{
+    return value * value;
+}
+
+auto Exponential(double value) -> double
+{
+    return std::exp(value);
+}
+
+auto Logarithm(double value) -> double
+{
+    return std::log(value);
+}
+
+auto Logarithm10(double value) -> double
+{
+    return std::log10(value);
+}
+
+auto Absolute(double value) -> double
+{
+    return std::fabs(value);
+}
+
+auto Sign(double value) -> double
+{
+    return value > 0.0 ? 1.0 : (value < 0.0 ? -1.0 : 0.0);
+}
+
+auto Floor(double value) -> double
+{
+    return std::floor(value);
+}
+
+auto Ceiling(double value) -> double
+{
+    return std::ceil(value);
+}
+
+const std::map<std::string, UnaryFunction> UnaryFunctions{
+    {"sin", Sine},
+    {"cos", Cosine},
+    {"tan", Tangent},
+    {"asin", ArcSine},
+    {"acos", ArcCosine},
+    {"atan", ArcTangent},
+    {"sqrt", SquareRoot},
+    {"sqr", Square},
+    {"exp", Exponential},
+    {"log", Logarithm},
+    {"log10", Logarithm10},
+    {"abs", Absolute},
+    {"sign", Sign},
+    {"floor", Floor},
+    {"ceil", Ceiling}};
+
+const std::map<std::string, BinaryFunction> BinaryFunctions{
+    {"atan2", ArcTangent2},
+    {"pow", Power},
+    {"min", Minimum},
+    {"max", Maximum},
+    {"sigmoid", Sigmoid},
+    {"above", Above},
+    {"below", Below},
+    {"equal", Equal}};
+
+const std::map<std::string, BinaryFunction> BinaryOperators{
+    {"+", Add},
+    {"-", Subtract},
+    {"*", Multiply},
+    {"/", Divide},
+    {"^", Power},
+    {"==", Equal},
+    {"!=", NotEqual},
+    {"===", ExactlyEqual},
+    {"!==", NotExactlyEqual},
+    {"<", Below},
+    {">", Above},
+    {"<=", BelowOrEqual},
+    {">=", AboveOrEqual}};
+
+template<typename Function>
+auto Find(const std::map<std::string, Function>& functions, const std::string& name) -> Function
+{
+    auto const function = functions.find(name);
+    return function != functions.end() ? function->second : nullptr;
+}
+
+} // namespace
+
+auto IsTrue(double value) -> bool
+{
+    return std::fabs(value) > CloseFactor;
+}
+
+auto LoopCount(double count) -> double
+{
+    if (!(count >= 1.0))
+    {
+        return 0.0;
+    }
+    return std::min(std::trunc(count), MaxLoopIterations);
+}
+
+auto FindUnaryFunction(const std::string& name) -> UnaryFunction
+{
+    return Find(UnaryFunctions, name);
+}
+
+auto FindBinaryFunction(const std::string& name) -> BinaryFunction
+{
+    return Find(BinaryFunctions, name);
+}
+
+auto FindBinaryOperator(const std::string& name) -> BinaryFunction
+{
+    return Find(BinaryOperators, name);
+}
+
+} // namespace ExpressionFunctions
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Reference implementations of the expression language operators and pure functions.
+ *
+ * Shared by everything in libprojectM evaluating expression code outside of projectm-eval, so the
+ * results match no matter where the code runs.
+ */
+namespace ExpressionFunctions {
+
+constexpr double CloseFactor{0.00001};       //!< Values closer than this are considered equal, or false if compared to zero.
+constexpr double MaxLoopIterations{1048576}; //!< Iteration limit of loop() and while(), same as in projectm-eval.
+
+using UnaryFunction = double (*)(double);
+using BinaryFunction = double (*)(double, double);
+
+/**
+ * @brief Returns whether a value is considered true in conditions.
+ * @param value The value to test.
+ * @return True if the value isn't within CloseFactor of zero.
+ */
+auto IsTrue(double value) -> bool;
+
+/**
+ * @brief Returns the number of iterations of a loop() call.
+ * @param count The first loop() argument.
+ * @return The truncated count, limited to 0 to MaxLoopIterations.
+ */
+auto LoopCount(double count) -> double;
+
+/**
+ * @brief Returns a pure function taking one argument, e.g. sin().
+ * @param name The lower-case function name.
+ * @return The function implementation, or nullptr if there is no such pure function.
+ */
+auto FindUnaryFunction(const std::string& name) -> UnaryFunction;
+
+/**
+ * @brief Returns a pure function taking two arguments, e.g. pow().
+ * @param name The lower-case function name.
+ * @return The function implementation, or nullptr if there is no such pure function.
+ */
+auto FindBinaryFunction(const std::string& name) -> BinaryFunction;
+
+/**
+ * @brief Returns the implementation of a binary arithmetic or comparison operator.
+ *
+ * Logic operators aren't included, as they only evaluate their second operand if needed.
+ *
+ * @param name The operator, e.g. "+" or "==".
+ * @return The operator implementation, or nullptr if not supported.
+ */
+auto FindBinaryOperator(const std::string& name) -> BinaryFunction;
+
+} // namespace ExpressionFunctions
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,842 @@
+#include "ExpressionJit.hpp"
+
+#include "CompiledCodeCache.hpp"
+#include "ExpressionOptimizer.hpp"
+#include "ExpressionFunctions.hpp"
+#include "ExpressionTree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <type_traits>
+
+#if defined(MILKDROP_EXPRESSION_JIT) && (defined(__x86_64__) || defined(_M_X64))
+#define MILKDROP_EXPRESSION_JIT_X86_64 1
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+using ExpressionFunctions::CloseFactor;
+using ExpressionFunctions::MaxLoopIterations;
+
+std::atomic<JitPrecision> vertexCodePrecision{JitPrecision::Double}; //!< Precision of per-pixel and per-point code.
+
+/**
+ * @brief Generates x86-64 machine code from an expression tree.
+ *
+ * The generated function takes the variable pointer table as its only argument, which is kept in
+ * rbx. The result of each node is in xmm0, with xmm1 as the second operand. Intermediate results
+ * are spilled to stack slots above the 32 bytes of Windows shadow space.
+ *
+ * In double precision, all values are doubles. In single precision, all values are floats and use
+ * the scalar single precision instructions, so loads and stores need no conversion. Only the
+ * arguments and results of calls to the shared double precision functions are converted.
+ */
+class CodeGenerator
+{
+public:
+    explicit CodeGenerator(JitPrecision precision)
+        : m_precision(precision)
+    {
+        Emit({0x53}); // push rbx
+#ifdef _WIN32
+        Emit({0x48, 0x89, 0xCB}); // mov rbx, rcx
+#else
+        Emit({0x48, 0x89, 0xFB}); // mov rbx, rdi
+#endif
+        Emit({0x48, 0x81, 0xEC}); // sub rsp, frame size
+        m_frameSizeOffset = m_code.size();
+        EmitValue<int32_t>(0);
+    }
+
+    /**
+     * @brief Generates the code for the whole program.
+     * @param root The root node returned by ParseExpressionTree().
+     * @return True if the code only uses supported features.
+     */
+    auto Generate(const ExpressionNode& root) -> bool
+    {
+        GenerateNode(root);
+        if (!m_supported)
+        {
+            return false;
+        }
+
+        // The stack pointer must stay 16-byte aligned for calls. It is after pushing rbx.
+        auto const frameSize = static_cast<int32_t>((32 + m_maxTemporaries * 8 + 15) & ~size_t{15});
+        std::memcpy(&m_code[m_frameSizeOffset], &frameSize, sizeof(frameSize));
+
+        if (m_precision == JitPrecision::Single)
+        {
+            Emit({0xF3, 0x0F, 0x5A, 0xC0}); // cvtss2sd xmm0, xmm0
+        }
+
+        Emit({0x48, 0x81, 0xC4}); // add rsp, frame size
+        EmitValue(frameSize);
+        Emit({0x5B, 0xC3}); // pop rbx; ret
+
+        return true;
+    }
+
+    auto Code() const -> const std::vector<uint8_t>&
+    {
+        return m_code;
+    }
+
+    auto Variables() const -> const std::vector<std::string>&
+    {
+        return m_variables;
+    }
+
+private:
+    void Emit(std::initializer_list<uint8_t> bytes)
+    {
+        m_code.insert(m_code.end(), bytes);
+    }
+
+    template<typename T>
+    void EmitValue(T value)
+    {
+        auto const offset = m_code.size();
+        m_code.resize(offset + sizeof(T));
+        std::memcpy(&m_code[offset], &value, sizeof(T));
+    }
+
+    /**
+     * @brief Emits a jump instruction with a 32-bit displacement to be patched by Bind().
+     * @return The offset of the displacement.
+     */
+    auto EmitJump(std::initializer_list<uint8_t> opcode) -> size_t
+    {
+        Emit(opcode);
+        auto const offset = m_code.size();
+        EmitValue<int32_t>(0);
+        return offset;
+    }
+
+    /**
+     * @brief Emits a jump instruction to an earlier position.
+     */
+    void EmitJumpTo(std::initializer_list<uint8_t> opcode, size_t target)
+    {
+        Emit(opcode);
+        EmitValue(static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(m_code.size() + 4)));
+    }
+
+    /**
+     * @brief Makes a jump emitted by EmitJump() target the current position.
+     */
+    void Bind(size_t jumpOffset)
+    {
+        auto const displacement = static_cast<int32_t>(m_code.size() - (jumpOffset + 4));
+        std::memcpy(&m_code[jumpOffset], &displacement, sizeof(displacement));
+    }
+
+    auto VariableOffset(const std::string& name) -> int32_t
+    {
+        auto variable = m_variableIndices.find(name);
+        if (variable == m_variableIndices.end())
+        {
+            variable = m_variableIndices.emplace(name, m_variables.size()).first;
+            m_variables.push_back(name);
+        }
+        return static_cast<int32_t>(variable->second * sizeof(PRJM_EVAL_F*));
+    }
+
+    /**
+     * @brief Returns the prefix selecting the double (sd) or single (ss) variant of scalar SSE instructions.
+     */
+    auto ScalarPrefix() const -> uint8_t
+    {
+        return m_precision == JitPrecision::Single ? 0xF3 : 0xF2;
+    }
+
+    /**
+     * @brief Emits a scalar SSE instruction in the precision of the generated code.
+     */
+    void EmitScalar(std::initializer_list<uint8_t> opcodeAndOperands)
+    {
+        m_code.push_back(ScalarPrefix());
+        Emit(opcodeAndOperands);
+    }
+
+    /**
+     * @brief Emits a packed bitwise or compare instruction, with the 0x66 prefix in double precision.
+     */
+    void EmitPacked(std::initializer_list<uint8_t> opcodeAndOperands)
+    {
+        if (m_precision == JitPrecision::Double)
+        {
+            m_code.push_back(0x66);
+        }
+        Emit(opcodeAndOperands);
+    }
+
+    void LoadVariable(const std::string& name, int xmmRegister)
+    {
+        Emit({0x48, 0x8B, 0x83}); // mov rax, [rbx + offset]
+        EmitValue(VariableOffset(name));
+        EmitScalar({0x0F, 0x10, static_cast<uint8_t>(xmmRegister << 3)}); // movsd/movss xmmN, [rax]
+    }
+
+    void StoreVariable(const std::string& name)
+    {
+        Emit({0x48, 0x8B, 0x83}); // mov rax, [rbx + offset]
+        EmitValue(VariableOffset(name));
+        EmitScalar({0x0F, 0x11, 0x00}); // movsd/movss [rax], xmm0
+    }
+
+    void LoadConstant(double value, int xmmRegister)
+    {
+        uint64_t bits;
+        if (m_precision == JitPrecision::Single)
+        {
+            auto const singleValue = static_cast<float>(value);
+            uint32_t singleBits;
+            std::memcpy(&singleBits, &singleValue, sizeof(singleBits));
+            bits = singleBits;
+        }
+        else
+        {
+            std::memcpy(&bits, &value, sizeof(bits));
+        }
+
+        if (bits == 0)
+        {
+            Emit({0x0F, 0x57, static_cast<uint8_t>(0xC0 | xmmRegister << 3 | xmmRegister)}); // xorps xmmN, xmmN
+            return;
+        }
+
+        Emit({0x48, 0xB8}); // mov rax, imm64
+        EmitValue(bits);
+        Emit({0x66, 0x48, 0x0F, 0x6E, static_cast<uint8_t>(0xC0 | xmmRegister << 3)}); // movq xmmN, rax
+    }
+
+    auto PushTemporary() -> int32_t
+    {
+        auto const offset = static_cast<int32_t>(32 + m_temporaries * 8);
+        m_temporaries++;
+        m_maxTemporaries = std::max(m_maxTemporaries, m_temporaries);
+        StoreTemporary(offset);
+        return offset;
+    }
+
+    void LoadTemporary(int32_t offset, int xmmRegister)
+    {
+        EmitScalar({0x0F, 0x10, static_cast<uint8_t>(0x84 | xmmRegister << 3), 0x24}); // movsd/movss xmmN, [rsp + offset]
+        EmitValue(offset);
+    }
+
+    void StoreTemporary(int32_t offset)
+    {
+        EmitScalar({0x0F, 0x11, 0x84, 0x24}); // movsd/movss [rsp + offset], xmm0
+        EmitValue(offset);
+    }
+
+    void PopTemporary()
+    {
+        m_temporaries--;
+    }
+
+    /**
+     * @brief Calls a double precision function with the arguments in xmm0 and xmm1.
+     * @param function The function to call.
+     * @param argumentCount The number of arguments, converted to double first in single precision.
+     */
+    template<typename Function>
+    void Call(Function function, int argumentCount)
+    {
+        if (m_precision == JitPrecision::Single)
+        {
+            Emit({0xF3, 0x0F, 0x5A, 0xC0}); // cvtss2sd xmm0, xmm0
+            if (argumentCount > 1)
+            {
+                Emit({0xF3, 0x0F, 0x5A, 0xC9}); // cvtss2sd xmm1, xmm1
+            }
+        }
+
+        Emit({0x48, 0xB8}); // mov rax, imm64
+        EmitValue(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(function)));
+        Emit({0xFF, 0xD0}); // call rax
+
+        if (m_precision == JitPrecision::Single)
+        {
+            Emit({0xF2, 0x0F, 0x5A, 0xC0}); // cvtsd2ss xmm0, xmm0
+        }
+    }
+
+    /**
+     * @brief Evaluates two operands, leaving the first in xmm0 and the second in xmm1.
+     */
+    void GenerateOperands(const ExpressionNode& first, const ExpressionNode& second)
+    {
+        GenerateNode(first);
+
+        // Loading a leaf can't change the first value, so no need to spill it.
+        if (second.type == ExpressionNode::Type::Constant)
+        {
+            LoadConstant(second.value, 1);
+            return;
+        }
+        if (second.type == ExpressionNode::Type::Variable && IsSupportedVariable(second.name))
+        {
+            LoadVariable(second.name, 1);
+            return;
+        }
+
+        auto const temporary = PushTemporary();
+        GenerateNode(second);
+        EmitScalar({0x0F, 0x10, 0xC8}); // movsd/movss xmm1, xmm0
+        LoadTemporary(temporary, 0);
+        PopTemporary();
+    }
+
+    /**
+     * @brief Evaluates a condition and emits a jump that is taken if it is false.
+     * @return The jump to Bind() to the false branch.
+     */
+    auto GenerateBranchIfFalse(const ExpressionNode& condition) -> size_t
+    {
+        GenerateNode(condition);
+        LoadConstant(-0.0, 1);
+        EmitPacked({0x0F, 0x55, 0xC8}); // andnpd/andnps xmm1, xmm0
+        LoadConstant(CloseFactor, 0);
+        EmitPacked({0x0F, 0x2E, 0xC8}); // ucomisd/ucomiss xmm1, xmm0
+        return EmitJump({0x0F, 0x86});  // jbe, also taken for NaN
+    }
+
+    /**
+     * @brief Loads 1.0 or 0.0 into xmm0, depending on which of the two jumps was taken.
+     */
+    void GenerateBooleanResult(const std::vector<size_t>& trueJumps, const std::vector<size_t>& falseJumps)
+    {
+        for (auto jump : trueJumps)
+        {
+            Bind(jump);
+        }
+        LoadConstant(1.0, 0);
+        auto const end = EmitJump({0xE9});
+        for (auto jump : falseJumps)
+        {
+            Bind(jump);
+        }
+        LoadConstant(0.0, 0);
+        Bind(end);
+    }
+
+    static auto IsSupportedVariable(const std::string& name) -> bool
+    {
+        // Global registers are resolved by the projectm-eval compiler, not through the context variables.
+        return !(name.size() == 5 && name.compare(0, 3, "reg") == 0 &&
+                 std::isdigit(static_cast<unsigned char>(name[3])) && std::isdigit(static_cast<unsigned char>(name[4])));
+    }
+
+    void GenerateNode(const ExpressionNode& node)
+    {
+        if (!m_supported)
+        {
+            return;
+        }
+
+        switch (node.type)
+        {
+            case ExpressionNode::Type::Constant:
+                LoadConstant(node.value, 0);
+                return;
+
+            case ExpressionNode::Type::Variable:
+                if (!IsSupportedVariable(node.name))
+                {
+                    m_supported = false;
+                    return;
+                }
+                LoadVariable(node.name, 0);
+                return;
+
+            case ExpressionNode::Type::Function:
+                GenerateFunction(node);
+                return;
+
+            case ExpressionNode::Type::Operator:
+                GenerateOperator(node);
+                return;
+
+            case ExpressionNode::Type::Assignment:
+                GenerateAssignment(node);
+                return;
+
+            case ExpressionNode::Type::Sequence:
+                GenerateSequence(node.arguments);
+                return;
+        }
+    }
+
+    void GenerateSequence(const std::vector<ExpressionNode::Ptr>& statements)
+    {
+        if (statements.empty())
+        {
+            LoadConstant(0.0, 0);
+            return;
+        }
+
+        for (const auto& statement : statements)
+        {
+            GenerateNode(*statement);
+        }
+    }
+
+    void GenerateFunction(const ExpressionNode& node)
+    {
+        auto const& arguments = node.arguments;
+
+        auto const unaryFunction = ExpressionFunctions::FindUnaryFunction(node.name);
+        if (unaryFunction != nullptr && arguments.size() == 1)
+        {
+            GenerateNode(*arguments[0]);
+            Call(unaryFunction, 1);
+            return;
+        }
+
+        auto const binaryFunction = ExpressionFunctions::FindBinaryFunction(node.name);
+        if (binaryFunction != nullptr && arguments.size() == 2)
+        {
+            GenerateOperands(*arguments[0], *arguments[1]);
+            Call(binaryFunction, 2);
+            return;
+        }
+
+        if (node.name == "if" && arguments.size() == 3)
+        {
+            auto const elseJump = GenerateBranchIfFalse(*arguments[0]);
+            GenerateNode(*arguments[1]);
+            auto const endJump = EmitJump({0xE9});
+            Bind(elseJump);
+            GenerateNode(*arguments[2]);
+            Bind(endJump);
+            return;
+        }
+
+        if ((node.name == "exec2" && arguments.size() == 2) || (node.name == "exec3" && arguments.size() == 3))
+        {
+            GenerateSequence(arguments);
+            return;
+        }
+
+        if (node.name == "band" && arguments.size() == 2)
+        {
+            GenerateAnd(*arguments[0], *arguments[1]);
+            return;
+        }
+
+        if (node.name == "bor" && arguments.size() == 2)
+        {
+            GenerateOr(*arguments[0], *arguments[1]);
+            return;
+        }
+
+        if (node.name == "bnot" && arguments.size() == 1)
+        {
+            GenerateNot(*arguments[0]);
+            return;
+        }
+
+        if (node.name == "loop" && arguments.size() == 2)
+        {
+            GenerateLoop(*arguments[0], *arguments[1]);
+            return;
+        }
+
+        if (node.name == "while" && arguments.size() == 1)
+        {
+            GenerateWhile(*arguments[0]);
+            return;
+        }
+
+        m_supported = false;
+    }
+
+    void GenerateOperator(const ExpressionNode& node)
+    {
+        if (node.arguments.size() == 1)
+        {
+            if (node.name == "-")
+            {
+                GenerateNode(*node.arguments[0]);
+                LoadConstant(-0.0, 1);
+                EmitPacked({0x0F, 0x57, 0xC1}); // xorpd/xorps xmm0, xmm1
+            }
+            else if (node.name == "+")
+            {
+                GenerateNode(*node.arguments[0]);
+            }
+            else if (node.name == "!")
+            {
+                GenerateNot(*node.arguments[0]);
+            }
+            else
+            {
+                m_supported = false;
+            }
+            return;
+        }
+
+        if (node.name == "&&")
+        {
+            GenerateAnd(*node.arguments[0], *node.arguments[1]);
+            return;
+        }
+
+        if (node.name == "||")
+        {
+            GenerateOr(*node.arguments[0], *node.arguments[1]);
+            return;
+        }
+
+        GenerateBinaryOperation(node.name, *node.arguments[0], *node.arguments[1]);
+    }
+
+    /**
+     * @brief Generates a binary operation with both operands evaluated.
+     */
+    void GenerateBinaryOperation(const std::string& name, const ExpressionNode& first, const ExpressionNode& second)
+    {
+        if (ExpressionFunctions::FindBinaryOperator(name) == nullptr)
+        {
+            m_supported = false;
+            return;
+        }
+
+        GenerateOperands(first, second);
+        GenerateBinaryOperationInRegisters(name);
+    }
+
+    void GenerateAssignment(const ExpressionNode& node)
+    {
+        auto const& target = *node.arguments[0];
+        if (target.type != ExpressionNode::Type::Variable || !IsSupportedVariable(target.name))
+        {
+            m_supported = false;
+            return;
+        }
+
+        if (node.name == "=")
+        {
+            GenerateNode(*node.arguments[1]);
+        }
+        else
+        {
+            // The value is evaluated before reading the target, as it may assign the target itself.
+            GenerateNode(*node.arguments[1]);
+            EmitScalar({0x0F, 0x10, 0xC8}); // movsd/movss xmm1, xmm0
+            LoadVariable(target.name, 0);
+
+            GenerateBinaryOperationInRegisters(node.name.substr(0, node.name.size() - 1));
+        }
+
+        StoreVariable(target.name);
+    }
+
+    /**
+     * @brief Applies a binary operation to xmm0 and xmm1.
+     */
+    void GenerateBinaryOperationInRegisters(const std::string& name)
+    {
+        if (name == "+")
+        {
+            EmitScalar({0x0F, 0x58, 0xC1}); // addsd/addss xmm0, xmm1
+        }
+        else if (name == "-")
+        {
+            EmitScalar({0x0F, 0x5C, 0xC1}); // subsd/subss xmm0, xmm1
+        }
+        else if (name == "*")
+        {
+            EmitScalar({0x0F, 0x59, 0xC1}); // mulsd/mulss xmm0, xmm1
+        }
+        else
+        {
+            auto const function = ExpressionFunctions::FindBinaryOperator(name);
+            if (function == nullptr)
+            {
+                m_supported = false;
+                return;
+            }
+            Call(function, 2);
+        }
+    }
+
+    void GenerateAnd(const ExpressionNode& first, const ExpressionNode& second)
+    {
+        auto const firstFalse = GenerateBranchIfFalse(first);
+        auto const secondFalse = GenerateBranchIfFalse(second);
+        GenerateBooleanResult({}, {firstFalse, secondFalse});
+    }
+
+    void GenerateOr(const ExpressionNode& first, const ExpressionNode& second)
+    {
+        auto const firstFalse = GenerateBranchIfFalse(first);
+        auto const firstTrue = EmitJump({0xE9});
+        Bind(firstFalse);
+        auto const secondFalse = GenerateBranchIfFalse(second);
+        GenerateBooleanResult({firstTrue}, {secondFalse});
+    }
+
+    void GenerateNot(const ExpressionNode& value)
+    {
+        auto const valueFalse = GenerateBranchIfFalse(value);
+        LoadConstant(0.0, 0);
+        auto const end = EmitJump({0xE9});
+        Bind(valueFalse);
+        LoadConstant(1.0, 0);
+        Bind(end);
+    }
+
+    void GenerateLoop(const ExpressionNode& count, const ExpressionNode& body)
+    {
+        GenerateNode(count);
+        Call(ExpressionFunctions::LoopCount, 1);
+        auto const counter = PushTemporary();
+
+        auto const top = m_code.size();
+        LoadTemporary(counter, 0);
+        LoadConstant(0.0, 1);
+        EmitPacked({0x0F, 0x2E, 0xC1}); // ucomisd/ucomiss xmm0, xmm1
+        auto const end = EmitJump({0x0F, 0x86}); // jbe
+        LoadConstant(1.0, 1);
+        EmitScalar({0x0F, 0x5C, 0xC1}); // subsd/subss xmm0, xmm1
+        StoreTemporary(counter);
+        GenerateNode(body);
+        EmitJumpTo({0xE9}, top);
+        Bind(end);
+
+        PopTemporary();
+        LoadConstant(0.0, 0);
+    }
+
+    void GenerateWhile(const ExpressionNode& body)
+    {
+        LoadConstant(MaxLoopIterations, 0);
+        auto const counter = PushTemporary();
+
+        auto const top = m_code.size();
+        auto const end = GenerateBranchIfFalse(body);
+        LoadTemporary(counter, 0);
+        LoadConstant(1.0, 1);
+        EmitScalar({0x0F, 0x5C, 0xC1}); // subsd/subss xmm0, xmm1
+        StoreTemporary(counter);
+        LoadConstant(0.0, 1);
+        EmitPacked({0x0F, 0x2E, 0xC1}); // ucomisd/ucomiss xmm0, xmm1
+        EmitJumpTo({0x0F, 0x87}, top);  // ja
+        Bind(end);
+
+        PopTemporary();
+        LoadConstant(0.0, 0);
+    }
+
+    JitPrecision m_precision;                         //!< Storage type of the variables.
+    std::vector<uint8_t> m_code;                      //!< The generated machine code.
+    size_t m_frameSizeOffset{};                       //!< Offset of the stack frame size in the prologue.
+    size_t m_temporaries{};                           //!< Number of currently used stack slots.
+    size_t m_maxTemporaries{};                        //!< Maximum number of simultaneously used stack slots.
+    std::map<std::string, size_t> m_variableIndices;  //!< Index of each variable in the pointer table.
+    std::vector<std::string> m_variables;             //!< Variable names in pointer table order.
+    bool m_supported{true};                           //!< False once an unsupported construct was found.
+};
+
+} // namespace
+
+JitProgram::~JitProgram()
+{
+#ifdef MILKDROP_EXPRESSION_JIT_X86_64
+    if (m_memory == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(m_memory, 0, MEM_RELEASE);
+#else
+    munmap(m_memory, m_memorySize);
+#endif
+#endif
+}
+
+auto JitProgram::IsAvailable() -> bool
+{
+#ifdef MILKDROP_EXPRESSION_JIT_X86_64
+    // The generated code uses double precision SSE2 instructions.
+    return std::is_same<PRJM_EVAL_F, double>::value;
+#else
+    return false;
+#endif
+}
+
+auto JitProgram::Compile(const std::string& code, JitPrecision precision) -> std::shared_ptr<const JitProgram>
+{
+    if (!IsAvailable())
+    {
+        return {};
+    }
+
+    // Code relying on operator grouping which might differ from projectm-eval's stays on the interpreter.
+    auto const tree = ParseExpressionTree(code);
+    if (!tree || HasAmbiguousGrouping(*tree))
+    {
+        return {};
+    }
+
+#ifdef MILKDROP_EXPRESSION_OPTIMIZER
+    // Contexts pass the code as stored in the preset, which is also the cache key, so optimize it here.
+    OptimizeExpressionTree(*tree);
+#endif
+
+    CodeGenerator generator(precision);
+    if (!generator.Generate(*tree))
+    {
+        return {};
+    }
+
+    std::shared_ptr<JitProgram> program(new JitProgram());
+    program->m_precision = precision;
+    program->m_variables = generator.Variables();
+
+#ifdef MILKDROP_EXPRESSION_JIT_X86_64
+    // Write the code into writable memory first, then make it executable, but never both at once.
+    auto const& machineCode = generator.Code();
+    program->m_memorySize = machineCode.size();
+#ifdef _WIN32
+    program->m_memory = VirtualAlloc(nullptr, program->m_memorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (program->m_memory == nullptr)
+    {
+        return {};
+    }
+    std::memcpy(program->m_memory, machineCode.data(), machineCode.size());
+    DWORD oldProtection;
+    if (!VirtualProtect(program->m_memory, program->m_memorySize, PAGE_EXECUTE_READ, &oldProtection))
+    {
+        return {};
+    }
+    FlushInstructionCache(GetCurrentProcess(), program->m_memory, program->m_memorySize);
+#else
+    void* memory = mmap(nullptr, program->m_memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return {};
+    }
+    program->m_memory = memory;
+    std::memcpy(program->m_memory, machineCode.data(), machineCode.size());
+    if (mprotect(program->m_memory, program->m_memorySize, PROT_READ | PROT_EXEC) != 0)
+    {
+        return {};
+    }
+#endif
+    program->m_function = reinterpret_cast<Function>(program->m_memory);
+#endif
+
+    return program;
+}
+
+auto JitCode::Compile(projectm_eval_context* context, const std::string& code,
+                      JitPrecision precision) -> std::unique_ptr<JitCode>
+{
+    if (!JitProgram::IsAvailable())
+    {
+        return {};
+    }
+
+    return Bind(context, CompiledCodeCache::Instance().Compile(code, precision));
+}
+
+auto JitCode::FromCache(projectm_eval_context* context, const std::string& code,
+                        JitPrecision precision) -> std::unique_ptr<JitCode>
+{
+    if (!JitProgram::IsAvailable())
+    {
+        return {};
+    }
+
+    return Bind(context, CompiledCodeCache::Instance().Find(code, precision));
+}
+
+auto JitCode::Bind(projectm_eval_context* context, std::shared_ptr<const JitProgram> program) -> std::unique_ptr<JitCode>
+{
+    if (!program)
+    {
+        return {};
+    }
+
+    std::unique_ptr<JitCode> jitCode(new JitCode());
+    for (const auto& name : program->Variables())
+    {
+        auto* variable = projectm_eval_context_register_variable(context, name.c_str());
+        if (variable == nullptr)
+        {
+            return {};
+        }
+        jitCode->m_variables.push_back(variable);
+    }
+
+    if (program->Precision() == JitPrecision::Single)
+    {
+        jitCode->m_singleValues.resize(jitCode->m_variables.size());
+        for (auto& value : jitCode->m_singleValues)
+        {
+            jitCode->m_singleVariables.push_back(&value);
+        }
+    }
+
+    jitCode->m_program = std::move(program);
+
+    return jitCode;
+}
+
+void JitCode::LoadVariables()
+{
+    for (size_t variable = 0; variable < m_singleValues.size(); variable++)
+    {
+        m_singleValues[variable] = static_cast<float>(*m_variables[variable]);
+    }
+}
+
+void JitCode::StoreVariables()
+{
+    for (size_t variable = 0; variable < m_singleValues.size(); variable++)
+    {
+        *m_variables[variable] = static_cast<PRJM_EVAL_F>(m_singleValues[variable]);
+    }
+}
+
+auto JitCode::Variable(const std::string& name) -> float*
+{
+    auto const& names = m_program->Variables();
+    auto const variable = std::find(names.begin(), names.end(), name);
+    if (variable == names.end() || m_singleVariables.empty())
+    {
+        return nullptr;
+    }
+    return m_singleVariables[static_cast<size_t>(variable - names.begin())];
+}
+
+void SetVertexCodePrecision(JitPrecision precision)
+{
+    vertexCodePrecision = precision;
+}
+
+auto VertexCodePrecision() -> JitPrecision
+{
+    return vertexCodePrecision;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
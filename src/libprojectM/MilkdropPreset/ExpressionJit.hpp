@@ -0,0 +1,207 @@
+#pragma once
+
+#include "JitPrecision.hpp"
+
+#include <projectm-eval.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Expression code compiled into native machine code.
+ *
+ * The JIT compiler is an optional alternative to the projectm-eval tree interpreter. It's only
+ * available if libprojectM was built with ENABLE_EXPRESSION_JIT for x86-64, and supports the same
+ * subset of expression code as the GLSL translator plus loop() and while(). Memory buffers, global
+ * registers, rand() and other functions with state aren't supported, so callers always compile the
+ * code with projectm-eval first and keep it as fallback.
+ *
+ * The machine code doesn't depend on a context. Variables are accessed through a table of pointers
+ * passed to Execute(), with one entry for each name returned by Variables().
+ *
+ * In single precision, the variables are floats and calculations use scalar single precision
+ * instructions. Only function calls like sin() convert their arguments to double and the result
+ * back to float.
+ */
+class JitProgram
+{
+public:
+    JitProgram(const JitProgram&) = delete;
+    auto operator=(const JitProgram&) -> JitProgram& = delete;
+
+    /**
+     * @brief Destructor. Frees the executable memory.
+     */
+    ~JitProgram();
+
+    /**
+     * @brief Returns whether the JIT compiler is available in this build and on this platform.
+     * @return true if Compile() can return programs, false if it always returns nullptr.
+     */
+    static auto IsAvailable() -> bool;
+
+    /**
+     * @brief Compiles expression code into machine code.
+     * @param code The expression code, as stored in the preset.
+     * @param precision The storage type of the variables.
+     * @return The compiled program, or nullptr if the JIT isn't available or the code uses unsupported features.
+     */
+    static auto Compile(const std::string& code, JitPrecision precision = JitPrecision::Double) -> std::shared_ptr<const JitProgram>;
+
+    /**
+     * @brief Returns the storage type of the variables the program was compiled for.
+     * @return The variable precision.
+     */
+    auto Precision() const -> JitPrecision
+    {
+        return m_precision;
+    }
+
+    /**
+     * @brief Returns the lower-case names of the variables used by the code, in table order.
+     * @return The variable names.
+     */
+    auto Variables() const -> const std::vector<std::string>&
+    {
+        return m_variables;
+    }
+
+    /**
+     * @brief Runs code compiled for double precision.
+     * @param variables Pointers to the storage of each variable, in the order returned by Variables().
+     * @return The value of the last statement.
+     */
+    auto Execute(PRJM_EVAL_F* const* variables) const -> PRJM_EVAL_F
+    {
+        return m_function(reinterpret_cast<void* const*>(variables));
+    }
+
+    /**
+     * @brief Runs code compiled for single precision.
+     * @param variables Pointers to the storage of each variable, in the order returned by Variables().
+     * @return The value of the last statement.
+     */
+    auto Execute(float* const* variables) const -> PRJM_EVAL_F
+    {
+        return m_function(reinterpret_cast<void* const*>(variables));
+    }
+
+private:
+    using Function = PRJM_EVAL_F (*)(void* const*);
+
+    JitProgram() = default;
+
+    void* m_memory{};                     //!< Executable memory holding the machine code.
+    size_t m_memorySize{};                //!< Size of the executable memory in bytes.
+    Function m_function{};                //!< Entry point of the machine code.
+    JitPrecision m_precision{};           //!< Storage type of the variables.
+    std::vector<std::string> m_variables; //!< Names of the variables in the pointer table.
+};
+
+/**
+ * @brief A JIT-compiled program bound to the variables of an expression evaluator context.
+ *
+ * Single precision programs work on float copies of the context variables. Execute() copies the
+ * values in and out on each call. Code running many times in a row, like per-pixel and per-point
+ * code, calls LoadVariables() once, then accesses the inputs and results through Variable() and
+ * runs ExecuteLoaded() for each vertex, and finally calls StoreVariables().
+ */
+class JitCode
+{
+public:
+    /**
+     * @brief Compiles expression code and binds the program to the variables of the given context.
+     *
+     * Variables not yet known to the context are registered, just like projectm-eval does when
+     * compiling the same code. The program is taken from the CompiledCodeCache if the same code
+     * was compiled before.
+     *
+     * @param context The context holding the variables.
+     * @param code The expression code, as stored in the preset.
+     * @param precision The storage type of the variables while the program runs.
+     * @return The bound code, or nullptr if the code can't be JIT-compiled.
+     */
+    static auto Compile(projectm_eval_context* context, const std::string& code,
+                        JitPrecision precision = JitPrecision::Double) -> std::unique_ptr<JitCode>;
+
+    /**
+     * @brief Binds a program from the CompiledCodeCache to the variables of the given context.
+     *
+     * Unlike Compile(), the code is never compiled. Code found in the cache was accepted by
+     * projectm-eval when it was first compiled, so callers can skip compiling it with projectm-eval.
+     *
+     * @param context The context holding the variables.
+     * @param code The expression code, as stored in the preset.
+     * @param precision The storage type of the variables while the program runs.
+     * @return The bound code, or nullptr if no program for the code is cached.
+     */
+    static auto FromCache(projectm_eval_context* context, const std::string& code,
+                          JitPrecision precision = JitPrecision::Double) -> std::unique_ptr<JitCode>;
+
+    /**
+     * @brief Returns the storage type of the variables the program works on.
+     * @return The variable precision.
+     */
+    auto Precision() const -> JitPrecision
+    {
+        return m_program->Precision();
+    }
+
+    /**
+     * @brief Runs the compiled code on the context's variables.
+     * @return The value of the last statement.
+     */
+    auto Execute() -> PRJM_EVAL_F
+    {
+        LoadVariables();
+        auto const result = ExecuteLoaded();
+        StoreVariables();
+        return result;
+    }
+
+    /**
+     * @brief Copies the context variables into the single precision copies. Does nothing in double precision.
+     */
+    void LoadVariables();
+
+    /**
+     * @brief Runs the compiled code on the variables, without copying them from or to the context.
+     * @return The value of the last statement.
+     */
+    auto ExecuteLoaded() -> PRJM_EVAL_F
+    {
+        if (m_singleVariables.empty())
+        {
+            return m_program->Execute(m_variables.data());
+        }
+        return m_program->Execute(m_singleVariables.data());
+    }
+
+    /**
+     * @brief Copies the single precision copies back into the context variables. Does nothing in double precision.
+     */
+    void StoreVariables();
+
+    /**
+     * @brief Returns the single precision copy of a variable.
+     * @param name The lower-case variable name.
+     * @return A pointer to the copy, or nullptr if the code doesn't use the variable or runs in double precision.
+     */
+    auto Variable(const std::string& name) -> float*;
+
+private:
+    static auto Bind(projectm_eval_context* context, std::shared_ptr<const JitProgram> program) -> std::unique_ptr<JitCode>;
+
+    std::shared_ptr<const JitProgram> m_program; //!< The compiled program.
+    std::vector<PRJM_EVAL_F*> m_variables;       //!< The context variables, in program table order.
+    std::vector<float> m_singleValues;           //!< Single precision copies of the variables.
+    std::vector<float*> m_singleVariables;       //!< The table passed to single precision programs.
+};
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,490 @@
+#include "ExpressionOptimizer.hpp"
+
+#include "ExpressionFunctions.hpp"
+
+#include <cmath>
+
+#ifdef MILKDROP_PRESET_DEBUG
+#include <iostream>
+#endif
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+using Type = ExpressionNode::Type;
+
+auto MakeConstant(double value) -> ExpressionNode::Ptr
+{
+    auto node = std::make_unique<ExpressionNode>();
+    node->type = Type::Constant;
+    node->value = value;
+    return node;
+}
+
+auto IsConstant(const ExpressionNode::Ptr& node) -> bool
+{
+    return node->type == Type::Constant;
+}
+
+/**
+ * @brief Returns whether a node reads or writes the given variable anywhere in its subtree.
+ */
+auto References(const ExpressionNode& node, const std::string& name) -> bool
+{
+    if (node.type == Type::Variable && node.name == name)
+    {
+        return true;
+    }
+
+    for (const auto& argument : node.arguments)
+    {
+        if (References(*argument, name))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Returns whether the given function neither has state nor changes anything besides its arguments.
+ */
+auto IsPureFunction(const ExpressionNode& node) -> bool
+{
+    auto const argumentCount = node.arguments.size();
+    if (argumentCount == 1)
+    {
+        return ExpressionFunctions::FindUnaryFunction(node.name) != nullptr || node.name == "bnot";
+    }
+    if (argumentCount == 2)
+    {
+        return ExpressionFunctions::FindBinaryFunction(node.name) != nullptr ||
+               node.name == "band" || node.name == "bor" || node.name == "exec2";
+    }
+    if (argumentCount == 3)
+    {
+        return node.name == "if" || node.name == "exec3";
+    }
+    return false;
+}
+
+/**
+ * @brief Returns whether evaluating a node changes any state.
+ *
+ * Memory buffers, rand() and unknown functions are always assumed to have side effects.
+ */
+auto HasSideEffects(const ExpressionNode& node) -> bool
+{
+    switch (node.type)
+    {
+        case Type::Constant:
+        case Type::Variable:
+            return false;
+
+        case Type::Assignment:
+            return true;
+
+        case Type::Function:
+            if (node.name == "loop" && node.arguments.size() == 2 && node.arguments[0]->type == Type::Constant &&
+                ExpressionFunctions::LoopCount(node.arguments[0]->value) == 0.0)
+            {
+                return false;
+            }
+
+            // A loop without side effects in its body doesn't have any either, no matter how often it runs.
+            if (!IsPureFunction(node) &&
+                !(node.name == "loop" && node.arguments.size() == 2) &&
+                !(node.name == "while" && node.arguments.size() == 1))
+            {
+                return true;
+            }
+            break;
+
+        case Type::Operator:
+        case Type::Sequence:
+            break;
+    }
+
+    for (const auto& argument : node.arguments)
+    {
+        if (HasSideEffects(*argument))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Returns whether the code uses operators whose grouping may differ from projectm-eval.
+ *
+ * Printing the tree adds parentheses according to our own precedence table, which has only been
+ * checked for the arithmetic and comparison operators so far. Code using modulo, shift or bitwise
+ * operators, or mixing && with ||, is therefore passed to projectm-eval unchanged.
+ */
+auto UsesUncheckedOperators(const ExpressionNode& node, bool& usesAnd, bool& usesOr) -> bool
+{
+    if (node.type == Type::Operator)
+    {
+        if (IsUncheckedOperator(node.name))
+        {
+            return true;
+        }
+
+        usesAnd |= node.name == "&&";
+        usesOr |= node.name == "||";
+        if (usesAnd && usesOr)
+        {
+            return true;
+        }
+    }
+
+    for (const auto& argument : node.arguments)
+    {
+        if (UsesUncheckedOperators(*argument, usesAnd, usesOr))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Applies the optimizations to a tree, repeating them until nothing changes anymore.
+ */
+class Optimizer
+{
+public:
+    auto Run(ExpressionNode& root) -> bool
+    {
+        bool changed{};
+        do
+        {
+            m_changed = false;
+            OptimizeSequence(root);
+            changed |= m_changed;
+        } while (m_changed);
+        return changed;
+    }
+
+private:
+    void Replace(ExpressionNode::Ptr& node, ExpressionNode::Ptr replacement)
+    {
+        node = std::move(replacement);
+        m_changed = true;
+    }
+
+    /**
+     * @brief Replaces a node by a constant if the value is finite.
+     */
+    void Fold(ExpressionNode::Ptr& node, double value)
+    {
+        if (std::isfinite(value))
+        {
+            Replace(node, MakeConstant(value));
+        }
+    }
+
+    void Optimize(ExpressionNode::Ptr& node)
+    {
+        if (node->type == Type::Sequence)
+        {
+            OptimizeSequence(*node);
+
+            // Keep the empty list, as it evaluates to 0 without being a constant statement.
+            if (node->arguments.size() == 1)
+            {
+                auto statement = std::move(node->arguments[0]);
+                Replace(node, std::move(statement));
+            }
+            return;
+        }
+
+        for (auto& argument : node->arguments)
+        {
+            Optimize(argument);
+        }
+
+        if (node->type == Type::Operator)
+        {
+            FoldOperator(node);
+        }
+        else if (node->type == Type::Function)
+        {
+            FoldFunction(node);
+        }
+    }
+
+    void FoldOperator(ExpressionNode::Ptr& node)
+    {
+        auto& arguments = node->arguments;
+
+        if (arguments.size() == 1)
+        {
+            if (node->name == "+")
+            {
+                auto argument = std::move(arguments[0]);
+                Replace(node, std::move(argument));
+            }
+            else if (IsConstant(arguments[0]) && node->name == "-")
+            {
+                Fold(node, -arguments[0]->value);
+            }
+            else if (IsConstant(arguments[0]) && node->name == "!")
+            {
+                Fold(node, ExpressionFunctions::IsTrue(arguments[0]->value) ? 0.0 : 1.0);
+            }
+            return;
+        }
+
+        if (node->name == "&&" || node->name == "||")
+        {
+            FoldLogic(node, node->name == "&&");
+            return;
+        }
+
+        auto const function = ExpressionFunctions::FindBinaryOperator(node->name);
+        if (function != nullptr && IsConstant(arguments[0]) && IsConstant(arguments[1]))
+        {
+            Fold(node, function(arguments[0]->value, arguments[1]->value));
+        }
+    }
+
+    /**
+     * @brief Folds a logic operation whose first operand is constant.
+     *
+     * The second operand is only evaluated if the first one doesn't decide the result, so it may be
+     * dropped even if it has side effects.
+     */
+    void FoldLogic(ExpressionNode::Ptr& node, bool isAnd)
+    {
+        auto& arguments = node->arguments;
+        if (!IsConstant(arguments[0]))
+        {
+            return;
+        }
+
+        auto const first = ExpressionFunctions::IsTrue(arguments[0]->value);
+        if (first != isAnd)
+        {
+            Fold(node, first ? 1.0 : 0.0);
+        }
+        else if (IsConstant(arguments[1]))
+        {
+            Fold(node, ExpressionFunctions::IsTrue(arguments[1]->value) ? 1.0 : 0.0);
+        }
+    }
+
+    void FoldFunction(ExpressionNode::Ptr& node)
+    {
+        auto& arguments = node->arguments;
+        auto const& name = node->name;
+
+        if (arguments.size() == 1 && IsConstant(arguments[0]))
+        {
+            if (name == "bnot")
+            {
+                Fold(node, ExpressionFunctions::IsTrue(arguments[0]->value) ? 0.0 : 1.0);
+                return;
+            }
+
+            auto const function = ExpressionFunctions::FindUnaryFunction(name);
+            if (function != nullptr)
+            {
+                Fold(node, function(arguments[0]->value));
+            }
+            return;
+        }
+
+        if (arguments.size() == 2)
+        {
+            if (name == "band" || name == "bor")
+            {
+                FoldLogic(node, name == "band");
+                return;
+            }
+
+            auto const function = ExpressionFunctions::FindBinaryFunction(name);
+            if (function != nullptr)
+            {
+                if (IsConstant(arguments[0]) && IsConstant(arguments[1]))
+                {
+                    Fold(node, function(arguments[0]->value, arguments[1]->value));
+                }
+                return;
+            }
+        }
+
+        if (name == "if" && arguments.size() == 3 && IsConstant(arguments[0]))
+        {
+            auto branch = std::move(arguments[ExpressionFunctions::IsTrue(arguments[0]->value) ? 1 : 2]);
+            Replace(node, std::move(branch));
+            return;
+        }
+
+        // exec2() and exec3() are just statement lists, which can then be flattened.
+        if ((name == "exec2" && arguments.size() == 2) || (name == "exec3" && arguments.size() == 3))
+        {
+            node->type = Type::Sequence;
+            node->name.clear();
+            m_changed = true;
+        }
+    }
+
+    void OptimizeSequence(ExpressionNode& sequence)
+    {
+        for (auto& statement : sequence.arguments)
+        {
+            Optimize(statement);
+        }
+
+        // Flatten nested lists.
+        std::vector<ExpressionNode::Ptr> statements;
+        for (auto& statement : sequence.arguments)
+        {
+            if (statement->type == Type::Sequence && !statement->arguments.empty())
+            {
+                for (auto& nestedStatement : statement->arguments)
+                {
+                    statements.push_back(std::move(nestedStatement));
+                }
+                m_changed = true;
+            }
+            else
+            {
+                statements.push_back(std::move(statement));
+            }
+        }
+
+        // The last statement provides the value of the list, all others only matter for their side effects.
+        for (size_t index = 0; index + 1 < statements.size();)
+        {
+            if (!HasSideEffects(*statements[index]))
+            {
+                statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(index));
+                m_changed = true;
+            }
+            else if (IsDeadStore(statements, index))
+            {
+                auto value = std::move(statements[index]->arguments[1]);
+                if (HasSideEffects(*value))
+                {
+                    statements[index] = std::move(value);
+                    index++;
+                }
+                else
+                {
+                    statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(index));
+                }
+                m_changed = true;
+            }
+            else
+            {
+                index++;
+            }
+        }
+
+        sequence.arguments = std::move(statements);
+    }
+
+    /**
+     * @brief Returns whether a statement is a plain assignment overwritten by a later statement
+     *        before the variable is used in any way.
+     */
+    static auto IsDeadStore(const std::vector<ExpressionNode::Ptr>& statements, size_t index) -> bool
+    {
+        auto const& store = *statements[index];
+        if (store.type != Type::Assignment || store.name != "=" || store.arguments[0]->type != Type::Variable)
+        {
+            return false;
+        }
+
+        auto const& variable = store.arguments[0]->name;
+        for (size_t later = index + 1; later < statements.size(); later++)
+        {
+            auto const& statement = *statements[later];
+            if (statement.type == Type::Assignment && statement.name == "=" &&
+                statement.arguments[0]->type == Type::Variable && statement.arguments[0]->name == variable)
+            {
+                return !References(*statement.arguments[1], variable);
+            }
+
+            if (References(statement, variable))
+            {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    bool m_changed{}; //!< True if the current pass modified the tree.
+};
+
+} // namespace
+
+auto OptimizeExpressionTree(ExpressionNode& root) -> bool
+{
+    Optimizer optimizer;
+    return optimizer.Run(root);
+}
+
+auto OptimizeCode(const std::string& code) -> OptimizedCode
+{
+    OptimizedCode result;
+    result.code = code;
+
+    auto const tree = ParseExpressionTree(code);
+    bool usesAnd{};
+    bool usesOr{};
+    if (!tree || HasAmbiguousGrouping(*tree) || UsesUncheckedOperators(*tree, usesAnd, usesOr))
+    {
+        return result;
+    }
+
+    result.nodesBefore = CountExpressionNodes(*tree);
+    if (!OptimizeExpressionTree(*tree))
+    {
+        return result;
+    }
+    result.nodesAfter = CountExpressionNodes(*tree);
+
+    result.code = PrintExpressionTree(*tree);
+    result.optimized = true;
+    return result;
+}
+
+auto CompileCode(projectm_eval_context* context, const std::string& code, std::string& compiledCode) -> projectm_eval_code*
+{
+#ifdef MILKDROP_EXPRESSION_OPTIMIZER
+    auto const optimizedCode = OptimizeCode(code);
+    if (optimizedCode.optimized)
+    {
+        auto* handle = projectm_eval_code_compile(context, optimizedCode.code.c_str());
+        if (handle != nullptr)
+        {
+#ifdef MILKDROP_PRESET_DEBUG
+            std::cerr << "[Preset] Code optimized from " << optimizedCode.nodesBefore
+                      << " to " << optimizedCode.nodesAfter << " expression nodes" << std::endl;
+#endif
+            compiledCode = optimizedCode.code;
+            return handle;
+        }
+
+#ifdef MILKDROP_PRESET_DEBUG
+        std::cerr << "[Preset] Optimized code failed to compile, using the original code" << std::endl;
+#endif
+    }
+#endif
+
+    compiledCode = code;
+    return projectm_eval_code_compile(context, code.c_str());
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
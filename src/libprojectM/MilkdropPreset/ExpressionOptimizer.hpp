@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ExpressionTree.hpp"
+
+#include <projectm-eval.h>
+
+#include <cstddef>
+#include <string>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Result of optimizing expression code.
+ */
+struct OptimizedCode
+{
+    std::string code;     //!< The optimized code, or the original code if nothing could be optimized.
+    bool optimized{};     //!< True if the optimizer changed the code.
+    size_t nodesBefore{}; //!< Number of expression tree nodes before optimizing.
+    size_t nodesAfter{};  //!< Number of expression tree nodes after optimizing.
+};
+
+/**
+ * @brief Simplifies an expression tree without changing its results.
+ *
+ * Applies these transformations until nothing changes anymore:
+ * - Operators and pure functions with constant arguments are replaced by their result.
+ * - if(), ternaries, logic operators and loops with constant conditions are reduced to the
+ *   branch actually taken.
+ * - Nested statement lists are flattened and statements without side effects are removed,
+ *   unless they provide the value of the list.
+ * - Assignments to variables which are overwritten before being read are removed, keeping
+ *   any side effects of the assigned value.
+ *
+ * Results which aren't finite are never folded, as they can't be written back as code.
+ *
+ * @param root The root node, as returned by ParseExpressionTree().
+ * @return True if the tree was changed.
+ */
+auto OptimizeExpressionTree(ExpressionNode& root) -> bool;
+
+/**
+ * @brief Parses, optimizes and prints expression code.
+ *
+ * The original code is returned unchanged if it can't be parsed, if nothing could be optimized,
+ * or if it uses operators whose grouping hasn't been verified against projectm-eval yet, which
+ * are %, <<, >>, |, &, ~ and && mixed with ||.
+ *
+ * @param code The expression code, as stored in the preset.
+ * @return The optimized code and node count statistics.
+ */
+auto OptimizeCode(const std::string& code) -> OptimizedCode;
+
+/**
+ * @brief Compiles expression code, optimizing it first if the optimizer is enabled.
+ *
+ * The optimizer is only used if the library was built with ENABLE_EXPRESSION_OPTIMIZER. If the
+ * optimized code fails to compile, the original code is compiled instead.
+ *
+ * @param context The projectm-eval context to compile the code in.
+ * @param code The expression code, as stored in the preset.
+ * @param[out] compiledCode Receives the code which was actually compiled.
+ * @return The compiled code handle, or nullptr if the original code failed to compile.
+ */
+auto CompileCode(projectm_eval_context* context, const std::string& code, std::string& compiledCode) -> projectm_eval_code*;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,650 @@
+#include "ExpressionTree.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <locale>
+#include <sstream>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr double E = 2.71828182845904523536;
+constexpr double Phi = 1.61803398874989484820;
+
+/**
+ * @brief A lexical token of the expression code.
+ */
+struct Token
+{
+    enum class Type
+    {
+        Number,     //!< A numeric constant, stored in value.
+        Identifier, //!< A variable or function name, stored in lower case.
+        Operator,   //!< An operator or punctuation character.
+        End         //!< End of the code.
+    };
+
+    Type type{Type::End};
+    double value{};
+    std::string text;
+};
+
+/**
+ * @brief Operators and punctuation, longest first so the tokenizer always matches the longest one.
+ */
+const char* const Operators[] = {
+    "===", "!==", "<<=", ">>=",
+    "==", "!=", "<=", ">=", "&&", "||", "<<", ">>",
+    "+=", "-=", "*=", "/=", "%=", "^=", "|=", "&=", "~=",
+    "+", "-", "*", "/", "%", "^", "|", "&", "~", "!", "<", ">", "=", "?", ":", "(", ")", ",", ";", "[", "]"};
+
+auto IsAssignmentOperator(const std::string& text) -> bool
+{
+    return text == "=" || (text.size() == 2 && text[1] == '=' && std::string("+-*/%^|&~").find(text[0]) != std::string::npos) ||
+           text == "<<=" || text == ">>=";
+}
+
+/**
+ * @brief Recursive descent parser for EEL2 expression code.
+ *
+ * Any syntax error sets m_failed, after which all parse functions return as quickly as possible.
+ */
+class Parser
+{
+public:
+    explicit Parser(const std::string& code)
+        : m_code(code)
+    {
+        Advance();
+    }
+
+    auto Parse() -> ExpressionNode::Ptr
+    {
+        auto root = ParseSequence(true);
+        if (m_failed || m_token.type != Token::Type::End)
+        {
+            return {};
+        }
+        return root;
+    }
+
+private:
+    static auto MakeNode(ExpressionNode::Type type, std::string name) -> ExpressionNode::Ptr
+    {
+        auto node = std::make_unique<ExpressionNode>();
+        node->type = type;
+        node->name = std::move(name);
+        return node;
+    }
+
+    static auto MakeConstant(double value) -> ExpressionNode::Ptr
+    {
+        auto node = MakeNode(ExpressionNode::Type::Constant, {});
+        node->value = value;
+        return node;
+    }
+
+    auto IsOperator(const char* text) const -> bool
+    {
+        return m_token.type == Token::Type::Operator && m_token.text == text;
+    }
+
+    void Fail()
+    {
+        m_failed = true;
+        m_token.type = Token::Type::End;
+    }
+
+    void Expect(const char* text)
+    {
+        if (!IsOperator(text))
+        {
+            Fail();
+            return;
+        }
+        Advance();
+    }
+
+    /**
+     * @brief Reads the next token from the code into m_token.
+     */
+    void Advance()
+    {
+        if (m_failed)
+        {
+            return;
+        }
+
+        SkipWhitespaceAndComments();
+
+        m_token = {};
+        if (m_pos >= m_code.size())
+        {
+            return;
+        }
+
+        char const character = m_code[m_pos];
+        if (std::isdigit(static_cast<unsigned char>(character)) != 0 ||
+            (character == '.' && m_pos + 1 < m_code.size() && std::isdigit(static_cast<unsigned char>(m_code[m_pos + 1])) != 0))
+        {
+            ReadNumber();
+        }
+        else if (character == '$')
+        {
+            ReadNamedConstant();
+        }
+        else if (std::isalpha(static_cast<unsigned char>(character)) != 0 || character == '_')
+        {
+            m_token.type = Token::Type::Identifier;
+            while (m_pos < m_code.size() &&
+                   (std::isalnum(static_cast<unsigned char>(m_code[m_pos])) != 0 || m_code[m_pos] == '_' || m_code[m_pos] == '.'))
+            {
+                m_token.text.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(m_code[m_pos]))));
+                m_pos++;
+            }
+        }
+        else
+        {
+            for (const auto* op : Operators)
+            {
+                if (m_code.compare(m_pos, std::char_traits<char>::length(op), op) == 0)
+                {
+                    m_token.type = Token::Type::Operator;
+                    m_token.text = op;
+                    m_pos += m_token.text.size();
+                    return;
+                }
+            }
+            Fail();
+        }
+    }
+
+    void SkipWhitespaceAndComments()
+    {
+        while (m_pos < m_code.size())
+        {
+            if (std::isspace(static_cast<unsigned char>(m_code[m_pos])) != 0)
+            {
+                m_pos++;
+            }
+            else if (m_code.compare(m_pos, 2, "//") == 0)
+            {
+                m_pos = std::min(m_code.find('\n', m_pos), m_code.size());
+            }
+            else if (m_code.compare(m_pos, 2, "/*") == 0)
+            {
+                auto const end = m_code.find("*/", m_pos + 2);
+                m_pos = end == std::string::npos ? m_code.size() : end + 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    void ReadNumber()
+    {
+        size_t const start = m_pos;
+        while (m_pos < m_code.size() &&
+               (std::isdigit(static_cast<unsigned char>(m_code[m_pos])) != 0 || m_code[m_pos] == '.'))
+        {
+            m_pos++;
+        }
+
+        // Always parse with a dot as the decimal separator, regardless of the global locale.
+        std::istringstream stream(m_code.substr(start, m_pos - start));
+        stream.imbue(std::locale::classic());
+        stream >> m_token.value;
+        if (stream.fail() || stream.peek() != std::char_traits<char>::eof())
+        {
+            Fail();
+            return;
+        }
+        m_token.type = Token::Type::Number;
+    }
+
+    void ReadNamedConstant()
+    {
+        size_t const start = ++m_pos;
+        while (m_pos < m_code.size() && std::isalnum(static_cast<unsigned char>(m_code[m_pos])) != 0)
+        {
+            m_pos++;
+        }
+
+        std::string name;
+        for (size_t index = start; index < m_pos; index++)
+        {
+            name.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(m_code[index]))));
+        }
+
+        m_token.type = Token::Type::Number;
+        if (name == "pi")
+        {
+            m_token.value = Pi;
+        }
+        else if (name == "e")
+        {
+            m_token.value = E;
+        }
+        else if (name == "phi")
+        {
+            m_token.value = Phi;
+        }
+        else if (name.size() > 1 && name.size() <= 17 && name[0] == 'x' && name.find_first_not_of("0123456789abcdef", 1) == std::string::npos)
+        {
+            m_token.value = static_cast<double>(std::stoull(name.substr(1), nullptr, 16));
+        }
+        else
+        {
+            Fail();
+        }
+    }
+
+    /**
+     * @brief Parses statements separated by semicolons.
+     * @param topLevel If true, the result is always a sequence node.
+     * @return The sequence, or the single statement if not on the top level.
+     */
+    auto ParseSequence(bool topLevel) -> ExpressionNode::Ptr
+    {
+        auto sequence = MakeNode(ExpressionNode::Type::Sequence, {});
+
+        while (!m_failed && m_token.type != Token::Type::End && !IsOperator(")") && !IsOperator(","))
+        {
+            if (IsOperator(";"))
+            {
+                Advance();
+                continue;
+            }
+
+            sequence->arguments.push_back(ParseAssignment());
+
+            if (!IsOperator(";"))
+            {
+                break;
+            }
+        }
+
+        if (!topLevel && sequence->arguments.size() == 1)
+        {
+            return std::move(sequence->arguments[0]);
+        }
+        if (!topLevel && sequence->arguments.empty())
+        {
+            return MakeConstant(0.0);
+        }
+        return sequence;
+    }
+
+    auto ParseAssignment() -> ExpressionNode::Ptr
+    {
+        auto target = ParseTernary();
+
+        if (m_token.type == Token::Type::Operator && IsAssignmentOperator(m_token.text))
+        {
+            if (target->type != ExpressionNode::Type::Variable && target->type != ExpressionNode::Type::Function)
+            {
+                Fail();
+                return target;
+            }
+
+            auto assignment = MakeNode(ExpressionNode::Type::Assignment, m_token.text);
+            Advance();
+            assignment->arguments.push_back(std::move(target));
+            assignment->arguments.push_back(ParseAssignment());
+            return assignment;
+        }
+
+        return target;
+    }
+
+    auto ParseTernary() -> ExpressionNode::Ptr
+    {
+        auto condition = ParseBinary(0);
+        if (!IsOperator("?"))
+        {
+            return condition;
+        }
+        Advance();
+
+        // "a ? b : c" is the same as "if(a, b, c)", a missing else branch evaluates to 0.
+        auto node = MakeNode(ExpressionNode::Type::Function, "if");
+        node->arguments.push_back(std::move(condition));
+        node->arguments.push_back(ParseAssignment());
+        if (IsOperator(":"))
+        {
+            Advance();
+            node->arguments.push_back(ParseAssignment());
+        }
+        else
+        {
+            node->arguments.push_back(MakeConstant(0.0));
+        }
+        return node;
+    }
+
+    /**
+     * @brief Parses left-associative binary operators, from lowest (0) to highest precedence.
+     *
+     * The levels follow the EEL2 operator precedence: && and || share one level, and % and the
+     * shift operators bind tighter than multiplication and division.
+     *
+     * @param level The precedence level to parse.
+     * @return The parsed expression.
+     */
+    auto ParseBinary(size_t level) -> ExpressionNode::Ptr
+    {
+        static const std::vector<std::vector<std::string>> levels{
+            {"||", "&&"},
+            {"==", "!=", "===", "!==", "<", ">", "<=", ">="},
+            {"|", "&", "~"},
+            {"+", "-"},
+            {"*", "/"},
+            {"<<", ">>"},
+            {"%"}};
+
+        if (level >= levels.size())
+        {
+            return ParseUnary();
+        }
+
+        auto left = ParseBinary(level + 1);
+        while (!m_failed && m_token.type == Token::Type::Operator)
+        {
+            const auto& operators = levels[level];
+            if (std::find(operators.begin(), operators.end(), m_token.text) == operators.end())
+            {
+                break;
+            }
+
+            auto node = MakeNode(ExpressionNode::Type::Operator, m_token.text);
+            Advance();
+            node->arguments.push_back(std::move(left));
+            node->arguments.push_back(ParseBinary(level + 1));
+            left = std::move(node);
+        }
+        return left;
+    }
+
+    auto ParseUnary() -> ExpressionNode::Ptr
+    {
+        if (IsOperator("-") || IsOperator("+") || IsOperator("!"))
+        {
+            auto node = MakeNode(ExpressionNode::Type::Operator, m_token.text);
+            Advance();
+            node->arguments.push_back(ParseUnary());
+            return node;
+        }
+        return ParsePower();
+    }
+
+    /**
+     * @brief Parses the power operator, which binds tighter than unary operators: "-a ^ b" is "-(a ^ b)".
+     * @return The parsed expression.
+     */
+    auto ParsePower() -> ExpressionNode::Ptr
+    {
+        auto base = ParsePrimary();
+        if (!IsOperator("^"))
+        {
+            return base;
+        }
+        Advance();
+
+        auto node = MakeNode(ExpressionNode::Type::Operator, "^");
+        node->arguments.push_back(std::move(base));
+        node->arguments.push_back(ParseUnary());
+        return node;
+    }
+
+    auto ParsePrimary() -> ExpressionNode::Ptr
+    {
+        if (m_token.type == Token::Type::Number)
+        {
+            auto node = MakeConstant(m_token.value);
+            Advance();
+            return node;
+        }
+
+        if (m_token.type == Token::Type::Identifier)
+        {
+            auto name = m_token.text;
+            Advance();
+
+            if (!IsOperator("("))
+            {
+                return MakeNode(ExpressionNode::Type::Variable, std::move(name));
+            }
+            Advance();
+
+            auto node = MakeNode(ExpressionNode::Type::Function, std::move(name));
+            if (!IsOperator(")"))
+            {
+                node->arguments.push_back(ParseSequence(false));
+                while (IsOperator(","))
+                {
+                    Advance();
+                    node->arguments.push_back(ParseSequence(false));
+                }
+            }
+            Expect(")");
+            return node;
+        }
+
+        if (IsOperator("("))
+        {
+            Advance();
+            auto node = ParseSequence(false);
+            Expect(")");
+            node->parenthesized = true;
+            return node;
+        }
+
+        Fail();
+        return MakeConstant(0.0);
+    }
+
+    const std::string& m_code; //!< The code being parsed.
+    size_t m_pos{};            //!< Position of the next token in m_code.
+    Token m_token;             //!< The current token.
+    bool m_failed{};           //!< True if a syntax error occurred.
+};
+
+/**
+ * @brief Prints a non-negative value in fixed notation with the given number of significant digits.
+ */
+auto PrintDecimal(double magnitude, int significantDigits) -> std::string
+{
+    std::ostringstream stream;
+    stream.imbue(std::locale::classic());
+    stream.setf(std::ios::fixed);
+    auto const integerDigits = magnitude >= 1.0 ? static_cast<int>(std::floor(std::log10(magnitude))) + 1 : 0;
+    auto const leadingZeros = magnitude > 0.0 && magnitude < 1.0 ? static_cast<int>(-std::floor(std::log10(magnitude))) - 1 : 0;
+    stream.precision(std::max(0, significantDigits - integerDigits) + leadingZeros);
+    stream << magnitude;
+
+    auto result = stream.str();
+    if (result.find('.') != std::string::npos)
+    {
+        result.erase(result.find_last_not_of('0') + 1);
+        if (result.back() == '.')
+        {
+            result.pop_back();
+        }
+    }
+
+    return result;
+}
+
+auto PrintConstant(double value) -> std::string
+{
+    // The expression syntax has no exponent notation. Use the shortest decimal which reads back
+    // as the same value, 17 significant digits are always enough.
+    auto const magnitude = std::fabs(value);
+    std::string result;
+    for (int significantDigits = 15; significantDigits <= 17; significantDigits++)
+    {
+        result = PrintDecimal(magnitude, significantDigits);
+
+        std::istringstream stream(result);
+        stream.imbue(std::locale::classic());
+        double parsedValue{};
+        stream >> parsedValue;
+        if (parsedValue == magnitude)
+        {
+            break;
+        }
+    }
+
+    return std::signbit(value) ? "(-" + result + ")" : result;
+}
+
+auto PrintNode(const ExpressionNode& node, bool statement) -> std::string
+{
+    switch (node.type)
+    {
+        case ExpressionNode::Type::Constant:
+            return PrintConstant(node.value);
+
+        case ExpressionNode::Type::Variable:
+            return node.name;
+
+        case ExpressionNode::Type::Function: {
+            std::string result = node.name + "(";
+            for (size_t argument = 0; argument < node.arguments.size(); argument++)
+            {
+                result.append(argument > 0 ? ", " : "");
+                result.append(PrintNode(*node.arguments[argument], false));
+            }
+            return result + ")";
+        }
+
+        case ExpressionNode::Type::Operator:
+            if (node.arguments.size() == 1)
+            {
+                return "(" + node.name + PrintNode(*node.arguments[0], false) + ")";
+            }
+            return "(" + PrintNode(*node.arguments[0], false) + " " + node.name + " " + PrintNode(*node.arguments[1], false) + ")";
+
+        case ExpressionNode::Type::Assignment: {
+            auto result = PrintNode(*node.arguments[0], false) + " " + node.name + " " + PrintNode(*node.arguments[1], false);
+            return statement ? result : "(" + result + ")";
+        }
+
+        case ExpressionNode::Type::Sequence: {
+            if (node.arguments.empty())
+            {
+                return "0";
+            }
+            std::string result;
+            for (const auto& child : node.arguments)
+            {
+                result.append(result.empty() ? "" : "; ");
+                result.append(PrintNode(*child, true));
+            }
+            return "(" + result + ")";
+        }
+    }
+
+    return {};
+}
+
+/**
+ * @brief Returns whether an operator and its unparenthesized operator operand could be grouped differently.
+ */
+auto IsAmbiguousPair(const ExpressionNode& parent, const ExpressionNode& operand) -> bool
+{
+    if (operand.type != ExpressionNode::Type::Operator || operand.parenthesized)
+    {
+        return false;
+    }
+
+    if (parent.arguments.size() == 1)
+    {
+        return operand.name == "^";
+    }
+    if (operand.arguments.size() == 1)
+    {
+        return false;
+    }
+
+    if (parent.name == "^" && operand.name == "^")
+    {
+        return true;
+    }
+    if ((parent.name == "&&" && operand.name == "||") || (parent.name == "||" && operand.name == "&&"))
+    {
+        return true;
+    }
+    return parent.name != operand.name && (IsUncheckedOperator(parent.name) || IsUncheckedOperator(operand.name));
+}
+
+void CountNodes(const ExpressionNode& node, size_t& count)
+{
+    count++;
+    for (const auto& child : node.arguments)
+    {
+        CountNodes(*child, count);
+    }
+}
+
+} // namespace
+
+auto ParseExpressionTree(const std::string& code) -> ExpressionNode::Ptr
+{
+    return Parser(code).Parse();
+}
+
+auto PrintExpressionTree(const ExpressionNode& root) -> std::string
+{
+    std::string code;
+    for (const auto& statement : root.arguments)
+    {
+        code.append(PrintNode(*statement, true) + ";\n");
+    }
+    return code;
+}
+
+auto IsUncheckedOperator(const std::string& name) -> bool
+{
+    return name == "%" || name == "<<" || name == ">>" || name == "|" || name == "&" || name == "~";
+}
+
+auto HasAmbiguousGrouping(const ExpressionNode& node) -> bool
+{
+    if (node.type == ExpressionNode::Type::Operator)
+    {
+        for (const auto& operand : node.arguments)
+        {
+            if (IsAmbiguousPair(node, *operand))
+            {
+                return true;
+            }
+        }
+    }
+
+    for (const auto& argument : node.arguments)
+    {
+        if (HasAmbiguousGrouping(*argument))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto CountExpressionNodes(const ExpressionNode& node) -> size_t
+{
+    size_t count{};
+    CountNodes(node, count);
+    return count;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief A node of a parsed Milkdrop expression.
+ *
+ * The actual evaluation is done by projectm-eval. This tree is only used to analyze and transform
+ * expression code in libprojectM, e.g. to translate it into other languages.
+ */
+struct ExpressionNode
+{
+    enum class Type
+    {
+        Constant,   //!< A numeric constant, stored in value.
+        Variable,   //!< A variable. name holds the lower-case variable name.
+        Function,   //!< A function call. name holds the lower-case function name, arguments the parameters.
+        Operator,   //!< A unary or binary operator. name holds the operator, arguments the operands.
+        Assignment, //!< An assignment. name holds the operator, e.g. "=" or "+=", arguments the target and value.
+        Sequence    //!< A list of statements. The value of the last statement is the result.
+    };
+
+    using Ptr = std::unique_ptr<ExpressionNode>;
+
+    Type type{Type::Constant};
+    double value{};               //!< Value of a constant.
+    std::string name;             //!< Variable, function or operator name.
+    std::vector<Ptr> arguments;   //!< Operands, function parameters or statements.
+    bool parenthesized{};         //!< True if the node was enclosed in parentheses in the parsed code.
+};
+
+/**
+ * @brief Parses Milkdrop expression code into a tree.
+ *
+ * Supports the EEL2 operators, function calls, ternaries, numbers and the $pi, $e, $phi and $x
+ * (hexadecimal) constants. Code using other syntax, e.g. character constants, isn't parsed.
+ *
+ * Operators are grouped by EEL2 precedence, from highest to lowest: ^, unary -/+/!, %, << and >>,
+ * * and /, + and -, | & and ~, comparisons, && and || (same level), the ternary and assignments.
+ *
+ * @param code The expression code, as stored in the preset.
+ * @return The root node, always a sequence, or nullptr if the code couldn't be parsed.
+ */
+auto ParseExpressionTree(const std::string& code) -> ExpressionNode::Ptr;
+
+/**
+ * @brief Converts a tree back into expression code.
+ *
+ * All operations are parenthesized and constants are printed with full precision, so parsing
+ * the result yields the same tree. Comments and formatting of the original code are lost.
+ *
+ * @param root The root node, as returned by ParseExpressionTree().
+ * @return The expression code, one line per top-level statement.
+ */
+auto PrintExpressionTree(const ExpressionNode& root) -> std::string;
+
+/**
+ * @brief Returns whether projectm-eval's grammar wasn't verified to group the operator like the parser.
+ *
+ * These are %, <<, >>, |, & and ~. HasAmbiguousGrouping() and the expression optimizer both use
+ * this list, so it only needs to be updated here once the grouping has been verified.
+ *
+ * @param name The operator.
+ * @return True if the operator's precedence hasn't been verified.
+ */
+auto IsUncheckedOperator(const std::string& name) -> bool;
+
+/**
+ * @brief Returns whether the tree contains operators whose grouping might differ from projectm-eval's.
+ *
+ * The parser follows the EEL2 precedence, but it hasn't been verified against projectm-eval for all
+ * operators. Code relying on precedence, i.e. without parentheses, in these cases is reported:
+ * - %, <<, >>, |, & or ~ combined with a different binary operator
+ * - && combined with ||
+ * - chained ^ operators, or a unary operator applied to ^
+ *
+ * Code using the tree to compute values, instead of passing the original code to projectm-eval,
+ * must not use trees for which this function returns true.
+ *
+ * @param node The root node of the tree.
+ * @return True if the grouping of at least one operator is ambiguous.
+ */
+auto HasAmbiguousGrouping(const ExpressionNode& node) -> bool;
+
+/**
+ * @brief Counts the nodes of a tree.
+ * @param node The root node of the tree.
+ * @return The number of nodes, including the root.
+ */
+auto CountExpressionNodes(const ExpressionNode& node) -> size_t;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
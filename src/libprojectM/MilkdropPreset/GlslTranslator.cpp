@@ -0,0 +1,339 @@
+#include "GlslTranslator.hpp"
+
+#include "ExpressionTree.hpp"
+
+#include <cmath>
+#include <locale>
+#include <map>
+#include <sstream>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+/**
+ * @brief GLSL templates for the supported functions, with $1 to $3 as argument placeholders.
+ */
+const std::map<std::string, std::pair<size_t, std::string>> Functions{
+    {"sin", {1, "sin($1)"}},
+    {"cos", {1, "cos($1)"}},
+    {"tan", {1, "tan($1)"}},
+    {"asin", {1, "asin($1)"}},
+    {"acos", {1, "acos($1)"}},
+    {"atan", {1, "atan($1)"}},
+    {"atan2", {2, "atan($1, $2)"}},
+    {"sqrt", {1, "sqrt(abs($1))"}},
+    {"invsqrt", {1, "inversesqrt(abs($1))"}},
+    {"sqr", {1, "expr_sqr($1)"}},
+    {"pow", {2, "expr_pow($1, $2)"}},
+    {"exp", {1, "exp($1)"}},
+    {"log", {1, "log($1)"}},
+    {"log10", {1, "expr_log10($1)"}},
+    {"abs", {1, "abs($1)"}},
+    {"sign", {1, "sign($1)"}},
+    {"floor", {1, "floor($1)"}},
+    {"ceil", {1, "ceil($1)"}},
+    {"min", {2, "min($1, $2)"}},
+    {"max", {2, "max($1, $2)"}},
+    {"sigmoid", {2, "expr_sigmoid($1, $2)"}},
+    {"above", {2, "float($1 > $2)"}},
+    {"below", {2, "float($1 < $2)"}},
+    {"equal", {2, "expr_equal($1, $2)"}},
+    {"bnot", {1, "float(!expr_true($1))"}},
+    {"band", {2, "float(expr_true($1) && expr_true($2))"}},
+    {"bor", {2, "float(expr_true($1) || expr_true($2))"}},
+    {"if", {3, "(expr_true($1) ? $2 : $3)"}},
+    {"exec2", {2, "($1, $2)"}},
+    {"exec3", {3, "($1, $2, $3)"}}};
+
+/**
+ * @brief GLSL templates for the supported operators, with $1 and $2 as operand placeholders.
+ */
+const std::map<std::string, std::string> BinaryOperators{
+    {"+", "($1 + $2)"},
+    {"-", "($1 - $2)"},
+    {"*", "($1 * $2)"},
+    {"/", "expr_div($1, $2)"},
+    {"^", "expr_pow($1, $2)"},
+    {"==", "expr_equal($1, $2)"},
+    {"!=", "(1.0 - expr_equal($1, $2))"},
+    {"===", "float($1 == $2)"},
+    {"!==", "float($1 != $2)"},
+    {"<", "float($1 < $2)"},
+    {">", "float($1 > $2)"},
+    {"<=", "float($1 <= $2)"},
+    {">=", "float($1 >= $2)"},
+    {"&&", "float(expr_true($1) && expr_true($2))"},
+    {"||", "float(expr_true($1) || expr_true($2))"}};
+
+/**
+ * @brief Translates an expression tree into a GLSL expression.
+ *
+ * The first unsupported construct sets the error message, after which the output is meaningless.
+ */
+class Translator
+{
+public:
+    auto Translate(const ExpressionNode& node) -> std::string
+    {
+        if (!error.empty())
+        {
+            return {};
+        }
+
+        switch (node.type)
+        {
+            case ExpressionNode::Type::Constant:
+                return TranslateConstant(node.value);
+
+            case ExpressionNode::Type::Variable:
+                if (node.name.find('.') != std::string::npos)
+                {
+                    error = "unsupported variable name \"" + node.name + "\"";
+                    return {};
+                }
+                variables.insert(node.name);
+                return GlslVariableName(node.name);
+
+            case ExpressionNode::Type::Function:
+                return TranslateFunction(node);
+
+            case ExpressionNode::Type::Operator:
+                return TranslateOperator(node);
+
+            case ExpressionNode::Type::Assignment:
+                return TranslateAssignment(node);
+
+            case ExpressionNode::Type::Sequence:
+                return TranslateSequence(node);
+        }
+
+        return {};
+    }
+
+    std::string error;               //!< Description of the first unsupported construct.
+    std::set<std::string> variables; //!< Referenced variables.
+
+private:
+    /**
+     * @brief Replaces $1, $2 and $3 in a template with the translated arguments.
+     */
+    auto Substitute(std::string result, const ExpressionNode& node) -> std::string
+    {
+        for (size_t argument = 0; argument < node.arguments.size(); argument++)
+        {
+            auto const placeholder = "$" + std::to_string(argument + 1);
+            auto const translated = Translate(*node.arguments[argument]);
+            auto position = result.find(placeholder);
+            while (position != std::string::npos)
+            {
+                result.replace(position, placeholder.size(), translated);
+                position = result.find(placeholder, position + translated.size());
+            }
+        }
+        return result;
+    }
+
+    auto TranslateConstant(double value) -> std::string
+    {
+        if (!std::isfinite(value))
+        {
+            error = "non-finite constant";
+            return {};
+        }
+
+        std::ostringstream stream;
+        stream.imbue(std::locale::classic());
+        stream.precision(9);
+        stream << value;
+
+        auto result = stream.str();
+        if (result.find_first_of(".e") == std::string::npos)
+        {
+            result.append(".0");
+        }
+        if (value < 0.0)
+        {
+            result = "(" + result + ")";
+        }
+        return result;
+    }
+
+    auto TranslateFunction(const ExpressionNode& node) -> std::string
+    {
+        auto const function = Functions.find(node.name);
+        if (function == Functions.end())
+        {
+            error = "unsupported function \"" + node.name + "\"";
+            return {};
+        }
+
+        if (function->second.first != node.arguments.size())
+        {
+            error = "wrong argument count for \"" + node.name + "\"";
+            return {};
+        }
+
+        return Substitute(function->second.second, node);
+    }
+
+    auto TranslateOperator(const ExpressionNode& node) -> std::string
+    {
+        if (node.arguments.size() == 1)
+        {
+            if (node.name == "-")
+            {
+                return Substitute("(-$1)", node);
+            }
+            if (node.name == "+")
+            {
+                return Translate(*node.arguments[0]);
+            }
+            if (node.name == "!")
+            {
+                return Substitute("float(!expr_true($1))", node);
+            }
+        }
+        else
+        {
+            auto const binaryOperator = BinaryOperators.find(node.name);
+            if (binaryOperator != BinaryOperators.end())
+            {
+                return Substitute(binaryOperator->second, node);
+            }
+        }
+
+        error = "unsupported operator \"" + node.name + "\"";
+        return {};
+    }
+
+    auto TranslateAssignment(const ExpressionNode& node) -> std::string
+    {
+        if (node.arguments[0]->type != ExpressionNode::Type::Variable)
+        {
+            error = "assignment to \"" + node.arguments[0]->name + "\"";
+            return {};
+        }
+
+        if (node.name == "=" || node.name == "+=" || node.name == "-=" || node.name == "*=")
+        {
+            return Substitute("($1 " + node.name + " $2)", node);
+        }
+        if (node.name == "/=")
+        {
+            return Substitute("($1 = expr_div($1, $2))", node);
+        }
+
+        error = "unsupported operator \"" + node.name + "\"";
+        return {};
+    }
+
+    auto TranslateSequence(const ExpressionNode& node) -> std::string
+    {
+        if (node.arguments.empty())
+        {
+            return "0.0";
+        }
+
+        // GLSL's comma operator has the same semantics as the expression statement separator.
+        std::string result = "(";
+        for (const auto& statement : node.arguments)
+        {
+            if (result.size() > 1)
+            {
+                result.append(", ");
+            }
+            result.append(Translate(*statement));
+        }
+        result.append(")");
+        return result;
+    }
+};
+
+} // namespace
+
+auto TranslateToGlsl(const std::string& code) -> GlslTranslation
+{
+    GlslTranslation translation;
+
+    auto const tree = ParseExpressionTree(code);
+    if (!tree)
+    {
+        translation.error = "unsupported syntax";
+        return translation;
+    }
+
+    if (HasAmbiguousGrouping(*tree))
+    {
+        translation.error = "ambiguous operator grouping";
+        return translation;
+    }
+
+    Translator translator;
+    for (const auto& statement : tree->arguments)
+    {
+        translation.code.append("    " + translator.Translate(*statement) + ";\n");
+    }
+
+    if (!translator.error.empty())
+    {
+        translation.error = translator.error;
+        translation.code.clear();
+        return translation;
+    }
+
+    translation.translated = true;
+    translation.variables = std::move(translator.variables);
+    return translation;
+}
+
+auto GlslVariableName(const std::string& name) -> std::string
+{
+    return "expr_var_" + name;
+}
+
+auto GlslHelperFunctions() -> const std::string&
+{
+    // Milkdrop considers values within 0.00001 of each other equal, which also applies to boolean tests.
+    static const std::string helperFunctions = R"(
+bool expr_true(float value) {
+    return abs(value) > 0.00001;
+}
+
+float expr_equal(float a, float b) {
+    return abs(a - b) < 0.00001 ? 1.0 : 0.0;
+}
+
+float expr_div(float a, float b) {
+    return b == 0.0 ? 0.0 : a / b;
+}
+
+float expr_pow(float base, float exponent) {
+    // GLSL's pow() is undefined for negative bases, C's pow() handles integer exponents.
+    if (base >= 0.0 || exponent != floor(exponent)) {
+        return pow(base, exponent);
+    }
+    float result = pow(-base, exponent);
+    return mod(exponent, 2.0) == 0.0 ? result : -result;
+}
+
+float expr_sqr(float value) {
+    return value * value;
+}
+
+float expr_log10(float value) {
+    return log(value) * 0.434294482;
+}
+
+float expr_sigmoid(float value, float constraint) {
+    float t = 1.0 + exp(-value * constraint);
+    return abs(t) > 0.00001 ? 1.0 / t : 0.0;
+}
+)";
+
+    return helperFunctions;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
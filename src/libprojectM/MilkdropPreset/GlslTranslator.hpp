@@ -0,0 +1,55 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Result of translating Milkdrop expression code into GLSL.
+ */
+struct GlslTranslation
+{
+    bool translated{};               //!< True if the code was translated successfully.
+    std::string error;               //!< If not translated, a short description of the reason.
+    std::string code;                //!< GLSL statements, one indented line per top-level statement.
+    std::set<std::string> variables; //!< Lower-case names of all variables referenced by the code.
+};
+
+/**
+ * @brief Translates expression code into GLSL statements.
+ *
+ * Only code using arithmetic, comparison and logic operators, assignments to plain variables and
+ * pure math functions can be translated. Memory buffers, loops, rand() and any other function with
+ * side effects or state aren't supported. Code whose operator grouping might differ from
+ * projectm-eval's, as reported by HasAmbiguousGrouping(), isn't translated either.
+ *
+ * Each expression variable maps to a float variable named by GlslVariableName(), which the caller
+ * has to declare and initialize before the statements. The statements also use the functions
+ * returned by GlslHelperFunctions().
+ *
+ * @param code The expression code, as stored in the preset.
+ * @return The translation result.
+ */
+auto TranslateToGlsl(const std::string& code) -> GlslTranslation;
+
+/**
+ * @brief Returns the name of the GLSL variable holding an expression variable.
+ * @param name The lower-case expression variable name.
+ * @return The GLSL variable name.
+ */
+auto GlslVariableName(const std::string& name) -> std::string;
+
+/**
+ * @brief Returns the definitions of helper functions used by the translated code.
+ *
+ * The helpers implement the Milkdrop semantics where they differ from plain GLSL, e.g. division
+ * by zero returning zero.
+ *
+ * @return GLSL function definitions, to be inserted on the global scope of the shader.
+ */
+auto GlslHelperFunctions() -> const std::string&;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Storage type of the variables accessed by JIT-compiled code.
+ */
+enum class JitPrecision : int
+{
+    Double, //!< Variables are PRJM_EVAL_F values, shared with projectm-eval.
+    Single  //!< Variables and calculations are floats, only function calls use doubles.
+};
+
+/**
+ * @brief Sets the precision used for per-pixel and per-point code compiled from now on.
+ *
+ * Per-frame and init code always use double precision, as presets often accumulate values
+ * like time over many frames. Only JIT-compiled code is affected, the interpreter always uses
+ * double precision.
+ *
+ * @param precision The variable precision.
+ */
+void SetVertexCodePrecision(JitPrecision precision);
+
+/**
+ * @brief Returns the precision used for per-pixel and per-point code.
+ * @return The variable precision, double by default.
+ */
+auto VertexCodePrecision() -> JitPrecision;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
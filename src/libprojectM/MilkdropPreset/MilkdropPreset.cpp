@@ -24,6 +24,9 @@
 #include "Factory.hpp"
 #include "MilkdropPresetExceptions.hpp"
 #include "PresetFileParser.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
 
 #ifdef MILKDROP_PRESET_DEBUG
 #include <iostream>
@@ -38,6 +41,7 @@ MilkdropPreset::MilkdropPreset(const std::string& absoluteFilePath)
     , m_perPixelContext(m_state.globalMemory, &m_state.globalRegisters)
     , m_motionVectors(m_state)
     , m_waveform(m_state)
+    , m_workerPool(WorkerPool::Get())
     , m_darkenCenter(m_state)
     , m_border(m_state)
 {
@@ -49,6 +53,7 @@ MilkdropPreset::MilkdropPreset(std::istream& presetData)
     , m_perPixelContext(m_state.globalMemory, &m_state.globalRegisters)
     , m_motionVectors(m_state)
     , m_waveform(m_state)
+    , m_workerPool(WorkerPool::Get())
     , m_darkenCenter(m_state)
     , m_border(m_state)
 {
@@ -71,13 +76,15 @@ void MilkdropPreset::Initialize(const Renderer::RenderContext& renderContext)
         m_state.mainTexture = m_framebuffer.GetColorAttachmentTexture(1, 0);
     }
 
-    m_perPixelMesh.CompileWarpShader(m_state);
+    m_perPixelMesh.CompileWarpShader(m_state, m_perFrameContext, m_perPixelContext);
     m_finalComposite.CompileCompositeShader(m_state);
 }
 
 void MilkdropPreset::RenderFrame(const libprojectM::Audio::FrameAudioData& audioData, const Renderer::RenderContext& renderContext)
 {
-    m_state.audioData = audioData;
+    PROJECTM_PROFILE_FRAME(m_profiler);
+
+    m_state.audioData = &audioData;
     m_state.renderContext = renderContext;
 
     // Update framebuffer and u/v texture size if needed
@@ -130,9 +137,10 @@ void MilkdropPreset::RenderFrame(const libprojectM::Audio::FrameAudioData& audio
     {
         shape->Draw();
     }
+    EvaluateCustomWaveforms();
     for (auto& wave : m_customWaveforms)
     {
-        wave->Draw(m_perFrameContext);
+        wave->Draw();
     }
     m_waveform.Draw(m_perFrameContext);
 
@@ -183,10 +191,29 @@ void MilkdropPreset::DrawInitialImage(const std::shared_ptr<Renderer::Texture>&
     m_flipTexture.Draw(image, m_framebuffer, m_previousFrameBuffer);
 }
 
+auto MilkdropPreset::PerPixelEvaluation() const -> PerPixelEvaluationMode
+{
+    if (!m_perPixelContext.HasCode())
+    {
+        return PerPixelEvaluationMode::None;
+    }
+
+    return m_perPixelMesh.EvaluatesOnGpu() ? PerPixelEvaluationMode::Gpu : PerPixelEvaluationMode::Cpu;
+}
+
+#ifdef PROJECTM_STAGE_PROFILER
+auto MilkdropPreset::FrameStatistics() const -> FrameStats
+{
+    return m_profiler.Stats();
+}
+#endif
+
 void MilkdropPreset::PerFrameUpdate()
 {
+    PROJECTM_PROFILE_STAGE(PerFrameUpdate);
+
     m_perFrameContext.LoadStateVariables(m_state);
-    m_perPixelContext.LoadStateReadOnlyVariables(m_state, m_perFrameContext);
+    m_perPixelContext.LoadStateReadOnlyVariables(m_state);
 
     m_perFrameContext.ExecutePerFrameCode();
 
@@ -197,6 +224,39 @@ void MilkdropPreset::PerFrameUpdate()
     *m_perFrameContext.echo_zoom = std::max(0.001, std::min(1000.0, *m_perFrameContext.echo_zoom));
 }
 
+void MilkdropPreset::EvaluateCustomWaveforms()
+{
+    PROJECTM_PROFILE_STAGE(CustomWaveformEvaluate);
+
+    std::array<CustomWaveform*, CustomWaveformCount> enabledWaves{};
+    size_t enabledWaveCount{};
+    for (auto& wave : m_customWaveforms)
+    {
+        if (wave->Enabled())
+        {
+            enabledWaves[enabledWaveCount++] = wave.get();
+        }
+    }
+
+    // Waveform code using gmegabuf, regXX vars or other shared state must run in order on a single thread.
+    bool const multithreaded = enabledWaveCount > 1 &&
+                               std::all_of(enabledWaves.begin(), enabledWaves.begin() + enabledWaveCount,
+                                           [](const CustomWaveform* wave) { return wave->SupportsMultithreading(); });
+
+    if (!multithreaded)
+    {
+        for (size_t index = 0; index < enabledWaveCount; index++)
+        {
+            enabledWaves[index]->Evaluate(m_perFrameContext);
+        }
+        return;
+    }
+
+    m_workerPool->Run(enabledWaveCount, [&](size_t index) {
+        enabledWaves[index]->Evaluate(m_perFrameContext);
+    });
+}
+
 void MilkdropPreset::Load(const std::string& pathname)
 {
 #ifdef MILKDROP_PRESET_DEBUG
@@ -34,6 +34,7 @@
 #include "PerPixelContext.hpp"
 #include "PerPixelMesh.hpp"
 #include "Preset.hpp"
+#include "StageProfiler.hpp"
 #include "Waveform.hpp"
 
 #include <Renderer/CopyTexture.hpp>
@@ -49,6 +50,7 @@ namespace MilkdropPreset {
 
 class Factory;
 class PresetFileParser;
+class WorkerPool;
 
 class MilkdropPreset : public ::libprojectM::Preset
 {
@@ -86,6 +88,12 @@ public:
 
     void DrawInitialImage(const std::shared_ptr<Renderer::Texture>& image, const Renderer::RenderContext& renderContext) override;
 
+    auto PerPixelEvaluation() const -> PerPixelEvaluationMode override;
+
+#ifdef PROJECTM_STAGE_PROFILER
+    auto FrameStatistics() const -> FrameStats override;
+#endif
+
 private:
     void PerFrameUpdate();
 
@@ -97,6 +105,13 @@ private:
 
     void CompileCodeAndRunInitExpressions();
 
+    /**
+     * @brief Runs the code of all enabled custom waveforms and calculates their vertices.
+     *
+     * If none of the waveforms use shared state, they're evaluated in parallel on the worker pool.
+     */
+    void EvaluateCustomWaveforms();
+
     /**
      * @brief Compiles the warp and composite shaders.
      */
@@ -122,6 +137,7 @@ private:
     Waveform m_waveform;                                                                //!< Preset default waveform.
     std::array<std::unique_ptr<CustomWaveform>, CustomWaveformCount> m_customWaveforms; //!< Custom waveforms in this preset.
     std::array<std::unique_ptr<CustomShape>, CustomShapeCount> m_customShapes;          //!< Custom shapes in this preset.
+    std::shared_ptr<WorkerPool> m_workerPool;                                           //!< Threads evaluating the custom waveforms.
     DarkenCenter m_darkenCenter;                                                        //!< Center darkening effect.
     Border m_border;                                                                    //!< Inner/outer borders.
     Renderer::CopyTexture m_flipTexture;                                                //!< Texture flip filter
@@ -129,6 +145,10 @@ private:
     FinalComposite m_finalComposite; //!< Final composite shader or filters.
 
     bool m_isFirstFrame{true}; //!< Controls drawing the motion vectors starting with the second frame.
+
+#ifdef PROJECTM_STAGE_PROFILER
+    StageProfiler m_profiler; //!< CPU time spent in the render stages of this preset.
+#endif
 };
 
 } // namespace MilkdropPreset
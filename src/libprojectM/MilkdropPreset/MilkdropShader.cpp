@@ -2,6 +2,7 @@
 
 #include "PerFrameContext.hpp"
 #include "PresetState.hpp"
+#include "StageProfiler.hpp"
 
 #include <MilkdropStaticShaders.hpp>
 
@@ -56,6 +57,11 @@ void MilkdropShader::LoadCode(const std::string& presetShaderCode)
     PreprocessPresetShader(m_preprocessedCode);
 }
 
+void MilkdropShader::SetVertexShaderCode(const std::string& vertexShaderCode)
+{
+    m_vertexShaderCode = vertexShaderCode;
+}
+
 void MilkdropShader::LoadTexturesAndCompile(PresetState& presetState)
 {
     std::locale loc;
@@ -149,6 +155,8 @@ void MilkdropShader::LoadTexturesAndCompile(PresetState& presetState)
 
 void MilkdropShader::LoadVariables(const PresetState& presetState, const PerFrameContext& perFrameContext)
 {
+    PROJECTM_PROFILE_STAGE(ShaderLoadVariables);
+
     // These are the inputs: http://www.geisswerks.com/milkdrop/milkdrop_preset_authoring.html#3f6
 
     auto floatTime = static_cast<float>(presetState.renderContext.time);
@@ -186,14 +194,14 @@ void MilkdropShader::LoadVariables(const PresetState& presetState, const PerFram
                                       presetState.renderContext.fps,
                                       presetState.renderContext.frame,
                                       presetState.renderContext.progress});
-    m_shader.SetUniformFloat4("_c3", {presetState.audioData.bass / 100,
-                                      presetState.audioData.mid / 100,
-                                      presetState.audioData.treb / 100,
-                                      presetState.audioData.vol / 100});
-    m_shader.SetUniformFloat4("_c4", {presetState.audioData.bassAtt / 100,
-                                      presetState.audioData.midAtt / 100,
-                                      presetState.audioData.trebAtt / 100,
-                                      presetState.audioData.volAtt / 100});
+    m_shader.SetUniformFloat4("_c3", {presetState.audioData->bass / 100,
+                                      presetState.audioData->mid / 100,
+                                      presetState.audioData->treb / 100,
+                                      presetState.audioData->vol / 100});
+    m_shader.SetUniformFloat4("_c4", {presetState.audioData->bassAtt / 100,
+                                      presetState.audioData->midAtt / 100,
+                                      presetState.audioData->trebAtt / 100,
+                                      presetState.audioData->volAtt / 100});
     m_shader.SetUniformFloat4("_c5", {blurMax[0] - blurMin[0],
                                       blurMin[0],
                                       blurMax[1] - blurMin[1],
@@ -619,7 +627,11 @@ void MilkdropShader::TranspileHLSLShader(const PresetState& presetState, std::st
 
     // Now we have GLSL source for the preset shader program (hopefully it's valid!)
     // Compile the preset shader fragment shader with the standard vertex shader and cross our fingers.
-    if (m_type == ShaderType::WarpShader)
+    if (!m_vertexShaderCode.empty())
+    {
+        m_shader.CompileProgram(m_vertexShaderCode, generator.GetResult());
+    }
+    else if (m_type == ShaderType::WarpShader)
     {
         m_shader.CompileProgram(MilkdropStaticShaders::Get()->GetPresetWarpVertexShader(), generator.GetResult());
     }
@@ -46,6 +46,13 @@ public:
      */
     void LoadCode(const std::string& presetShaderCode);
 
+    /**
+     * @brief Sets the vertex shader to compile the program with, instead of the default one.
+     * Must be called before LoadTexturesAndCompile().
+     * @param vertexShaderCode The complete GLSL vertex shader source, or an empty string to use the default.
+     */
+    void SetVertexShaderCode(const std::string& vertexShaderCode);
+
     /**
      * @brief Loads the required texture references into the shader.
      * Binds the underlying shader program.
@@ -97,6 +104,7 @@ private:
     ShaderType m_type{ShaderType::WarpShader}; //!< Type of this shader.
     std::string m_fragmentShaderCode;          //!< The original preset fragment shader code.
     std::string m_preprocessedCode;            //!< The preprocessed preset shader code.
+    std::string m_vertexShaderCode;            //!< Custom vertex shader code. If empty, the default shader is used.
 
     std::set<std::string> m_samplerNames;                                        //!< All sampler names referenced in the shader code.
     std::vector<Renderer::TextureSamplerDescriptor> m_mainTextureDescriptors;              //!< Descriptors for all main texture references.
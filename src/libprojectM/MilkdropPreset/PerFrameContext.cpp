@@ -1,5 +1,6 @@
 #include "PerFrameContext.hpp"
 
+#include "ExpressionOptimizer.hpp"
 #include "MilkdropPresetExceptions.hpp"
 
 #ifdef MILKDROP_PRESET_DEBUG
@@ -44,15 +45,6 @@ void PerFrameContext::RegisterBuiltinVariables()
     REG_VAR(dy);
     REG_VAR(sx);
     REG_VAR(sy);
-    REG_VAR(time);
-    REG_VAR(fps);
-    REG_VAR(bass);
-    REG_VAR(mid);
-    REG_VAR(treb);
-    REG_VAR(bass_att);
-    REG_VAR(mid_att);
-    REG_VAR(treb_att);
-    REG_VAR(frame);
     REG_VAR(decay);
     REG_VAR(wave_a);
     REG_VAR(wave_r);
@@ -62,12 +54,6 @@ void PerFrameContext::RegisterBuiltinVariables()
     REG_VAR(wave_y);
     REG_VAR(wave_mystery);
     REG_VAR(wave_mode);
-    for (int q = 0; q < QVarCount; q++)
-    {
-        std::string qvar = "q" + std::to_string(q + 1);
-        q_vars[q] = projectm_eval_context_register_variable(perFrameCodeContext, qvar.c_str());
-    }
-    REG_VAR(progress);
     REG_VAR(ob_size);
     REG_VAR(ob_r);
     REG_VAR(ob_g);
@@ -114,6 +100,9 @@ void PerFrameContext::RegisterBuiltinVariables()
     REG_VAR(blur2_max);
     REG_VAR(blur3_max);
     REG_VAR(blur1_edge_darken);
+
+    frameVariables.Register(perFrameCodeContext, FrameVariables::Names());
+    q_vars.Register(perFrameCodeContext, QVariableNames());
 }
 
 void PerFrameContext::EvaluateInitCode(PresetState& state)
@@ -141,15 +130,27 @@ void PerFrameContext::EvaluateInitCode(PresetState& state)
     projectm_eval_code_execute(initCode);
     projectm_eval_code_destroy(initCode);
 
-    for (int q = 0; q < QVarCount; q++)
-    {
-        q_values_after_init_code[q] = *q_vars[q];
-        state.frameQVariables[q] = *q_vars[q];
-    }
+    q_vars.Store(q_values_after_init_code);
+    state.frameQVariables = q_values_after_init_code;
 }
 
 void PerFrameContext::LoadStateVariables(PresetState& state)
 {
+    auto& values = state.frameVariables;
+    values[FrameVariables::Time] = static_cast<PRJM_EVAL_F>(state.renderContext.time);
+    values[FrameVariables::Fps] = static_cast<PRJM_EVAL_F>(state.renderContext.fps);
+    values[FrameVariables::Frame] = static_cast<PRJM_EVAL_F>(state.renderContext.frame);
+    values[FrameVariables::Progress] = static_cast<PRJM_EVAL_F>(state.renderContext.progress);
+    values[FrameVariables::Bass] = static_cast<PRJM_EVAL_F>(state.audioData->bass);
+    values[FrameVariables::Mid] = static_cast<PRJM_EVAL_F>(state.audioData->mid);
+    values[FrameVariables::Treb] = static_cast<PRJM_EVAL_F>(state.audioData->treb);
+    values[FrameVariables::BassAtt] = static_cast<PRJM_EVAL_F>(state.audioData->bassAtt);
+    values[FrameVariables::MidAtt] = static_cast<PRJM_EVAL_F>(state.audioData->midAtt);
+    values[FrameVariables::TrebAtt] = static_cast<PRJM_EVAL_F>(state.audioData->trebAtt);
+
+    frameVariables.Load(values);
+    q_vars.Load(q_values_after_init_code);
+
     *zoom = static_cast<PRJM_EVAL_F>(state.zoom);
     *zoomexp = static_cast<PRJM_EVAL_F>(state.zoomExponent);
     *rot = static_cast<PRJM_EVAL_F>(state.rot);
@@ -160,20 +161,6 @@ void PerFrameContext::LoadStateVariables(PresetState& state)
     *dy = static_cast<PRJM_EVAL_F>(state.yPush);
     *sx = static_cast<PRJM_EVAL_F>(state.stretchX);
     *sy = static_cast<PRJM_EVAL_F>(state.stretchY);
-    *time = static_cast<PRJM_EVAL_F>(state.renderContext.time);
-    *fps = static_cast<PRJM_EVAL_F>(state.renderContext.fps);
-    *bass = static_cast<PRJM_EVAL_F>(state.audioData.bass);
-    *mid = static_cast<PRJM_EVAL_F>(state.audioData.mid);
-    *treb = static_cast<PRJM_EVAL_F>(state.audioData.treb);
-    *bass_att = static_cast<PRJM_EVAL_F>(state.audioData.bassAtt);
-    *mid_att = static_cast<PRJM_EVAL_F>(state.audioData.midAtt);
-    *treb_att = static_cast<PRJM_EVAL_F>(state.audioData.trebAtt);
-    *frame = static_cast<PRJM_EVAL_F>(state.renderContext.frame);
-    for (int q = 0; q < QVarCount; q++)
-    {
-        *q_vars[q] = q_values_after_init_code[q];
-    }
-    *progress = static_cast<PRJM_EVAL_F>(state.renderContext.progress);
     *decay = static_cast<PRJM_EVAL_F>(state.decay);
     *wave_a = static_cast<PRJM_EVAL_F>(state.waveAlpha);
     *wave_r = static_cast<PRJM_EVAL_F>(state.waveR);
@@ -238,7 +225,15 @@ void PerFrameContext::CompilePerFrameCode(const std::string& perFrameCode)
         return;
     }
 
-    perFrameCodeHandle = projectm_eval_code_compile(perFrameCodeContext, perFrameCode.c_str());
+    // Cached programs were compiled with projectm-eval before, so the interpreter isn't needed.
+    perFrameCodeJit = JitCode::FromCache(perFrameCodeContext, perFrameCode);
+    if (perFrameCodeJit)
+    {
+        return;
+    }
+
+    std::string compiledCode;
+    perFrameCodeHandle = CompileCode(perFrameCodeContext, perFrameCode, compiledCode);
     if (perFrameCodeHandle == nullptr)
     {
 #ifdef MILKDROP_PRESET_DEBUG
@@ -252,11 +247,17 @@ void PerFrameContext::CompilePerFrameCode(const std::string& perFrameCode)
 #endif
         throw MilkdropCompileException("Could not compile per-frame code");
     }
+
+    perFrameCodeJit = JitCode::Compile(perFrameCodeContext, perFrameCode);
 }
 
 void PerFrameContext::ExecutePerFrameCode()
 {
-    if (perFrameCodeHandle != nullptr)
+    if (perFrameCodeJit)
+    {
+        perFrameCodeJit->Execute();
+    }
+    else if (perFrameCodeHandle != nullptr)
     {
         projectm_eval_code_execute(perFrameCodeHandle);
     }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "ExpressionJit.hpp"
 #include "PresetState.hpp"
+#include "VariableBlock.hpp"
 
 #include <projectm-eval.h>
 
@@ -40,6 +42,10 @@ public:
 
     /**
      * @brief Loads the current state values into the expression evaluator variables.
+     *
+     * Also updates the time and audio values in state.frameVariables, which all other code
+     * contexts load on this frame.
+     *
      * @param state The preset state container.
      */
     void LoadStateVariables(PresetState& state);
@@ -65,6 +71,10 @@ public:
 
     projectm_eval_context* perFrameCodeContext{nullptr}; //!< The code runtime context, holds memory buffers and variables.
     projectm_eval_code* perFrameCodeHandle{nullptr}; //!< The compiled per-frame code handle.
+    std::unique_ptr<JitCode> perFrameCodeJit;        //!< The per-frame code compiled to machine code, or nullptr to use the interpreter.
+
+    VariableBinding<FrameVariables::Count> frameVariables; //!< Time and audio variables.
+    VariableBinding<QVarCount> q_vars;                     //!< Q variables.
 
     PRJM_EVAL_F* zoom{};
     PRJM_EVAL_F* zoomexp{};
@@ -76,14 +86,6 @@ public:
     PRJM_EVAL_F* dy{};
     PRJM_EVAL_F* sx{};
     PRJM_EVAL_F* sy{};
-    PRJM_EVAL_F* time{};
-    PRJM_EVAL_F* fps{};
-    PRJM_EVAL_F* bass{};
-    PRJM_EVAL_F* mid{};
-    PRJM_EVAL_F* treb{};
-    PRJM_EVAL_F* bass_att{};
-    PRJM_EVAL_F* mid_att{};
-    PRJM_EVAL_F* treb_att{};
     PRJM_EVAL_F* wave_a{};
     PRJM_EVAL_F* wave_r{};
     PRJM_EVAL_F* wave_g{};
@@ -93,9 +95,6 @@ public:
     PRJM_EVAL_F* wave_mystery{};
     PRJM_EVAL_F* wave_mode{};
     PRJM_EVAL_F* decay{};
-    PRJM_EVAL_F* frame{};
-    PRJM_EVAL_F* q_vars[QVarCount]{};
-    PRJM_EVAL_F* progress{};
     PRJM_EVAL_F* ob_size{};
     PRJM_EVAL_F* ob_r{};
     PRJM_EVAL_F* ob_g{};
@@ -143,7 +142,7 @@ public:
     PRJM_EVAL_F* blur3_max{};
     PRJM_EVAL_F* blur1_edge_darken{};
 
-    PRJM_EVAL_F q_values_after_init_code[QVarCount]{};
+    QVariableBlock q_values_after_init_code; //!< Q variable values after running the init code, loaded before each per-frame code run.
 };
 
 } // namespace MilkdropPreset
@@ -1,7 +1,12 @@
 #include "PerPixelContext.hpp"
 
+#include "CodeAnalysis.hpp"
+#include "ExpressionOptimizer.hpp"
 #include "MilkdropPresetExceptions.hpp"
 
+#include <algorithm>
+#include <set>
+
 #ifdef MILKDROP_PRESET_DEBUG
 #include <iostream>
 #endif
@@ -12,8 +17,25 @@
 namespace libprojectM {
 namespace MilkdropPreset {
 
+constexpr size_t PerPixelContext::BlockSize;
+
+namespace {
+
+/**
+ * @brief Variables the per-pixel code may change without carrying state to the next vertex.
+ *
+ * The motion variables are reset to the per-frame values and the vertex inputs are loaded before
+ * each vertex is evaluated.
+ */
+const std::set<std::string> VertexVariables{"zoom", "zoomexp", "rot", "warp", "cx", "cy", "dx", "dy", "sx", "sy",
+                                            "x", "y", "rad", "ang"};
+
+} // namespace
+
 PerPixelContext::PerPixelContext(projectm_eval_mem_buffer gmegabuf, PRJM_EVAL_F (*globalRegisters)[100])
     : perPixelCodeContext(projectm_eval_context_create(gmegabuf, globalRegisters))
+    , m_gmegabuf(gmegabuf)
+    , m_globalRegisters(globalRegisters)
 {
 }
 
@@ -30,6 +52,62 @@ PerPixelContext::~PerPixelContext()
     }
 }
 
+auto PerPixelContext::Clone() const -> std::unique_ptr<PerPixelContext>
+{
+    auto clone = std::make_unique<PerPixelContext>(m_gmegabuf, m_globalRegisters);
+    clone->RegisterBuiltinVariables();
+    clone->CompilePerPixelCode(m_perPixelCode);
+    clone->LoadVariablesFrom(*this);
+    return clone;
+}
+
+void PerPixelContext::LoadVariablesFrom(const PerPixelContext& other)
+{
+    frameVariables.Load(other.frameVariables);
+    q_vars.Load(other.q_vars);
+    *meshx = *other.meshx;
+    *meshy = *other.meshy;
+    *pixelsx = *other.pixelsx;
+    *pixelsy = *other.pixelsy;
+    *aspectx = *other.aspectx;
+    *aspecty = *other.aspecty;
+}
+
+auto PerPixelContext::ReadOnlyVariable(const std::string& name) const -> const PRJM_EVAL_F*
+{
+    auto const& frameVariableNames = FrameVariables::Names();
+    for (size_t index = 0; index < FrameVariables::Count; index++)
+    {
+        if (name == frameVariableNames[index])
+        {
+            return frameVariables[index];
+        }
+    }
+
+    auto const& qVariableNames = QVariableNames();
+    for (size_t index = 0; index < QVarCount; index++)
+    {
+        if (name == qVariableNames[index])
+        {
+            return q_vars[index];
+        }
+    }
+
+    std::pair<const char*, PRJM_EVAL_F*> const variables[] = {
+        {"meshx", meshx}, {"meshy", meshy}, {"pixelsx", pixelsx}, {"pixelsy", pixelsy},
+        {"aspectx", aspectx}, {"aspecty", aspecty}};
+
+    for (const auto& variable : variables)
+    {
+        if (name == variable.first)
+        {
+            return variable.second;
+        }
+    }
+
+    return nullptr;
+}
+
 void PerPixelContext::RegisterBuiltinVariables()
 {
     projectm_eval_context_reset_variables(perPixelCodeContext);
@@ -44,45 +122,24 @@ void PerPixelContext::RegisterBuiltinVariables()
     REG_VAR(dy);
     REG_VAR(sx);
     REG_VAR(sy);
-    REG_VAR(time);
-    REG_VAR(fps);
-    REG_VAR(bass);
-    REG_VAR(mid);
-    REG_VAR(treb);
-    REG_VAR(bass_att);
-    REG_VAR(mid_att);
-    REG_VAR(treb_att);
-    REG_VAR(frame);
     REG_VAR(x);
     REG_VAR(y);
     REG_VAR(rad);
     REG_VAR(ang);
-    for (int q = 0; q < QVarCount; q++)
-    {
-        std::string qvar = "q" + std::to_string(q + 1);
-        q_vars[q] = projectm_eval_context_register_variable(perPixelCodeContext, qvar.c_str());
-    }
-    REG_VAR(progress);
     REG_VAR(meshx);
     REG_VAR(meshy);
     REG_VAR(pixelsx);
     REG_VAR(pixelsy);
     REG_VAR(aspectx);
     REG_VAR(aspecty);
+
+    frameVariables.Register(perPixelCodeContext, FrameVariables::Names());
+    q_vars.Register(perPixelCodeContext, QVariableNames());
 }
 
-void PerPixelContext::LoadStateReadOnlyVariables(PresetState& state, PerFrameContext& perFrameState)
+void PerPixelContext::LoadStateReadOnlyVariables(const PresetState& state)
 {
-    *time = static_cast<PRJM_EVAL_F>(*perFrameState.time);
-    *fps = static_cast<PRJM_EVAL_F>(*perFrameState.fps);
-    *frame = static_cast<PRJM_EVAL_F>(*perFrameState.frame);
-    *progress = static_cast<PRJM_EVAL_F>(*perFrameState.progress);
-    *bass = static_cast<PRJM_EVAL_F>(*perFrameState.bass);
-    *mid = static_cast<PRJM_EVAL_F>(*perFrameState.mid);
-    *treb = static_cast<PRJM_EVAL_F>(*perFrameState.treb);
-    *bass_att = static_cast<PRJM_EVAL_F>(*perFrameState.bass_att);
-    *mid_att = static_cast<PRJM_EVAL_F>(*perFrameState.mid_att);
-    *treb_att = static_cast<PRJM_EVAL_F>(*perFrameState.treb_att);
+    frameVariables.Load(state.frameVariables);
     *meshx = static_cast<PRJM_EVAL_F>(state.renderContext.perPixelMeshX);
     *meshy = static_cast<PRJM_EVAL_F>(state.renderContext.perPixelMeshY);
     *pixelsx = static_cast<PRJM_EVAL_F>(state.renderContext.viewportSizeX);
@@ -93,11 +150,8 @@ void PerPixelContext::LoadStateReadOnlyVariables(PresetState& state, PerFrameCon
 
 void PerPixelContext::LoadPerFrameQVariables(PresetState& state, PerFrameContext& perFrameState)
 {
-    for (int q = 0; q < QVarCount; q++)
-    {
-        state.frameQVariables[q] = *perFrameState.q_vars[q];
-        *q_vars[q] = *perFrameState.q_vars[q];
-    }
+    perFrameState.q_vars.Store(state.frameQVariables);
+    q_vars.Load(state.frameQVariables);
 }
 
 void PerPixelContext::CompilePerPixelCode(const std::string& perPixelCode)
@@ -107,26 +161,203 @@ void PerPixelContext::CompilePerPixelCode(const std::string& perPixelCode)
         return;
     }
 
-    perPixelCodeHandle = projectm_eval_code_compile(perPixelCodeContext, perPixelCode.c_str());
-    if (perPixelCodeHandle == nullptr)
+    m_perPixelCode = perPixelCode;
+
+    // Cached programs were compiled with projectm-eval before, so the interpreter isn't needed.
+    std::string compiledCode = perPixelCode;
+    perPixelCodeJit = JitCode::FromCache(perPixelCodeContext, perPixelCode, VertexCodePrecision());
+    if (!perPixelCodeJit)
     {
+        perPixelCodeHandle = CompileCode(perPixelCodeContext, perPixelCode, compiledCode);
+        if (perPixelCodeHandle == nullptr)
+        {
 #ifdef MILKDROP_PRESET_DEBUG
-        int line;
-        int col;
-        auto* errmsg = projectm_eval_get_error(perPixelCodeContext, &line, &col);
-        std::cerr << "[Preset] Could not compile per-pixel code: " << errmsg << "(L" << line << " C" << col << ")" << std::endl;
+            int line;
+            int col;
+            auto* errmsg = projectm_eval_get_error(perPixelCodeContext, &line, &col);
+            std::cerr << "[Preset] Could not compile per-pixel code: " << errmsg << "(L" << line << " C" << col << ")" << std::endl;
 #endif
-        throw MilkdropCompileException("Could not compile per-pixel code");
+            throw MilkdropCompileException("Could not compile per-pixel code");
+        }
+
+        perPixelCodeJit = JitCode::Compile(perPixelCodeContext, perPixelCode, VertexCodePrecision());
+    }
+
+    BindSingleVariables();
+
+    auto const analysis = AnalyzeCode(compiledCode);
+
+    // Carried variables make the results depend on the evaluation order of the vertices.
+    bool const carriesState = std::any_of(analysis.carriedVariables.begin(), analysis.carriedVariables.end(),
+                                          [](const std::string& name) {
+                                              return VertexVariables.find(name) == VertexVariables.end();
+                                          });
+
+    m_supportsMultithreading = !analysis.usesSharedState && !carriesState;
+
+    if (analysis.usesSharedState || carriesState ||
+        analysis.References("x") || analysis.References("y") || analysis.References("ang"))
+    {
+        m_vertexDependency = VertexDependency::Varying;
+    }
+    else if (analysis.References("rad"))
+    {
+        m_vertexDependency = VertexDependency::RadiusOnly;
+    }
+    else
+    {
+        m_vertexDependency = VertexDependency::Invariant;
+    }
+
+    if (m_supportsMultithreading)
+    {
+        m_glslCode = TranslateToGlsl(compiledCode);
+    }
+    else
+    {
+        m_glslCode = {};
+        m_glslCode.error = analysis.usesSharedState ? "uses shared state" : "carries variables between vertices";
     }
+
+#ifdef MILKDROP_PRESET_DEBUG
+    std::cerr << "[Preset] Per-pixel code vertex dependency: " << static_cast<int>(m_vertexDependency)
+              << ", multithreading " << (m_supportsMultithreading ? "enabled" : "disabled")
+              << ", GLSL translation " << (m_glslCode.translated ? "succeeded" : "failed: " + m_glslCode.error) << std::endl;
+#endif
 }
 
 void PerPixelContext::ExecutePerPixelCode()
 {
-    if (perPixelCodeHandle != nullptr)
+    if (perPixelCodeJit)
+    {
+        perPixelCodeJit->Execute();
+    }
+    else if (perPixelCodeHandle != nullptr)
     {
         projectm_eval_code_execute(perPixelCodeHandle);
     }
 }
 
+void PerPixelContext::ExecutePerPixelCode(const PerFrameContext& perFrameContext, VertexBlock& block)
+{
+    if (!HasCode())
+    {
+        return;
+    }
+
+    std::array<PRJM_EVAL_F, 10> const initialMotion{*perFrameContext.zoom, *perFrameContext.zoomexp,
+                                                    *perFrameContext.rot, *perFrameContext.warp,
+                                                    *perFrameContext.cx, *perFrameContext.cy,
+                                                    *perFrameContext.dx, *perFrameContext.dy,
+                                                    *perFrameContext.sx, *perFrameContext.sy};
+    std::array<float*, 10> const results{block.zoom.data(), block.zoomExp.data(), block.rot.data(), block.warp.data(),
+                                         block.centerX.data(), block.centerY.data(),
+                                         block.distanceX.data(), block.distanceY.data(),
+                                         block.stretchX.data(), block.stretchY.data()};
+
+    if (perPixelCodeJit && perPixelCodeJit->Precision() == JitPrecision::Single)
+    {
+        ExecuteSinglePrecision(initialMotion, results, block);
+        return;
+    }
+
+    // The compiler can't keep values in registers across the opaque execute call, so copy
+    // all pointers into locals first.
+    auto* const code = perPixelCodeHandle;
+    auto* const jitCode = perPixelCodeJit.get();
+
+    PRJM_EVAL_F* const vertexX = x;
+    PRJM_EVAL_F* const vertexY = y;
+    PRJM_EVAL_F* const vertexRad = rad;
+    PRJM_EVAL_F* const vertexAng = ang;
+
+    std::array<PRJM_EVAL_F*, 10> const motion{zoom, zoomexp, rot, warp, cx, cy, dx, dy, sx, sy};
+
+    for (size_t vertex = 0; vertex < block.count; vertex++)
+    {
+        *vertexX = static_cast<PRJM_EVAL_F>(block.x[vertex]);
+        *vertexY = static_cast<PRJM_EVAL_F>(block.y[vertex]);
+        *vertexRad = static_cast<PRJM_EVAL_F>(block.rad[vertex]);
+        *vertexAng = static_cast<PRJM_EVAL_F>(block.ang[vertex]);
+        for (size_t variable = 0; variable < motion.size(); variable++)
+        {
+            *motion[variable] = initialMotion[variable];
+        }
+
+        if (jitCode != nullptr)
+        {
+            jitCode->Execute();
+        }
+        else
+        {
+            projectm_eval_code_execute(code);
+        }
+
+        for (size_t variable = 0; variable < motion.size(); variable++)
+        {
+            results[variable][vertex] = static_cast<float>(*motion[variable]);
+        }
+    }
+}
+
+void PerPixelContext::BindSingleVariables()
+{
+    static const std::array<const char*, 14> names{"x", "y", "rad", "ang", "zoom", "zoomexp", "rot", "warp",
+                                                   "cx", "cy", "dx", "dy", "sx", "sy"};
+
+    // Variables the code doesn't use are written to and read from local storage instead.
+    for (size_t index = 0; index < names.size(); index++)
+    {
+        auto* const value = perPixelCodeJit ? perPixelCodeJit->Variable(names[index]) : nullptr;
+        m_singleVariables[index] = value != nullptr ? value : &m_unusedSingleVariables[index];
+    }
+}
+
+void PerPixelContext::ExecuteSinglePrecision(const std::array<PRJM_EVAL_F, 10>& initialMotion,
+                                             const std::array<float*, 10>& results,
+                                             VertexBlock& block)
+{
+    auto& jitCode = *perPixelCodeJit;
+
+    float* const vertexX = m_singleVariables[0];
+    float* const vertexY = m_singleVariables[1];
+    float* const vertexRad = m_singleVariables[2];
+    float* const vertexAng = m_singleVariables[3];
+
+    std::array<float*, 10> const motion{m_singleVariables[4], m_singleVariables[5], m_singleVariables[6],
+                                        m_singleVariables[7], m_singleVariables[8], m_singleVariables[9],
+                                        m_singleVariables[10], m_singleVariables[11], m_singleVariables[12],
+                                        m_singleVariables[13]};
+    std::array<float, 10> initialValues{};
+    for (size_t index = 0; index < initialValues.size(); index++)
+    {
+        initialValues[index] = static_cast<float>(initialMotion[index]);
+    }
+
+    // Everything else only needs to be converted once per block.
+    jitCode.LoadVariables();
+
+    for (size_t vertex = 0; vertex < block.count; vertex++)
+    {
+        *vertexX = block.x[vertex];
+        *vertexY = block.y[vertex];
+        *vertexRad = block.rad[vertex];
+        *vertexAng = block.ang[vertex];
+        for (size_t index = 0; index < motion.size(); index++)
+        {
+            *motion[index] = initialValues[index];
+        }
+
+        jitCode.ExecuteLoaded();
+
+        for (size_t index = 0; index < motion.size(); index++)
+        {
+            results[index][vertex] = *motion[index];
+        }
+    }
+
+    jitCode.StoreVariables();
+}
+
 } // namespace MilkdropPreset
 } // namespace libprojectM
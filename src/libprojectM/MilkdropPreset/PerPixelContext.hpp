@@ -1,16 +1,63 @@
 #pragma once
 
+#include "ExpressionJit.hpp"
+#include "GlslTranslator.hpp"
 #include "PerFrameContext.hpp"
 #include "PresetState.hpp"
+#include "VariableBlock.hpp"
 
 #include <projectm-eval.h>
 
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
 namespace libprojectM {
 namespace MilkdropPreset {
 
 class PerPixelContext
 {
 public:
+    /**
+     * @brief Which per-vertex inputs the per-pixel code results depend on.
+     */
+    enum class VertexDependency : int
+    {
+        Invariant,  //!< Same results for all vertices, the code only needs to run once per frame.
+        RadiusOnly, //!< Results only depend on rad, the code needs to run once per distinct radius.
+        Varying     //!< The code needs to run for each vertex.
+    };
+
+    static constexpr size_t BlockSize = 64; //!< Maximum number of vertices evaluated per ExecutePerPixelCode() call.
+
+    /**
+     * @brief Per-vertex inputs and results of the per-pixel code for a block of mesh vertices.
+     *
+     * Values are stored as structure of arrays, so the inputs can be prepared and the results
+     * converted to the vertex attributes in tight, vectorizable loops.
+     */
+    struct VertexBlock
+    {
+        size_t count{}; //!< Number of valid vertices in the block, at most BlockSize.
+
+        const float* x{};   //!< Input: x coordinates of the vertices, count elements.
+        const float* y{};   //!< Input: y coordinates of the vertices, count elements.
+        const float* rad{}; //!< Input: radii of the vertices, count elements.
+        const float* ang{}; //!< Input: angles of the vertices, count elements.
+
+        std::array<float, BlockSize> zoom{};      //!< Result: zoom.
+        std::array<float, BlockSize> zoomExp{};   //!< Result: zoom exponent.
+        std::array<float, BlockSize> rot{};       //!< Result: rotation.
+        std::array<float, BlockSize> warp{};      //!< Result: warp amount.
+        std::array<float, BlockSize> centerX{};   //!< Result: rotation/zoom center X.
+        std::array<float, BlockSize> centerY{};   //!< Result: rotation/zoom center Y.
+        std::array<float, BlockSize> distanceX{}; //!< Result: X translation.
+        std::array<float, BlockSize> distanceY{}; //!< Result: Y translation.
+        std::array<float, BlockSize> stretchX{};  //!< Result: X stretch.
+        std::array<float, BlockSize> stretchY{};  //!< Result: Y stretch.
+    };
+
     /**
      * @brief Constructor. Creates a new per-frame state object.
      * @param gmegabuf The global memory buffer to use in the code context.
@@ -23,6 +70,84 @@ public:
      */
     ~PerPixelContext();
 
+    PerPixelContext(const PerPixelContext&) = delete;
+    auto operator=(const PerPixelContext&) -> PerPixelContext& = delete;
+
+    /**
+     * @brief Creates a new context with the same builtin variables and compiled per-pixel code.
+     *
+     * The clone shares gmegabuf and the global registers with this context, but has its own
+     * megabuf and custom variables. Use LoadVariablesFrom() to copy the current state.
+     *
+     * @return The cloned context.
+     */
+    auto Clone() const -> std::unique_ptr<PerPixelContext>;
+
+    /**
+     * @brief Copies the values of all read-only builtin variables and the Q variables from another context.
+     * @param other The context to copy the values from, usually the one this context was cloned from.
+     */
+    void LoadVariablesFrom(const PerPixelContext& other);
+
+    /**
+     * @brief Checks whether the per-pixel code can be evaluated in multiple contexts concurrently.
+     *
+     * This is a conservative lexical check: code referencing megabuf/gmegabuf, any other memory
+     * functions, the global registers or rand(), or carrying custom variables over from one
+     * vertex to the next, is only run on a single thread.
+     *
+     * @return True if the code doesn't use shared state.
+     */
+    auto SupportsMultithreading() const -> bool
+    {
+        return m_supportsMultithreading;
+    }
+
+    /**
+     * @brief Returns whether the preset has per-pixel code.
+     *
+     * Code bound from the compiled code cache has no projectm-eval handle, so check both.
+     *
+     * @return True if per-pixel code was compiled.
+     */
+    auto HasCode() const -> bool
+    {
+        return perPixelCodeHandle != nullptr || perPixelCodeJit != nullptr;
+    }
+
+    /**
+     * @brief Returns which vertex inputs the per-pixel code depends on.
+     *
+     * Determined by a conservative lexical analysis when compiling the code. Code using shared
+     * state or carrying custom variables over from one vertex to the next is always varying.
+     *
+     * @return The vertex dependency of the compiled code.
+     */
+    auto Dependency() const -> VertexDependency
+    {
+        return m_vertexDependency;
+    }
+
+    /**
+     * @brief Returns the per-pixel code translated into GLSL.
+     *
+     * The code is only translated if it doesn't use shared state or carry custom variables over
+     * from one vertex to the next, as each vertex is evaluated independently on the GPU.
+     *
+     * @return The translation result. Not translated if there is no code or it isn't supported.
+     */
+    auto GlslCode() const -> const GlslTranslation&
+    {
+        return m_glslCode;
+    }
+
+    /**
+     * @brief Returns a pointer to a builtin variable which is loaded once per frame.
+     * @param name The lower-case variable name, e.g. "time" or "q1".
+     * @return A pointer to the variable value, or nullptr if the name isn't a read-only builtin variable.
+     */
+    auto ReadOnlyVariable(const std::string& name) const -> const PRJM_EVAL_F*;
+
     /**
      * @brief Registers the state variables in the expression evaluator context.
      */
@@ -37,10 +162,10 @@ public:
      *
      * @param state The preset state container.
      */
-    void LoadStateReadOnlyVariables(PresetState& state, PerFrameContext& perFrameState);
+    void LoadStateReadOnlyVariables(const PresetState& state);
 
     /**
-     * @brief Copies the current per-frame Q variable values into the per-pixel state.
+     * @brief Copies the current per-frame Q variable values into the preset state and the per-pixel state.
      * @param state The preset state container.
      * @param perFrameState The per-frame execution context.
      */
@@ -58,8 +183,27 @@ public:
      */
     void ExecutePerPixelCode();
 
+    /**
+     * @brief Executes the per-pixel code for a block of vertices.
+     *
+     * Before each vertex, x, y, rad and ang are loaded from the block and the motion variables
+     * are reset to the per-frame values. Afterwards, the motion variables are stored in the block.
+     * The per-frame values are only read once per block.
+     *
+     * If the code was JIT-compiled for single precision, the variables are only converted from and
+     * to the context once per block, and the inputs and results are copied without conversion.
+     *
+     * @param perFrameContext The per-frame context to retrieve the initial motion values from.
+     * @param block The vertex inputs and result storage.
+     */
+    void ExecutePerPixelCode(const PerFrameContext& perFrameContext, VertexBlock& block);
+
     projectm_eval_context* perPixelCodeContext{nullptr}; //!< The code runtime context, holds memory buffers and variables.
     projectm_eval_code* perPixelCodeHandle{nullptr};     //!< The compiled per-pixel code handle.
+    std::unique_ptr<JitCode> perPixelCodeJit;            //!< The per-pixel code compiled to machine code, or nullptr to use the interpreter.
+
+    VariableBinding<FrameVariables::Count> frameVariables; //!< Time and audio variables.
+    VariableBinding<QVarCount> q_vars;                     //!< Q variables.
 
     PRJM_EVAL_F* zoom{};
     PRJM_EVAL_F* zoomexp{};
@@ -71,27 +215,41 @@ public:
     PRJM_EVAL_F* dy{};
     PRJM_EVAL_F* sx{};
     PRJM_EVAL_F* sy{};
-    PRJM_EVAL_F* time{};
-    PRJM_EVAL_F* fps{};
-    PRJM_EVAL_F* bass{};
-    PRJM_EVAL_F* mid{};
-    PRJM_EVAL_F* treb{};
-    PRJM_EVAL_F* bass_att{};
-    PRJM_EVAL_F* mid_att{};
-    PRJM_EVAL_F* treb_att{};
     PRJM_EVAL_F* x{};
     PRJM_EVAL_F* y{};
     PRJM_EVAL_F* rad{};
     PRJM_EVAL_F* ang{};
-    PRJM_EVAL_F* frame{};
-    PRJM_EVAL_F* q_vars[QVarCount]{};
-    PRJM_EVAL_F* progress{};
     PRJM_EVAL_F* meshx{};
     PRJM_EVAL_F* meshy{};
     PRJM_EVAL_F* pixelsx{};
     PRJM_EVAL_F* pixelsy{};
     PRJM_EVAL_F* aspectx{};
     PRJM_EVAL_F* aspecty{};
+
+private:
+    /**
+     * @brief Executes the single precision JIT-compiled per-pixel code for a block of vertices.
+     * @param initialMotion The per-frame motion values each vertex starts with.
+     * @param results The result arrays of the block, in the same order as initialMotion.
+     * @param block The vertex inputs and result storage.
+     */
+    void ExecuteSinglePrecision(const std::array<PRJM_EVAL_F, 10>& initialMotion,
+                                const std::array<float*, 10>& results,
+                                VertexBlock& block);
+
+    /**
+     * @brief Looks up the single precision vertex input and motion variables once after compiling.
+     */
+    void BindSingleVariables();
+
+    projectm_eval_mem_buffer m_gmegabuf{};                          //!< The global memory buffer, passed to clones.
+    PRJM_EVAL_F (*m_globalRegisters)[100]{};                        //!< The global registers, passed to clones.
+    std::string m_perPixelCode;                                     //!< The compiled per-pixel code, recompiled in clones.
+    bool m_supportsMultithreading{true};                            //!< True if the code neither uses shared state nor carries variables.
+    VertexDependency m_vertexDependency{VertexDependency::Varying}; //!< Vertex inputs the code depends on.
+    GlslTranslation m_glslCode;                                     //!< The per-pixel code translated into GLSL.
+    std::array<float*, 14> m_singleVariables{};                     //!< x, y, rad, ang and the motion variables of single precision code.
+    std::array<float, 14> m_unusedSingleVariables{};                //!< Storage for the variables single precision code doesn't use.
 };
 
 } // namespace MilkdropPreset
@@ -5,9 +5,13 @@
 #include "PerFrameContext.hpp"
 #include "PerPixelContext.hpp"
 #include "PresetState.hpp"
+#include "StageProfiler.hpp"
+#include "WorkerPool.hpp"
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <unordered_map>
 
 #ifdef MILKDROP_PRESET_DEBUG
 #include <iostream>
@@ -17,15 +21,77 @@ namespace libprojectM {
 namespace MilkdropPreset {
 
 static constexpr uint32_t VerticesPerDrawCall = 1024 * 3;
+static constexpr size_t MinVerticesPerBand = 1024; //!< Smaller meshes aren't split, as the threading overhead outweighs the gain.
+
+namespace {
+
+/**
+ * @brief Replaces a marker comment in a shader source with the given code.
+ * @param source The shader source.
+ * @param marker The marker comment.
+ * @param code The code to insert.
+ */
+void ReplaceMarker(std::string& source, const std::string& marker, const std::string& code)
+{
+    auto const position = source.find(marker);
+    if (position != std::string::npos)
+    {
+        source.replace(position, marker.size(), code);
+    }
+}
+
+template<typename Vertex>
+void CopyMotion(const Vertex& source, Vertex& target)
+{
+    target.zoom = source.zoom;
+    target.zoomExp = source.zoomExp;
+    target.rot = source.rot;
+    target.warp = source.warp;
+    target.centerX = source.centerX;
+    target.centerY = source.centerY;
+    target.distanceX = source.distanceX;
+    target.distanceY = source.distanceY;
+    target.stretchX = source.stretchX;
+    target.stretchY = source.stretchY;
+}
+
+} // namespace
 
 PerPixelMesh::PerPixelMesh()
     : RenderItem()
+    , m_workerPool(WorkerPool::Get())
 {
     RenderItem::Init();
 
     auto staticShaders = libprojectM::MilkdropPreset::MilkdropStaticShaders::Get();
     m_perPixelMeshShader.CompileProgram(staticShaders->GetPresetWarpVertexShader(),
                                         staticShaders->GetPresetWarpFragmentShader());
+
+    glGenVertexArrays(1, &m_staticVaoID);
+    glGenBuffers(1, &m_staticVboID);
+    glGenBuffers(1, &m_staticIboID);
+
+    glBindVertexArray(m_staticVaoID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_staticVboID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_staticIboID);
+
+    // The motion values are calculated in the vertex shader, only position, radius and angle are needed.
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<void*>(offsetof(MeshVertex, x)));      // Position
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<void*>(offsetof(MeshVertex, radius))); // Radius & angle
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+PerPixelMesh::~PerPixelMesh()
+{
+    glDeleteBuffers(1, &m_staticIboID);
+    glDeleteBuffers(1, &m_staticVboID);
+    glDeleteVertexArrays(1, &m_staticVaoID);
 }
 
 void PerPixelMesh::InitVertexAttrib()
@@ -88,12 +154,17 @@ void PerPixelMesh::LoadWarpShader(const PresetState& presetState)
     }
 }
 
-void PerPixelMesh::CompileWarpShader(PresetState& presetState)
+void PerPixelMesh::CompileWarpShader(PresetState& presetState,
+                                     const PerFrameContext& perFrameContext,
+                                     const PerPixelContext& perPixelContext)
 {
+    auto const perPixelCodeVertexShader = CompilePerPixelCodeShader(presetState, perFrameContext, perPixelContext);
+
     if (m_warpShader)
     {
         try
         {
+            m_warpShader->SetVertexShaderCode(perPixelCodeVertexShader);
             m_warpShader->LoadTexturesAndCompile(presetState);
 #ifdef MILKDROP_PRESET_DEBUG
             std::cerr << "[Warp Shader] Successfully compiled warp shader code." << std::endl;
@@ -111,6 +182,137 @@ void PerPixelMesh::CompileWarpShader(PresetState& presetState)
     }
 }
 
+auto PerPixelMesh::CompilePerPixelCodeShader(const PresetState& presetState,
+                                             const PerFrameContext& perFrameContext,
+                                             const PerPixelContext& perPixelContext) -> std::string
+{
+    m_evaluateOnGpu = false;
+    m_gpuUniforms.clear();
+
+    // Presets without per-pixel code keep using the regular mesh shader.
+    if (!presetState.renderContext.perPixelCodeOnGpu || !perPixelContext.HasCode())
+    {
+        return {};
+    }
+
+    const auto& glslCode = perPixelContext.GlslCode();
+    if (!glslCode.translated)
+    {
+#ifdef MILKDROP_PRESET_DEBUG
+        std::cerr << "[Per-Pixel Mesh] Evaluating per-pixel code on the CPU: " << glslCode.error << std::endl;
+#endif
+        return {};
+    }
+
+    // Float uniforms can't hold time and frame precisely after long runtimes, which makes
+    // periodic functions of them jitter, so keep such code on the CPU in double precision.
+    for (const auto* name : {"time", "frame"})
+    {
+        if (glslCode.variables.count(name) > 0)
+        {
+#ifdef MILKDROP_PRESET_DEBUG
+            std::cerr << "[Per-Pixel Mesh] Evaluating per-pixel code on the CPU: reads " << name << std::endl;
+#endif
+            return {};
+        }
+    }
+
+    std::pair<const char*, const PRJM_EVAL_F*> const motionVariables[] = {
+        {"zoom", perFrameContext.zoom}, {"zoomexp", perFrameContext.zoomexp},
+        {"rot", perFrameContext.rot}, {"warp", perFrameContext.warp},
+        {"cx", perFrameContext.cx}, {"cy", perFrameContext.cy},
+        {"dx", perFrameContext.dx}, {"dy", perFrameContext.dy},
+        {"sx", perFrameContext.sx}, {"sy", perFrameContext.sy}};
+
+    // Per-frame values are passed as uniforms, the per-pixel code inputs are calculated like in InitializeMesh().
+    std::string declarations = "precision highp float;\n";
+    std::string code;
+    auto const addUniform = [&](const std::string& name, const PRJM_EVAL_F* value) {
+        declarations.append("uniform float per_pixel_" + name + ";\n");
+        code.append("    float " + GlslVariableName(name) + " = per_pixel_" + name + ";\n");
+        m_gpuUniforms.emplace_back("per_pixel_" + name, value);
+    };
+
+    for (const auto& variable : motionVariables)
+    {
+        addUniform(variable.first, variable.second);
+    }
+
+    for (const auto& name : glslCode.variables)
+    {
+        if (std::any_of(std::begin(motionVariables), std::end(motionVariables),
+                        [&name](const std::pair<const char*, const PRJM_EVAL_F*>& variable) {
+                            return name == variable.first;
+                        }))
+        {
+            continue;
+        }
+
+        std::string initialValue = "0.0";
+        if (name == "x")
+        {
+            initialValue = "pos.x * 0.5 * aspectX + 0.5";
+        }
+        else if (name == "y")
+        {
+            initialValue = "pos.y * -0.5 * aspectY + 0.5";
+        }
+        else if (name == "rad")
+        {
+            initialValue = "radius";
+        }
+        else if (name == "ang")
+        {
+            initialValue = "angle";
+        }
+        else if (const auto* value = perPixelContext.ReadOnlyVariable(name))
+        {
+            addUniform(name, value);
+            continue;
+        }
+
+        code.append("    float " + GlslVariableName(name) + " = " + initialValue + ";\n");
+    }
+
+    declarations.append(GlslHelperFunctions());
+
+    code.append(glslCode.code);
+    code.append("    zoom = " + GlslVariableName("zoom") + ";\n"
+                "    zoomExp = " + GlslVariableName("zoomexp") + ";\n"
+                "    rot = " + GlslVariableName("rot") + ";\n"
+                "    warp = " + GlslVariableName("warp") + ";\n"
+                "    center = vec2(" + GlslVariableName("cx") + ", " + GlslVariableName("cy") + ");\n"
+                "    distance = vec2(" + GlslVariableName("dx") + ", " + GlslVariableName("dy") + ");\n"
+                "    stretch = vec2(" + GlslVariableName("sx") + ", " + GlslVariableName("sy") + ");\n");
+
+    auto staticShaders = MilkdropStaticShaders::Get();
+    auto vertexShader = staticShaders->GetPresetWarpVertexShader();
+    ReplaceMarker(vertexShader, "// PER_PIXEL_DECLARATIONS", declarations);
+    ReplaceMarker(vertexShader, "// PER_PIXEL_CODE", code);
+
+    try
+    {
+        m_perPixelCodeShader.CompileProgram(vertexShader, staticShaders->GetPresetWarpFragmentShader());
+    }
+    catch (Renderer::ShaderException& ex)
+    {
+#ifdef MILKDROP_PRESET_DEBUG
+        std::cerr << "[Per-Pixel Mesh] Error compiling per-pixel code shader, evaluating on the CPU:" << ex.message() << std::endl;
+#else
+        (void)ex; // silence unused parameter warning
+#endif
+        m_gpuUniforms.clear();
+        return {};
+    }
+
+#ifdef MILKDROP_PRESET_DEBUG
+    std::cerr << "[Per-Pixel Mesh] Evaluating per-pixel code on the GPU." << std::endl;
+#endif
+
+    m_evaluateOnGpu = true;
+    return vertexShader;
+}
+
 void PerPixelMesh::Draw(const PresetState& presetState,
                         const PerFrameContext& perFrameContext,
                         PerPixelContext& perPixelContext)
@@ -126,8 +328,11 @@ void PerPixelMesh::Draw(const PresetState& presetState,
     // Initialize or recreate the mesh (if grid size changed)
     InitializeMesh(presetState);
 
-    // Calculate the dynamic movement values
-    CalculateMesh(presetState, perFrameContext, perPixelContext);
+    // Calculate the dynamic movement values, unless the vertex shader does it.
+    if (!m_evaluateOnGpu)
+    {
+        CalculateMesh(perFrameContext, perPixelContext);
+    }
 
     // Render the resulting mesh.
     WarpedBlit(presetState, perFrameContext);
@@ -143,6 +348,7 @@ void PerPixelMesh::InitializeMesh(const PresetState& presetState)
 
         // Grid size has changed, reallocate vertex buffers
         m_vertices.resize((m_gridSizeX + 1) * (m_gridSizeY + 1));
+        m_radiusIndices.resize(m_vertices.size());
         m_listIndices.resize(m_gridSizeX * m_gridSizeY * 6);
     }
     else if (m_viewportWidth == presetState.renderContext.viewportSizeX &&
@@ -155,7 +361,15 @@ void PerPixelMesh::InitializeMesh(const PresetState& presetState)
     float aspectX = static_cast<float>(presetState.renderContext.aspectX);
     float aspectY = static_cast<float>(presetState.renderContext.aspectY);
 
+    m_viewportWidth = presetState.renderContext.viewportSizeX;
+    m_viewportHeight = presetState.renderContext.viewportSizeY;
+    m_staticMeshChanged = true;
+
     // Either viewport size or mesh size changed, reinitialize the vertices.
+    m_allVertices.Clear();
+    m_radiusVertices.Clear();
+    std::unordered_map<float, size_t> radiusIndices;
+
     int vertexIndex{0};
     for (int gridY = 0; gridY <= m_gridSizeY; gridY++)
     {
@@ -163,8 +377,10 @@ void PerPixelMesh::InitializeMesh(const PresetState& presetState)
         {
             auto& vertex = m_vertices.at(vertexIndex);
 
-            vertex.x = static_cast<float>(gridX) / static_cast<float>(m_gridSizeX) * 2.0f - 1.0f;
-            vertex.y = static_cast<float>(gridY) / static_cast<float>(m_gridSizeY) * 2.0f - 1.0f;
+            // Calculated from the offset to the center, so the coordinates of mirrored vertices only
+            // differ in sign and all four quadrants share exactly the same radii.
+            vertex.x = static_cast<float>(gridX * 2 - m_gridSizeX) / static_cast<float>(m_gridSizeX);
+            vertex.y = static_cast<float>(gridY * 2 - m_gridSizeY) / static_cast<float>(m_gridSizeY);
 
             // Milkdrop uses sqrtf, but hypotf is probably safer.
             vertex.radius = hypotf(vertex.x * aspectX, vertex.y * aspectY);
@@ -177,6 +393,20 @@ void PerPixelMesh::InitializeMesh(const PresetState& presetState)
                 vertex.angle = atan2f(vertex.y * aspectY, vertex.x * aspectX);
             }
 
+            // The per-pixel code inputs only depend on the grid and aspect ratio. They're calculated
+            // in single precision, so storing them as floats doesn't lose anything.
+            auto const inputX = vertex.x * 0.5f * aspectX + 0.5f;
+            auto const inputY = vertex.y * -0.5f * aspectY + 0.5f;
+            m_allVertices.Add(vertexIndex, inputX, inputY, vertex.radius, vertex.angle);
+
+            // Group vertices by radius for per-pixel code only depending on rad.
+            auto const radius = radiusIndices.emplace(vertex.radius, m_radiusVertices.vertices.size());
+            if (radius.second)
+            {
+                m_radiusVertices.Add(vertexIndex, inputX, inputY, vertex.radius, vertex.angle);
+            }
+            m_radiusIndices[vertexIndex] = radius.first->second;
+
             vertexIndex++;
         }
     }
@@ -217,9 +447,40 @@ void PerPixelMesh::InitializeMesh(const PresetState& presetState)
     }
 }
 
-void PerPixelMesh::CalculateMesh(const PresetState& presetState, const PerFrameContext& perFrameContext, PerPixelContext& perPixelContext)
+void PerPixelMesh::CalculateMesh(const PerFrameContext& perFrameContext, PerPixelContext& perPixelContext)
 {
-    // Cache some per-frame values as floats
+    PROJECTM_PROFILE_STAGE(CalculateMesh);
+
+    if (perPixelContext.HasCode())
+    {
+        switch (perPixelContext.Dependency())
+        {
+            case PerPixelContext::VertexDependency::Invariant:
+                // Same results for all vertices, so only run the code once.
+                EvaluateVertices(perFrameContext, perPixelContext, m_allVertices, 1);
+                for (auto& curVertex : m_vertices)
+                {
+                    CopyMotion(m_vertices[0], curVertex);
+                }
+                break;
+
+            case PerPixelContext::VertexDependency::RadiusOnly:
+                // Run the code once per distinct radius, then copy the results to all vertices with the same radius.
+                EvaluateVertices(perFrameContext, perPixelContext, m_radiusVertices, m_radiusVertices.vertices.size());
+                for (size_t vertex = 0; vertex < m_vertices.size(); vertex++)
+                {
+                    CopyMotion(m_vertices[m_radiusVertices.vertices[m_radiusIndices[vertex]]], m_vertices[vertex]);
+                }
+                break;
+
+            default:
+                EvaluateVertices(perFrameContext, perPixelContext, m_allVertices, m_allVertices.vertices.size());
+                break;
+        }
+        return;
+    }
+
+    // Cache some per-frame values as floats and use them for all vertices
     float zoom = static_cast<float>(*perFrameContext.zoom);
     float zoomExp = static_cast<float>(*perFrameContext.zoomexp);
     float rot = static_cast<float>(*perFrameContext.rot);
@@ -231,65 +492,117 @@ void PerPixelMesh::CalculateMesh(const PresetState& presetState, const PerFrameC
     float sx = static_cast<float>(*perFrameContext.sx);
     float sy = static_cast<float>(*perFrameContext.sy);
 
-    int vertex = 0;
+    for (auto& curVertex : m_vertices)
+    {
+        curVertex.zoom = zoom;
+        curVertex.zoomExp = zoomExp;
+        curVertex.rot = rot;
+        curVertex.warp = warp;
+        curVertex.centerX = cx;
+        curVertex.centerY = cy;
+        curVertex.distanceX = dx;
+        curVertex.distanceY = dy;
+        curVertex.stretchX = sx;
+        curVertex.stretchY = sy;
+    }
+}
+
+void PerPixelMesh::EvaluateVertices(const PerFrameContext& perFrameContext,
+                                    PerPixelContext& perPixelContext,
+                                    const VertexInputs& inputs,
+                                    size_t count)
+{
+    // Per-pixel code using gmegabuf, regXX vars or other shared state must run on a single thread.
+    size_t bandCount{1};
+    if (perPixelContext.SupportsMultithreading())
+    {
+        bandCount = std::max(std::min(m_workerPool->ThreadCount(), count / MinVerticesPerBand), size_t{1});
+    }
 
-    // Can't make this multithreaded as per-pixel code may use gmegabuf or regXX vars.
-    for (int y = 0; y <= m_gridSizeY; y++)
+    if (m_bands.size() < bandCount)
     {
-        for (int x = 0; x <= m_gridSizeX; x++)
+        m_bands.resize(bandCount);
+    }
+
+    if (bandCount == 1)
+    {
+        CalculateVertexRange(perFrameContext, perPixelContext, m_bands[0].block, inputs, 0, count);
+        return;
+    }
+
+    // Split the vertices into bands, each evaluated with its own context.
+    for (size_t band = 1; band < bandCount; band++)
+    {
+        if (!m_bands[band].context)
         {
-            auto& curVertex = m_vertices[vertex];
+            m_bands[band].context = perPixelContext.Clone();
+        }
+        else
+        {
+            m_bands[band].context->LoadVariablesFrom(perPixelContext);
+        }
+    }
 
-            // Execute per-vertex/per-pixel code if the preset uses it.
-            if (perPixelContext.perPixelCodeHandle)
-            {
-                *perPixelContext.x = static_cast<double>(curVertex.x * 0.5f * presetState.renderContext.aspectX + 0.5f);
-                *perPixelContext.y = static_cast<double>(curVertex.y * -0.5f * presetState.renderContext.aspectY + 0.5f);
-                *perPixelContext.rad = static_cast<double>(curVertex.radius);
-                *perPixelContext.ang = static_cast<double>(curVertex.angle);
-                *perPixelContext.zoom = static_cast<double>(*perFrameContext.zoom);
-                *perPixelContext.zoomexp = static_cast<double>(*perFrameContext.zoomexp);
-                *perPixelContext.rot = static_cast<double>(*perFrameContext.rot);
-                *perPixelContext.warp = static_cast<double>(*perFrameContext.warp);
-                *perPixelContext.cx = static_cast<double>(*perFrameContext.cx);
-                *perPixelContext.cy = static_cast<double>(*perFrameContext.cy);
-                *perPixelContext.dx = static_cast<double>(*perFrameContext.dx);
-                *perPixelContext.dy = static_cast<double>(*perFrameContext.dy);
-                *perPixelContext.sx = static_cast<double>(*perFrameContext.sx);
-                *perPixelContext.sy = static_cast<double>(*perFrameContext.sy);
-
-                perPixelContext.ExecutePerPixelCode();
-
-                curVertex.zoom = static_cast<float>(*perPixelContext.zoom);
-                curVertex.zoomExp = static_cast<float>(*perPixelContext.zoomexp);
-                curVertex.rot = static_cast<float>(*perPixelContext.rot);
-                curVertex.warp = static_cast<float>(*perPixelContext.warp);
-                curVertex.centerX = static_cast<float>(*perPixelContext.cx);
-                curVertex.centerY = static_cast<float>(*perPixelContext.cy);
-                curVertex.distanceX = static_cast<float>(*perPixelContext.dx);
-                curVertex.distanceY = static_cast<float>(*perPixelContext.dy);
-                curVertex.stretchX = static_cast<float>(*perPixelContext.sx);
-                curVertex.stretchY = static_cast<float>(*perPixelContext.sy);
-            }
-            else
-            {
-                curVertex.zoom = zoom;
-                curVertex.zoomExp = zoomExp;
-                curVertex.rot = rot;
-                curVertex.warp = warp;
-                curVertex.centerX = cx;
-                curVertex.centerY = cy;
-                curVertex.distanceX = dx;
-                curVertex.distanceY = dy;
-                curVertex.stretchX = sx;
-                curVertex.stretchY = sy;
-            }
+    m_workerPool->Run(bandCount, [&](size_t band) {
+        auto& context = band == 0 ? perPixelContext : *m_bands[band].context;
+        CalculateVertexRange(perFrameContext, context, m_bands[band].block, inputs,
+                             count * band / bandCount, count * (band + 1) / bandCount);
+    });
+}
 
-            vertex++;
+void PerPixelMesh::CalculateVertexRange(const PerFrameContext& perFrameContext,
+                                        PerPixelContext& perPixelContext,
+                                        PerPixelContext::VertexBlock& block,
+                                        const VertexInputs& inputs,
+                                        size_t begin, size_t end)
+{
+    // Execute per-vertex/per-pixel code in blocks, then copy the results into the vertices.
+    for (size_t first = begin; first < end; first += PerPixelContext::BlockSize)
+    {
+        block.count = std::min(PerPixelContext::BlockSize, end - first);
+        block.x = inputs.x.data() + first;
+        block.y = inputs.y.data() + first;
+        block.rad = inputs.rad.data() + first;
+        block.ang = inputs.ang.data() + first;
+
+        perPixelContext.ExecutePerPixelCode(perFrameContext, block);
+
+        for (size_t index = 0; index < block.count; index++)
+        {
+            auto& curVertex = m_vertices[inputs.vertices[first + index]];
+
+            curVertex.zoom = block.zoom[index];
+            curVertex.zoomExp = block.zoomExp[index];
+            curVertex.rot = block.rot[index];
+            curVertex.warp = block.warp[index];
+            curVertex.centerX = block.centerX[index];
+            curVertex.centerY = block.centerY[index];
+            curVertex.distanceX = block.distanceX[index];
+            curVertex.distanceY = block.distanceY[index];
+            curVertex.stretchX = block.stretchX[index];
+            curVertex.stretchY = block.stretchY[index];
         }
     }
 }
 
+void PerPixelMesh::VertexInputs::Clear()
+{
+    x.clear();
+    y.clear();
+    rad.clear();
+    ang.clear();
+    vertices.clear();
+}
+
+void PerPixelMesh::VertexInputs::Add(size_t vertexIndex, float inputX, float inputY, float inputRad, float inputAng)
+{
+    x.push_back(inputX);
+    y.push_back(inputY);
+    rad.push_back(inputRad);
+    ang.push_back(inputAng);
+    vertices.push_back(vertexIndex);
+}
+
 void PerPixelMesh::WarpedBlit(const PresetState& presetState,
                               const PerFrameContext& perFrameContext)
 {
@@ -319,34 +632,34 @@ void PerPixelMesh::WarpedBlit(const PresetState& presetState,
     // No blending between presets here, so we make sure blending is disabled.
     glDisable(GL_BLEND);
 
+    Renderer::Shader* shader{};
     if (!m_warpShader)
     {
-        m_perPixelMeshShader.Bind();
-        m_perPixelMeshShader.SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
-        m_perPixelMeshShader.SetUniformInt("texture_sampler", 0);
-        m_perPixelMeshShader.SetUniformFloat4("aspect", {presetState.renderContext.aspectX,
-                                                         presetState.renderContext.aspectY,
-                                                         presetState.renderContext.invAspectX,
-                                                         presetState.renderContext.invAspectY});
-        m_perPixelMeshShader.SetUniformFloat("warpTime", warpTime);
-        m_perPixelMeshShader.SetUniformFloat("warpScaleInverse", warpScaleInverse);
-        m_perPixelMeshShader.SetUniformFloat4("warpFactors", warpFactors);
-        m_perPixelMeshShader.SetUniformFloat2("texelOffset", texelOffsets);
-        m_perPixelMeshShader.SetUniformFloat("decay", decay);
+        shader = m_evaluateOnGpu ? &m_perPixelCodeShader : &m_perPixelMeshShader;
+        shader->Bind();
+        shader->SetUniformMat4x4("vertex_transformation", PresetState::orthogonalProjection);
+        shader->SetUniformInt("texture_sampler", 0);
     }
     else
     {
         m_warpShader->LoadVariables(presetState, perFrameContext);
-        auto& shader = m_warpShader->Shader();
-        shader.SetUniformFloat4("aspect", {presetState.renderContext.aspectX,
-                                           presetState.renderContext.aspectY,
-                                           presetState.renderContext.invAspectX,
-                                           presetState.renderContext.invAspectY});
-        shader.SetUniformFloat("warpTime", warpTime);
-        shader.SetUniformFloat("warpScaleInverse", warpScaleInverse);
-        shader.SetUniformFloat4("warpFactors", warpFactors);
-        shader.SetUniformFloat2("texelOffset", texelOffsets);
-        shader.SetUniformFloat("decay", decay);
+        shader = &m_warpShader->Shader();
+    }
+
+    shader->SetUniformFloat4("aspect", {presetState.renderContext.aspectX,
+                                        presetState.renderContext.aspectY,
+                                        presetState.renderContext.invAspectX,
+                                        presetState.renderContext.invAspectY});
+    shader->SetUniformFloat("warpTime", warpTime);
+    shader->SetUniformFloat("warpScaleInverse", warpScaleInverse);
+    shader->SetUniformFloat4("warpFactors", warpFactors);
+    shader->SetUniformFloat2("texelOffset", texelOffsets);
+    shader->SetUniformFloat("decay", decay);
+
+    // Per-frame inputs of the per-pixel code in the vertex shader.
+    for (const auto& uniform : m_gpuUniforms)
+    {
+        shader->SetUniformFloat(uniform.first.c_str(), static_cast<float>(*uniform.second));
     }
 
     assert(!presetState.mainTexture.expired());
@@ -363,6 +676,28 @@ void PerPixelMesh::WarpedBlit(const PresetState& presetState,
     }
     m_perPixelSampler.Bind(0);
 
+    if (m_evaluateOnGpu)
+    {
+        glBindVertexArray(m_staticVaoID);
+
+        if (m_staticMeshChanged)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_staticVboID);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(MeshVertex) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * m_listIndices.size(), m_listIndices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            m_staticMeshChanged = false;
+        }
+
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_listIndices.size()), GL_UNSIGNED_INT, nullptr);
+
+        glBindVertexArray(0);
+
+        Renderer::Sampler::Unbind(0);
+        Renderer::Shader::Unbind();
+        return;
+    }
+
     glBindVertexArray(m_vaoID);
     glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
 
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "PerPixelContext.hpp"
+
 #include <Renderer/RenderItem.hpp>
 #include <Renderer/Shader.hpp>
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace libprojectM {
@@ -11,8 +16,8 @@ namespace MilkdropPreset {
 
 class PresetState;
 class PerFrameContext;
-class PerPixelContext;
 class MilkdropShader;
+class WorkerPool;
 
 /**
  * @brief The "per-pixel" transformation mesh.
@@ -24,6 +29,8 @@ class MilkdropShader;
  *
  * A higher resolution grid means better quality, especially for rotations, but also quickly
  * increases the CPU usage as the per-pixel expression needs to be run for every grid point.
+ * If the per-pixel code can be translated into GLSL, it is evaluated in the vertex shader instead
+ * and the mesh vertices are only uploaded once.
  *
  * The mesh size can be changed between frames, the class will reallocate the buffers if needed.
  */
@@ -32,6 +39,8 @@ class PerPixelMesh : public Renderer::RenderItem
 public:
     PerPixelMesh();
 
+    ~PerPixelMesh() override;
+
     void InitVertexAttrib() override;
 
     /**
@@ -42,9 +51,26 @@ public:
 
     /**
      * @brief Loads the required textures and compiles the warp shader.
+     *
+     * Also tries to compile the per-pixel code into the warp vertex shader. If this fails, the
+     * per-pixel code is evaluated on the CPU.
+     *
      * @param presetState The preset state to retrieve the configuration values from.
+     * @param perFrameContext The per-frame context to retrieve the initial motion values from.
+     * @param perPixelContext The per-pixel code context with the compiled code.
      */
-    void CompileWarpShader(PresetState& presetState);
+    void CompileWarpShader(PresetState& presetState,
+                           const PerFrameContext& perFrameContext,
+                           const PerPixelContext& perPixelContext);
+
+    /**
+     * @brief Returns whether the per-pixel code is evaluated in the warp vertex shader.
+     * @return True if the per-pixel code runs on the GPU, false if it runs on the CPU.
+     */
+    auto EvaluatesOnGpu() const -> bool
+    {
+        return m_evaluateOnGpu;
+    }
 
     /**
      * @brief Renders the transformation mesh.
@@ -84,6 +110,33 @@ private:
 
     using VertexList = std::vector<MeshVertex>;
 
+    /**
+     * @brief Per-pixel code inputs for a list of mesh vertices, stored as structure of arrays.
+     */
+    struct VertexInputs
+    {
+        /**
+         * @brief Removes all entries.
+         */
+        void Clear();
+
+        /**
+         * @brief Adds the inputs of a mesh vertex.
+         * @param vertexIndex The index of the vertex in the mesh.
+         * @param inputX The per-pixel code x input.
+         * @param inputY The per-pixel code y input.
+         * @param inputRad The per-pixel code rad input.
+         * @param inputAng The per-pixel code ang input.
+         */
+        void Add(size_t vertexIndex, float inputX, float inputY, float inputRad, float inputAng);
+
+        std::vector<float> x;         //!< Per-pixel code input x.
+        std::vector<float> y;         //!< Per-pixel code input y.
+        std::vector<float> rad;       //!< Per-pixel code input rad.
+        std::vector<float> ang;       //!< Per-pixel code input ang.
+        std::vector<size_t> vertices; //!< Index of the mesh vertex receiving the results.
+    };
+
     /**
      * @brief Initializes the vertex array and fills in static data if needed.
      *
@@ -97,14 +150,57 @@ private:
     /**
      * @brief Executes the per-pixel code and calculates the u/v coordinates.
      * The x/y coordinates are either a static grid or computed by the per-vertex expression.
-     * @param presetState The preset state to retrieve the configuration values from.
      * @param presetPerFrameContext The per-frame context to retrieve the initial vars from.
      * @param perPixelContext The per-pixel code context to use.
      */
-    void CalculateMesh(const PresetState& presetState,
-                       const PerFrameContext& perFrameContext,
+    void CalculateMesh(const PerFrameContext& perFrameContext,
                        PerPixelContext& perPixelContext);
 
+    /**
+     * @brief Executes the per-pixel code for the first count entries of the given inputs.
+     *
+     * If the code supports it, the inputs are split into bands which are evaluated on multiple threads.
+     *
+     * @param perFrameContext The per-frame context to retrieve the initial vars from.
+     * @param perPixelContext The per-pixel code context to use.
+     * @param inputs The vertices to evaluate.
+     * @param count The number of entries to evaluate.
+     */
+    void EvaluateVertices(const PerFrameContext& perFrameContext,
+                          PerPixelContext& perPixelContext,
+                          const VertexInputs& inputs,
+                          size_t count);
+
+    /**
+     * @brief Executes the per-pixel code for a range of inputs and stores the results in the vertices.
+     * @param perFrameContext The per-frame context to retrieve the initial vars from.
+     * @param perPixelContext The per-pixel code context to use.
+     * @param block Storage for the per-pixel code inputs and results.
+     * @param inputs The vertices to evaluate.
+     * @param begin Index of the first entry in inputs.
+     * @param end Index after the last entry in inputs.
+     */
+    void CalculateVertexRange(const PerFrameContext& perFrameContext,
+                              PerPixelContext& perPixelContext,
+                              PerPixelContext::VertexBlock& block,
+                              const VertexInputs& inputs,
+                              size_t begin, size_t end);
+
+    /**
+     * @brief Compiles the default warp shader with the per-pixel code evaluated in the vertex shader.
+     *
+     * Nothing is compiled if GPU evaluation is disabled in the render context, the preset has no
+     * per-pixel code, the code can't be translated to GLSL or reads time or frame.
+     *
+     * @param presetState The preset state to retrieve the render context from.
+     * @param perFrameContext The per-frame context to retrieve the initial motion values from.
+     * @param perPixelContext The per-pixel code context with the translated code.
+     * @return The vertex shader source, or an empty string if the code can't be evaluated on the GPU.
+     */
+    auto CompilePerPixelCodeShader(const PresetState& presetState,
+                                   const PerFrameContext& perFrameContext,
+                                   const PerPixelContext& perPixelContext) -> std::string;
+
     /**
      * @brief Draws the warp mesh with or without a warp shader.
      * If the preset doesn't use a warp shader, a default textured shader is used.
@@ -119,10 +215,34 @@ private:
 
     VertexList m_vertices; //!< The calculated mesh vertices.
 
+    VertexInputs m_allVertices;          //!< Per-pixel code inputs for every vertex.
+    VertexInputs m_radiusVertices;       //!< Per-pixel code inputs for one vertex per distinct radius.
+    std::vector<size_t> m_radiusIndices; //!< For each vertex, the index of its radius in m_radiusVertices.
+
+    /**
+     * @brief Per-pixel code state for one band of vertices evaluated on a worker thread.
+     */
+    struct Band
+    {
+        std::unique_ptr<PerPixelContext> context; //!< Cloned per-pixel context. Band 0 uses the preset's context.
+        PerPixelContext::VertexBlock block;       //!< Inputs and results of the per-pixel code for one block of vertices.
+    };
+
+    std::shared_ptr<WorkerPool> m_workerPool; //!< Threads evaluating the mesh bands.
+    std::vector<Band> m_bands;                //!< One entry per band of vertices.
+
     std::vector<int> m_listIndices; //!< List of vertex indices to render.
     VertexList m_drawVertices;      //!< Temp data buffer for the vertices to be drawn.
 
+    bool m_evaluateOnGpu{};                                                //!< True if the per-pixel code is evaluated in the vertex shader.
+    std::vector<std::pair<std::string, const PRJM_EVAL_F*>> m_gpuUniforms; //!< Per-pixel code inputs, uniform name and value source.
+    GLuint m_staticVaoID{};                                                //!< Vertex array object for drawing the mesh with the per-pixel code evaluated on the GPU.
+    GLuint m_staticVboID{};                                                //!< Mesh vertices, only uploaded when the mesh changes.
+    GLuint m_staticIboID{};                                                //!< Triangle list indices, only uploaded when the mesh changes.
+    bool m_staticMeshChanged{true};                                        //!< True if the static buffers need to be uploaded again.
+
     Renderer::Shader m_perPixelMeshShader;                            //!< Special shader which calculates the per-pixel UV coordinates.
+    Renderer::Shader m_perPixelCodeShader;                            //!< The same shader with the per-pixel code evaluated on the GPU.
     std::unique_ptr<MilkdropShader> m_warpShader;           //!< The warp shader. Either preset-defined or a default shader.
     Renderer::Sampler m_perPixelSampler{GL_CLAMP_TO_EDGE, GL_LINEAR}; //!< The main texture sampler.
 };
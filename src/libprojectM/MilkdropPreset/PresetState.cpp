@@ -12,6 +12,7 @@ namespace MilkdropPreset {
 
 const glm::mat4 PresetState::orthogonalProjection = glm::ortho(-1.0f, 1.0f, 1.0f, -1.0f, -40.0f, 40.0f);
 const glm::mat4 PresetState::orthogonalProjectionFlipped = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -40.0f, 40.0f);
+const libprojectM::Audio::FrameAudioData PresetState::silentAudioData{};
 
 PresetState::PresetState()
     : globalMemory(projectm_eval_memory_buffer_create())
@@ -21,6 +22,12 @@ PresetState::PresetState()
                                     staticShaders->GetUntexturedDrawFragmentShader());
     texturedShader.CompileProgram(staticShaders->GetTexturedDrawVertexShader(),
                                   staticShaders->GetTexturedDrawFragmentShader());
+    untexturedShapeShader.CompileProgram(staticShaders->GetShapeVertexShader(),
+                                         staticShaders->GetUntexturedDrawFragmentShader());
+    texturedShapeShader.CompileProgram(staticShaders->GetShapeVertexShader(),
+                                       staticShaders->GetTexturedDrawFragmentShader());
+    shapeBorderShader.CompileProgram(staticShaders->GetShapeBorderVertexShader(),
+                                     staticShaders->GetUntexturedDrawFragmentShader());
 
     std::random_device randomDevice;
     std::mt19937 randomGenerator(randomDevice());
@@ -8,6 +8,7 @@
 #include "Constants.hpp"
 
 #include "BlurTexture.hpp"
+#include "VariableBlock.hpp"
 
 #include <Audio/FrameAudioData.hpp>
 
@@ -126,12 +127,13 @@ public:
 
     std::array<float, 4> hueRandomOffsets; //!< Per-preset constant offsets for the hue animation
 
-    projectm_eval_mem_buffer globalMemory{nullptr};  //!< gmegabuf data. Using per-frame buffers in projectM to reduce interference.
-    double globalRegisters[100]{};                   //!< Global reg00-reg99 variables.
-    std::array<double, QVarCount> frameQVariables{}; //!< Q variables after per-frame code evaluation.
+    projectm_eval_mem_buffer globalMemory{nullptr}; //!< gmegabuf data. Using per-frame buffers in projectM to reduce interference.
+    double globalRegisters[100]{};                  //!< Global reg00-reg99 variables.
+    FrameVariableBlock frameVariables;              //!< Time and audio variables passed to all code contexts, updated before the per-frame code runs.
+    QVariableBlock frameQVariables;                 //!< Q variables after per-frame code evaluation.
 
-    libprojectM::Audio::FrameAudioData audioData; //!< Holds audio/spectrum data and values for beat detection.
-    Renderer::RenderContext renderContext;        //!< Current renderer state data like viewport size and generic shaders.
+    const libprojectM::Audio::FrameAudioData* audioData{&silentAudioData}; //!< Audio/spectrum data and values for beat detection of the current frame. Owned by the audio analyzer.
+    Renderer::RenderContext renderContext;                                 //!< Current renderer state data like viewport size and generic shaders.
 
     std::string perFrameInitCode; //!< Preset init code, run once on load.
     std::string perFrameCode;     //!< Preset per-frame code, run once at the start of each frame.
@@ -150,6 +152,10 @@ public:
     Renderer::Shader untexturedShader; //!< Shader used to draw untextured primitives, e.g. waveforms.
     Renderer::Shader texturedShader;   //!< Shader used to draw textured primitives, e.g. textured shapes and the warp mesh.
 
+    Renderer::Shader untexturedShapeShader; //!< Shader used to draw instanced untextured custom shapes.
+    Renderer::Shader texturedShapeShader;   //!< Shader used to draw instanced textured custom shapes.
+    Renderer::Shader shapeBorderShader;     //!< Shader used to draw instanced custom shape outlines.
+
     std::weak_ptr<Renderer::Texture> mainTexture; //!< A weak reference to the main texture in the preset framebuffer.
     BlurTexture blurTexture;                      //!< The blur textures used in this preset. Contents depend on the shader code using GetBlurX().
 
@@ -157,6 +163,8 @@ public:
 
     static const glm::mat4 orthogonalProjection;        //!< Projection matrix that transforms DirectX screen-space coordinates into the OpenGL coordinate frame.
     static const glm::mat4 orthogonalProjectionFlipped; //!< Projection matrix that transforms DirectX screen-space coordinates into the OpenGL coordinate frame.
+
+    static const libprojectM::Audio::FrameAudioData silentAudioData; //!< Empty audio data used before the first frame is rendered.
 };
 
 } // namespace MilkdropPreset
@@ -3,10 +3,6 @@ precision mediump float;
 #define pos vertex_position
 #define radius rad_ang.x
 #define angle rad_ang.y
-#define zoom transforms.x
-#define zoomExp transforms.y
-#define rot transforms.z
-#define warp transforms.w
 
 #define aspectX aspect.x
 #define aspectY aspect.y
@@ -16,9 +12,9 @@ precision mediump float;
 layout(location = 0) in vec2 vertex_position;
 layout(location = 1) in vec2 rad_ang;
 layout(location = 2) in vec4 transforms;
-layout(location = 3) in vec2 center;
-layout(location = 4) in vec2 distance;
-layout(location = 5) in vec2 stretch;
+layout(location = 3) in vec2 vertex_center;
+layout(location = 4) in vec2 vertex_distance;
+layout(location = 5) in vec2 vertex_stretch;
 
 uniform mat4 vertex_transformation;
 uniform vec4 aspect;
@@ -32,9 +28,22 @@ out vec4 frag_COLOR;
 out vec4 frag_TEXCOORD0;
 out vec2 frag_TEXCOORD1;
 
+// PER_PIXEL_DECLARATIONS
+
 void main() {
     gl_Position = vertex_transformation * vec4(pos, 0.0, 1.0);
 
+    // Motion values, either calculated on the CPU or by the per-pixel code inserted below.
+    float zoom = transforms.x;
+    float zoomExp = transforms.y;
+    float rot = transforms.z;
+    float warp = transforms.w;
+    vec2 center = vertex_center;
+    vec2 distance = vertex_distance;
+    vec2 stretch = vertex_stretch;
+
+    // PER_PIXEL_CODE
+
     float zoom2 = pow(zoom, pow(zoomExp, radius * 2.0 - 1.0));
     float zoom2Inverse = 1.0 / zoom2;
 
@@ -0,0 +1,22 @@
+precision highp float;
+
+layout(location = 0) in vec3 vertex_corner;
+layout(location = 1) in vec4 instance_transform;
+layout(location = 2) in vec4 instance_rotation;
+layout(location = 5) in vec4 instance_border_color;
+
+uniform mat4 vertex_transformation;
+uniform float aspect_y;
+uniform vec2 vertex_offset;
+
+out vec4 fragment_color;
+
+// Same corner placement as the shape fill, moved by vertex_offset to draw thick outlines.
+void main(){
+    vec2 corner = vec2(vertex_corner.x * instance_rotation.x - vertex_corner.y * instance_rotation.y,
+                       vertex_corner.x * instance_rotation.y + vertex_corner.y * instance_rotation.x);
+    vec2 position = instance_transform.xy + instance_transform.z * vec2(corner.x * aspect_y, corner.y) + vertex_offset;
+
+    gl_Position = vertex_transformation * vec4(position, 0.0, 1.0);
+    fragment_color = instance_border_color;
+}
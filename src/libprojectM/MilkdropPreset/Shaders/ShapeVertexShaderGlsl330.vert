@@ -0,0 +1,30 @@
+precision highp float;
+
+layout(location = 0) in vec3 vertex_corner;
+layout(location = 1) in vec4 instance_transform;
+layout(location = 2) in vec4 instance_rotation;
+layout(location = 3) in vec4 instance_color;
+layout(location = 4) in vec4 instance_edge_color;
+
+uniform mat4 vertex_transformation;
+uniform float aspect_y;
+uniform float texture_aspect_y;
+
+out vec4 fragment_color;
+out vec2 fragment_texture;
+
+// vertex_corner.xy is the unrotated unit circle position, z is 0.0 for the center and 1.0 for the corners.
+// instance_transform holds the center x/y, the radius and the inverse texture zoom.
+// instance_rotation holds cos/sin of the shape angle and cos/sin of the texture angle.
+void main(){
+    vec2 corner = vec2(vertex_corner.x * instance_rotation.x - vertex_corner.y * instance_rotation.y,
+                       vertex_corner.x * instance_rotation.y + vertex_corner.y * instance_rotation.x);
+    vec2 position = instance_transform.xy + instance_transform.z * vec2(corner.x * aspect_y, corner.y);
+
+    gl_Position = vertex_transformation * vec4(position, 0.0, 1.0);
+    fragment_color = mix(instance_color, instance_edge_color, vertex_corner.z);
+
+    vec2 textureCorner = vec2(vertex_corner.x * instance_rotation.z - vertex_corner.y * instance_rotation.w,
+                              vertex_corner.x * instance_rotation.w + vertex_corner.y * instance_rotation.z);
+    fragment_texture = vec2(0.5) + 0.5 * instance_transform.w * vec2(textureCorner.x * texture_aspect_y, textureCorner.y);
+}
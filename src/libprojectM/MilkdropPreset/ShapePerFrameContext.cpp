@@ -1,9 +1,13 @@
 #include "ShapePerFrameContext.hpp"
 
+#include "CodeAnalysis.hpp"
 #include "CustomShape.hpp"
+#include "ExpressionOptimizer.hpp"
 #include "MilkdropPresetExceptions.hpp"
 #include "PerFrameContext.hpp"
 
+#include <algorithm>
+
 #ifdef MILKDROP_PRESET_DEBUG
 #include <iostream>
 #endif
@@ -14,6 +18,25 @@
 namespace libprojectM {
 namespace MilkdropPreset {
 
+auto ShapeVariables::Names() -> const std::array<std::string, Count>&
+{
+    static const auto names = [] {
+        std::array<std::string, Count> blockNames;
+        std::copy(FrameVariables::Names().begin(), FrameVariables::Names().end(), blockNames.begin() + FrameValues);
+        std::copy(QVariableNames().begin(), QVariableNames().end(), blockNames.begin() + QValues);
+        std::copy(TVariableNames().begin(), TVariableNames().end(), blockNames.begin() + TValues);
+
+        std::array<const char*, Count - X> const shapeNames{
+            "x", "y", "rad", "ang", "tex_zoom", "tex_ang", "sides", "additive", "textured", "num_inst", "thick",
+            "r", "g", "b", "a", "r2", "g2", "b2", "a2", "border_r", "border_g", "border_b", "border_a"};
+        std::copy(shapeNames.begin(), shapeNames.end(), blockNames.begin() + X);
+
+        return blockNames;
+    }();
+
+    return names;
+}
+
 ShapePerFrameContext::ShapePerFrameContext(projectm_eval_mem_buffer gmegabuf, PRJM_EVAL_F (*globalRegisters)[100])
     : perFrameCodeContext(projectm_eval_context_create(gmegabuf, globalRegisters))
 {
@@ -36,29 +59,6 @@ void ShapePerFrameContext::RegisterBuiltinVariables()
 {
     projectm_eval_context_reset_variables(perFrameCodeContext);
 
-    REG_VAR(time);
-    REG_VAR(fps);
-    REG_VAR(frame);
-    REG_VAR(progress);
-
-    for (int q = 0; q < QVarCount; q++)
-    {
-        std::string qvar = "q" + std::to_string(q + 1);
-        q_vars[q] = projectm_eval_context_register_variable(perFrameCodeContext, qvar.c_str());
-    }
-
-    for (int t = 0; t < TVarCount; t++)
-    {
-        std::string tvar = "t" + std::to_string(t + 1);
-        t_vars[t] = projectm_eval_context_register_variable(perFrameCodeContext, tvar.c_str());
-    }
-
-    REG_VAR(bass);
-    REG_VAR(mid);
-    REG_VAR(treb);
-    REG_VAR(bass_att);
-    REG_VAR(mid_att);
-    REG_VAR(treb_att);
     REG_VAR(x);
     REG_VAR(y);
     REG_VAR(rad);
@@ -83,56 +83,53 @@ void ShapePerFrameContext::RegisterBuiltinVariables()
     REG_VAR(border_g);
     REG_VAR(border_b);
     REG_VAR(border_a);
+
+    t_vars.Register(perFrameCodeContext, TVariableNames());
+    m_stateVariables.Register(perFrameCodeContext, ShapeVariables::Names());
 }
 void ShapePerFrameContext::LoadStateVariables(const PresetState& state,
-                                              CustomShape& shape,
-                                              int inst)
+                                              const CustomShape& shape)
 {
-    *time = static_cast<double>(state.renderContext.time);
-    *frame = static_cast<double>(state.renderContext.frame);
-    *fps = static_cast<double>(state.renderContext.fps);
-    *progress = static_cast<double>(state.renderContext.progress);
-    *bass = static_cast<double>(state.audioData.bass);
-    *mid = static_cast<double>(state.audioData.mid);
-    *treb = static_cast<double>(state.audioData.treb);
-    *bass_att = static_cast<double>(state.audioData.bassAtt);
-    *mid_att = static_cast<double>(state.audioData.midAtt);
-    *treb_att = static_cast<double>(state.audioData.trebAtt);
-
-    for (int q = 0; q < QVarCount; q++)
-    {
-        *q_vars[q] = state.frameQVariables[q];
-    }
+    auto& values = m_stateValues.values;
+    std::copy(state.frameVariables.values.begin(), state.frameVariables.values.end(), values.begin() + ShapeVariables::FrameValues);
+    std::copy(state.frameQVariables.values.begin(), state.frameQVariables.values.end(), values.begin() + ShapeVariables::QValues);
+    std::copy(shape.m_tValuesAfterInitCode.values.begin(), shape.m_tValuesAfterInitCode.values.end(), values.begin() + ShapeVariables::TValues);
+
+    values[ShapeVariables::X] = static_cast<double>(shape.m_x);
+    values[ShapeVariables::Y] = static_cast<double>(shape.m_y);
+    values[ShapeVariables::Rad] = static_cast<double>(shape.m_radius);
+    values[ShapeVariables::Ang] = static_cast<double>(shape.m_angle);
+    values[ShapeVariables::TexZoom] = static_cast<double>(shape.m_tex_zoom);
+    values[ShapeVariables::TexAng] = static_cast<double>(shape.m_tex_ang);
+    values[ShapeVariables::Sides] = static_cast<double>(shape.m_sides);
+    values[ShapeVariables::Additive] = static_cast<double>(shape.m_additive);
+    values[ShapeVariables::Textured] = static_cast<double>(shape.m_textured);
+    values[ShapeVariables::NumInst] = static_cast<double>(shape.m_instances);
+    values[ShapeVariables::Thick] = static_cast<double>(shape.m_thickOutline);
+    values[ShapeVariables::R] = static_cast<double>(shape.m_r);
+    values[ShapeVariables::G] = static_cast<double>(shape.m_g);
+    values[ShapeVariables::B] = static_cast<double>(shape.m_b);
+    values[ShapeVariables::A] = static_cast<double>(shape.m_a);
+    values[ShapeVariables::R2] = static_cast<double>(shape.m_r2);
+    values[ShapeVariables::G2] = static_cast<double>(shape.m_g2);
+    values[ShapeVariables::B2] = static_cast<double>(shape.m_b2);
+    values[ShapeVariables::A2] = static_cast<double>(shape.m_a2);
+    values[ShapeVariables::BorderR] = static_cast<double>(shape.m_border_r);
+    values[ShapeVariables::BorderG] = static_cast<double>(shape.m_border_g);
+    values[ShapeVariables::BorderB] = static_cast<double>(shape.m_border_b);
+    values[ShapeVariables::BorderA] = static_cast<double>(shape.m_border_a);
+
+    m_stateVariables.Load(m_stateValues);
+    *instance = 0.0;
+}
 
-    for (int t = 0; t < TVarCount; t++)
+void ShapePerFrameContext::LoadInstanceVariables(int inst)
+{
+    if (inst > 0)
     {
-        *t_vars[t] = shape.m_tValuesAfterInitCode[t];
+        m_stateVariables.Load(m_stateValues, m_assignedVariables);
     }
-
-    *x = static_cast<double>(shape.m_x);
-    *y = static_cast<double>(shape.m_y);
-    *rad = static_cast<double>(shape.m_radius);
-    *ang = static_cast<double>(shape.m_angle);
-    *tex_zoom = static_cast<double>(shape.m_tex_zoom);
-    *tex_ang = static_cast<double>(shape.m_tex_ang);
-    *sides = static_cast<double>(shape.m_sides);
-    *additive = static_cast<double>(shape.m_additive);
-    *textured = static_cast<double>(shape.m_textured);
-    *num_inst = static_cast<double>(shape.m_instances);
     *instance = static_cast<double>(inst);
-    *thick = static_cast<double>(shape.m_thickOutline);
-    *r = static_cast<double>(shape.m_r);
-    *g = static_cast<double>(shape.m_g);
-    *b = static_cast<double>(shape.m_b);
-    *a = static_cast<double>(shape.m_a);
-    *r2 = static_cast<double>(shape.m_r2);
-    *g2 = static_cast<double>(shape.m_g2);
-    *b2 = static_cast<double>(shape.m_b2);
-    *a2 = static_cast<double>(shape.m_a2);
-    *border_r = static_cast<double>(shape.m_border_r);
-    *border_g = static_cast<double>(shape.m_border_g);
-    *border_b = static_cast<double>(shape.m_border_b);
-    *border_a = static_cast<double>(shape.m_border_a);
 }
 
 void ShapePerFrameContext::EvaluateInitCode(const std::string& perFrameInitCode,
@@ -170,26 +167,49 @@ void ShapePerFrameContext::CompilePerFrameCode(const std::string& perFrameCode,
         return;
     }
 
-    perFrameCodeHandle = projectm_eval_code_compile(perFrameCodeContext, perFrameCode.c_str());
-    if (perFrameCodeHandle == nullptr)
+    // Cached programs were compiled with projectm-eval before, so the interpreter isn't needed.
+    std::string compiledCode = perFrameCode;
+    perFrameCodeJit = JitCode::FromCache(perFrameCodeContext, perFrameCode);
+    if (!perFrameCodeJit)
     {
+        perFrameCodeHandle = CompileCode(perFrameCodeContext, perFrameCode, compiledCode);
+        if (perFrameCodeHandle == nullptr)
+        {
 #ifdef MILKDROP_PRESET_DEBUG
-        int line;
-        int col;
-        auto* errmsg = projectm_eval_get_error(perFrameCodeContext, &line, &col);
-        if (errmsg)
+            int line;
+            int col;
+            auto* errmsg = projectm_eval_get_error(perFrameCodeContext, &line, &col);
+            if (errmsg)
+            {
+                std::cerr << "[Preset] Could not compile custom shape " << shape.m_index << " per-frame code: " << errmsg << "(L" << line << " C" << col << ")" << std::endl;
+            }
+#endif
+            throw MilkdropCompileException("Could not compile custom shape " + std::to_string(shape.m_index) + " per-frame code");
+        }
+
+        perFrameCodeJit = JitCode::Compile(perFrameCodeContext, perFrameCode);
+    }
+
+    auto const analysis = AnalyzeCode(compiledCode);
+    auto const& names = ShapeVariables::Names();
+    m_assignedVariables.clear();
+    for (size_t index = 0; index < ShapeVariables::Count; index++)
+    {
+        if (analysis.assignedVariables.find(names[index]) != analysis.assignedVariables.end())
         {
-            std::cerr << "[Preset] Could not compile custom shape " << shape.m_index << " per-frame code: " << errmsg << "(L" << line << " C" << col << ")" << std::endl;
+            m_assignedVariables.push_back(index);
         }
-#endif
-        throw MilkdropCompileException("Could not compile custom shape " + std::to_string(shape.m_index) + " per-frame code");
     }
 }
 
 
 void ShapePerFrameContext::ExecutePerFrameCode()
 {
-    if (perFrameCodeHandle != nullptr)
+    if (perFrameCodeJit)
+    {
+        perFrameCodeJit->Execute();
+    }
+    else if (perFrameCodeHandle != nullptr)
     {
         projectm_eval_code_execute(perFrameCodeHandle);
     }
@@ -1,6 +1,13 @@
 #pragma once
 
+#include "ExpressionJit.hpp"
 #include "PresetState.hpp"
+#include "VariableBlock.hpp"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
 
 namespace libprojectM {
 namespace MilkdropPreset {
@@ -8,6 +15,52 @@ namespace MilkdropPreset {
 class PerFrameContext;
 class CustomShape;
 
+/**
+ * @brief Layout of the state block loaded into the shape per-frame context.
+ *
+ * Contains all built-in variables except "instance": the time and audio values, followed by
+ * the q and t variables and the shape parameters.
+ */
+struct ShapeVariables
+{
+    enum Index : size_t
+    {
+        FrameValues = 0,                               //!< Start of the time and audio values, in FrameVariables order.
+        QValues = FrameValues + FrameVariables::Count, //!< Start of q1 to q32.
+        TValues = QValues + QVarCount,                 //!< Start of t1 to t8.
+        X = TValues + TVarCount,
+        Y,
+        Rad,
+        Ang,
+        TexZoom,
+        TexAng,
+        Sides,
+        Additive,
+        Textured,
+        NumInst,
+        Thick,
+        R,
+        G,
+        B,
+        A,
+        R2,
+        G2,
+        B2,
+        A2,
+        BorderR,
+        BorderG,
+        BorderB,
+        BorderA,
+        Count
+    };
+
+    /**
+     * @brief Returns the variable names in block order.
+     * @return The lower-case variable names.
+     */
+    static auto Names() -> const std::array<std::string, Count>&;
+};
+
 /**
  * @class ShapePerFrameContext
  * @brief Contains the per-frame execution context and code for shapes. 
@@ -31,13 +84,25 @@ public:
 
     /**
      * @brief Loads the current state values into the expression evaluator variables.
+     *
+     * The values are collected in the shape's state block once per frame, with "instance" set to 0.
+     * Use LoadInstanceVariables() to prepare the context for each following instance.
+     *
      * @param state The preset state container.
      * @param shape The shape this context belongs to.
-     * @param inst The current shape instance.
      */
     void LoadStateVariables(const PresetState& state,
-                            CustomShape& shape,
-                            int inst);
+                            const CustomShape& shape);
+
+    /**
+     * @brief Resets the variables to the state values before running the per-frame code of an instance.
+     *
+     * Variables the per-frame code never assigns still hold the state values, so only the assigned
+     * ones are reloaded from the state block.
+     *
+     * @param inst The shape instance about to be drawn.
+     */
+    void LoadInstanceVariables(int inst);
 
     /**
      * @brief Compiles and runs the preset init code.
@@ -62,20 +127,10 @@ public:
 
     projectm_eval_context* perFrameCodeContext{nullptr}; //!< The code runtime context, holds memory buffers and variables.
     projectm_eval_code* perFrameCodeHandle{nullptr};     //!< The compiled per-frame code handle.
+    std::unique_ptr<JitCode> perFrameCodeJit;            //!< The per-frame code compiled to machine code, or nullptr to use the interpreter.
 
     // Expression variable pointers.
-    PRJM_EVAL_F* time{};
-    PRJM_EVAL_F* fps{};
-    PRJM_EVAL_F* frame{};
-    PRJM_EVAL_F* progress{};
-    PRJM_EVAL_F* q_vars[QVarCount]{};
-    PRJM_EVAL_F* t_vars[TVarCount]{};
-    PRJM_EVAL_F* bass{};
-    PRJM_EVAL_F* mid{};
-    PRJM_EVAL_F* treb{};
-    PRJM_EVAL_F* bass_att{};
-    PRJM_EVAL_F* mid_att{};
-    PRJM_EVAL_F* treb_att{};
+    VariableBinding<TVarCount> t_vars; //!< T variables.
     PRJM_EVAL_F* r{};
     PRJM_EVAL_F* g{};
     PRJM_EVAL_F* b{};
@@ -100,6 +155,11 @@ public:
     PRJM_EVAL_F* instance{};
     PRJM_EVAL_F* tex_zoom{};
     PRJM_EVAL_F* tex_ang{};
+
+private:
+    VariableBinding<ShapeVariables::Count> m_stateVariables; //!< All variables of the state block.
+    VariableBlock<ShapeVariables::Count> m_stateValues;      //!< The state values of the current frame.
+    std::vector<size_t> m_assignedVariables;                 //!< Block indices of the variables assigned by the per-frame code.
 };
 
 } // namespace MilkdropPreset
@@ -0,0 +1,102 @@
+#include "StageProfiler.hpp"
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+constexpr size_t StageProfiler::StageCount;
+constexpr size_t StageProfiler::AverageFrames;
+
+namespace {
+
+thread_local StageProfiler* currentProfiler{nullptr};
+
+auto MillisecondsSince(StageProfiler::Clock::time_point start) -> double
+{
+    return std::chrono::duration<double, std::milli>(StageProfiler::Clock::now() - start).count();
+}
+
+} // namespace
+
+StageProfiler::FrameScope::FrameScope(StageProfiler& profiler)
+    : m_profiler(profiler)
+    , m_previousProfiler(currentProfiler)
+    , m_start(Clock::now())
+{
+    currentProfiler = &m_profiler;
+}
+
+StageProfiler::FrameScope::~FrameScope()
+{
+    m_profiler.Add(Stage::RenderFrame, MillisecondsSince(m_start));
+    m_profiler.EndFrame();
+
+    currentProfiler = m_previousProfiler;
+}
+
+StageProfiler::StageTimer::StageTimer(Stage stage)
+    : m_profiler(currentProfiler)
+    , m_stage(stage)
+{
+    if (m_profiler != nullptr)
+    {
+        m_start = Clock::now();
+    }
+}
+
+StageProfiler::StageTimer::~StageTimer()
+{
+    if (m_profiler != nullptr)
+    {
+        m_profiler->Add(m_stage, MillisecondsSince(m_start));
+    }
+}
+
+auto StageProfiler::Current() -> StageProfiler*
+{
+    return currentProfiler;
+}
+
+void StageProfiler::Add(Stage stage, double milliseconds)
+{
+    m_currentFrame[stage] += milliseconds;
+}
+
+void StageProfiler::EndFrame()
+{
+    auto& oldestFrame = m_history[m_historyIndex];
+    for (size_t stage = 0; stage < StageCount; stage++)
+    {
+        m_historySum[stage] += m_currentFrame[stage] - oldestFrame[stage];
+    }
+
+    oldestFrame = m_currentFrame;
+    m_lastFrame = m_currentFrame;
+    m_currentFrame.fill(0.0);
+
+    m_historyIndex = (m_historyIndex + 1) % AverageFrames;
+    if (m_historyCount < AverageFrames)
+    {
+        m_historyCount++;
+    }
+}
+
+auto StageProfiler::Stats() const -> Preset::FrameStats
+{
+    Preset::FrameStats stats;
+    if (m_historyCount == 0)
+    {
+        return stats;
+    }
+
+    stats.lastFrame = m_lastFrame;
+    for (size_t stage = 0; stage < StageCount; stage++)
+    {
+        stats.average[stage] = m_historySum[stage] / static_cast<double>(m_historyCount);
+    }
+    stats.averageFrames = static_cast<uint32_t>(m_historyCount);
+
+    return stats;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Preset.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief Records the CPU time spent in the render stages of a preset.
+ *
+ * Each preset owns a profiler. While the preset renders a frame, a FrameScope makes its profiler
+ * the current one on the rendering thread, so StageTimer objects further down the call chain
+ * add their time to it without passing the profiler around. Timers on other threads, e.g. in
+ * worker pool tasks, have no current profiler and don't record anything.
+ *
+ * The timers are only placed in the code if libprojectM is built with ENABLE_STAGE_PROFILER,
+ * using the PROJECTM_PROFILE_FRAME() and PROJECTM_PROFILE_STAGE() macros.
+ */
+class StageProfiler
+{
+public:
+    using Stage = Preset::FrameStats::Stage;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t StageCount = Preset::FrameStats::StageCount; //!< Number of recorded stages.
+    static constexpr size_t AverageFrames = 60;                         //!< Number of frames in the rolling average.
+
+    /**
+     * @brief Makes a profiler current for the calling thread and records the enclosed scope as RenderFrame.
+     * Ends the profiler frame when leaving the scope.
+     */
+    class FrameScope
+    {
+    public:
+        explicit FrameScope(StageProfiler& profiler);
+
+        ~FrameScope();
+
+        FrameScope(const FrameScope&) = delete;
+        auto operator=(const FrameScope&) -> FrameScope& = delete;
+
+    private:
+        StageProfiler& m_profiler;         //!< The profiler of the rendered preset.
+        StageProfiler* m_previousProfiler; //!< The profiler current before this scope.
+        Clock::time_point m_start;         //!< Start time of the frame.
+    };
+
+    /**
+     * @brief Adds the time spent in the enclosing scope to a stage of the current profiler.
+     */
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(Stage stage);
+
+        ~StageTimer();
+
+        StageTimer(const StageTimer&) = delete;
+        auto operator=(const StageTimer&) -> StageTimer& = delete;
+
+    private:
+        StageProfiler* m_profiler; //!< The profiler current when the timer was started, or nullptr.
+        Stage m_stage;             //!< The stage the time is added to.
+        Clock::time_point m_start; //!< Start time of the stage.
+    };
+
+    /**
+     * @brief Returns the profiler current on the calling thread.
+     * @return The current profiler, or nullptr if no frame is being profiled on this thread.
+     */
+    static auto Current() -> StageProfiler*;
+
+    /**
+     * @brief Adds time to a stage of the current frame.
+     * @param stage The stage.
+     * @param milliseconds The time spent in the stage.
+     */
+    void Add(Stage stage, double milliseconds);
+
+    /**
+     * @brief Finishes the current frame and updates the last frame and rolling average timings.
+     */
+    void EndFrame();
+
+    /**
+     * @brief Returns the recorded timings.
+     * @return The last frame and average timings.
+     */
+    auto Stats() const -> Preset::FrameStats;
+
+private:
+    using StageTimes = std::array<double, StageCount>;
+
+    StageTimes m_currentFrame{};                       //!< Times recorded in the frame being rendered.
+    StageTimes m_lastFrame{};                          //!< Times of the last finished frame.
+    StageTimes m_historySum{};                         //!< Sum of all frames in the history.
+    std::array<StageTimes, AverageFrames> m_history{}; //!< Ring buffer with the times of the last frames.
+    size_t m_historyIndex{};                           //!< Index of the next history entry to overwrite.
+    size_t m_historyCount{};                           //!< Number of valid history entries.
+};
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
+
+#ifdef PROJECTM_STAGE_PROFILER
+#define PROJECTM_PROFILE_FRAME(profiler) ::libprojectM::MilkdropPreset::StageProfiler::FrameScope stageProfilerFrameScope(profiler)
+#define PROJECTM_PROFILE_STAGE(stage) ::libprojectM::MilkdropPreset::StageProfiler::StageTimer stageProfilerTimer(::libprojectM::Preset::FrameStats::stage)
+#else
+#define PROJECTM_PROFILE_FRAME(profiler)
+#define PROJECTM_PROFILE_STAGE(stage)
+#endif
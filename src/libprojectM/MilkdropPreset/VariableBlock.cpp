@@ -0,0 +1,43 @@
+#include "VariableBlock.hpp"
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+namespace {
+
+template<size_t Size>
+auto NumberedNames(const std::string& prefix) -> std::array<std::string, Size>
+{
+    std::array<std::string, Size> names;
+    for (size_t index = 0; index < Size; index++)
+    {
+        names[index] = prefix + std::to_string(index + 1);
+    }
+    return names;
+}
+
+} // namespace
+
+auto FrameVariables::Names() -> const std::array<std::string, Count>&
+{
+    static const std::array<std::string, Count> names{
+        "time", "fps", "frame", "progress",
+        "bass", "mid", "treb", "bass_att", "mid_att", "treb_att"};
+
+    return names;
+}
+
+auto QVariableNames() -> const std::array<std::string, QVarCount>&
+{
+    static const auto names = NumberedNames<QVarCount>("q");
+    return names;
+}
+
+auto TVariableNames() -> const std::array<std::string, TVarCount>&
+{
+    static const auto names = NumberedNames<TVarCount>("t");
+    return names;
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Constants.hpp"
+
+#include <projectm-eval.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief A contiguous block of expression variable values in a fixed order.
+ *
+ * The order is defined by the index enum of the variable set the block is used for, e.g.
+ * FrameVariables::Index. Blocks are plain arrays, so passing a set of values from one context
+ * to another is a single copy of known size.
+ *
+ * Blocks aren't over-aligned, as they're part of heap-allocated preset objects and C++14 doesn't
+ * support aligned allocation.
+ *
+ * @tparam Size The number of values in the block.
+ */
+template<size_t Size>
+struct VariableBlock
+{
+    auto operator[](size_t index) -> PRJM_EVAL_F&
+    {
+        return values[index];
+    }
+
+    auto operator[](size_t index) const -> const PRJM_EVAL_F&
+    {
+        return values[index];
+    }
+
+    std::array<PRJM_EVAL_F, Size> values{}; //!< The variable values.
+};
+
+/**
+ * @brief Pointers to the variables of an expression context, in the order of a VariableBlock.
+ *
+ * projectm-eval owns the storage of all context variables and doesn't place them in any known
+ * order, so a block can't be mapped into a context directly. The variables are instead bound
+ * once after registering the built-in variables, which turns loading a block into a single pass
+ * over two arrays instead of dozens of individually named pointer accesses.
+ *
+ * @tparam Size The number of variables in the binding.
+ */
+template<size_t Size>
+class VariableBinding
+{
+public:
+    /**
+     * @brief Registers the variables in the context and stores the pointers to their values.
+     * @param context The expression evaluator context.
+     * @param names The lower-case variable names, in block order.
+     */
+    void Register(projectm_eval_context* context, const std::array<std::string, Size>& names)
+    {
+        for (size_t index = 0; index < Size; index++)
+        {
+            m_variables[index] = projectm_eval_context_register_variable(context, names[index].c_str());
+        }
+    }
+
+    /**
+     * @brief Copies all values of a block into the bound variables.
+     * @param block The values to load.
+     */
+    void Load(const VariableBlock<Size>& block) const
+    {
+        for (size_t index = 0; index < Size; index++)
+        {
+            *m_variables[index] = block.values[index];
+        }
+    }
+
+    /**
+     * @brief Copies the values at the given indices of a block into the bound variables.
+     * @param block The values to load.
+     * @param indices The block indices of the variables to load.
+     */
+    void Load(const VariableBlock<Size>& block, const std::vector<size_t>& indices) const
+    {
+        for (auto index : indices)
+        {
+            *m_variables[index] = block.values[index];
+        }
+    }
+
+    /**
+     * @brief Copies the values of another context's bound variables into the bound variables.
+     * @param source The binding of the same variables in the other context.
+     */
+    void Load(const VariableBinding<Size>& source) const
+    {
+        for (size_t index = 0; index < Size; index++)
+        {
+            *m_variables[index] = *source.m_variables[index];
+        }
+    }
+
+    /**
+     * @brief Copies the current values of the bound variables into a block.
+     * @param block The block receiving the values.
+     */
+    void Store(VariableBlock<Size>& block) const
+    {
+        for (size_t index = 0; index < Size; index++)
+        {
+            block.values[index] = *m_variables[index];
+        }
+    }
+
+    /**
+     * @brief Returns the pointer to a bound variable.
+     * @param index The block index of the variable.
+     * @return The pointer to the variable value in the context.
+     */
+    auto operator[](size_t index) const -> PRJM_EVAL_F*
+    {
+        return m_variables[index];
+    }
+
+private:
+    std::array<PRJM_EVAL_F*, Size> m_variables{}; //!< The bound variables, in block order.
+};
+
+/**
+ * @brief The time and audio variables passed to all expression contexts on each frame.
+ */
+struct FrameVariables
+{
+    enum Index : size_t
+    {
+        Time,
+        Fps,
+        Frame,
+        Progress,
+        Bass,
+        Mid,
+        Treb,
+        BassAtt,
+        MidAtt,
+        TrebAtt,
+        Count
+    };
+
+    /**
+     * @brief Returns the variable names in block order.
+     * @return The lower-case variable names.
+     */
+    static auto Names() -> const std::array<std::string, Count>&;
+};
+
+using FrameVariableBlock = VariableBlock<FrameVariables::Count>; //!< Values of the time and audio variables.
+using QVariableBlock = VariableBlock<QVarCount>;                 //!< Values of q1 to q32.
+using TVariableBlock = VariableBlock<TVarCount>;                 //!< Values of t1 to t8.
+
+/**
+ * @brief Returns the names of the q variables in block order.
+ * @return The names "q1" to "q32".
+ */
+auto QVariableNames() -> const std::array<std::string, QVarCount>&;
+
+/**
+ * @brief Returns the names of the t variables in block order.
+ * @return The names "t1" to "t8".
+ */
+auto TVariableNames() -> const std::array<std::string, TVarCount>&;
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -1,6 +1,7 @@
 #include "WaveformPerFrameContext.hpp"
 
 #include "CustomWaveform.hpp"
+#include "ExpressionOptimizer.hpp"
 #include "MilkdropPresetExceptions.hpp"
 #include "PerFrameContext.hpp"
 
@@ -36,58 +37,22 @@ void WaveformPerFrameContext::RegisterBuiltinVariables()
 {
     projectm_eval_context_reset_variables(perFrameCodeContext);
 
-    REG_VAR(time);
-    REG_VAR(fps);
-    REG_VAR(frame);
-    REG_VAR(progress);
-
-    for (int q = 0; q < QVarCount; q++)
-    {
-        std::string qvar = "q" + std::to_string(q + 1);
-        q_vars[q] = projectm_eval_context_register_variable(perFrameCodeContext, qvar.c_str());
-    }
-
-    for (int t = 0; t < TVarCount; t++)
-    {
-        std::string tvar = "t" + std::to_string(t + 1);
-        t_vars[t] = projectm_eval_context_register_variable(perFrameCodeContext, tvar.c_str());
-    }
-
-    REG_VAR(bass);
-    REG_VAR(mid);
-    REG_VAR(treb);
-    REG_VAR(bass_att);
-    REG_VAR(mid_att);
-    REG_VAR(treb_att);
     REG_VAR(r);
     REG_VAR(g);
     REG_VAR(b);
     REG_VAR(a);
     REG_VAR(samples);
+
+    frameVariables.Register(perFrameCodeContext, FrameVariables::Names());
+    q_vars.Register(perFrameCodeContext, QVariableNames());
+    t_vars.Register(perFrameCodeContext, TVariableNames());
 }
 
 void WaveformPerFrameContext::LoadStateVariables(PresetState& state, const PerFrameContext& presetPerFrameContext, CustomWaveform& waveform)
 {
-    *time = static_cast<double>(state.renderContext.time);
-    *frame = static_cast<double>(state.renderContext.frame);
-    *fps = static_cast<double>(state.renderContext.fps);
-    *progress = static_cast<double>(state.renderContext.progress);
-    *bass = static_cast<double>(state.audioData.bass);
-    *mid = static_cast<double>(state.audioData.mid);
-    *treb = static_cast<double>(state.audioData.treb);
-    *bass_att = static_cast<double>(state.audioData.bassAtt);
-    *mid_att = static_cast<double>(state.audioData.midAtt);
-    *treb_att = static_cast<double>(state.audioData.trebAtt);
-
-    for (int q = 0; q < QVarCount; q++)
-    {
-        *q_vars[q] = *presetPerFrameContext.q_vars[q];
-    }
-
-    for (int t = 0; t < TVarCount; t++)
-    {
-        *t_vars[t] = waveform.m_tValuesAfterInitCode[t];
-    }
+    frameVariables.Load(state.frameVariables);
+    q_vars.Load(presetPerFrameContext.q_vars);
+    t_vars.Load(waveform.m_tValuesAfterInitCode);
 
     *r = static_cast<double>(waveform.m_r);
     *g = static_cast<double>(waveform.m_g);
@@ -131,7 +96,15 @@ void WaveformPerFrameContext::CompilePerFrameCode(const std::string& perFrameCod
         return;
     }
 
-    perFrameCodeHandle = projectm_eval_code_compile(perFrameCodeContext, perFrameCode.c_str());
+    // Cached programs were compiled with projectm-eval before, so the interpreter isn't needed.
+    perFrameCodeJit = JitCode::FromCache(perFrameCodeContext, perFrameCode);
+    if (perFrameCodeJit)
+    {
+        return;
+    }
+
+    std::string compiledCode;
+    perFrameCodeHandle = CompileCode(perFrameCodeContext, perFrameCode, compiledCode);
     if (perFrameCodeHandle == nullptr)
     {
 #ifdef MILKDROP_PRESET_DEBUG
@@ -145,11 +118,17 @@ void WaveformPerFrameContext::CompilePerFrameCode(const std::string& perFrameCod
 #endif
         throw MilkdropCompileException("Could not compile custom wave " + std::to_string(waveform.m_index) + " per-frame code");
     }
+
+    perFrameCodeJit = JitCode::Compile(perFrameCodeContext, perFrameCode);
 }
 
 void WaveformPerFrameContext::ExecutePerFrameCode()
 {
-    if (perFrameCodeHandle != nullptr)
+    if (perFrameCodeJit)
+    {
+        perFrameCodeJit->Execute();
+    }
+    else if (perFrameCodeHandle != nullptr)
     {
         projectm_eval_code_execute(perFrameCodeHandle);
     }
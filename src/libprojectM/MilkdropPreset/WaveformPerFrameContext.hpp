@@ -1,6 +1,8 @@
 #pragma once
 
+#include "ExpressionJit.hpp"
 #include "PresetState.hpp"
+#include "VariableBlock.hpp"
 
 namespace libprojectM {
 namespace MilkdropPreset {
@@ -56,19 +58,12 @@ public:
 
     projectm_eval_context* perFrameCodeContext{nullptr}; //!< The code runtime context, holds memory buffers and variables.
     projectm_eval_code* perFrameCodeHandle{nullptr}; //!< The compiled per-frame code handle.
+    std::unique_ptr<JitCode> perFrameCodeJit;        //!< The per-frame code compiled to machine code, or nullptr to use the interpreter.
+
+    VariableBinding<FrameVariables::Count> frameVariables; //!< Time and audio variables.
+    VariableBinding<QVarCount> q_vars;                     //!< Q variables.
+    VariableBinding<TVarCount> t_vars;                     //!< T variables.
 
-    PRJM_EVAL_F* time{};
-    PRJM_EVAL_F* fps{};
-    PRJM_EVAL_F* frame{};
-    PRJM_EVAL_F* progress{};
-    PRJM_EVAL_F* q_vars[QVarCount]{};
-    PRJM_EVAL_F* t_vars[TVarCount]{};
-    PRJM_EVAL_F* bass{};
-    PRJM_EVAL_F* mid{};
-    PRJM_EVAL_F* treb{};
-    PRJM_EVAL_F* bass_att{};
-    PRJM_EVAL_F* mid_att{};
-    PRJM_EVAL_F* treb_att{};
     PRJM_EVAL_F* r{};
     PRJM_EVAL_F* g{};
     PRJM_EVAL_F* b{};
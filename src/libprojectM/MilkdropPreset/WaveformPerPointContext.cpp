@@ -1,9 +1,12 @@
 #include "WaveformPerPointContext.hpp"
 
 #include "CustomWaveform.hpp"
+#include "ExpressionOptimizer.hpp"
 #include "MilkdropPresetExceptions.hpp"
 #include "PerFrameContext.hpp"
 
+#include <array>
+
 #ifdef MILKDROP_PRESET_DEBUG
 #include <iostream>
 #endif
@@ -36,29 +39,6 @@ void WaveformPerPointContext::RegisterBuiltinVariables()
 {
     projectm_eval_context_reset_variables(perPointCodeContext);
 
-    REG_VAR(time);
-    REG_VAR(fps);
-    REG_VAR(frame);
-    REG_VAR(progress);
-
-    for (int q = 0; q < QVarCount; q++)
-    {
-        std::string const qvar = "q" + std::to_string(q + 1);
-        q_vars[q] = projectm_eval_context_register_variable(perPointCodeContext, qvar.c_str());
-    }
-
-    for (int t = 0; t < TVarCount; t++)
-    {
-        std::string const tvar = "t" + std::to_string(t + 1);
-        t_vars[t] = projectm_eval_context_register_variable(perPointCodeContext, tvar.c_str());
-    }
-
-    REG_VAR(bass);
-    REG_VAR(mid);
-    REG_VAR(treb);
-    REG_VAR(bass_att);
-    REG_VAR(mid_att);
-    REG_VAR(treb_att);
     REG_VAR(sample);
     REG_VAR(value1);
     REG_VAR(value2);
@@ -68,20 +48,15 @@ void WaveformPerPointContext::RegisterBuiltinVariables()
     REG_VAR(g);
     REG_VAR(b);
     REG_VAR(a);
+
+    frameVariables.Register(perPointCodeContext, FrameVariables::Names());
+    q_vars.Register(perPointCodeContext, QVariableNames());
+    t_vars.Register(perPointCodeContext, TVariableNames());
 }
 
 void WaveformPerPointContext::LoadReadOnlyStateVariables(const PerFrameContext& presetPerFrameContext)
 {
-    *time = *presetPerFrameContext.time;
-    *frame = *presetPerFrameContext.frame;
-    *fps = *presetPerFrameContext.fps;
-    *progress = *presetPerFrameContext.progress;
-    *bass = *presetPerFrameContext.bass;
-    *mid = *presetPerFrameContext.mid;
-    *treb = *presetPerFrameContext.treb;
-    *bass_att = *presetPerFrameContext.bass_att;
-    *mid_att = *presetPerFrameContext.mid_att;
-    *treb_att = *presetPerFrameContext.treb_att;
+    frameVariables.Load(presetPerFrameContext.frameVariables);
 }
 
 void WaveformPerPointContext::CompilePerPointCode(const std::string& perPointCode,
@@ -92,7 +67,16 @@ void WaveformPerPointContext::CompilePerPointCode(const std::string& perPointCod
         return;
     }
 
-    perPointCodeHandle = projectm_eval_code_compile(perPointCodeContext, perPointCode.c_str());
+    // Cached programs were compiled with projectm-eval before, so the interpreter isn't needed.
+    perPointCodeJit = JitCode::FromCache(perPointCodeContext, perPointCode, VertexCodePrecision());
+    if (perPointCodeJit)
+    {
+        BindSingleVariables();
+        return;
+    }
+
+    std::string compiledCode;
+    perPointCodeHandle = CompileCode(perPointCodeContext, perPointCode, compiledCode);
     if (perPointCodeHandle == nullptr)
     {
 #ifdef MILKDROP_PRESET_DEBUG
@@ -106,15 +90,107 @@ void WaveformPerPointContext::CompilePerPointCode(const std::string& perPointCod
 #endif
         throw MilkdropCompileException("Could not compile custom wave " + std::to_string(waveform.m_index) + " per-point code");
     }
+
+    perPointCodeJit = JitCode::Compile(perPointCodeContext, perPointCode, VertexCodePrecision());
+    BindSingleVariables();
 }
 
 void WaveformPerPointContext::ExecutePerPointCode()
 {
-    if (perPointCodeHandle != nullptr)
+    if (perPointCodeJit)
+    {
+        perPointCodeJit->Execute();
+    }
+    else if (perPointCodeHandle != nullptr)
     {
         projectm_eval_code_execute(perPointCodeHandle);
     }
 }
 
+void WaveformPerPointContext::ExecutePerPointCode(PointBlock& points)
+{
+    if (perPointCodeJit && perPointCodeJit->Precision() == JitPrecision::Single)
+    {
+        ExecuteSinglePrecision(points);
+        return;
+    }
+
+    for (size_t index = 0; index < points.count; index++)
+    {
+        *sample = static_cast<PRJM_EVAL_F>(points.sample[index]);
+        *value1 = static_cast<PRJM_EVAL_F>(points.value1[index]);
+        *value2 = static_cast<PRJM_EVAL_F>(points.value2[index]);
+        *x = static_cast<PRJM_EVAL_F>(points.x[index]);
+        *y = static_cast<PRJM_EVAL_F>(points.y[index]);
+        *r = static_cast<PRJM_EVAL_F>(points.r[index]);
+        *g = static_cast<PRJM_EVAL_F>(points.g[index]);
+        *b = static_cast<PRJM_EVAL_F>(points.b[index]);
+        *a = static_cast<PRJM_EVAL_F>(points.a[index]);
+
+        ExecutePerPointCode();
+
+        points.x[index] = static_cast<float>(*x);
+        points.y[index] = static_cast<float>(*y);
+        points.r[index] = static_cast<float>(*r);
+        points.g[index] = static_cast<float>(*g);
+        points.b[index] = static_cast<float>(*b);
+        points.a[index] = static_cast<float>(*a);
+    }
+}
+
+void WaveformPerPointContext::BindSingleVariables()
+{
+    static const std::array<const char*, 9> names{"sample", "value1", "value2", "x", "y", "r", "g", "b", "a"};
+
+    // Variables the code doesn't use are written to and read from local storage instead.
+    for (size_t index = 0; index < names.size(); index++)
+    {
+        auto* const value = perPointCodeJit ? perPointCodeJit->Variable(names[index]) : nullptr;
+        m_singleVariables[index] = value != nullptr ? value : &m_unusedSingleVariables[index];
+    }
+}
+
+void WaveformPerPointContext::ExecuteSinglePrecision(PointBlock& points)
+{
+    auto& jitCode = *perPointCodeJit;
+
+    float* const pointSample = m_singleVariables[0];
+    float* const pointValue1 = m_singleVariables[1];
+    float* const pointValue2 = m_singleVariables[2];
+    float* const pointX = m_singleVariables[3];
+    float* const pointY = m_singleVariables[4];
+    float* const pointR = m_singleVariables[5];
+    float* const pointG = m_singleVariables[6];
+    float* const pointB = m_singleVariables[7];
+    float* const pointA = m_singleVariables[8];
+
+    // Everything else only needs to be converted once for all points.
+    jitCode.LoadVariables();
+
+    for (size_t index = 0; index < points.count; index++)
+    {
+        *pointSample = points.sample[index];
+        *pointValue1 = points.value1[index];
+        *pointValue2 = points.value2[index];
+        *pointX = points.x[index];
+        *pointY = points.y[index];
+        *pointR = points.r[index];
+        *pointG = points.g[index];
+        *pointB = points.b[index];
+        *pointA = points.a[index];
+
+        jitCode.ExecuteLoaded();
+
+        points.x[index] = *pointX;
+        points.y[index] = *pointY;
+        points.r[index] = *pointR;
+        points.g[index] = *pointG;
+        points.b[index] = *pointB;
+        points.a[index] = *pointA;
+    }
+
+    jitCode.StoreVariables();
+}
+
 } // namespace MilkdropPreset
 } // namespace libprojectM
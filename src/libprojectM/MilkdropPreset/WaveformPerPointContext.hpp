@@ -1,6 +1,11 @@
 #pragma once
 
+#include "ExpressionJit.hpp"
 #include "PresetState.hpp"
+#include "VariableBlock.hpp"
+
+#include <array>
+#include <cstddef>
 
 namespace libprojectM {
 namespace MilkdropPreset {
@@ -11,6 +16,27 @@ class PerFrameContext;
 class WaveformPerPointContext
 {
 public:
+    /**
+     * @brief Inputs and results of the per-point code for all points of a waveform.
+     *
+     * Each variable is stored in its own array, indexed by the point number. The storage is
+     * sized for the maximum number of points, so a block can be reused on every frame.
+     */
+    struct PointBlock
+    {
+        size_t count{}; //!< Number of points in the block.
+
+        std::array<float, WaveformMaxPoints> sample{}; //!< Input: position of the point in the waveform, 0.0 to 1.0.
+        std::array<float, WaveformMaxPoints> value1{}; //!< Input: left channel value.
+        std::array<float, WaveformMaxPoints> value2{}; //!< Input: right channel value.
+        std::array<float, WaveformMaxPoints> x{};      //!< Input and result: x coordinate.
+        std::array<float, WaveformMaxPoints> y{};      //!< Input and result: y coordinate.
+        std::array<float, WaveformMaxPoints> r{};      //!< Input and result: red color component.
+        std::array<float, WaveformMaxPoints> g{};      //!< Input and result: green color component.
+        std::array<float, WaveformMaxPoints> b{};      //!< Input and result: blue color component.
+        std::array<float, WaveformMaxPoints> a{};      //!< Input and result: alpha value.
+    };
+
     /**
      * @brief Constructor. Creates a new waveform per-point state object.
      * @param gmegabuf The global memory buffer to use in the code context.
@@ -45,21 +71,24 @@ public:
      */
     void ExecutePerPointCode();
 
+    /**
+     * @brief Executes the per-point code for all points of a block, in order.
+     *
+     * If the code was JIT-compiled for single precision, the variables are only converted from and
+     * to the context once, and the point inputs and results are copied without conversion.
+     *
+     * @param points The point inputs, replaced by the results.
+     */
+    void ExecutePerPointCode(PointBlock& points);
+
     projectm_eval_context* perPointCodeContext{nullptr}; //!< The code runtime context, holds memory buffers and variables.
     projectm_eval_code* perPointCodeHandle{nullptr}; //!< The compiled waveform per-point code handle.
+    std::unique_ptr<JitCode> perPointCodeJit;        //!< The per-point code compiled to machine code, or nullptr to use the interpreter.
+
+    VariableBinding<FrameVariables::Count> frameVariables; //!< Time and audio variables.
+    VariableBinding<QVarCount> q_vars;                     //!< Q variables.
+    VariableBinding<TVarCount> t_vars;                     //!< T variables.
 
-    PRJM_EVAL_F* time{};
-    PRJM_EVAL_F* fps{};
-    PRJM_EVAL_F* frame{};
-    PRJM_EVAL_F* progress{};
-    PRJM_EVAL_F* q_vars[QVarCount]{};
-    PRJM_EVAL_F* t_vars[TVarCount]{};
-    PRJM_EVAL_F* bass{};
-    PRJM_EVAL_F* mid{};
-    PRJM_EVAL_F* treb{};
-    PRJM_EVAL_F* bass_att{};
-    PRJM_EVAL_F* mid_att{};
-    PRJM_EVAL_F* treb_att{};
     PRJM_EVAL_F* sample{};
     PRJM_EVAL_F* value1{};
     PRJM_EVAL_F* value2{};
@@ -69,6 +98,21 @@ public:
     PRJM_EVAL_F* g{};
     PRJM_EVAL_F* b{};
     PRJM_EVAL_F* a{};
+
+private:
+    /**
+     * @brief Executes the single precision JIT-compiled per-point code for all points of a block.
+     * @param points The point inputs, replaced by the results.
+     */
+    void ExecuteSinglePrecision(PointBlock& points);
+
+    /**
+     * @brief Looks up the single precision point variables once after compiling.
+     */
+    void BindSingleVariables();
+
+    std::array<float*, 9> m_singleVariables{};      //!< sample, value1, value2, x, y, r, g, b and a of single precision code.
+    std::array<float, 9> m_unusedSingleVariables{}; //!< Storage for the variables single precision code doesn't use.
 };
 
 } // namespace MilkdropPreset
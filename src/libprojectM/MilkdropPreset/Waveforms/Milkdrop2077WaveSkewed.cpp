@@ -19,7 +19,7 @@ void Milkdrop2077WaveSkewed::GenerateVertices(const PresetState& presetState,
     float alpha = static_cast<float>(*presetPerFrameContext.wave_a) * 1.25f;
     if (presetState.modWaveAlphaByvolume)
     {
-        alpha *= presetState.audioData.vol;
+        alpha *= presetState.audioData->vol;
     }
     alpha = std::max(0.0f, std::min(1.0f, alpha));
 
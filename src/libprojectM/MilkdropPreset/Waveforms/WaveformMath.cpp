@@ -21,22 +21,22 @@ auto WaveformMath::GetVertices(const PresetState& presetState,
     // Get the correct audio sample type for the current waveform mode.
     if (IsSpectrumWave())
     {
-        std::copy(begin(presetState.audioData.spectrumLeft),
-                  begin(presetState.audioData.spectrumLeft) + Audio::SpectrumSamples,
+        std::copy(begin(presetState.audioData->spectrumLeft),
+                  begin(presetState.audioData->spectrumLeft) + Audio::SpectrumSamples,
                   begin(m_pcmDataL));
 
-        std::copy(begin(presetState.audioData.spectrumRight),
-                  begin(presetState.audioData.spectrumRight) + Audio::SpectrumSamples,
+        std::copy(begin(presetState.audioData->spectrumRight),
+                  begin(presetState.audioData->spectrumRight) + Audio::SpectrumSamples,
                   begin(m_pcmDataR));
     }
     else
     {
-        std::copy(begin(presetState.audioData.waveformLeft),
-                  begin(presetState.audioData.waveformLeft) + Audio::WaveformSamples,
+        std::copy(begin(presetState.audioData->waveformLeft),
+                  begin(presetState.audioData->waveformLeft) + Audio::WaveformSamples,
                   begin(m_pcmDataL));
 
-        std::copy(begin(presetState.audioData.waveformRight),
-                  begin(presetState.audioData.waveformRight) + Audio::WaveformSamples,
+        std::copy(begin(presetState.audioData->waveformRight),
+                  begin(presetState.audioData->waveformRight) + Audio::WaveformSamples,
                   begin(m_pcmDataR));
     }
 
@@ -0,0 +1,115 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+constexpr size_t WorkerPool::MaxThreads;
+
+auto WorkerPool::Get() -> std::shared_ptr<WorkerPool>
+{
+    static std::shared_ptr<WorkerPool> instance(
+        new WorkerPool(std::min<size_t>(std::thread::hardware_concurrency(), MaxThreads)));
+    return instance;
+}
+
+WorkerPool::WorkerPool(size_t threadCount)
+{
+    for (size_t thread = 1; thread < threadCount; thread++)
+    {
+        try
+        {
+            m_threads.emplace_back(&WorkerPool::WorkerThread, this);
+        }
+        catch (std::system_error&)
+        {
+            // Run with the threads we got so far.
+            break;
+        }
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::Run(size_t count, const Task& task)
+{
+    if (m_threads.empty() || count < 2)
+    {
+        for (size_t index = 0; index < count; index++)
+        {
+            task(index);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_taskCount = count;
+        m_nextTask.store(0, std::memory_order_relaxed);
+        m_busyWorkers = m_threads.size();
+        m_batch++;
+    }
+    m_workAvailable.notify_all();
+
+    RunTasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+}
+
+void WorkerPool::WorkerThread()
+{
+    uint64_t lastBatch{};
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this, lastBatch] { return m_stop || m_batch != lastBatch; });
+            if (m_stop)
+            {
+                return;
+            }
+            lastBatch = m_batch;
+        }
+
+        RunTasks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+        {
+            m_workDone.notify_one();
+        }
+    }
+}
+
+void WorkerPool::RunTasks()
+{
+    for (size_t index = m_nextTask.fetch_add(1, std::memory_order_relaxed);
+         index < m_taskCount;
+         index = m_nextTask.fetch_add(1, std::memory_order_relaxed))
+    {
+        (*m_task)(index);
+    }
+}
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libprojectM {
+namespace MilkdropPreset {
+
+/**
+ * @brief A small pool of worker threads for splitting per-frame work into independent tasks.
+ *
+ * Run() distributes a number of tasks over the worker threads and the calling thread, and
+ * returns once all tasks have finished. Tasks must not throw and must not call Run() themselves.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * @brief Task function. Receives the task index, from 0 to the task count minus one.
+     */
+    using Task = std::function<void(size_t index)>;
+
+    static constexpr size_t MaxThreads = 8; //!< Upper limit for the number of threads used by the shared pool.
+
+    /**
+     * @brief Returns the shared pool, sized for the number of CPU cores.
+     * @return The process-wide worker pool instance.
+     */
+    static auto Get() -> std::shared_ptr<WorkerPool>;
+
+    /**
+     * @brief Creates a pool with the given number of threads, including the calling thread.
+     * @param threadCount The number of threads running tasks. 0 or 1 run all tasks on the calling thread.
+     */
+    explicit WorkerPool(size_t threadCount);
+
+    /**
+     * @brief Stops and joins all worker threads.
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    auto operator=(const WorkerPool&) -> WorkerPool& = delete;
+    auto operator=(WorkerPool&&) -> WorkerPool& = delete;
+
+    /**
+     * @brief Returns the number of threads running tasks, including the calling thread.
+     * @return The number of threads, at least 1.
+     */
+    auto ThreadCount() const -> size_t
+    {
+        return m_threads.size() + 1;
+    }
+
+    /**
+     * @brief Runs the task for each index in [0, count) and waits for all of them to finish.
+     *
+     * Concurrent calls from different threads are serialized.
+     *
+     * @param count The number of tasks to run.
+     * @param task The task function.
+     */
+    void Run(size_t count, const Task& task);
+
+private:
+    /**
+     * @brief Worker thread main loop.
+     */
+    void WorkerThread();
+
+    /**
+     * @brief Runs tasks of the current batch until none are left.
+     */
+    void RunTasks();
+
+    std::vector<std::thread> m_threads; //!< The worker threads.
+
+    std::mutex m_runMutex; //!< Serializes calls to Run().
+
+    std::mutex m_mutex;                      //!< Protects the batch state below.
+    std::condition_variable m_workAvailable; //!< Signals a new batch or shutdown to the workers.
+    std::condition_variable m_workDone;      //!< Signals the last worker finishing a batch.
+    const Task* m_task{};                    //!< The task of the current batch.
+    size_t m_taskCount{};                    //!< Number of tasks in the current batch.
+    size_t m_busyWorkers{};                  //!< Number of workers still running the current batch.
+    uint64_t m_batch{};                      //!< Batch counter, incremented for each Run() call.
+    bool m_stop{};                           //!< If true, the workers exit.
+
+    std::atomic<size_t> m_nextTask{}; //!< Index of the next task to run in the current batch.
+};
+
+} // namespace MilkdropPreset
+} // namespace libprojectM
@@ -5,6 +5,9 @@
 #include <Renderer/RenderContext.hpp>
 #include <Renderer/Texture.hpp>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -13,6 +16,41 @@ namespace libprojectM {
 class Preset
 {
 public:
+    /**
+     * @brief Where the per-pixel equations of the preset are evaluated.
+     */
+    enum class PerPixelEvaluationMode
+    {
+        None, //!< The preset has no per-pixel code.
+        Cpu,  //!< The per-pixel code is evaluated on the CPU for each mesh vertex.
+        Gpu   //!< The per-pixel code was translated into the warp vertex shader.
+    };
+
+    /**
+     * @brief CPU time spent in the stages of rendering a frame, in milliseconds.
+     *
+     * All stages are part of RenderFrame, which holds the total time spent rendering the preset.
+     */
+    struct FrameStats
+    {
+        enum Stage : size_t
+        {
+            RenderFrame,            //!< The whole preset frame.
+            PerFrameUpdate,         //!< Running the per-frame code.
+            CalculateMesh,          //!< Running the per-pixel code on the CPU.
+            CustomWaveformEvaluate, //!< Running the custom waveform per-frame and per-point code.
+            CustomWaveformDraw,     //!< Drawing the custom waveforms.
+            CustomShapeDraw,        //!< Running the custom shape per-frame code and drawing the shapes.
+            BlurUpdate,             //!< Rendering the blur textures.
+            ShaderLoadVariables,    //!< Uploading the warp and composite shader uniforms.
+            StageCount
+        };
+
+        std::array<double, StageCount> lastFrame{}; //!< Time spent in each stage in the last frame.
+        std::array<double, StageCount> average{};   //!< Time spent in each stage, averaged over the last frames.
+        uint32_t averageFrames{};                   //!< Number of frames in the rolling average. 0 if no stats are available.
+    };
+
     virtual ~Preset() = default;
 
     /**
@@ -23,7 +61,8 @@ public:
 
     /**
      * @brief Renders the preset into the current framebuffer.
-     * @param audioData Audio data to be used by the preset.
+     * @param audioData Audio data to be used by the preset. Presets keep a reference to this data, so it
+     *                  must remain valid until the next frame is rendered.
      * @param renderContext The current render context data.
      */
     virtual void RenderFrame(const libprojectM::Audio::FrameAudioData& audioData,
@@ -47,6 +86,24 @@ public:
     virtual void DrawInitialImage(const std::shared_ptr<Renderer::Texture>& image,
                                   const Renderer::RenderContext& renderContext) = 0;
 
+    /**
+     * @brief Returns where the per-pixel equations are evaluated, for debugging purposes.
+     * @return The evaluation mode of the per-pixel code.
+     */
+    virtual auto PerPixelEvaluation() const -> PerPixelEvaluationMode
+    {
+        return PerPixelEvaluationMode::None;
+    }
+
+    /**
+     * @brief Returns the CPU time spent in each render stage, for profiling purposes.
+     * @return The stage timings, or empty stats if the preset doesn't record them.
+     */
+    virtual auto FrameStatistics() const -> FrameStats
+    {
+        return {};
+    }
+
     inline void SetFilename(const std::string& filename)
     {
         m_filename = filename;
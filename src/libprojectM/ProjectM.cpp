@@ -101,9 +101,9 @@ void ProjectM::RenderFrame()
     // Update FPS and other timer values.
     m_timeKeeper->UpdateTimers();
 
-    // Update and retrieve audio data
+    // Update and retrieve audio data. The data is shared by all presets and the transition, not copied.
     m_audioStorage.UpdateFrameAudioData(m_timeKeeper->SecondsSinceLastFrame(), m_frameCount);
-    auto audioData = m_audioStorage.GetFrameAudioData();
+    auto const& audioData = m_audioStorage.GetFrameAudioData();
 
     // Check if the preset isn't locked, and we've not already notified the user
     if (!m_presetChangeNotified)
@@ -282,6 +282,32 @@ auto ProjectM::PresetLocked() const -> bool
     return m_presetLocked;
 }
 
+auto ProjectM::PerPixelEvaluation() const -> Preset::PerPixelEvaluationMode
+{
+    if (m_transitioningPreset)
+    {
+        return m_transitioningPreset->PerPixelEvaluation();
+    }
+    if (m_activePreset)
+    {
+        return m_activePreset->PerPixelEvaluation();
+    }
+    return Preset::PerPixelEvaluationMode::None;
+}
+
+auto ProjectM::FrameStatistics() const -> Preset::FrameStats
+{
+    if (m_transitioningPreset)
+    {
+        return m_transitioningPreset->FrameStatistics();
+    }
+    if (m_activePreset)
+    {
+        return m_activePreset->FrameStatistics();
+    }
+    return {};
+}
+
 void ProjectM::SetBeatSensitivity(float sensitivity)
 {
     m_beatSensitivity = std::min(std::max(0.0f, sensitivity), 2.0f);
@@ -402,6 +428,16 @@ void ProjectM::SetMeshSize(uint32_t meshResolutionX, uint32_t meshResolutionY)
     m_meshY = std::max(8u, std::min(400u, m_meshY));
 }
 
+auto ProjectM::PerPixelCodeOnGpu() const -> bool
+{
+    return m_perPixelCodeOnGpu;
+}
+
+void ProjectM::SetPerPixelCodeOnGpu(bool enabled)
+{
+    m_perPixelCodeOnGpu = enabled;
+}
+
 auto ProjectM::PCM() -> libprojectM::Audio::PCM&
 {
     return m_audioStorage;
@@ -442,6 +478,7 @@ auto ProjectM::GetRenderContext() -> Renderer::RenderContext
     ctx.invAspectY = 1.0f / ctx.aspectY;
     ctx.perPixelMeshX = static_cast<int>(m_meshX);
     ctx.perPixelMeshY = static_cast<int>(m_meshY);
+    ctx.perPixelCodeOnGpu = m_perPixelCodeOnGpu;
     ctx.textureManager = m_textureManager.get();
 
     return ctx;
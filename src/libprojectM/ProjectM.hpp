@@ -20,6 +20,8 @@
  */
 #pragma once
 
+#include "Preset.hpp"
+
 #include <projectM-4/projectM_export.h>
 
 #include <Renderer/RenderContext.hpp>
@@ -40,7 +42,6 @@ class TextureManager;
 class TransitionShaderManager;
 } // namespace Renderer
 
-class Preset;
 class PresetFactoryManager;
 class TimeKeeper;
 
@@ -155,6 +156,10 @@ public:
 
     void SetMeshSize(uint32_t meshResolutionX, uint32_t meshResolutionY);
 
+    auto PerPixelCodeOnGpu() const -> bool;
+
+    void SetPerPixelCodeOnGpu(bool enabled);
+
     void Touch(float touchX, float touchY, int pressure, int touchType);
 
     void TouchDrag(float touchX, float touchY, int pressure);
@@ -169,6 +174,20 @@ public:
     /// Returns true if the active preset is locked
     auto PresetLocked() const -> bool;
 
+    /**
+     * @brief Returns where the per-pixel code of the current preset is evaluated.
+     * During a transition, the mode of the preset being transitioned to is returned.
+     * @return The per-pixel code evaluation mode, or None if no preset is loaded.
+     */
+    auto PerPixelEvaluation() const -> Preset::PerPixelEvaluationMode;
+
+    /**
+     * @brief Returns the CPU time spent in the render stages of the current preset.
+     * During a transition, the stats of the preset being transitioned to are returned.
+     * @return The stage timings, or empty stats if no preset is loaded or the profiler is disabled.
+     */
+    auto FrameStatistics() const -> Preset::FrameStats;
+
     auto PCM() -> Audio::PCM&;
 
     auto WindowWidth() -> int;
@@ -196,6 +215,7 @@ private:
     float m_hardCutSensitivity{2.0}; //!< Loudness sensitivity value for hard cuts.
     float m_beatSensitivity{1.0};    //!< General beat sensitivity modifier for presets.
     bool m_aspectCorrection{true};   //!< If true, corrects aspect ratio for non-rectangular windows.
+    bool m_perPixelCodeOnGpu{true};  //!< If true, translatable per-pixel code of presets loaded afterwards runs in the warp vertex shader.
     float m_easterEgg{1.0};          //!< Random preset duration modifier. See TimeKeeper class.
     float m_previousFrameVolume{};   //!< Volume in previous frame, used for hard cuts.
 
@@ -3,8 +3,15 @@
 #include <projectM-4/projectM.h>
 
 #include <Audio/AudioConstants.hpp>
+#include <Audio/AudioFeatureFile.hpp>
+#include <Audio/OfflineAnalyzer.hpp>
+
+#include <MilkdropPreset/CompiledCodeCache.hpp>
+#include <MilkdropPreset/ExpressionJit.hpp>
+#include <MilkdropPreset/JitPrecision.hpp>
 
 #include <cstring>
+#include <memory>
 #include <sstream>
 
 namespace libprojectM {
@@ -165,6 +172,43 @@ char* projectm_get_vcs_version_string()
     return buffer;
 }
 
+bool projectm_get_code_cache_statistics(uint64_t* hits, uint64_t* misses, size_t* entries)
+{
+    // Only JIT programs are cached, so without the JIT the counters would silently stay zero.
+    bool const available = libprojectM::MilkdropPreset::JitProgram::IsAvailable();
+    auto const statistics = available ? libprojectM::MilkdropPreset::CompiledCodeCache::Instance().GetStatistics()
+                                      : libprojectM::MilkdropPreset::CompiledCodeCache::Statistics{};
+
+    if (hits != nullptr)
+    {
+        *hits = statistics.hits;
+    }
+    if (misses != nullptr)
+    {
+        *misses = statistics.misses;
+    }
+    if (entries != nullptr)
+    {
+        *entries = statistics.entries;
+    }
+
+    return available;
+}
+
+void projectm_set_code_cache_size(size_t max_entries)
+{
+    libprojectM::MilkdropPreset::CompiledCodeCache::Instance().SetCapacity(max_entries);
+}
+
+bool projectm_set_single_precision_vertex_code(bool enabled)
+{
+    libprojectM::MilkdropPreset::SetVertexCodePrecision(enabled ? libprojectM::MilkdropPreset::JitPrecision::Single
+                                                                 : libprojectM::MilkdropPreset::JitPrecision::Double);
+
+    // The precision only applies to JIT-compiled code.
+    return libprojectM::MilkdropPreset::JitProgram::IsAvailable();
+}
+
 void projectm_opengl_render_frame(projectm_handle instance)
 {
     auto projectMInstance = handle_to_instance(instance);
@@ -258,6 +302,18 @@ void projectm_set_mesh_size(projectm_handle instance, size_t width, size_t heigh
     projectMInstance->SetMeshSize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 }
 
+bool projectm_get_per_pixel_code_on_gpu(projectm_handle instance)
+{
+    auto projectMInstance = handle_to_instance(instance);
+    return projectMInstance->PerPixelCodeOnGpu();
+}
+
+void projectm_set_per_pixel_code_on_gpu(projectm_handle instance, bool enabled)
+{
+    auto projectMInstance = handle_to_instance(instance);
+    projectMInstance->SetPerPixelCodeOnGpu(enabled);
+}
+
 int32_t projectm_get_fps(projectm_handle instance)
 {
     auto projectMInstance = handle_to_instance(instance);
@@ -371,7 +427,165 @@ auto projectm_pcm_add_uint8(projectm_handle instance, const uint8_t* samples, un
     PcmAdd(instance, samples, count, channels);
 }
 
+auto projectm_pcm_set_pull_callback(projectm_handle instance, projectm_pcm_pull_callback callback, void* user_data) -> void
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    projectMInstance->PCM().SetAudioSource(callback, user_data);
+}
+
+auto projectm_pcm_get_current_time() -> double
+{
+    return libprojectM::Audio::PCM::CurrentTime();
+}
+
+template<class BufferType>
+static auto PcmAddTimestamped(projectm_handle instance, const BufferType* samples, unsigned int count, projectm_channels channels, double timestamp) -> void
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    projectMInstance->PCM().Add(samples, channels, count, timestamp);
+}
+
+auto projectm_pcm_add_float_timestamped(projectm_handle instance, const float* samples, unsigned int count, projectm_channels channels, double timestamp) -> void
+{
+    PcmAddTimestamped(instance, samples, count, channels, timestamp);
+}
+
+auto projectm_pcm_add_int16_timestamped(projectm_handle instance, const int16_t* samples, unsigned int count, projectm_channels channels, double timestamp) -> void
+{
+    PcmAddTimestamped(instance, samples, count, channels, timestamp);
+}
+
+auto projectm_pcm_add_uint8_timestamped(projectm_handle instance, const uint8_t* samples, unsigned int count, projectm_channels channels, double timestamp) -> void
+{
+    PcmAddTimestamped(instance, samples, count, channels, timestamp);
+}
+
+auto projectm_pcm_set_presentation_latency(projectm_handle instance, double seconds) -> void
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    projectMInstance->PCM().SetPresentationLatency(seconds);
+}
+
+auto projectm_pcm_get_presentation_latency(projectm_handle instance) -> double
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    return projectMInstance->PCM().PresentationLatency();
+}
+
+auto projectm_pcm_set_downmix_matrix(projectm_handle instance, unsigned int channels, const float* coefficients) -> bool
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    return projectMInstance->PCM().SetDownmixMatrix(channels, coefficients);
+}
+
+auto projectm_pcm_set_background_analysis(projectm_handle instance, bool enabled, unsigned int analyses_per_second) -> bool
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    return projectMInstance->PCM().SetBackgroundAnalysis(enabled, analyses_per_second);
+}
+
+auto projectm_pcm_get_background_analysis(projectm_handle instance) -> bool
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    return projectMInstance->PCM().BackgroundAnalysis();
+}
+
+auto projectm_pcm_analyze_wav_file(const char* wav_filename, const char* feature_filename, double fps) -> bool
+{
+    if (wav_filename == nullptr || feature_filename == nullptr)
+    {
+        return false;
+    }
+
+    try
+    {
+        libprojectM::Audio::OfflineAnalyzer::AnalyzeWavFile(wav_filename, feature_filename, fps);
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+auto projectm_pcm_replay_feature_file(projectm_handle instance, const char* feature_filename) -> bool
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    if (feature_filename == nullptr)
+    {
+        projectMInstance->PCM().SetFeatureReplay(nullptr);
+        return false;
+    }
+
+    try
+    {
+        projectMInstance->PCM().SetFeatureReplay(std::make_unique<libprojectM::Audio::AudioFeatureFileReader>(feature_filename));
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+auto projectm_pcm_seek_feature_file(projectm_handle instance, unsigned int frame) -> void
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    projectMInstance->PCM().SeekFeatureReplay(frame);
+}
+
 auto projectm_write_debug_image_on_next_frame(projectm_handle, const char*) -> void
 {
     // UNIMPLEMENTED
-}
\ No newline at end of file
+}
+
+auto projectm_get_per_pixel_evaluation(projectm_handle instance) -> projectm_per_pixel_evaluation
+{
+    auto* projectMInstance = handle_to_instance(instance);
+
+    switch (projectMInstance->PerPixelEvaluation())
+    {
+        case libprojectM::Preset::PerPixelEvaluationMode::Cpu:
+            return PROJECTM_PER_PIXEL_EVALUATION_CPU;
+
+        case libprojectM::Preset::PerPixelEvaluationMode::Gpu:
+            return PROJECTM_PER_PIXEL_EVALUATION_GPU;
+
+        default:
+            return PROJECTM_PER_PIXEL_EVALUATION_NONE;
+    }
+}
+
+auto projectm_get_frame_stats(projectm_handle instance, projectm_frame_stats* stats) -> bool
+{
+    static_assert(static_cast<size_t>(PROJECTM_FRAME_STAGE_COUNT) == libprojectM::Preset::FrameStats::StageCount,
+                  "C API stage list doesn't match the preset stage list.");
+
+    if (stats == nullptr)
+    {
+        return false;
+    }
+
+    auto* projectMInstance = handle_to_instance(instance);
+    auto const frameStats = projectMInstance->FrameStatistics();
+
+    for (size_t stage = 0; stage < PROJECTM_FRAME_STAGE_COUNT; stage++)
+    {
+        stats->last_frame_ms[stage] = frameStats.lastFrame[stage];
+        stats->average_ms[stage] = frameStats.average[stage];
+    }
+    stats->average_frames = frameStats.averageFrames;
+
+    return frameStats.averageFrames > 0;
+}
@@ -29,6 +29,8 @@ public:
     int perPixelMeshX{64}; //!< Per-pixel/per-vertex mesh X resolution.
     int perPixelMeshY{48}; //!< Per-pixel/per-vertex mesh Y resolution.
 
+    bool perPixelCodeOnGpu{true}; //!< Evaluate translatable per-pixel code in the warp vertex shader.
+
     TextureManager* textureManager{nullptr}; //!< Holds all loaded textures for shader access.
 };
 
@@ -0,0 +1,252 @@
+#include "Audio/AudioConstants.hpp"
+#include "Audio/Loudness.hpp"
+#include "Audio/MilkdropFFT.hpp"
+#include "Audio/PCM.hpp"
+#include "Audio/SampleConverter.hpp"
+#include "Audio/WaveformAligner.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+constexpr size_t SamplesPerCall = 512;   //!< A typical audio callback buffer size.
+constexpr uint32_t SampleRate = 44100;   //!< Sample rate of the synthetic signal.
+constexpr size_t SignalFrames = 64;      //!< Number of distinct frames to cycle through.
+constexpr size_t SamplesPerFrame = 735;  //!< Samples per frame at 60 FPS.
+
+/**
+ * Fixed synthetic test signal in the range [-1, 1]: a bass tone, a mid tone with a slow tremolo,
+ * and a quiet high-frequency tone. Identical on every run and CPU.
+ */
+auto Signal(size_t sample, uint32_t channel) -> float
+{
+    double const time = static_cast<double>(sample) / SampleRate;
+    double const pi = 3.141592653589793;
+
+    double value = 0.4 * std::sin(2.0 * pi * 55.0 * time + channel);
+    value += 0.3 * std::sin(2.0 * pi * 440.0 * time) * (0.5 + 0.5 * std::sin(2.0 * pi * 2.0 * time));
+    value += 0.1 * std::sin(2.0 * pi * 5000.0 * time * (channel + 1));
+
+    return static_cast<float>(value);
+}
+
+template<typename SampleType>
+auto ConvertSample(float value) -> SampleType;
+
+template<>
+auto ConvertSample<float>(float value) -> float
+{
+    return value;
+}
+
+template<>
+auto ConvertSample<int16_t>(float value) -> int16_t
+{
+    return static_cast<int16_t>(value * 32767.0f);
+}
+
+template<>
+auto ConvertSample<uint8_t>(float value) -> uint8_t
+{
+    return static_cast<uint8_t>(value * 127.0f + 128.0f);
+}
+
+template<typename SampleType>
+auto GenerateInterleaved(size_t count, uint32_t channels) -> std::vector<SampleType>
+{
+    std::vector<SampleType> samples(count * channels);
+    for (size_t sample = 0; sample < count; sample++)
+    {
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            samples[sample * channels + channel] = ConvertSample<SampleType>(Signal(sample, channel));
+        }
+    }
+    return samples;
+}
+
+/**
+ * Returns one analysis window per frame, scaled to the internal sample range.
+ */
+auto GenerateWaveforms(uint32_t channel) -> std::vector<WaveformBuffer>
+{
+    std::vector<WaveformBuffer> waveforms(SignalFrames);
+    for (size_t frame = 0; frame < SignalFrames; frame++)
+    {
+        for (size_t i = 0; i < AudioBufferSamples; i++)
+        {
+            waveforms[frame][i] = 128.0f * Signal(frame * SamplesPerFrame + i, channel);
+        }
+    }
+    return waveforms;
+}
+
+template<typename SampleType>
+void PCMAdd(benchmark::State& state)
+{
+    auto const channels = static_cast<uint32_t>(state.range(0));
+    auto const samples = GenerateInterleaved<SampleType>(SamplesPerCall, channels);
+    auto pcm = std::make_unique<PCM>();
+
+    for (auto _ : state)
+    {
+        pcm->Add(samples.data(), channels, SamplesPerCall);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * SamplesPerCall));
+}
+
+template<typename SampleType>
+void SampleConverterDownmix(benchmark::State& state)
+{
+    auto const instructionSet = static_cast<SampleConverter::InstructionSet>(state.range(0));
+    if (!SampleConverter::IsSupported(instructionSet))
+    {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+
+    // 5.1 surround input, downmixed to stereo.
+    constexpr uint32_t channels = 6;
+    auto const samples = GenerateInterleaved<SampleType>(SamplesPerCall, channels);
+    SampleConverter const converter(instructionSet);
+    std::vector<float> left(SamplesPerCall);
+    std::vector<float> right(SamplesPerCall);
+
+    for (auto _ : state)
+    {
+        converter.Convert(samples.data(), channels, SamplesPerCall, left.data(), right.data());
+        benchmark::DoNotOptimize(left.data());
+        benchmark::DoNotOptimize(right.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * SamplesPerCall));
+}
+
+template<typename Config>
+void PCMUpdateFrameAudioData(benchmark::State& state)
+{
+    auto const samples = GenerateInterleaved<float>(SamplesPerFrame * SignalFrames, 2);
+    auto pcm = std::make_unique<BasicPCM<Config>>();
+    uint32_t frame{};
+
+    for (auto _ : state)
+    {
+        // Adding samples is measured separately and only a small part of the time spent here.
+        state.PauseTiming();
+        pcm->Add(samples.data() + (frame % SignalFrames) * SamplesPerFrame * 2, 2, SamplesPerFrame);
+        state.ResumeTiming();
+
+        pcm->UpdateFrameAudioData(1.0 / 60.0, frame++);
+        benchmark::DoNotOptimize(pcm->GetFrameAudioData().vol);
+    }
+}
+
+void MilkdropFFTMono(benchmark::State& state)
+{
+    MilkdropFFT fft(true);
+    auto const waveforms = GenerateWaveforms(0);
+    std::vector<float> waveform(AudioBufferSamples);
+    std::vector<float> spectrum(SpectrumSamples);
+    size_t frame{};
+
+    for (auto _ : state)
+    {
+        std::copy(waveforms[frame].begin(), waveforms[frame].end(), waveform.begin());
+        fft.TimeToFrequencyDomain(waveform, spectrum);
+        benchmark::DoNotOptimize(spectrum.data());
+        frame = (frame + 1) % SignalFrames;
+    }
+}
+
+void MilkdropFFTStereo(benchmark::State& state)
+{
+    MilkdropFFT fft(true);
+    auto const waveformsLeft = GenerateWaveforms(0);
+    auto const waveformsRight = GenerateWaveforms(1);
+    SpectrumBuffer spectrumLeft{};
+    SpectrumBuffer spectrumRight{};
+    size_t frame{};
+
+    for (auto _ : state)
+    {
+        fft.TimeToFrequencyDomain(waveformsLeft[frame].data(), waveformsRight[frame].data(), spectrumLeft.data(), spectrumRight.data());
+        benchmark::DoNotOptimize(spectrumLeft.data());
+        benchmark::DoNotOptimize(spectrumRight.data());
+        frame = (frame + 1) % SignalFrames;
+    }
+}
+
+void WaveformAlignerAlign(benchmark::State& state)
+{
+    WaveformAligner aligner;
+    auto const waveforms = GenerateWaveforms(0);
+    WaveformBuffer waveform{};
+    size_t frame{};
+
+    for (auto _ : state)
+    {
+        // Align() shifts the buffer in place, so start with a fresh copy each time.
+        waveform = waveforms[frame];
+        aligner.Align(waveform);
+        benchmark::DoNotOptimize(waveform.data());
+        frame = (frame + 1) % SignalFrames;
+    }
+}
+
+void LoudnessUpdate(benchmark::State& state)
+{
+    MilkdropFFT fft(true);
+    auto const waveformsLeft = GenerateWaveforms(0);
+    auto const waveformsRight = GenerateWaveforms(1);
+    std::vector<SpectrumBuffer> spectra(SignalFrames);
+    SpectrumBuffer spectrumRight{};
+    for (size_t frame = 0; frame < SignalFrames; frame++)
+    {
+        fft.TimeToFrequencyDomain(waveformsLeft[frame].data(), waveformsRight[frame].data(), spectra[frame].data(), spectrumRight.data());
+    }
+
+    Loudness bass(Loudness::Band::Bass);
+    Loudness middles(Loudness::Band::Middles);
+    Loudness treble(Loudness::Band::Treble);
+    uint32_t frame{};
+
+    for (auto _ : state)
+    {
+        auto const& spectrum = spectra[frame % SignalFrames];
+        bass.Update(spectrum, 1.0 / 60.0, frame);
+        middles.Update(spectrum, 1.0 / 60.0, frame);
+        treble.Update(spectrum, 1.0 / 60.0, frame);
+        benchmark::DoNotOptimize(bass.CurrentRelative());
+        benchmark::DoNotOptimize(middles.CurrentRelative());
+        benchmark::DoNotOptimize(treble.CurrentRelative());
+        frame++;
+    }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(PCMAdd, float)->ArgName("channels")->Arg(1)->Arg(2)->Arg(6);
+BENCHMARK_TEMPLATE(PCMAdd, int16_t)->ArgName("channels")->Arg(1)->Arg(2)->Arg(6);
+BENCHMARK_TEMPLATE(PCMAdd, uint8_t)->ArgName("channels")->Arg(1)->Arg(2)->Arg(6);
+
+// Arguments are SampleConverter::InstructionSet values: Scalar, SSE2, AVX2 and NEON.
+BENCHMARK_TEMPLATE(SampleConverterDownmix, float)->ArgName("isa")->DenseRange(0, 3);
+BENCHMARK_TEMPLATE(SampleConverterDownmix, int16_t)->ArgName("isa")->DenseRange(0, 3);
+
+BENCHMARK_TEMPLATE(PCMUpdateFrameAudioData, DefaultAudioConfig);
+BENCHMARK_TEMPLATE(PCMUpdateFrameAudioData, LowLatencyAudioConfig);
+BENCHMARK_TEMPLATE(PCMUpdateFrameAudioData, HighResolutionAudioConfig);
+BENCHMARK(MilkdropFFTMono);
+BENCHMARK(MilkdropFFTStereo);
+BENCHMARK(WaveformAlignerAlign);
+BENCHMARK(LoudnessUpdate);
@@ -0,0 +1,107 @@
+#include "Audio/SampleConverter.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+constexpr size_t SamplesPerCall = 512; //!< A typical audio callback buffer size.
+
+template<typename SampleType>
+auto GenerateSamples(size_t count) -> std::vector<SampleType>
+{
+    std::vector<SampleType> samples(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i] = static_cast<SampleType>(i % 97);
+    }
+    return samples;
+}
+
+/**
+ * Runs the conversion kernel for the instruction set and channel count given as benchmark arguments.
+ */
+template<typename SampleType>
+void SampleConverterConvert(benchmark::State& state)
+{
+    auto const instructionSet = static_cast<SampleConverter::InstructionSet>(state.range(0));
+    auto const channels = static_cast<uint32_t>(state.range(1));
+
+    if (!SampleConverter::IsSupported(instructionSet))
+    {
+        state.SkipWithError("Instruction set not supported on this CPU.");
+        return;
+    }
+
+    SampleConverter const converter(instructionSet);
+    auto const samples = GenerateSamples<SampleType>(SamplesPerCall * channels);
+    std::vector<float> left(SamplesPerCall);
+    std::vector<float> right(SamplesPerCall);
+
+    for (auto _ : state)
+    {
+        converter.Convert(samples.data(), channels, SamplesPerCall, left.data(), right.data());
+        benchmark::DoNotOptimize(left.data());
+        benchmark::DoNotOptimize(right.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * SamplesPerCall));
+}
+
+/**
+ * The per-sample circular-buffer conversion used before the vectorized kernels, for comparison.
+ */
+template<int signalAmplitude, int signalOffset, typename SampleType>
+void LegacyAddToBuffer(benchmark::State& state)
+{
+    auto const channels = static_cast<uint32_t>(state.range(0));
+    auto const samples = GenerateSamples<SampleType>(SamplesPerCall * channels);
+    std::vector<float> left(576);
+    std::vector<float> right(576);
+    size_t start{};
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < SamplesPerCall; i++)
+        {
+            size_t const bufferOffset = (start + i) % left.size();
+            left[bufferOffset] = 128.0f * (static_cast<float>(samples[0 + i * channels]) - float(signalOffset)) / float(signalAmplitude);
+            if (channels > 1)
+            {
+                right[bufferOffset] = 128.0f * (static_cast<float>(samples[1 + i * channels]) - float(signalOffset)) / float(signalAmplitude);
+            }
+            else
+            {
+                right[bufferOffset] = left[bufferOffset];
+            }
+        }
+        start = (start + SamplesPerCall) % left.size();
+        benchmark::DoNotOptimize(left.data());
+        benchmark::DoNotOptimize(right.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * SamplesPerCall));
+}
+
+// Arguments: instruction set (Scalar, SSE2, AVX2, NEON), channel count.
+void ConverterArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"isa", "channels"});
+    benchmark->ArgsProduct({{0, 1, 2, 3}, {1, 2}});
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(SampleConverterConvert, float)->Apply(ConverterArguments);
+BENCHMARK_TEMPLATE(SampleConverterConvert, int16_t)->Apply(ConverterArguments);
+BENCHMARK_TEMPLATE(SampleConverterConvert, uint8_t)->Apply(ConverterArguments);
+
+BENCHMARK_TEMPLATE(LegacyAddToBuffer, 1, 0, float)->ArgName("channels")->Arg(1)->Arg(2);
+BENCHMARK_TEMPLATE(LegacyAddToBuffer, 32768, 0, int16_t)->ArgName("channels")->Arg(1)->Arg(2);
+BENCHMARK_TEMPLATE(LegacyAddToBuffer, 128, 128, uint8_t)->ArgName("channels")->Arg(1)->Arg(2);
@@ -0,0 +1,54 @@
+#include "MilkdropPreset/CodeAnalysis.hpp"
+
+#include <gtest/gtest.h>
+
+using libprojectM::MilkdropPreset::AnalyzeCode;
+
+TEST(projectMCodeAnalysis, ReferencedVariables)
+{
+    auto const analysis = AnalyzeCode("zoom = zoom + 0.1 * sin(Rad * 3.0 + $PI);\n"
+                                      "rot = q1 * .5; // ang\n"
+                                      "/* x = y; */ dx = if(above(bass, 1), 0.01, 0);");
+
+    EXPECT_TRUE(analysis.References("zoom"));
+    EXPECT_TRUE(analysis.References("rad"));
+    EXPECT_TRUE(analysis.References("q1"));
+    EXPECT_TRUE(analysis.References("bass"));
+    EXPECT_FALSE(analysis.References("sin"));
+    EXPECT_FALSE(analysis.References("above"));
+    EXPECT_FALSE(analysis.References("ang"));
+    EXPECT_FALSE(analysis.References("x"));
+    EXPECT_FALSE(analysis.References("y"));
+
+    EXPECT_EQ(analysis.assignedVariables, (std::set<std::string>{"zoom", "rot", "dx"}));
+    EXPECT_FALSE(analysis.usesSharedState);
+}
+
+TEST(projectMCodeAnalysis, CarriedVariables)
+{
+    // t is defined before use, n and m accumulate, k is only assigned conditionally, c is never assigned.
+    auto const analysis = AnalyzeCode("t = sin(time) * c;\n"
+                                      "n = n + 1;\n"
+                                      "m += t;\n"
+                                      "if(above(t, 0), k = 1, 0);\n"
+                                      "zoom = zoom + t * 0.01 + k;");
+
+    EXPECT_EQ(analysis.carriedVariables, (std::set<std::string>{"n", "m", "k", "zoom"}));
+}
+
+TEST(projectMCodeAnalysis, AssignFunction)
+{
+    auto const analysis = AnalyzeCode("assign(x, 0.5); y = assign ( sides , 4 ) + r;");
+
+    EXPECT_EQ(analysis.assignedVariables, (std::set<std::string>{"x", "y", "sides"}));
+}
+
+TEST(projectMCodeAnalysis, SharedState)
+{
+    EXPECT_FALSE(AnalyzeCode("a = 1; b = a == 1; regular = 2;").usesSharedState);
+    EXPECT_TRUE(AnalyzeCode("megabuf(0) = 1;").usesSharedState);
+    EXPECT_TRUE(AnalyzeCode("a = gmegabuf(x * 100);").usesSharedState);
+    EXPECT_TRUE(AnalyzeCode("reg01 = reg01 + 1;").usesSharedState);
+    EXPECT_TRUE(AnalyzeCode("zoom = zoom + rand(10) * 0.001;").usesSharedState);
+    EXPECT_TRUE(AnalyzeCode("memset(0, 0, 100);").usesSharedState);
+}
@@ -0,0 +1,127 @@
+#include "MilkdropPreset/CompiledCodeCache.hpp"
+#include "MilkdropPreset/ExpressionJit.hpp"
+
+#include <gtest/gtest.h>
+
+using libprojectM::MilkdropPreset::CompiledCodeCache;
+using libprojectM::MilkdropPreset::JitPrecision;
+using libprojectM::MilkdropPreset::JitProgram;
+
+/**
+ * Empties the process-wide cache and restores the default capacity after the test.
+ */
+class CacheReset
+{
+public:
+    CacheReset()
+    {
+        CompiledCodeCache::Instance().Clear();
+    }
+
+    ~CacheReset()
+    {
+        CompiledCodeCache::Instance().SetCapacity(CompiledCodeCache::DefaultCapacity);
+        CompiledCodeCache::Instance().Clear();
+    }
+};
+
+TEST(projectMCompiledCodeCache, HitsAndMisses)
+{
+    CacheReset reset;
+    auto& cache = CompiledCodeCache::Instance();
+
+    auto const first = cache.Compile("x = sin(time);");
+    auto const second = cache.Compile("x = sin(time);");
+    cache.Compile("y = 2;");
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, 1);
+    EXPECT_EQ(statistics.misses, 2);
+    EXPECT_EQ(statistics.entries, 2);
+    EXPECT_EQ(statistics.capacity, CompiledCodeCache::DefaultCapacity);
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first != nullptr, JitProgram::IsAvailable());
+}
+
+TEST(projectMCompiledCodeCache, EvictsLeastRecentlyUsed)
+{
+    CacheReset reset;
+    auto& cache = CompiledCodeCache::Instance();
+    cache.SetCapacity(2);
+
+    cache.Compile("a = 1;");
+    cache.Compile("b = 2;");
+    cache.Compile("a = 1;"); // Hit, b is now the least recently used entry.
+    cache.Compile("c = 3;"); // Evicts b.
+    cache.Compile("a = 1;"); // Hit.
+    cache.Compile("b = 2;"); // Miss, evicts c.
+
+    auto statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, 2);
+    EXPECT_EQ(statistics.misses, 4);
+    EXPECT_EQ(statistics.entries, 2);
+
+    cache.SetCapacity(1);
+    EXPECT_EQ(cache.GetStatistics().entries, 1);
+    cache.Compile("b = 2;");
+    EXPECT_EQ(cache.GetStatistics().hits, 3);
+}
+
+TEST(projectMCompiledCodeCache, Disabled)
+{
+    CacheReset reset;
+    auto& cache = CompiledCodeCache::Instance();
+    cache.SetCapacity(0);
+
+    cache.Compile("a = 1;");
+    cache.Compile("a = 1;");
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, 0);
+    EXPECT_EQ(statistics.misses, 2);
+    EXPECT_EQ(statistics.entries, 0);
+}
+
+TEST(projectMCompiledCodeCache, PrecisionsCachedSeparately)
+{
+    CacheReset reset;
+    auto& cache = CompiledCodeCache::Instance();
+
+    auto const doublePrecision = cache.Compile("x = sin(time);", JitPrecision::Double);
+    auto const singlePrecision = cache.Compile("x = sin(time);", JitPrecision::Single);
+    cache.Compile("x = sin(time);", JitPrecision::Single);
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, 1);
+    EXPECT_EQ(statistics.misses, 2);
+    EXPECT_EQ(statistics.entries, 2);
+
+    if (JitProgram::IsAvailable())
+    {
+        EXPECT_NE(doublePrecision, singlePrecision);
+        EXPECT_EQ(doublePrecision->Precision(), JitPrecision::Double);
+        EXPECT_EQ(singlePrecision->Precision(), JitPrecision::Single);
+    }
+}
+
+TEST(projectMCompiledCodeCache, FindDoesNotCompile)
+{
+    CacheReset reset;
+    auto& cache = CompiledCodeCache::Instance();
+
+    EXPECT_EQ(cache.Find("x = sin(time);"), nullptr);
+    EXPECT_EQ(cache.GetStatistics().entries, 0);
+
+    auto const program = cache.Compile("x = sin(time);");
+    EXPECT_EQ(cache.Find("x = sin(time);"), program);
+    EXPECT_EQ(cache.Find("x = sin(time);", JitPrecision::Single), nullptr);
+
+    // Code the JIT can't compile is cached, but not returned.
+    cache.Compile("megabuf(0) = 1;");
+    EXPECT_EQ(cache.Find("megabuf(0) = 1;"), nullptr);
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, program != nullptr ? 1 : 0);
+    EXPECT_EQ(statistics.misses, 2);
+}
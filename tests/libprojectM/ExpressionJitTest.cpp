@@ -0,0 +1,363 @@
+#include "MilkdropPreset/CodeAnalysis.hpp"
+#include "MilkdropPreset/ExpressionJit.hpp"
+#include "MilkdropPreset/PresetFileParser.hpp"
+#include "Renderer/FileScanner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <projectm-eval.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+static constexpr auto testPresetsPath{PROJECTM_TEST_PRESETS_DIR};
+static constexpr int frameCount{100};
+
+using libprojectM::MilkdropPreset::AnalyzeCode;
+using libprojectM::MilkdropPreset::JitCode;
+using libprojectM::MilkdropPreset::JitPrecision;
+using libprojectM::MilkdropPreset::JitProgram;
+using libprojectM::MilkdropPreset::PresetFileParser;
+using libprojectM::Renderer::FileScanner;
+
+/**
+ * Expression context with its own memory and registers, so both backends run independently.
+ */
+class EvalContext
+{
+public:
+    EvalContext()
+        : m_memory(projectm_eval_memory_buffer_create())
+        , m_context(projectm_eval_context_create(m_memory, &m_registers))
+    {
+    }
+
+    ~EvalContext()
+    {
+        projectm_eval_context_destroy(m_context);
+        projectm_eval_memory_buffer_destroy(m_memory);
+    }
+
+    auto Context() const -> projectm_eval_context*
+    {
+        return m_context;
+    }
+
+    auto Variable(const std::string& name) -> PRJM_EVAL_F&
+    {
+        return *projectm_eval_context_register_variable(m_context, name.c_str());
+    }
+
+private:
+    PRJM_EVAL_F m_registers[100]{};
+    projectm_eval_mem_buffer m_memory{};
+    projectm_eval_context* m_context{};
+};
+
+using CodeHandle = std::unique_ptr<projectm_eval_code, decltype(&projectm_eval_code_destroy)>;
+
+/**
+ * Runs the init code with the interpreter, then the code with the interpreter and the JIT for a number
+ * of frames, comparing all variables after each frame.
+ * @return True if the JIT compiled the code, false if only the interpreter ran it.
+ */
+static auto CompareBackends(const std::string& initCode, const std::string& code) -> bool
+{
+    EvalContext interpreter;
+    EvalContext jit;
+
+    auto variables = AnalyzeCode(initCode).variables;
+    auto const codeVariables = AnalyzeCode(code).variables;
+    variables.insert(codeVariables.begin(), codeVariables.end());
+
+    // Distinct start values, so uninitialized inputs don't hide differences.
+    int index{};
+    for (const auto& name : variables)
+    {
+        auto const value = static_cast<PRJM_EVAL_F>(std::sin(index++ * 7.3) * 2.0);
+        interpreter.Variable(name) = value;
+        jit.Variable(name) = value;
+    }
+
+    if (!initCode.empty())
+    {
+        for (auto* context : {&interpreter, &jit})
+        {
+            CodeHandle init(projectm_eval_code_compile(context->Context(), initCode.c_str()), &projectm_eval_code_destroy);
+            EXPECT_NE(init, nullptr);
+            if (init)
+            {
+                projectm_eval_code_execute(init.get());
+            }
+        }
+    }
+
+    CodeHandle interpretedCode(projectm_eval_code_compile(interpreter.Context(), code.c_str()), &projectm_eval_code_destroy);
+    EXPECT_NE(interpretedCode, nullptr);
+    auto const jitCode = JitCode::Compile(jit.Context(), code);
+    if (!interpretedCode || !jitCode)
+    {
+        return false;
+    }
+
+    for (int frame = 0; frame < frameCount && !::testing::Test::HasFailure(); frame++)
+    {
+        for (auto* context : {&interpreter, &jit})
+        {
+            context->Variable("frame") = static_cast<PRJM_EVAL_F>(frame);
+            context->Variable("time") = static_cast<PRJM_EVAL_F>(frame / 60.0);
+        }
+
+        projectm_eval_code_execute(interpretedCode.get());
+        jitCode->Execute();
+
+        for (const auto& name : variables)
+        {
+            auto const expected = interpreter.Variable(name);
+            auto const actual = jit.Variable(name);
+            if (std::isnan(expected))
+            {
+                EXPECT_TRUE(std::isnan(actual)) << "Variable \"" << name << "\" in frame " << frame;
+            }
+            else if (std::isinf(expected))
+            {
+                EXPECT_EQ(actual, expected) << "Variable \"" << name << "\" in frame " << frame;
+            }
+            else
+            {
+                EXPECT_NEAR(actual, expected, 1e-9 * std::max(1.0, std::fabs(expected)))
+                    << "Variable \"" << name << "\" in frame " << frame;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Runs the code compiled for double and single precision on the same inputs for a number of frames.
+ * @return The largest difference of any variable after a frame, relative to the variable's magnitude
+ *         if above 1, or a negative value if the code can't be JIT-compiled.
+ */
+static auto SinglePrecisionError(const std::string& code) -> double
+{
+    EvalContext doublePrecision;
+    EvalContext singlePrecision;
+
+    auto const variables = AnalyzeCode(code).variables;
+    int index{};
+    for (const auto& name : variables)
+    {
+        auto const value = static_cast<PRJM_EVAL_F>(std::sin(index++ * 7.3) * 2.0);
+        doublePrecision.Variable(name) = value;
+        singlePrecision.Variable(name) = value;
+    }
+
+    auto const doubleCode = JitCode::Compile(doublePrecision.Context(), code);
+    auto const singleCode = JitCode::Compile(singlePrecision.Context(), code, JitPrecision::Single);
+    if (!doubleCode || !singleCode)
+    {
+        return -1.0;
+    }
+
+    double maxError{};
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        for (auto* context : {&doublePrecision, &singlePrecision})
+        {
+            context->Variable("frame") = static_cast<PRJM_EVAL_F>(frame);
+            context->Variable("time") = static_cast<PRJM_EVAL_F>(frame / 60.0);
+        }
+
+        doubleCode->Execute();
+        singleCode->Execute();
+
+        for (const auto& name : variables)
+        {
+            auto const expected = doublePrecision.Variable(name);
+            auto const actual = singlePrecision.Variable(name);
+            if (std::isfinite(expected) && std::isfinite(actual))
+            {
+                maxError = std::max(maxError, std::fabs(actual - expected) / std::max(1.0, std::fabs(expected)));
+            }
+            else if (std::isfinite(expected) != std::isfinite(actual))
+            {
+                maxError = std::max(maxError, 1.0);
+            }
+        }
+    }
+
+    return maxError;
+}
+
+TEST(projectMExpressionJit, TestPresets)
+{
+    if (!JitProgram::IsAvailable())
+    {
+        GTEST_SKIP() << "Expression JIT not available in this build.";
+    }
+
+    std::vector<std::string> extensions{".milk"};
+    FileScanner scanner({testPresetsPath}, extensions);
+
+    int compiledBlocks{};
+    scanner.Scan([&compiledBlocks](const std::string& path, const std::string&) {
+        PresetFileParser parser;
+        ASSERT_TRUE(parser.Read(path));
+
+        // Pairs of init and per-frame code, as executed by the preset contexts.
+        std::vector<std::pair<std::string, std::string>> blocks{
+            {parser.GetCode("per_frame_init_"), parser.GetCode("per_frame_")},
+            {{}, parser.GetCode("per_pixel_")}};
+        for (int index = 0; index < 4; index++)
+        {
+            auto const wavePrefix = "wave_" + std::to_string(index) + "_";
+            auto const shapePrefix = "shape_" + std::to_string(index) + "_";
+            blocks.emplace_back(parser.GetCode(wavePrefix + "init"), parser.GetCode(wavePrefix + "per_frame"));
+            blocks.emplace_back(std::string{}, parser.GetCode(wavePrefix + "per_point"));
+            blocks.emplace_back(parser.GetCode(shapePrefix + "init"), parser.GetCode(shapePrefix + "per_frame"));
+        }
+
+        for (const auto& block : blocks)
+        {
+            if (block.second.empty())
+            {
+                continue;
+            }
+
+            SCOPED_TRACE(path + ": " + block.second);
+            if (CompareBackends(block.first, block.second))
+            {
+                compiledBlocks++;
+            }
+        }
+    });
+
+    EXPECT_GT(compiledBlocks, 0);
+}
+
+TEST(projectMExpressionJit, LanguageFeatures)
+{
+    if (!JitProgram::IsAvailable())
+    {
+        GTEST_SKIP() << "Expression JIT not available in this build.";
+    }
+
+    const std::vector<std::string> snippets{
+        "a = b + c * d - e / f; g = a ^ 2; h = -a; i = +b; j = !c;",
+        "a += 1; b -= a; c *= b; d /= 0; e /= 2; f ^= 2;",
+        "x = if(above(a, b), sin(a), cos(b)) + min(a, b) * max(c, d);",
+        "x = 1 ? 2 : 3; y = 0 ? 2; z = (a = 5; b = a * 2); w = a / b;",
+        "x = 0.000001 ? 1 : 2; y = -0.00002 ? 1 : 2;",
+        "a = b || (c && d == e); f = g ? h : i; k = l != m; n = o === p; q = r !== s; t = u <= v; w = y >= z;",
+        "x = band(a, b) + bor(c, d) + bnot(e) + equal(a, a) + below(a, b); y = exec2(a = 1, b = 2); z = exec3(c = 1, d = 2, e = 3);",
+        "x = sqrt(-4) + sqr(a) + pow(-2, 3) + exp(a) + log(2) + log10(100) + abs(b) + sign(c) + floor(d) + ceil(d);",
+        "x = atan2(a, b) + sigmoid(a, b) + tan(a) + asin(c * 0.1) + acos(d * 0.1) + atan(e);",
+        "x = ((((a + b) * (c + d)) + ((e + f) * (g + h))) * (((a - b) * (c - d)) - ((e - f) * (g - h)))) / (sin(a) + 2);",
+        "loop(10, x += 1; y = y * 0.5);",
+        "loop(a * 3 + 5, loop(3, x += y; y = y + 1));",
+        "x = 0; while(x += 1; x < 100);"};
+
+    for (const auto& snippet : snippets)
+    {
+        SCOPED_TRACE(snippet);
+        EXPECT_TRUE(CompareBackends({}, snippet));
+    }
+}
+
+TEST(projectMExpressionJit, UnsupportedCode)
+{
+    // The interpreter runs these, so the JIT must not compile them.
+    EXPECT_EQ(JitProgram::Compile("megabuf(0) = 1;"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = gmegabuf(1);"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("reg00 = 1;"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = rand(10);"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = 5 % 3;"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = 5 | 3;"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = invsqrt(2);"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = sin(1, 2);"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = (1;"), nullptr);
+
+    // Operator grouping not verified against projectm-eval.
+    EXPECT_EQ(JitProgram::Compile("x = a || b && c;"), nullptr);
+    EXPECT_EQ(JitProgram::Compile("x = -a ^ 2;"), nullptr);
+}
+
+TEST(projectMExpressionJit, BindsCachedPrograms)
+{
+    if (!JitProgram::IsAvailable())
+    {
+        GTEST_SKIP() << "Expression JIT not available in this build.";
+    }
+
+    EvalContext first;
+    EvalContext second;
+
+    // Nothing is compiled if the code isn't cached yet.
+    EXPECT_EQ(JitCode::FromCache(first.Context(), "y = x * 2 + 1; z = 5;"), nullptr);
+
+    auto const compiled = JitCode::Compile(first.Context(), "y = x * 2 + 1; z = 5;");
+    auto const cached = JitCode::FromCache(second.Context(), "y = x * 2 + 1; z = 5;");
+    ASSERT_NE(compiled, nullptr);
+    ASSERT_NE(cached, nullptr);
+
+    // The cached program runs on the variables of the context it was bound to.
+    second.Variable("x") = 3.0;
+    cached->Execute();
+    EXPECT_EQ(second.Variable("y"), 7.0);
+    EXPECT_EQ(first.Variable("y"), 0.0);
+}
+
+TEST(projectMExpressionJit, SinglePrecisionAccuracy)
+{
+    if (!JitProgram::IsAvailable())
+    {
+        GTEST_SKIP() << "Expression JIT not available in this build.";
+    }
+
+    std::vector<std::string> extensions{".milk"};
+    FileScanner scanner({testPresetsPath}, extensions);
+
+    // Prints one line per per-pixel and per-point code block as accuracy report.
+    size_t checkedBlocks{};
+    scanner.Scan([&checkedBlocks](const std::string& path, const std::string&) {
+        PresetFileParser parser;
+        ASSERT_TRUE(parser.Read(path));
+
+        std::vector<std::pair<std::string, std::string>> blocks{{"per_pixel", parser.GetCode("per_pixel_")}};
+        for (int index = 0; index < 4; index++)
+        {
+            auto const key = "wave_" + std::to_string(index) + "_per_point";
+            blocks.emplace_back(key, parser.GetCode(key));
+        }
+
+        for (const auto& block : blocks)
+        {
+            if (block.second.empty())
+            {
+                continue;
+            }
+
+            auto const error = SinglePrecisionError(block.second);
+            if (error >= 0.0)
+            {
+                std::cout << "[ ACCURACY ] " << path.substr(path.find_last_of("/\\") + 1) << " " << block.first
+                          << ": max. relative error " << std::scientific << std::setprecision(2) << error
+                          << std::defaultfloat << std::endl;
+
+                // Single-step float rounding errors are around 6e-8. Anything much larger than what
+                // accumulates over the frames points to a code generation error in this block.
+                EXPECT_LT(error, 1e-6) << path << " " << block.first;
+                checkedBlocks++;
+            }
+        }
+    });
+
+    EXPECT_GT(checkedBlocks, 0);
+}
@@ -0,0 +1,90 @@
+#include "MilkdropPreset/ExpressionOptimizer.hpp"
+
+#include <gtest/gtest.h>
+
+using libprojectM::MilkdropPreset::OptimizeCode;
+
+TEST(projectMExpressionOptimizer, ConstantFolding)
+{
+    auto const result = OptimizeCode("x = 2 * 3 + sin(0) + a; y = 1 / 0; z = -(-2) + +w;\n"
+                                     "e = 0.5 * 4 - 2 == 0; f = sqrt(-4) + pow(2, 3); g = log(0);");
+
+    ASSERT_TRUE(result.optimized);
+    EXPECT_EQ(result.code,
+              "x = (6 + a);\n"
+              "y = 0;\n"
+              "z = (2 + w);\n"
+              "e = 1;\n"
+              "f = 10;\n"
+              "g = log(0);\n");
+    EXPECT_LT(result.nodesAfter, result.nodesBefore);
+}
+
+TEST(projectMExpressionOptimizer, ControlFlow)
+{
+    auto const result = OptimizeCode("a = if(1, b, c); d = 0 ? e : f; g = 0 && (h = 1);\n"
+                                     "loop(0, k = 1); while(0); l = exec2(m = 1, n = 2); o = (p; q; (r = 1; s))");
+
+    ASSERT_TRUE(result.optimized);
+    EXPECT_EQ(result.code,
+              "a = b;\n"
+              "d = f;\n"
+              "g = 0;\n"
+              "l = (m = 1; n = 2);\n"
+              "o = (r = 1; s);\n");
+
+    EXPECT_EQ(OptimizeCode("i = 1 || (j = 1);").code, "i = 1;\n");
+}
+
+TEST(projectMExpressionOptimizer, DeadStores)
+{
+    auto const result = OptimizeCode("x = 1; y = x; x = 2; z = 3; z = z + 1; w = 5; w = 6;\n"
+                                     "q1 = megabuf(1); q1 = 2; a = (b = 1); a = 4; sin(c); d = 1");
+
+    ASSERT_TRUE(result.optimized);
+    EXPECT_EQ(result.code,
+              "x = 1;\n"
+              "y = x;\n"
+              "x = 2;\n"
+              "z = 3;\n"
+              "z = (z + 1);\n"
+              "w = 6;\n"
+              "megabuf(1);\n"
+              "q1 = 2;\n"
+              "b = 1;\n"
+              "a = 4;\n"
+              "d = 1;\n");
+}
+
+TEST(projectMExpressionOptimizer, UnchangedCode)
+{
+    // Nothing to optimize, so the original text is kept instead of the printed tree.
+    auto const code = "zoom = zoom + 0.1 * sin(time); loop(3, rot += 0.01; dx = dx * 0.5)";
+    auto const result = OptimizeCode(code);
+
+    EXPECT_FALSE(result.optimized);
+    EXPECT_EQ(result.code, code);
+}
+
+TEST(projectMExpressionOptimizer, OriginalCodeKept)
+{
+    // Code which can't be parsed, or whose operator grouping isn't known, is returned as-is.
+    EXPECT_FALSE(OptimizeCode("x = (1;").optimized);
+    EXPECT_EQ(OptimizeCode("x = (1;").code, "x = (1;");
+    EXPECT_FALSE(OptimizeCode("x = -2 ^ 2;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = a ^ b ^ c;").optimized);
+}
+
+TEST(projectMExpressionOptimizer, UncheckedOperators)
+{
+    // Operators whose grouping hasn't been verified against projectm-eval disable the optimizer.
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3; y = a % 4;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3; y = a << 1;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3; y = a >> 1;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3; y = a | b;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3; y = a & b;").optimized);
+    EXPECT_FALSE(OptimizeCode("x = 2 * 3 && a; y = b || c;").optimized);
+    EXPECT_EQ(OptimizeCode("x = 2 * 3; y = a % 4;").code, "x = 2 * 3; y = a % 4;");
+
+    EXPECT_TRUE(OptimizeCode("x = 2 * 3 && a; y = b && c;").optimized);
+}
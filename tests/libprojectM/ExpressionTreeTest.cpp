@@ -0,0 +1,83 @@
+#include "MilkdropPreset/ExpressionTree.hpp"
+
+#include <gtest/gtest.h>
+
+using libprojectM::MilkdropPreset::HasAmbiguousGrouping;
+using libprojectM::MilkdropPreset::ParseExpressionTree;
+using libprojectM::MilkdropPreset::PrintExpressionTree;
+
+namespace {
+
+auto RoundTrip(const std::string& code) -> std::string
+{
+    auto const tree = ParseExpressionTree(code);
+    if (!tree)
+    {
+        return "<parse error>";
+    }
+
+    auto const printed = PrintExpressionTree(*tree);
+
+    // The fully parenthesized output must parse into the same tree.
+    auto const reparsed = ParseExpressionTree(printed);
+    EXPECT_TRUE(reparsed);
+    if (reparsed)
+    {
+        EXPECT_EQ(PrintExpressionTree(*reparsed), printed);
+        EXPECT_FALSE(HasAmbiguousGrouping(*reparsed)) << printed;
+    }
+
+    return printed;
+}
+
+} // namespace
+
+TEST(projectMExpressionTree, ArithmeticPrecedence)
+{
+    EXPECT_EQ(RoundTrip("a = b + c * d - e / f"), "a = ((b + (c * d)) - (e / f));\n");
+    EXPECT_EQ(RoundTrip("a = b * c % d"), "a = (b * (c % d));\n");
+    EXPECT_EQ(RoundTrip("a = b % c * d"), "a = ((b % c) * d);\n");
+    EXPECT_EQ(RoundTrip("a = b + c << 2"), "a = (b + (c << 2));\n");
+    EXPECT_EQ(RoundTrip("a = b / c >> 1"), "a = (b / (c >> 1));\n");
+    EXPECT_EQ(RoundTrip("a = b << c % d"), "a = (b << (c % d));\n");
+    EXPECT_EQ(RoundTrip("a = b | c + d & e"), "a = ((b | (c + d)) & e);\n");
+    EXPECT_EQ(RoundTrip("a = b == c | d"), "a = (b == (c | d));\n");
+}
+
+TEST(projectMExpressionTree, PowerAndUnaryPrecedence)
+{
+    EXPECT_EQ(RoundTrip("a = -b ^ 2"), "a = (-(b ^ 2));\n");
+    EXPECT_EQ(RoundTrip("a = (-b) ^ 2"), "a = ((-b) ^ 2);\n");
+    EXPECT_EQ(RoundTrip("a = b ^ -c"), "a = (b ^ (-c));\n");
+    EXPECT_EQ(RoundTrip("a = 2 * b ^ c"), "a = (2 * (b ^ c));\n");
+    EXPECT_EQ(RoundTrip("a = !b ^ c"), "a = (!(b ^ c));\n");
+    EXPECT_EQ(RoundTrip("a = -b * c"), "a = ((-b) * c);\n");
+}
+
+TEST(projectMExpressionTree, LogicPrecedence)
+{
+    // && and || share one precedence level and group from left to right.
+    EXPECT_EQ(RoundTrip("a = x || y && z"), "a = ((x || y) && z);\n");
+    EXPECT_EQ(RoundTrip("a = x && y || z"), "a = ((x && y) || z);\n");
+    EXPECT_EQ(RoundTrip("a = x < y && y + 1 > z"), "a = ((x < y) && ((y + 1) > z));\n");
+    EXPECT_EQ(RoundTrip("a = x || y ? b : c"), "a = if((x || y), b, c);\n");
+}
+
+TEST(projectMExpressionTree, AmbiguousGrouping)
+{
+    for (const auto* code : {"a = x || y && z", "a = -b ^ 2", "a = b ^ c ^ d", "a = b * c % d",
+                             "a = b + c << 2", "a = b & c | d", "a = b == c | d"})
+    {
+        auto const tree = ParseExpressionTree(code);
+        ASSERT_TRUE(tree) << code;
+        EXPECT_TRUE(HasAmbiguousGrouping(*tree)) << code;
+    }
+
+    for (const auto* code : {"a = (x || y) && z", "a = -(b ^ 2)", "a = b ^ (c ^ d)", "a = b * (c % d)",
+                             "a = b % c % d", "a = b + c * d - e", "a = x || y || z", "a = b ^ -c", "a = sin(b % c)"})
+    {
+        auto const tree = ParseExpressionTree(code);
+        ASSERT_TRUE(tree) << code;
+        EXPECT_FALSE(HasAmbiguousGrouping(*tree)) << code;
+    }
+}
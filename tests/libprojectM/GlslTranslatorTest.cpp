@@ -0,0 +1,69 @@
+#include "MilkdropPreset/GlslTranslator.hpp"
+
+#include <gtest/gtest.h>
+
+using libprojectM::MilkdropPreset::TranslateToGlsl;
+
+TEST(projectMGlslTranslator, Statements)
+{
+    auto const translation = TranslateToGlsl("zoom = zoom + 0.1 * sin(Rad * 3 + $PI);\n"
+                                             "rot = if(above(q1, .5), 0.1, -0.1); // comment\n"
+                                             "/* dx = 1; */ t = (-2) ^ 2;; dy /= t");
+
+    ASSERT_TRUE(translation.translated) << translation.error;
+    EXPECT_EQ(translation.variables, (std::set<std::string>{"zoom", "rad", "q1", "rot", "t", "dy"}));
+    EXPECT_EQ(translation.code,
+              "    (expr_var_zoom = (expr_var_zoom + (0.1 * sin(((expr_var_rad * 3.0) + 3.14159265)))));\n"
+              "    (expr_var_rot = (expr_true(float(expr_var_q1 > 0.5)) ? 0.1 : (-0.1)));\n"
+              "    (expr_var_t = expr_pow((-2.0), 2.0));\n"
+              "    (expr_var_dy = expr_div(expr_var_dy, expr_var_t));\n");
+}
+
+TEST(projectMGlslTranslator, Precedence)
+{
+    auto const translation = TranslateToGlsl("a = b || (c && d == e + f * g); h = i ? j : k ? l : m; n = (o; p)");
+
+    ASSERT_TRUE(translation.translated) << translation.error;
+    EXPECT_EQ(translation.code,
+              "    (expr_var_a = float(expr_true(expr_var_b) || expr_true(float(expr_true(expr_var_c) && "
+              "expr_true(expr_equal(expr_var_d, (expr_var_e + (expr_var_f * expr_var_g))))))));\n"
+              "    (expr_var_h = (expr_true(expr_var_i) ? expr_var_j : (expr_true(expr_var_k) ? expr_var_l : expr_var_m)));\n"
+              "    (expr_var_n = (expr_var_o, expr_var_p));\n");
+}
+
+TEST(projectMGlslTranslator, AmbiguousGrouping)
+{
+    // Operators whose grouping relies on precedence not verified against projectm-eval aren't translated.
+    for (const auto* code : {"a = b || c && d;", "a = -b ^ 2;", "a = b ^ c ^ d;", "a = b * c % d;", "a = b + c << 2;"})
+    {
+        auto const translation = TranslateToGlsl(code);
+        EXPECT_FALSE(translation.translated) << code;
+        EXPECT_EQ(translation.error, "ambiguous operator grouping") << code;
+    }
+
+    // Explicit parentheses make the grouping unambiguous.
+    auto const translation = TranslateToGlsl("a = (b || c) && d; e = -(f ^ 2); g = h ^ (i ^ j)");
+
+    ASSERT_TRUE(translation.translated) << translation.error;
+    EXPECT_EQ(translation.code,
+              "    (expr_var_a = float(expr_true(float(expr_true(expr_var_b) || expr_true(expr_var_c))) && expr_true(expr_var_d)));\n"
+              "    (expr_var_e = (-expr_pow(expr_var_f, 2.0)));\n"
+              "    (expr_var_g = expr_pow(expr_var_h, expr_pow(expr_var_i, expr_var_j)));\n");
+}
+
+TEST(projectMGlslTranslator, UnsupportedCode)
+{
+    EXPECT_FALSE(TranslateToGlsl("megabuf(0) = 1;").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = gmegabuf(1);").translated);
+    EXPECT_FALSE(TranslateToGlsl("loop(10, zoom += 0.01);").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = rand(10);").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = 5 % 3;").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = sin(1, 2);").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = (1;").translated);
+    EXPECT_FALSE(TranslateToGlsl("zoom = $'a';").translated);
+    EXPECT_FALSE(TranslateToGlsl("a[1] = 2;").translated);
+
+    auto const translation = TranslateToGlsl("zoom = 1; while(zoom -= 0.1);");
+    EXPECT_FALSE(translation.translated);
+    EXPECT_EQ(translation.error, "unsupported function \"while\"");
+}
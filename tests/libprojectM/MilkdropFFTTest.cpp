@@ -0,0 +1,125 @@
+#include "Audio/MilkdropFFT.hpp"
+
+#include "Audio/AudioConstants.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+constexpr double Pi = 3.141592653589793238462643383279502884197169399;
+
+/**
+ * Straightforward double-precision DFT with the same envelope and equalizer as MilkdropFFT.
+ */
+auto ReferenceSpectrum(const std::vector<float>& waveform, size_t samplesIn, size_t samplesOut) -> std::vector<double>
+{
+    size_t const numFrequencies = samplesOut * 2;
+    std::vector<double> spectrum(samplesOut);
+
+    for (size_t k = 0; k < samplesOut; k++)
+    {
+        std::complex<double> sum;
+        for (size_t n = 0; n < samplesIn; n++)
+        {
+            double const envelope = 0.5 + 0.5 * std::sin(static_cast<double>(n) * 2.0 * Pi / static_cast<double>(samplesIn) - Pi * 0.5);
+            sum += static_cast<double>(waveform[n]) * envelope * std::polar(1.0, -2.0 * Pi * static_cast<double>(k * n) / static_cast<double>(numFrequencies));
+        }
+
+        double const equalize = -0.02 * std::log(static_cast<double>(samplesOut - k) / static_cast<double>(samplesOut));
+        spectrum[k] = equalize * std::abs(sum);
+    }
+
+    return spectrum;
+}
+
+auto RandomWaveform(std::mt19937& random) -> std::vector<float>
+{
+    std::uniform_real_distribution<float> distribution(-128.0f, 128.0f);
+
+    std::vector<float> waveform(AudioBufferSamples);
+    for (auto& sample : waveform)
+    {
+        sample = distribution(random);
+    }
+
+    return waveform;
+}
+
+} // namespace
+
+TEST(projectMMilkdropFFT, MatchesReferenceDFT)
+{
+    MilkdropFFT fft(true);
+    std::mt19937 random(4711);
+
+    for (int run = 0; run < 4; run++)
+    {
+        auto const waveform = RandomWaveform(random);
+        auto const expected = ReferenceSpectrum(waveform, WaveformSamples, SpectrumSamples);
+
+        std::vector<float> spectrum;
+        fft.TimeToFrequencyDomain(waveform, spectrum);
+        ASSERT_EQ(spectrum.size(), SpectrumSamples);
+
+        double const maxValue = *std::max_element(expected.begin(), expected.end());
+        for (size_t i = 0; i < SpectrumSamples; i++)
+        {
+            EXPECT_NEAR(spectrum[i], expected[i], maxValue * 1e-5) << "Frequency " << i;
+        }
+    }
+}
+
+TEST(projectMMilkdropFFT, StereoMatchesMono)
+{
+    MilkdropFFT fft(true);
+    std::mt19937 random(815);
+
+    auto const left = RandomWaveform(random);
+    auto const right = RandomWaveform(random);
+
+    std::vector<float> expectedLeft;
+    std::vector<float> expectedRight;
+    fft.TimeToFrequencyDomain(left, expectedLeft);
+    fft.TimeToFrequencyDomain(right, expectedRight);
+
+    std::vector<float> spectrumLeft(SpectrumSamples);
+    std::vector<float> spectrumRight(SpectrumSamples);
+    fft.TimeToFrequencyDomain(left.data(), right.data(), spectrumLeft.data(), spectrumRight.data());
+
+    float const maxValue = std::max(*std::max_element(expectedLeft.begin(), expectedLeft.end()),
+                                    *std::max_element(expectedRight.begin(), expectedRight.end()));
+    for (size_t i = 0; i < SpectrumSamples; i++)
+    {
+        EXPECT_NEAR(spectrumLeft[i], expectedLeft[i], maxValue * 1e-5f) << "Frequency " << i;
+        EXPECT_NEAR(spectrumRight[i], expectedRight[i], maxValue * 1e-5f) << "Frequency " << i;
+    }
+}
+
+TEST(projectMMilkdropFFT, SineWavePeak)
+{
+    MilkdropFFT fft(false, -1.0f);
+
+    // A sine wave with a period of exactly 32 samples ends up in bin 1024 / 32 = 32.
+    std::vector<float> left(AudioBufferSamples);
+    std::vector<float> right(AudioBufferSamples);
+    for (size_t i = 0; i < AudioBufferSamples; i++)
+    {
+        left[i] = static_cast<float>(std::sin(2.0 * Pi * static_cast<double>(i) / 32.0));
+        right[i] = static_cast<float>(std::cos(2.0 * Pi * static_cast<double>(i) / 64.0));
+    }
+
+    std::vector<float> spectrumLeft(SpectrumSamples);
+    std::vector<float> spectrumRight(SpectrumSamples);
+    fft.TimeToFrequencyDomain(left.data(), right.data(), spectrumLeft.data(), spectrumRight.data());
+
+    EXPECT_EQ(std::distance(spectrumLeft.begin(), std::max_element(spectrumLeft.begin(), spectrumLeft.end())), 32);
+    EXPECT_EQ(std::distance(spectrumRight.begin(), std::max_element(spectrumRight.begin(), spectrumRight.end())), 16);
+}
@@ -0,0 +1,328 @@
+#include "Audio/AudioFeatureFile.hpp"
+#include "Audio/AudioFileException.hpp"
+#include "Audio/OfflineAnalyzer.hpp"
+#include "Audio/PCM.hpp"
+#include "Audio/WavFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+constexpr uint32_t SampleRate = 44100;
+
+void AppendUInt16(std::string& data, uint16_t value)
+{
+    data.push_back(static_cast<char>(value & 0xFF));
+    data.push_back(static_cast<char>(value >> 8));
+}
+
+void AppendUInt32(std::string& data, uint32_t value)
+{
+    AppendUInt16(data, static_cast<uint16_t>(value & 0xFFFF));
+    AppendUInt16(data, static_cast<uint16_t>(value >> 16));
+}
+
+/**
+ * Builds a WAVE file in memory, including an unknown chunk before the data to test chunk skipping.
+ * The format chunk is extended with zero bytes up to formatChunkSize. If dataChunkSize is non-zero,
+ * it is written as the data chunk size instead of the actual sample data size.
+ */
+auto MakeWavFile(uint16_t format, uint16_t channels, uint16_t bitsPerSample, const std::string& sampleData,
+                 uint32_t formatChunkSize = 16, uint32_t dataChunkSize = 0) -> std::string
+{
+    std::string chunks = "WAVE";
+
+    chunks += "fmt ";
+    AppendUInt32(chunks, formatChunkSize);
+    AppendUInt16(chunks, format);
+    AppendUInt16(chunks, channels);
+    AppendUInt32(chunks, SampleRate);
+    AppendUInt32(chunks, SampleRate * channels * bitsPerSample / 8);
+    AppendUInt16(chunks, static_cast<uint16_t>(channels * bitsPerSample / 8));
+    AppendUInt16(chunks, bitsPerSample);
+    chunks.append(formatChunkSize - 16 + (formatChunkSize & 1), '\0'); // Extra bytes and padding
+
+    chunks += "LIST";
+    AppendUInt32(chunks, 3);
+    chunks += "abc";
+    chunks.push_back('\0'); // Padding byte
+
+    chunks += "data";
+    AppendUInt32(chunks, dataChunkSize != 0 ? dataChunkSize : static_cast<uint32_t>(sampleData.size()));
+    chunks += sampleData;
+
+    std::string file = "RIFF";
+    AppendUInt32(file, static_cast<uint32_t>(chunks.size()));
+    return file + chunks;
+}
+
+auto MakeTestSignal(size_t sampleCount) -> std::vector<float>
+{
+    std::vector<float> samples(sampleCount * 2);
+    for (size_t i = 0; i < sampleCount; i++)
+    {
+        auto const time = static_cast<float>(i) / static_cast<float>(SampleRate);
+        samples[i * 2] = 0.5f * std::sin(2.0f * 3.14159265f * 110.0f * time) * std::sin(3.14159265f * time * 2.0f);
+        samples[i * 2 + 1] = 0.3f * std::sin(2.0f * 3.14159265f * 880.0f * time);
+    }
+
+    return samples;
+}
+
+auto ExpectFrameAudioDataEqual(const FrameAudioData& actual, const FrameAudioData& expected) -> void
+{
+    EXPECT_EQ(actual.bass, expected.bass);
+    EXPECT_EQ(actual.bassAtt, expected.bassAtt);
+    EXPECT_EQ(actual.mid, expected.mid);
+    EXPECT_EQ(actual.midAtt, expected.midAtt);
+    EXPECT_EQ(actual.treb, expected.treb);
+    EXPECT_EQ(actual.trebAtt, expected.trebAtt);
+    EXPECT_EQ(actual.vol, expected.vol);
+    EXPECT_EQ(actual.volAtt, expected.volAtt);
+    EXPECT_EQ(actual.waveformLeft, expected.waveformLeft);
+    EXPECT_EQ(actual.waveformRight, expected.waveformRight);
+    EXPECT_EQ(actual.spectrumLeft, expected.spectrumLeft);
+    EXPECT_EQ(actual.spectrumRight, expected.spectrumRight);
+}
+
+} // namespace
+
+TEST(projectMWavFile, ReadsInt16Stereo)
+{
+    std::string sampleData;
+    for (int16_t value : {int16_t{0}, int16_t{-32768}, int16_t{16384}, int16_t{32767}})
+    {
+        AppendUInt16(sampleData, static_cast<uint16_t>(value));
+    }
+
+    std::istringstream stream(MakeWavFile(1, 2, 16, sampleData));
+    auto const wavFile = WavFile::Load(stream);
+
+    EXPECT_EQ(wavFile.SampleRate(), SampleRate);
+    EXPECT_EQ(wavFile.Channels(), 2);
+    ASSERT_EQ(wavFile.SampleCount(), 2);
+    EXPECT_FLOAT_EQ(wavFile.Samples()[0], 0.0f);
+    EXPECT_FLOAT_EQ(wavFile.Samples()[1], -1.0f);
+    EXPECT_FLOAT_EQ(wavFile.Samples()[2], 0.5f);
+    EXPECT_NEAR(wavFile.Samples()[3], 1.0f, 1e-4f);
+}
+
+TEST(projectMWavFile, ReadsOtherFormats)
+{
+    {
+        std::istringstream stream(MakeWavFile(1, 1, 8, std::string{'\x00', '\x80', '\xC0'}));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 3);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[0], -1.0f);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[1], 0.0f);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[2], 0.5f);
+    }
+
+    {
+        // 24 bit, little-endian: -0.5 and 0.25
+        std::istringstream stream(MakeWavFile(1, 1, 24, std::string{'\x00', '\x00', '\xC0', '\x00', '\x00', '\x20'}));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 2);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[0], -0.5f);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[1], 0.25f);
+    }
+
+    {
+        // 32 bit float: 0.75
+        std::istringstream stream(MakeWavFile(3, 1, 32, std::string{'\x00', '\x00', '\x40', '\x3F'}));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 1);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[0], 0.75f);
+    }
+}
+
+TEST(projectMWavFile, RejectsInvalidFiles)
+{
+    std::istringstream notRiff("RIFX\x04\x00\x00\x00WAVE");
+    EXPECT_THROW(WavFile::Load(notRiff), AudioFileException);
+
+    // ADPCM is not supported.
+    std::istringstream adpcm(MakeWavFile(2, 1, 4, "abcd"));
+    EXPECT_THROW(WavFile::Load(adpcm), AudioFileException);
+
+    EXPECT_THROW(WavFile::Load(testing::TempDir() + "/does-not-exist.wav"), AudioFileException);
+
+    // Absurd format chunk sizes are not read.
+    std::string hugeFormatData = MakeWavFile(1, 1, 16, "ab");
+    hugeFormatData.replace(16, 4, "\xF0\xFF\xFF\xFF");
+    std::istringstream hugeFormat(hugeFormatData);
+    EXPECT_THROW(WavFile::Load(hugeFormat), AudioFileException);
+}
+
+TEST(projectMWavFile, ToleratesChunkSizes)
+{
+    std::string const sampleData{'\x00', '\x40', '\x00', '\xC0', '\x00', '\x20'};
+
+    // An odd-sized format chunk is followed by a padding byte.
+    {
+        std::istringstream stream(MakeWavFile(1, 1, 16, sampleData, 19));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 3);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[2], 0.25f);
+    }
+
+    // Streaming encoders write the maximum size if the length isn't known.
+    {
+        std::istringstream stream(MakeWavFile(1, 1, 16, sampleData, 16, 0xFFFFFFFF));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 3);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[0], 0.5f);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[1], -0.5f);
+    }
+
+    // A data chunk size smaller than the data limits the samples read.
+    {
+        std::istringstream stream(MakeWavFile(1, 1, 16, sampleData, 16, 4));
+        auto const wavFile = WavFile::Load(stream);
+        EXPECT_EQ(wavFile.SampleCount(), 2);
+    }
+
+    // Data larger than one read is fully decoded.
+    {
+        std::string longData;
+        for (int i = 0; i < 100000; i++)
+        {
+            AppendUInt16(longData, static_cast<uint16_t>(i));
+        }
+        std::istringstream stream(MakeWavFile(1, 2, 16, longData));
+        auto const wavFile = WavFile::Load(stream);
+        ASSERT_EQ(wavFile.SampleCount(), 50000);
+        EXPECT_FLOAT_EQ(wavFile.Samples()[99999], static_cast<int16_t>(99999 & 0xFFFF) / 32768.0f);
+    }
+}
+
+TEST(projectMOfflineAnalyzer, MatchesLiveAnalysis)
+{
+    double const fps = 30.0;
+    size_t const sampleCount = SampleRate / 2 + 123;
+    auto const samples = MakeTestSignal(sampleCount);
+
+    std::string const featureFile = testing::TempDir() + "/projectM-offline-analysis.pmaf";
+    {
+        std::ofstream output(featureFile, std::ios::binary | std::ios::trunc);
+        OfflineAnalyzer::Analyze(samples.data(), 2, sampleCount, SampleRate, fps, output);
+    }
+
+    AudioFeatureFileReader reader(featureFile);
+    EXPECT_EQ(reader.FramesPerSecond(), fps);
+    ASSERT_EQ(reader.FrameCount(), OfflineAnalyzer::FrameCount(sampleCount, SampleRate, fps));
+    ASSERT_EQ(reader.FrameCount(), 16);
+
+    // Feeding the same samples per frame into a live analyzer must give identical results.
+    auto pcm = std::make_unique<PCM>();
+    FrameAudioData replayed;
+    size_t startSample{};
+    for (uint32_t frame = 0; frame < reader.FrameCount(); frame++)
+    {
+        size_t const endSample = std::min(static_cast<size_t>((frame + 1) * SampleRate / fps), sampleCount);
+        pcm->Add(samples.data() + startSample * 2, 2, endSample - startSample);
+        pcm->UpdateFrameAudioData(1.0 / fps, frame);
+        startSample = endSample;
+
+        reader.ReadFrame(frame, replayed);
+        ExpectFrameAudioDataEqual(replayed, pcm->GetFrameAudioData());
+    }
+
+    std::remove(featureFile.c_str());
+}
+
+TEST(projectMOfflineAnalyzer, WavFileAnalysisIsDeterministic)
+{
+    size_t const sampleCount = SampleRate / 4;
+    auto const samples = MakeTestSignal(sampleCount);
+
+    std::string sampleData;
+    for (auto sample : samples)
+    {
+        AppendUInt16(sampleData, static_cast<uint16_t>(static_cast<int16_t>(sample * 32767.0f)));
+    }
+
+    std::string const wavFile = testing::TempDir() + "/projectM-offline-analysis.wav";
+    {
+        std::ofstream output(wavFile, std::ios::binary | std::ios::trunc);
+        output << MakeWavFile(1, 2, 16, sampleData);
+    }
+
+    std::string const firstFeatureFile = testing::TempDir() + "/projectM-offline-analysis-1.pmaf";
+    std::string const secondFeatureFile = testing::TempDir() + "/projectM-offline-analysis-2.pmaf";
+    OfflineAnalyzer::AnalyzeWavFile(wavFile, firstFeatureFile, 60.0);
+    OfflineAnalyzer::AnalyzeWavFile(wavFile, secondFeatureFile, 60.0);
+
+    std::ifstream first(firstFeatureFile, std::ios::binary);
+    std::ifstream second(secondFeatureFile, std::ios::binary);
+    std::string const firstContents((std::istreambuf_iterator<char>(first)), std::istreambuf_iterator<char>());
+    std::string const secondContents((std::istreambuf_iterator<char>(second)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ(firstContents.size(), AudioFeatureFileReader::HeaderSize + 15 * AudioFeatureFileReader::FrameSize);
+    EXPECT_TRUE(firstContents == secondContents);
+
+    std::remove(wavFile.c_str());
+    std::remove(firstFeatureFile.c_str());
+    std::remove(secondFeatureFile.c_str());
+}
+
+TEST(projectMOfflineAnalyzer, PCMReplaysFeatureFile)
+{
+    size_t const sampleCount = SampleRate / 10;
+    auto const samples = MakeTestSignal(sampleCount);
+
+    std::string const featureFile = testing::TempDir() + "/projectM-offline-replay.pmaf";
+    {
+        std::ofstream output(featureFile, std::ios::binary | std::ios::trunc);
+        OfflineAnalyzer::Analyze(samples.data(), 2, sampleCount, SampleRate, 60.0, output);
+    }
+
+    AudioFeatureFileReader reader(featureFile);
+    ASSERT_EQ(reader.FrameCount(), 6);
+
+    PCM pcm;
+    pcm.SetFeatureReplay(std::make_unique<AudioFeatureFileReader>(featureFile));
+    EXPECT_FALSE(pcm.SetBackgroundAnalysis(true));
+
+    FrameAudioData expected;
+    for (uint32_t frame = 0; frame < reader.FrameCount() + 2; frame++)
+    {
+        pcm.UpdateFrameAudioData(1.0 / 60.0, frame);
+
+        // The last frame is repeated after reaching the end.
+        reader.ReadFrame(std::min(frame, reader.FrameCount() - 1), expected);
+        ExpectFrameAudioDataEqual(pcm.GetFrameAudioData(), expected);
+    }
+
+    pcm.SeekFeatureReplay(2);
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 0);
+    reader.ReadFrame(2, expected);
+    ExpectFrameAudioDataEqual(pcm.GetFrameAudioData(), expected);
+
+    pcm.SetFeatureReplay(nullptr);
+    std::remove(featureFile.c_str());
+}
+
+TEST(projectMOfflineAnalyzer, RejectsInvalidFeatureFiles)
+{
+    std::string const featureFile = testing::TempDir() + "/projectM-invalid.pmaf";
+    {
+        std::ofstream output(featureFile, std::ios::binary | std::ios::trunc);
+        output << "This is not an audio feature file, but long enough for a header.";
+    }
+
+    EXPECT_THROW(AudioFeatureFileReader reader(featureFile), AudioFileException);
+    EXPECT_THROW(AudioFeatureFileReader reader(featureFile + ".missing"), AudioFileException);
+
+    std::remove(featureFile.c_str());
+}
@@ -0,0 +1,111 @@
+#include "Audio/PCM.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+std::atomic<bool> countAllocations{false}; //!< If true, calls to operator new are counted.
+std::atomic<size_t> allocationCount{0};    //!< Number of allocations while counting was enabled.
+
+auto CountedAllocate(size_t size) -> void*
+{
+    if (countAllocations.load(std::memory_order_relaxed))
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* pointer = std::malloc(size > 0 ? size : 1);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+} // namespace
+
+// Replace the global allocation functions for the whole test executable. The nothrow
+// and sized variants forward to these by default.
+void* operator new(size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+TEST(projectMPCM, NoAllocationsPerFrame)
+{
+    auto pcm = std::make_unique<PCM>();
+
+    std::vector<float> floatSamples(2 * 735);
+    std::vector<int16_t> int16Samples(2 * 735);
+    std::vector<uint8_t> uint8Samples(2 * 735);
+    for (size_t i = 0; i < floatSamples.size(); i++)
+    {
+        auto const value = std::sin(static_cast<float>(i) * 0.05f);
+        floatSamples[i] = value;
+        int16Samples[i] = static_cast<int16_t>(value * 32767.0f);
+        uint8Samples[i] = static_cast<uint8_t>(value * 127.0f + 128.0f);
+    }
+
+    auto renderFrame = [&](uint32_t frame) {
+        pcm->Add(floatSamples.data(), 2, floatSamples.size() / 2);
+        pcm->Add(int16Samples.data(), 2, int16Samples.size() / 2);
+        pcm->Add(uint8Samples.data(), 1, uint8Samples.size());
+        pcm->UpdateFrameAudioData(1.0 / 60.0, frame);
+        auto const& audioData = pcm->GetFrameAudioData();
+        EXPECT_GT(audioData.vol, 0.0f);
+    };
+
+    // Warm-up, e.g. for one-time initializations on the first frame.
+    uint32_t frame{};
+    for (; frame < 10; frame++)
+    {
+        renderFrame(frame);
+    }
+
+    allocationCount = 0;
+    countAllocations = true;
+
+    for (; frame < 200; frame++)
+    {
+        renderFrame(frame);
+    }
+
+    countAllocations = false;
+
+    EXPECT_EQ(allocationCount.load(), 0);
+}
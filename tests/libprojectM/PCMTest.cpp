@@ -0,0 +1,638 @@
+#include "Audio/PCM.hpp"
+#include "Audio/SampleConverter.hpp"
+#include "Audio/SampleRingBuffer.hpp"
+#include "Audio/TripleBuffer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace libprojectM::Audio;
+
+namespace {
+
+// Ramp values must stay exactly representable in a float after scaling by 128.
+constexpr uint32_t RampPeriod = 4096;
+
+/**
+ * Checks that the given samples are a contiguous section of the ramp written by the producer,
+ * scaled by the given factor.
+ */
+auto IsContiguousRamp(const float* samples, size_t count, float scale) -> bool
+{
+    for (size_t i = 1; i < count; i++)
+    {
+        auto const delta = samples[i] - samples[i - 1];
+        if (delta != scale && delta != -scale * static_cast<float>(RampPeriod - 1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Converts the samples with all supported instruction sets and compares the results against the scalar implementation.
+ */
+template<typename SampleType>
+void CompareConverters(const std::vector<SampleType>& samples)
+{
+    SampleConverter const scalar(SampleConverter::InstructionSet::Scalar);
+
+    for (auto instructionSet : {SampleConverter::InstructionSet::SSE2, SampleConverter::InstructionSet::AVX2, SampleConverter::InstructionSet::NEON})
+    {
+        if (!SampleConverter::IsSupported(instructionSet))
+        {
+            continue;
+        }
+
+        SampleConverter const converter(instructionSet);
+        ASSERT_EQ(converter.ActiveInstructionSet(), instructionSet);
+
+        // Up to 8 channels are downmixed, any further channels are ignored.
+        for (uint32_t channels = 1; channels <= SampleConverter::MaxDownmixChannels + 1; channels++)
+        {
+            // Odd counts also exercise the scalar tail handling.
+            for (size_t count : {size_t{0}, size_t{1}, size_t{7}, size_t{8}, size_t{17}, size_t{63}, samples.size() / channels})
+            {
+                std::vector<float> expectedLeft(count);
+                std::vector<float> expectedRight(count);
+                std::vector<float> left(count);
+                std::vector<float> right(count);
+
+                scalar.Convert(samples.data(), channels, count, expectedLeft.data(), expectedRight.data());
+                converter.Convert(samples.data(), channels, count, left.data(), right.data());
+
+                EXPECT_EQ(left, expectedLeft) << "Instruction set " << static_cast<int>(instructionSet) << ", " << channels << " channel(s)";
+                EXPECT_EQ(right, expectedRight) << "Instruction set " << static_cast<int>(instructionSet) << ", " << channels << " channel(s)";
+            }
+        }
+    }
+}
+
+/**
+ * Feeds a sine wave with a period of 32 samples into a PCM instance of the given configuration
+ * and returns the spectrum bin with the highest magnitude.
+ */
+template<typename Config>
+auto SinePeakBin() -> size_t
+{
+    BasicPCM<Config> pcm;
+
+    std::vector<float> samples(2 * Config::AudioBufferSamples);
+    for (size_t i = 0; i < Config::AudioBufferSamples; i++)
+    {
+        samples[2 * i] = std::sin(static_cast<float>(i) * 2.0f * 3.14159265f / 32.0f);
+        samples[2 * i + 1] = samples[2 * i];
+    }
+
+    pcm.Add(samples.data(), 2, Config::AudioBufferSamples);
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 0);
+
+    auto const& spectrum = pcm.GetFrameAudioData().spectrumLeft;
+    EXPECT_EQ(spectrum.size(), Config::SpectrumSamples);
+    EXPECT_EQ(pcm.GetFrameAudioData().waveformLeft.size(), Config::WaveformSamples);
+
+    return static_cast<size_t>(std::distance(spectrum.begin(), std::max_element(spectrum.begin(), spectrum.end())));
+}
+
+} // namespace
+
+TEST(projectMSampleConverter, InstructionSetsMatchScalar)
+{
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> floatDistribution(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> int16Distribution(-32768, 32767);
+    std::uniform_int_distribution<int> uint8Distribution(0, 255);
+
+    std::vector<float> floatSamples(1021);
+    std::vector<int16_t> int16Samples(1021);
+    std::vector<uint8_t> uint8Samples(1021);
+    for (size_t i = 0; i < floatSamples.size(); i++)
+    {
+        floatSamples[i] = floatDistribution(random);
+        int16Samples[i] = static_cast<int16_t>(int16Distribution(random));
+        uint8Samples[i] = static_cast<uint8_t>(uint8Distribution(random));
+    }
+
+    // Include the extremes.
+    int16Samples[0] = -32768;
+    int16Samples[1] = 32767;
+    uint8Samples[0] = 0;
+    uint8Samples[1] = 255;
+
+    CompareConverters(floatSamples);
+    CompareConverters(int16Samples);
+    CompareConverters(uint8Samples);
+}
+
+TEST(projectMSampleConverter, ScalesToInternalRange)
+{
+    SampleConverter const converter;
+
+    float const floatSamples[] = {-1.0f, 1.0f, 0.5f, -0.25f};
+    int16_t const int16Samples[] = {-32768, 16384, 0, -256};
+    uint8_t const uint8Samples[] = {0, 255, 128, 64};
+
+    float left[2]{};
+    float right[2]{};
+
+    converter.Convert(floatSamples, 2, 2, left, right);
+    EXPECT_FLOAT_EQ(left[0], -128.0f);
+    EXPECT_FLOAT_EQ(right[0], 128.0f);
+    EXPECT_FLOAT_EQ(left[1], 64.0f);
+    EXPECT_FLOAT_EQ(right[1], -32.0f);
+
+    converter.Convert(int16Samples, 2, 2, left, right);
+    EXPECT_FLOAT_EQ(left[0], -128.0f);
+    EXPECT_FLOAT_EQ(right[0], 64.0f);
+    EXPECT_FLOAT_EQ(left[1], 0.0f);
+    EXPECT_FLOAT_EQ(right[1], -1.0f);
+
+    converter.Convert(uint8Samples, 2, 2, left, right);
+    EXPECT_FLOAT_EQ(left[0], -128.0f);
+    EXPECT_FLOAT_EQ(right[0], 127.0f);
+    EXPECT_FLOAT_EQ(left[1], 0.0f);
+    EXPECT_FLOAT_EQ(right[1], -64.0f);
+
+    // Mono input is copied to both channels.
+    converter.Convert(floatSamples, 1, 2, left, right);
+    EXPECT_FLOAT_EQ(left[1], 128.0f);
+    EXPECT_FLOAT_EQ(right[1], 128.0f);
+}
+
+TEST(projectMSampleConverter, DownmixSurround)
+{
+    SampleConverter converter;
+
+    // One frame per channel, each with only that channel set.
+    std::array<float, 36> surround51{};
+    std::array<int16_t, 36> surround51Int16{};
+    for (size_t channel = 0; channel < 6; channel++)
+    {
+        surround51[channel * 6 + channel] = 0.5f;
+        surround51Int16[channel * 6 + channel] = 16384;
+    }
+
+    float const attenuated = 0.70710678f * 64.0f;
+    std::array<float, 6> const expectedLeft{64.0f, 0.0f, attenuated, 0.0f, attenuated, 0.0f};
+    std::array<float, 6> const expectedRight{0.0f, 64.0f, attenuated, 0.0f, 0.0f, attenuated};
+
+    std::array<float, 6> left{};
+    std::array<float, 6> right{};
+    converter.Convert(surround51.data(), 6, 6, left.data(), right.data());
+    EXPECT_EQ(left, expectedLeft);
+    EXPECT_EQ(right, expectedRight);
+
+    converter.Convert(surround51Int16.data(), 6, 6, left.data(), right.data());
+    EXPECT_EQ(left, expectedLeft);
+    EXPECT_EQ(right, expectedRight);
+
+    // Custom matrix: LFE only, mixed into both outputs.
+    std::array<float, 12> const lfeOnly{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f};
+    ASSERT_TRUE(converter.SetDownmixMatrix(6, lfeOnly.data()));
+    converter.Convert(surround51.data(), 6, 6, left.data(), right.data());
+    EXPECT_EQ(left, (std::array<float, 6>{0.0f, 0.0f, 0.0f, 64.0f, 0.0f, 0.0f}));
+    EXPECT_EQ(right, (std::array<float, 6>{0.0f, 0.0f, 0.0f, 32.0f, 0.0f, 0.0f}));
+
+    ASSERT_TRUE(converter.SetDownmixMatrix(6, nullptr));
+    converter.Convert(surround51.data(), 6, 6, left.data(), right.data());
+    EXPECT_EQ(left, expectedLeft);
+    EXPECT_EQ(right, expectedRight);
+
+    EXPECT_FALSE(converter.SetDownmixMatrix(2, lfeOnly.data()));
+    EXPECT_FALSE(converter.SetDownmixMatrix(SampleConverter::MaxDownmixChannels + 1, nullptr));
+}
+
+TEST(projectMSampleRingBuffer, ReadLatestWrapsAround)
+{
+    SampleRingBuffer buffer;
+
+    // Write enough samples to wrap around the buffer end at least once.
+    uint32_t value{};
+    for (size_t write = 0; write < SampleRingBuffer::Capacity / 500 + 3; write++)
+    {
+        size_t const count = 500;
+        auto const sequence = buffer.BeginWrite(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const index = SampleRingBuffer::Index(sequence + i);
+            buffer.Left()[index] = static_cast<float>(value);
+            buffer.Right()[index] = -static_cast<float>(value);
+            value++;
+        }
+        buffer.CommitWrite(count);
+    }
+
+    std::vector<float> left(AudioBufferSamples);
+    std::vector<float> right(AudioBufferSamples);
+
+    size_t newSamples{};
+    ASSERT_TRUE(buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, 0, newSamples));
+    EXPECT_EQ(newSamples, SampleRingBuffer::Capacity);
+    EXPECT_EQ(buffer.ReadSequence(), buffer.WriteSequence());
+
+    for (size_t i = 0; i < AudioBufferSamples; i++)
+    {
+        auto const expected = static_cast<float>(value - AudioBufferSamples + i);
+        EXPECT_EQ(left[i], expected);
+        EXPECT_EQ(right[i], -expected);
+    }
+
+    // Nothing new was added since the last read.
+    ASSERT_TRUE(buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, 0, newSamples));
+    EXPECT_EQ(newSamples, 0);
+}
+
+TEST(projectMSampleRingBuffer, ReadLatestWithDelay)
+{
+    SampleRingBuffer buffer;
+
+    size_t const count = SampleRingBuffer::MaxWriteSamples;
+    auto const sequence = buffer.BeginWrite(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        buffer.Left()[SampleRingBuffer::Index(sequence + i)] = static_cast<float>(i);
+        buffer.Right()[SampleRingBuffer::Index(sequence + i)] = -static_cast<float>(i);
+    }
+    buffer.CommitWrite(count);
+
+    std::vector<float> left(AudioBufferSamples);
+    std::vector<float> right(AudioBufferSamples);
+
+    size_t newSamples{};
+    ASSERT_TRUE(buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, 1000, newSamples));
+    EXPECT_EQ(left.back(), static_cast<float>(count - 1 - 1000));
+    EXPECT_EQ(right.front(), -static_cast<float>(count - 1000 - AudioBufferSamples));
+
+    // The delay is limited to the history kept in the buffer.
+    ASSERT_TRUE(buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, SampleRingBuffer::Capacity, newSamples));
+    EXPECT_EQ(left.front(), static_cast<float>(count - SampleRingBuffer::MaxReadSamples));
+}
+
+TEST(projectMSampleRingBuffer, SequenceAtTimestamp)
+{
+    SampleRingBuffer buffer;
+    size_t sequence{};
+
+    EXPECT_FALSE(buffer.SequenceAt(1.0, sequence));
+
+    // 1000 samples per second, with a gap between the second and third timestamp.
+    buffer.AddTimestamp(0, 10.0);
+    buffer.AddTimestamp(1000, 11.0);
+
+    ASSERT_TRUE(buffer.SequenceAt(10.5, sequence));
+    EXPECT_EQ(sequence, 500);
+
+    // Extrapolated past the newest timestamp.
+    ASSERT_TRUE(buffer.SequenceAt(11.25, sequence));
+    EXPECT_EQ(sequence, 1250);
+
+    // Before the oldest timestamp.
+    ASSERT_TRUE(buffer.SequenceAt(5.0, sequence));
+    EXPECT_EQ(sequence, 0);
+
+    buffer.AddTimestamp(3000, 13.0);
+    ASSERT_TRUE(buffer.SequenceAt(12.0, sequence));
+    EXPECT_EQ(sequence, 2000);
+
+    // Only the most recent timestamps are kept.
+    for (size_t i = 0; i < SampleRingBuffer::TimestampCount; i++)
+    {
+        buffer.AddTimestamp(10000 + i * 100, 20.0 + static_cast<double>(i) * 0.1);
+    }
+    ASSERT_TRUE(buffer.SequenceAt(12.0, sequence));
+    EXPECT_EQ(sequence, 10000);
+}
+
+TEST(projectMSampleRingBuffer, ConcurrentReadsAreNotTorn)
+{
+    SampleRingBuffer buffer;
+    std::atomic<bool> done{false};
+
+    // Start with one full, consistent analysis window, so the destination buffers always hold
+    // a consistent snapshot, no matter how many reads the producer interrupts.
+    uint32_t value{};
+    auto const firstSequence = buffer.BeginWrite(AudioBufferSamples);
+    for (size_t i = 0; i < AudioBufferSamples; i++)
+    {
+        auto const index = SampleRingBuffer::Index(firstSequence + i);
+        buffer.Left()[index] = static_cast<float>(value);
+        buffer.Right()[index] = -static_cast<float>(value);
+        value = (value + 1) % RampPeriod;
+    }
+    buffer.CommitWrite(AudioBufferSamples);
+
+    std::vector<float> left(AudioBufferSamples);
+    std::vector<float> right(AudioBufferSamples);
+    size_t newSamples{};
+    ASSERT_TRUE(buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, 0, newSamples));
+
+    std::thread producer([&buffer, &done, value]() mutable {
+        size_t count{1};
+        while (!done.load(std::memory_order_relaxed))
+        {
+            auto const sequence = buffer.BeginWrite(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                auto const index = SampleRingBuffer::Index(sequence + i);
+                buffer.Left()[index] = static_cast<float>(value);
+                buffer.Right()[index] = -static_cast<float>(value);
+                value = (value + 1) % RampPeriod;
+            }
+            buffer.CommitWrite(count);
+
+            // Vary chunk sizes to hit all wrap-around cases.
+            count = count % SampleRingBuffer::MaxWriteSamples + 37;
+        }
+    });
+
+    for (int read = 0; read < 20000; read++)
+    {
+        auto const previousLeft = left;
+        if (!buffer.ReadLatest(left.data(), right.data(), AudioBufferSamples, 0, newSamples))
+        {
+            // Failed reads must keep the previous snapshot.
+            ASSERT_EQ(left, previousLeft);
+            ASSERT_EQ(newSamples, 0);
+        }
+
+        ASSERT_TRUE(IsContiguousRamp(left.data(), AudioBufferSamples, 1.0f));
+        for (size_t i = 0; i < AudioBufferSamples; i++)
+        {
+            ASSERT_EQ(left[i], -right[i]);
+        }
+    }
+
+    done = true;
+    producer.join();
+}
+
+TEST(projectMPCM, ConcurrentAddAndUpdate)
+{
+    PCM pcm;
+    std::atomic<bool> done{false};
+
+    std::vector<float> samples(2 * 733);
+    uint32_t value{};
+    auto addSamples = [&pcm, &samples, &value]() {
+        for (size_t i = 0; i < samples.size(); i += 2)
+        {
+            samples[i] = static_cast<float>(value);
+            samples[i + 1] = static_cast<float>(value);
+            value = (value + 1) % RampPeriod;
+        }
+        pcm.Add(samples.data(), 2, samples.size() / 2);
+    };
+
+    // Fill the buffer once before the first frame is rendered.
+    addSamples();
+
+    // The application's audio thread, calling projectm_pcm_add_float().
+    std::thread audioThread([&addSamples, &done]() {
+        while (!done.load(std::memory_order_relaxed))
+        {
+            addSamples();
+        }
+    });
+
+    // The render thread, calling projectm_opengl_render_frame().
+    for (uint32_t frame = 0; frame < 2000; frame++)
+    {
+        pcm.UpdateFrameAudioData(1.0 / 60.0, frame);
+        auto const& audioData = pcm.GetFrameAudioData();
+
+        // Waveform alignment only shifts the window, so it must still be a contiguous ramp.
+        ASSERT_TRUE(IsContiguousRamp(audioData.waveformLeft.data(), WaveformSamples, 128.0f));
+        ASSERT_TRUE(IsContiguousRamp(audioData.waveformRight.data(), WaveformSamples, 128.0f));
+    }
+
+    done = true;
+    audioThread.join();
+}
+
+TEST(projectMPCM, FrameAudioDataIsShared)
+{
+    PCM pcm;
+
+    std::vector<float> samples(2 * AudioBufferSamples, 0.5f);
+    pcm.Add(samples.data(), 2, AudioBufferSamples);
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 0);
+
+    // All consumers in a frame get the same instance.
+    auto const& audioData = pcm.GetFrameAudioData();
+    EXPECT_EQ(&audioData, &pcm.GetFrameAudioData());
+    EXPECT_FLOAT_EQ(audioData.waveformLeft[0], 64.0f);
+
+    // The data is updated in place on the next frame.
+    std::fill(samples.begin(), samples.end(), -0.5f);
+    pcm.Add(samples.data(), 2, AudioBufferSamples);
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 1);
+    EXPECT_FLOAT_EQ(audioData.waveformLeft[0], -64.0f);
+}
+
+TEST(projectMPCM, PresentationLatency)
+{
+    PCM pcm;
+
+    // 1000 samples per second, the first half of the samples is negative, the second half positive.
+    // The sample played back right now is number 2000.
+    double const start = PCM::CurrentTime() - 2.0;
+    std::vector<float> samples(2 * 512);
+    for (size_t block = 0; block < 16; block++)
+    {
+        std::fill(samples.begin(), samples.end(), block < 8 ? -0.5f : 0.5f);
+        pcm.Add(samples.data(), 2, 512, start + static_cast<double>(block) * 0.512);
+    }
+
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 0);
+    EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformLeft[0], -64.0f);
+    EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformLeft[WaveformSamples - 1], -64.0f);
+
+    // Displayed four seconds later, around sample 6000.
+    pcm.SetPresentationLatency(4.0);
+    EXPECT_DOUBLE_EQ(pcm.PresentationLatency(), 4.0);
+
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 1);
+    EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformLeft[0], 64.0f);
+    EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformLeft[WaveformSamples - 1], 64.0f);
+}
+
+TEST(projectMPCM, AudioSourceCallback)
+{
+    struct Source
+    {
+        float value{};
+        uint32_t offered{};
+        uint32_t calls{};
+    } source;
+
+    auto const callback = [](float* left, float* right, uint32_t maxSamples, void* userData) -> uint32_t {
+        auto& data = *static_cast<Source*>(userData);
+        data.offered += maxSamples;
+        data.calls++;
+
+        // Deliver slightly more than one analysis window per frame.
+        uint32_t const count = std::min<uint32_t>(maxSamples, 600);
+        std::fill_n(left, count, data.value);
+        std::fill_n(right, count, -data.value);
+        return count;
+    };
+
+    PCM pcm;
+    pcm.SetAudioSource(callback, &source);
+
+    for (uint32_t frame = 0; frame < 40; frame++)
+    {
+        source.value = frame % 2 == 0 ? 0.5f : 0.25f;
+        pcm.UpdateFrameAudioData(1.0 / 60.0, frame);
+
+        EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformLeft[0], source.value * 128.0f);
+        EXPECT_FLOAT_EQ(pcm.GetFrameAudioData().waveformRight[WaveformSamples - 1], -source.value * 128.0f);
+    }
+
+    // The callback is called a second time when the offered span ends at the ring buffer end.
+    EXPECT_GT(source.calls, 40u);
+    EXPECT_LE(source.offered, 40 * SampleRingBuffer::MaxWriteSamples);
+
+    // Without a callback, the previously added samples stay in place.
+    pcm.SetAudioSource(nullptr, nullptr);
+    auto const calls = source.calls;
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 40);
+    EXPECT_EQ(source.calls, calls);
+}
+
+TEST(projectMPCM, AudioConfigurations)
+{
+    // The FFT calculates twice the number of spectrum samples, so the sine ends up in bin 2 * SpectrumSamples / 32.
+    EXPECT_EQ(SinePeakBin<DefaultAudioConfig>(), 32);
+    EXPECT_EQ(SinePeakBin<LowLatencyAudioConfig>(), 16);
+    EXPECT_EQ(SinePeakBin<HighResolutionAudioConfig>(), 64);
+}
+
+TEST(projectMTripleBuffer, ConsumerSeesLatestPublished)
+{
+    TripleBuffer<int> buffer;
+    buffer.Reset(-1);
+
+    EXPECT_FALSE(buffer.Update());
+    EXPECT_EQ(buffer.ReadBuffer(), -1);
+
+    buffer.WriteBuffer() = 1;
+    buffer.Publish();
+    buffer.WriteBuffer() = 2;
+    buffer.Publish();
+
+    // Only the latest published value is picked up.
+    EXPECT_TRUE(buffer.Update());
+    EXPECT_EQ(buffer.ReadBuffer(), 2);
+    EXPECT_FALSE(buffer.Update());
+    EXPECT_EQ(buffer.ReadBuffer(), 2);
+
+    buffer.WriteBuffer() = 3;
+    buffer.Publish();
+    EXPECT_TRUE(buffer.Update());
+    EXPECT_EQ(buffer.ReadBuffer(), 3);
+}
+
+TEST(projectMTripleBuffer, ConcurrentReadsAreNotTorn)
+{
+    using Data = std::array<uint32_t, 256>;
+
+    TripleBuffer<Data> buffer;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&buffer, &done]() {
+        uint32_t value{};
+        while (!done.load(std::memory_order_relaxed))
+        {
+            buffer.WriteBuffer().fill(++value);
+            buffer.Publish();
+        }
+    });
+
+    uint32_t previousValue{};
+    for (int read = 0; read < 20000; read++)
+    {
+        buffer.Update();
+        auto const& data = buffer.ReadBuffer();
+
+        ASSERT_TRUE(std::all_of(data.begin(), data.end(), [&data](uint32_t value) { return value == data[0]; }));
+        ASSERT_GE(data[0], previousValue);
+        previousValue = data[0];
+    }
+
+    done = true;
+    producer.join();
+}
+
+TEST(projectMPCM, BackgroundAnalysis)
+{
+    PCM pcm;
+    std::atomic<bool> done{false};
+
+    std::vector<float> samples(2 * 733);
+    uint32_t value{};
+    auto addSamples = [&pcm, &samples, &value]() {
+        for (size_t i = 0; i < samples.size(); i += 2)
+        {
+            samples[i] = static_cast<float>(value);
+            samples[i + 1] = static_cast<float>(value);
+            value = (value + 1) % RampPeriod;
+        }
+        pcm.Add(samples.data(), 2, samples.size() / 2);
+    };
+
+    addSamples();
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 0);
+
+    ASSERT_TRUE(pcm.SetBackgroundAnalysis(true, 200));
+    EXPECT_TRUE(pcm.BackgroundAnalysis());
+
+    // The last synchronous result is kept until the analysis thread publishes new data.
+    auto const firstFrame = pcm.GetFrameAudioData();
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 1);
+    EXPECT_TRUE(IsContiguousRamp(pcm.GetFrameAudioData().waveformLeft.data(), WaveformSamples, 128.0f));
+
+    std::thread audioThread([&addSamples, &done]() {
+        while (!done.load(std::memory_order_relaxed))
+        {
+            addSamples();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // Wait until the analysis thread has published new waveform data.
+    bool changed{false};
+    for (uint32_t frame = 2; frame < 1000 && !changed; frame++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        pcm.UpdateFrameAudioData(1.0 / 60.0, frame);
+        auto const& audioData = pcm.GetFrameAudioData();
+
+        ASSERT_TRUE(IsContiguousRamp(audioData.waveformLeft.data(), WaveformSamples, 128.0f));
+        ASSERT_TRUE(IsContiguousRamp(audioData.waveformRight.data(), WaveformSamples, 128.0f));
+        changed = audioData.waveformLeft != firstFrame.waveformLeft;
+    }
+    EXPECT_TRUE(changed);
+
+    done = true;
+    audioThread.join();
+
+    EXPECT_FALSE(pcm.SetBackgroundAnalysis(false));
+    EXPECT_FALSE(pcm.BackgroundAnalysis());
+
+    // Synchronous analysis continues after disabling the thread.
+    addSamples();
+    pcm.UpdateFrameAudioData(1.0 / 60.0, 1000);
+    EXPECT_TRUE(IsContiguousRamp(pcm.GetFrameAudioData().waveformLeft.data(), WaveformSamples, 128.0f));
+}
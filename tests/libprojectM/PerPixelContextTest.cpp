@@ -0,0 +1,138 @@
+#include "MilkdropPreset/PerFrameContext.hpp"
+#include "MilkdropPreset/PerPixelContext.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using libprojectM::MilkdropPreset::PerFrameContext;
+using libprojectM::MilkdropPreset::PerPixelContext;
+
+namespace {
+
+constexpr size_t VertexCount = 4 * PerPixelContext::BlockSize + 17;
+
+/**
+ * @brief Evaluates per-pixel code for a fixed set of vertices, split into bands like PerPixelMesh does.
+ */
+class BandedEvaluation
+{
+public:
+    BandedEvaluation(const std::string& code, size_t bandCount)
+        : m_gmegabuf(projectm_eval_memory_buffer_create())
+        , m_perFrameContext(m_gmegabuf, &m_globalRegisters)
+        , m_perPixelContext(m_gmegabuf, &m_globalRegisters)
+    {
+        m_perFrameContext.RegisterBuiltinVariables();
+        m_perPixelContext.RegisterBuiltinVariables();
+        m_perPixelContext.CompilePerPixelCode(code);
+
+        for (size_t vertex = 0; vertex < VertexCount; vertex++)
+        {
+            m_x.push_back(static_cast<float>(vertex % 17) / 16.0f);
+            m_y.push_back(static_cast<float>(vertex / 17) / 16.0f);
+            m_rad.push_back(static_cast<float>(vertex) / VertexCount);
+            m_ang.push_back(static_cast<float>(vertex) * 0.01f);
+        }
+
+        // Code which can't be split is evaluated by the preset's context only.
+        if (!m_perPixelContext.SupportsMultithreading())
+        {
+            bandCount = 1;
+        }
+
+        m_zoom.resize(VertexCount);
+        for (size_t band = 0; band < bandCount; band++)
+        {
+            std::unique_ptr<PerPixelContext> clone;
+            if (band > 0)
+            {
+                clone = m_perPixelContext.Clone();
+            }
+            Evaluate(band == 0 ? m_perPixelContext : *clone, VertexCount * band / bandCount, VertexCount * (band + 1) / bandCount);
+        }
+    }
+
+    ~BandedEvaluation()
+    {
+        projectm_eval_memory_buffer_destroy(m_gmegabuf);
+    }
+
+    auto SupportsMultithreading() const -> bool
+    {
+        return m_perPixelContext.SupportsMultithreading();
+    }
+
+    auto Zoom() const -> const std::vector<float>&
+    {
+        return m_zoom;
+    }
+
+private:
+    void Evaluate(PerPixelContext& context, size_t begin, size_t end)
+    {
+        PerPixelContext::VertexBlock block;
+        for (size_t first = begin; first < end; first += PerPixelContext::BlockSize)
+        {
+            block.count = std::min(PerPixelContext::BlockSize, end - first);
+            block.x = m_x.data() + first;
+            block.y = m_y.data() + first;
+            block.rad = m_rad.data() + first;
+            block.ang = m_ang.data() + first;
+
+            context.ExecutePerPixelCode(m_perFrameContext, block);
+
+            std::copy(block.zoom.begin(), block.zoom.begin() + block.count, m_zoom.begin() + first);
+        }
+    }
+
+    PRJM_EVAL_F m_globalRegisters[100]{};
+    projectm_eval_mem_buffer m_gmegabuf{};
+    PerFrameContext m_perFrameContext;
+    PerPixelContext m_perPixelContext;
+
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_rad;
+    std::vector<float> m_ang;
+    std::vector<float> m_zoom;
+};
+
+} // namespace
+
+TEST(projectMPerPixelContext, BandedEvaluationMatchesSingleThreaded)
+{
+    const std::vector<std::string> codes{
+        // Only vertex inputs and motion variables.
+        "zoom = zoom + x * 0.1 + sin(ang) * y; rot = rad;",
+        // Temporary variables defined before being read.
+        "t = x * y; zoom = 1 + t * t;",
+        // Counters and values carried from the previous vertex.
+        "n = n + 1; zoom = 1 + n * 0.001;",
+        "zoom = 1 + last; last = x;",
+        "total += rad; zoom = total;",
+        "assign(n, n + 1); zoom = 1 + n * 0.001;",
+    };
+
+    for (const auto& code : codes)
+    {
+        BandedEvaluation singleThreaded(code, 1);
+        BandedEvaluation banded(code, 4);
+
+        EXPECT_EQ(singleThreaded.Zoom(), banded.Zoom()) << code;
+    }
+}
+
+TEST(projectMPerPixelContext, CarriedVariablesDisableMultithreading)
+{
+    EXPECT_TRUE(BandedEvaluation("zoom = zoom + x * 0.1 + sin(ang) * y;", 1).SupportsMultithreading());
+    EXPECT_TRUE(BandedEvaluation("t = x * y; zoom = 1 + t * t;", 1).SupportsMultithreading());
+    EXPECT_FALSE(BandedEvaluation("n = n + 1; zoom = 1 + n * 0.001;", 1).SupportsMultithreading());
+    EXPECT_FALSE(BandedEvaluation("zoom = 1 + last; last = x;", 1).SupportsMultithreading());
+    EXPECT_FALSE(BandedEvaluation("total += rad; zoom = total;", 1).SupportsMultithreading());
+    EXPECT_FALSE(BandedEvaluation("assign(n, n + 1); zoom = 1 + n * 0.001;", 1).SupportsMultithreading());
+    EXPECT_FALSE(BandedEvaluation("zoom = megabuf(0); megabuf(0) = x;", 1).SupportsMultithreading());
+}
@@ -0,0 +1,88 @@
+#include "MilkdropPreset/StageProfiler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using libprojectM::Preset;
+using libprojectM::MilkdropPreset::StageProfiler;
+
+TEST(projectMStageProfiler, EmptyBeforeFirstFrame)
+{
+    StageProfiler profiler;
+
+    auto const stats = profiler.Stats();
+    EXPECT_EQ(stats.averageFrames, 0);
+    for (size_t stage = 0; stage < StageProfiler::StageCount; stage++)
+    {
+        EXPECT_EQ(stats.lastFrame[stage], 0.0);
+        EXPECT_EQ(stats.average[stage], 0.0);
+    }
+}
+
+TEST(projectMStageProfiler, LastFrameAndRollingAverage)
+{
+    StageProfiler profiler;
+
+    // Stages called more than once per frame are summed up.
+    profiler.Add(Preset::FrameStats::CustomShapeDraw, 1.0);
+    profiler.Add(Preset::FrameStats::CustomShapeDraw, 2.0);
+    profiler.EndFrame();
+
+    auto stats = profiler.Stats();
+    EXPECT_EQ(stats.averageFrames, 1);
+    EXPECT_DOUBLE_EQ(stats.lastFrame[Preset::FrameStats::CustomShapeDraw], 3.0);
+    EXPECT_DOUBLE_EQ(stats.average[Preset::FrameStats::CustomShapeDraw], 3.0);
+    EXPECT_EQ(stats.lastFrame[Preset::FrameStats::BlurUpdate], 0.0);
+
+    profiler.Add(Preset::FrameStats::CustomShapeDraw, 1.0);
+    profiler.EndFrame();
+
+    stats = profiler.Stats();
+    EXPECT_EQ(stats.averageFrames, 2);
+    EXPECT_DOUBLE_EQ(stats.lastFrame[Preset::FrameStats::CustomShapeDraw], 1.0);
+    EXPECT_DOUBLE_EQ(stats.average[Preset::FrameStats::CustomShapeDraw], 2.0);
+
+    // Only the last frames are averaged.
+    for (size_t frame = 0; frame < StageProfiler::AverageFrames; frame++)
+    {
+        profiler.Add(Preset::FrameStats::CustomShapeDraw, 4.0);
+        profiler.EndFrame();
+    }
+
+    stats = profiler.Stats();
+    EXPECT_EQ(stats.averageFrames, StageProfiler::AverageFrames);
+    EXPECT_DOUBLE_EQ(stats.average[Preset::FrameStats::CustomShapeDraw], 4.0);
+}
+
+TEST(projectMStageProfiler, ScopedTimers)
+{
+    StageProfiler profiler;
+
+    // Without a frame scope, there's no current profiler and timers don't record anything.
+    EXPECT_EQ(StageProfiler::Current(), nullptr);
+    {
+        StageProfiler::StageTimer timer(Preset::FrameStats::BlurUpdate);
+    }
+
+    {
+        StageProfiler::FrameScope frame(profiler);
+        EXPECT_EQ(StageProfiler::Current(), &profiler);
+
+        StageProfiler::StageTimer timer(Preset::FrameStats::PerFrameUpdate);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        // Other threads don't see the profiler.
+        std::thread([]() {
+            EXPECT_EQ(StageProfiler::Current(), nullptr);
+        }).join();
+    }
+
+    EXPECT_EQ(StageProfiler::Current(), nullptr);
+
+    auto const stats = profiler.Stats();
+    EXPECT_EQ(stats.averageFrames, 1);
+    EXPECT_GE(stats.lastFrame[Preset::FrameStats::PerFrameUpdate], 2.0);
+    EXPECT_GE(stats.lastFrame[Preset::FrameStats::RenderFrame], stats.lastFrame[Preset::FrameStats::PerFrameUpdate]);
+    EXPECT_EQ(stats.lastFrame[Preset::FrameStats::BlurUpdate], 0.0);
+}
@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <random>
+
 using namespace libprojectM::Audio;
 
 /**
@@ -16,12 +18,13 @@ private:
      * stick to the original structure as much as possible.
      */
     FRIEND_TEST(projectMWaveformAligner, AlignDelta);
+    FRIEND_TEST(projectMWaveformAligner, VectorizedMatchesScalar);
 };
 
 TEST(projectMWaveformAligner, AlignDelta)
 {
     auto aligner = WaveformAlignerMock();
-    ASSERT_EQ(aligner.m_octaves, 6);
+    ASSERT_EQ(WaveformAligner::Octaves, 6u);
 
     std::array<float, AudioBufferSamples> wf;
     std::fill(wf.begin(), wf.end(), 0.0f);
@@ -34,7 +37,7 @@ TEST(projectMWaveformAligner, AlignDelta)
     EXPECT_FLOAT_EQ(wf[AudioBufferSamples/2], 1.0f);
 
     // Verify weights
-    for (uint32_t octave=0; octave < aligner.m_octaves; octave++)
+    for (uint32_t octave=0; octave < WaveformAligner::Octaves; octave++)
     {
         size_t const compareSamples = aligner.m_octaveSamples[octave] - aligner.m_octaveSampleSpacing[octave];
         // Non-zero range should be (0.32, 0.68)*compareSamples based on
@@ -54,7 +57,7 @@ TEST(projectMWaveformAligner, AlignDelta)
     {
         wf[AudioBufferSamples/2 + i] = 1.0f;
 
-        std::vector<WaveformBuffer> newWaveformMips(aligner.m_octaves, WaveformBuffer());
+        WaveformAligner::WaveformMips newWaveformMips{};
         aligner.ResampleOctaves(newWaveformMips, wf);
         int alignOffset = aligner.CalculateOffset(newWaveformMips);
         if (i < 0 || i >= static_cast<int>(aligner.m_octaveSampleSpacing[0]))
@@ -83,3 +86,66 @@ TEST(projectMWaveformAligner, AlignDelta)
         wf[AudioBufferSamples/2] = 0.0f;
     }
 }
+
+TEST(projectMWaveformAligner, VectorizedMatchesScalar)
+{
+    if (!WaveformAligner::HasVectorizedOffsetSearch())
+    {
+        GTEST_SKIP() << "No vectorized implementation in this build.";
+    }
+
+    auto aligner = WaveformAlignerMock();
+    std::mt19937 random(2342);
+    std::uniform_real_distribution<float> sampleDistribution(-128.0f, 128.0f);
+    std::uniform_int_distribution<int> shiftDistribution(0, AudioBufferSamples - WaveformSamples - 1);
+    std::uniform_real_distribution<float> noiseDistribution(-8.0f, 8.0f);
+
+    WaveformBuffer oldWaveform;
+    for (auto& sample : oldWaveform)
+    {
+        sample = sampleDistribution(random);
+    }
+
+    // First call generates the weights and the old waveform mips.
+    aligner.Align(oldWaveform);
+
+    WaveformAligner::WaveformMips newWaveformMips{};
+    for (int run = 0; run < 500; run++)
+    {
+        // Shifted and noisy copies of the previous waveform give a wide range of offsets,
+        // pure noise tests offsets with similar errors.
+        WaveformBuffer newWaveform{};
+        int const shift = shiftDistribution(random);
+        for (size_t i = 0; i < AudioBufferSamples; i++)
+        {
+            if (run % 4 == 0)
+            {
+                newWaveform[i] = sampleDistribution(random);
+            }
+            else if (i >= static_cast<size_t>(shift))
+            {
+                newWaveform[i] = oldWaveform[i - shift] + noiseDistribution(random);
+            }
+        }
+
+        aligner.ResampleOctaves(newWaveformMips, newWaveform);
+        int const expectedOffset = aligner.CalculateOffsetScalar(newWaveformMips);
+        EXPECT_EQ(aligner.CalculateOffsetVectorized(newWaveformMips), expectedOffset) << "Run " << run;
+
+        // Check each octave's search separately, including all offset ranges which do not
+        // occur in the regular search.
+        for (uint32_t octave = 0; octave < WaveformAligner::Octaves; octave++)
+        {
+            int const spacing = static_cast<int>(aligner.m_octaveSampleSpacing[octave]);
+            int const offsetStart = std::uniform_int_distribution<int>(0, spacing - 1)(random);
+            int const offsetEnd = std::uniform_int_distribution<int>(offsetStart + 1, spacing)(random);
+
+            EXPECT_EQ(aligner.LowestErrorOffsetVectorized(newWaveformMips[octave], octave, offsetStart, offsetEnd),
+                      aligner.LowestErrorOffsetScalar(newWaveformMips[octave], octave, offsetStart, offsetEnd))
+                << "Run " << run << ", octave " << octave << ", offsets " << offsetStart << " to " << offsetEnd;
+        }
+
+        aligner.Align(newWaveform);
+        oldWaveform = newWaveform;
+    }
+}
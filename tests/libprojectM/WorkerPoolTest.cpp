@@ -0,0 +1,52 @@
+#include "MilkdropPreset/WorkerPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+using libprojectM::MilkdropPreset::WorkerPool;
+
+TEST(projectMWorkerPool, RunsEachTaskOnce)
+{
+    WorkerPool pool(4);
+    EXPECT_EQ(pool.ThreadCount(), 4);
+
+    for (size_t count : {size_t{0}, size_t{1}, size_t{3}, size_t{4}, size_t{100}})
+    {
+        std::vector<std::atomic<int>> runs(count);
+        for (int batch = 0; batch < 20; batch++)
+        {
+            pool.Run(count, [&runs](size_t index) {
+                runs[index]++;
+            });
+        }
+
+        for (size_t index = 0; index < count; index++)
+        {
+            EXPECT_EQ(runs[index], 20) << "Task " << index << " of " << count;
+        }
+    }
+}
+
+TEST(projectMWorkerPool, SingleThreadRunsInline)
+{
+    WorkerPool pool(1);
+    EXPECT_EQ(pool.ThreadCount(), 1);
+
+    std::vector<size_t> order;
+    pool.Run(5, [&order](size_t index) {
+        order.push_back(index);
+    });
+
+    EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(projectMWorkerPool, SharedPool)
+{
+    auto pool = WorkerPool::Get();
+    ASSERT_TRUE(pool);
+    EXPECT_EQ(pool, WorkerPool::Get());
+    EXPECT_GE(pool->ThreadCount(), 1);
+    EXPECT_LE(pool->ThreadCount(), WorkerPool::MaxThreads);
+}